@@ -0,0 +1,200 @@
+// AHB-Lite pressure threshold comparator (ahb_alarm.sv)
+// This module compares every raw pressure latched by the ahb_bmp_i2c
+// sequencer against a programmable window and raises an interrupt when the
+// pressure leaves it, so the processor does not have to look at every sample
+// to notice an altitude (or, with a window around the current pressure, a
+// rate of climb) limit being crossed.
+//
+// The thresholds are raw sensor values. Whether raw pressure rises or falls
+// with pressure depends on the sensor calibration, the firmware converts its
+// altitude limits into raw values (and converts them again when the
+// temperature changes, see BMP390_uncompensate_pressure_terms() in
+// bmp390_comp.h) and orders them into the lower and upper threshold.
+//
+// Number of addressable locations : 5
+// Size of each addressable location : 32 bits
+// Supported transfer sizes : Word
+// Alignment of base address : Word aligned
+//
+// Address map :
+//   Base addess + 0 :
+//     Read/Write
+//     Bits 23~0: Lower threshold (raw pressure)
+//   Base addess + 4 :
+//     Read/Write
+//     Bits 23~0: Upper threshold (raw pressure)
+//   Base addess + 8 :
+//     Read/Write
+//     Control register
+//       Bit 0: Enable, samples are only compared while set
+//       Bit 1: Interrupt enable, IRQ is raised while an alarm flag is set
+//       Bit 7~4: N, an alarm needs N + 1 consecutive samples outside the
+//                window (filters out single noisy samples)
+//   Base addess + 12 :
+//     Read only
+//     Status register
+//       Bit 0: Below, flagged when the pressure fell below the lower threshold
+//       Bit 1: Above, flagged when the pressure rose above the upper threshold
+//       (both are reset when status is read)
+//   Base addess + 16 :
+//     Read only
+//     Bits 23~0: Last raw pressure compared
+
+module ahb_alarm(
+
+  // AHB Global Signals
+  input HCLK,
+  input HRESETn,
+
+  // AHB Signals from Master to Slave
+  input [31:0] HADDR,
+  input [31:0] HWDATA,
+  input [2:0] HSIZE,
+  input [1:0] HTRANS,
+  input HWRITE,
+  input HREADY,
+  input HSEL,
+
+  // AHB Signals from Slave to Master
+  output logic [31:0] HRDATA,
+  output HREADYOUT,
+
+  // Non-AHB Signals
+  input [23:0] Pressure,   // from ahb_bmp_i2c
+  input NewSample,
+  output IRQ
+
+);
+
+timeunit 1ns;
+timeprecision 100ps;
+
+  // AHB transfer codes needed in this module
+  localparam No_Transfer = 2'b0;
+
+  // value of the BMP390 data registers before the first conversion has completed
+  localparam DATA_RESET = 24'h80_0000;
+
+  // Register addresses
+  localparam LOWER_REG = 3'd0;
+  localparam UPPER_REG = 3'd1;
+  localparam CONTROL_REG = 3'd2;
+  localparam STATUS_REG = 3'd3;
+  localparam PRESSURE_REG = 3'd4;
+
+  logic write_enable, read_enable;
+  logic [2:0] word_address;
+
+  // programmer's model registers
+  logic [23:0] lower, upper, last_pressure;
+  logic enable, irq_enable;
+  logic [3:0] filter;
+  logic below, above;
+
+  logic [3:0] outside_count;
+  logic compare, outside_low, outside_high;
+
+  // AHB address decoding and control
+  always_ff @(posedge HCLK, negedge HRESETn)
+  if(!HRESETn)
+    begin
+      write_enable <= '0;
+      read_enable <= '0;
+      word_address <= '0;
+    end
+  else
+    if (HREADY && HSEL && (HTRANS != No_Transfer))
+      begin
+        write_enable <= HWRITE;
+        read_enable <= !HWRITE;
+        word_address <= HADDR[4:2];
+      end
+    else
+      begin
+        write_enable <= '0;
+        read_enable <= '0;
+        word_address <= '0;
+      end
+
+  //AHB read operation
+  always_comb
+  if(!read_enable)
+    HRDATA = '0;
+  else
+    case (word_address)
+      LOWER_REG:    HRDATA = {8'b0, lower};
+      UPPER_REG:    HRDATA = {8'b0, upper};
+      CONTROL_REG:  HRDATA = {24'b0, filter, 2'b0, irq_enable, enable};
+      STATUS_REG:   HRDATA = {30'b0, above, below};
+      PRESSURE_REG: HRDATA = {8'b0, last_pressure};
+      default:      HRDATA = 32'b0;
+    endcase
+
+  // AHB write operation
+  always_ff @(posedge HCLK, negedge HRESETn)
+  if(!HRESETn)
+    begin
+      lower <= '0;
+      upper <= '1;
+      enable <= '0;
+      irq_enable <= '0;
+      filter <= '0;
+    end
+  else if(write_enable)
+    case (word_address)
+      LOWER_REG:    lower <= HWDATA[23:0];
+      UPPER_REG:    upper <= HWDATA[23:0];
+      CONTROL_REG:  begin
+                      enable <= HWDATA[0];
+                      irq_enable <= HWDATA[1];
+                      filter <= HWDATA[7:4];
+                    end
+      default: ;
+    endcase
+
+  // compare each new sample (the reset value of the data registers is not a reading)
+  assign compare = enable && NewSample && (Pressure != DATA_RESET);
+  assign outside_low = (Pressure < lower);
+  assign outside_high = (Pressure > upper);
+
+  always_ff @(posedge HCLK, negedge HRESETn)
+  if(!HRESETn)
+    begin
+      outside_count <= '0;
+      last_pressure <= '0;
+    end
+  else if(!enable)
+    outside_count <= '0;
+  else if(compare)
+    begin
+      last_pressure <= Pressure;
+      if(!outside_low && !outside_high)
+        outside_count <= '0;
+      else if(outside_count != filter)
+        outside_count <= outside_count + 1;
+    end
+
+  // alarm flags, reset when the status register is read
+  always_ff @(posedge HCLK, negedge HRESETn)
+  if(!HRESETn)
+    begin
+      below <= '0;
+      above <= '0;
+    end
+  else if(compare && (outside_count == filter) && (outside_low || outside_high))
+    begin
+      below <= below || outside_low;
+      above <= above || outside_high;
+    end
+  else if(read_enable && (word_address == STATUS_REG))
+    begin
+      below <= '0;
+      above <= '0;
+    end
+
+  assign IRQ = irq_enable && (below || above);
+
+  //Transfer Response
+  assign HREADYOUT = '1; //Single cycle Write & Read. Zero Wait state operations
+
+endmodule
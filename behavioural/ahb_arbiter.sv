@@ -0,0 +1,178 @@
+// AHB-Lite arbiter for two masters (ahb_arbiter.sv)
+//
+// Master 0 is the Cortex-M0 which, as an AHB-Lite master, has no bus request
+// signal and expects to own the bus at all times.
+// Master 1 is the DMA controller which requests the bus with HBUSREQ_DMA and
+// may only start a transfer when HGRANT_DMA is set.
+//
+// While the DMA is granted the bus, any transfer started by the processor is
+// accepted by the arbiter and held in a register (the processor sees a normal
+// address phase followed by a data phase with wait states). The held transfer
+// is issued on the shared bus as soon as the processor is granted the bus again.
+//
+// When both masters want the bus the grant alternates between them after
+// every transfer, when only one master wants the bus it keeps the grant.
+//
+// HRESP is only passed to the master which owns the data phase, so an ERROR
+// response to a DMA transfer is never seen by the processor (or vice versa).
+
+module ahb_arbiter(
+
+  // AHB Global Signals
+  input HCLK,
+  input HRESETn,
+
+  // Master 0 (processor)
+  input [31:0] HADDR_M0,
+  input [31:0] HWDATA_M0,
+  input [1:0] HTRANS_M0,
+  input [2:0] HSIZE_M0,
+  input [2:0] HBURST_M0,
+  input [3:0] HPROT_M0,
+  input HWRITE_M0,
+  output logic HREADY_M0,
+  output logic HRESP_M0,
+
+  // Master 1 (DMA)
+  input [31:0] HADDR_DMA,
+  input [31:0] HWDATA_DMA,
+  input [1:0] HTRANS_DMA,
+  input [2:0] HSIZE_DMA,
+  input HWRITE_DMA,
+  input HBUSREQ_DMA,
+  output logic HGRANT_DMA,
+  output logic HRESP_DMA,
+
+  // Shared bus to interconnect and slaves
+  output logic [31:0] HADDR,
+  output logic [31:0] HWDATA,
+  output logic [1:0] HTRANS,
+  output logic [2:0] HSIZE,
+  output logic [2:0] HBURST,
+  output logic [3:0] HPROT,
+  output logic HWRITE,
+  input HREADY,
+  input HRESP
+
+);
+
+timeunit 1ns;
+timeprecision 100ps;
+
+  // AHB transfer codes needed in this module
+  localparam No_Transfer = 2'b00;
+  localparam Non_Sequential = 2'b10;
+
+  // processor transfer held while the DMA is granted the bus
+  logic hold_valid;
+  logic [31:0] hold_addr;
+  logic [2:0] hold_size, hold_burst;
+  logic [3:0] hold_prot;
+  logic hold_write;
+  logic hold_capture;
+
+  // owner of the transfer currently in the bus data phase
+  logic m0_data_phase, dma_data_phase;
+
+  // address phase multiplexer
+  always_comb
+    if ( HGRANT_DMA )
+      begin
+        HADDR = HADDR_DMA;
+        HTRANS = HTRANS_DMA;
+        HWRITE = HWRITE_DMA;
+        HSIZE = HSIZE_DMA;
+        HBURST = 3'b000;      // single transfers only
+        HPROT = 4'b0011;      // non-cacheable, non-bufferable, privileged data access
+      end
+    else if ( hold_valid )
+      begin
+        HADDR = hold_addr;
+        HTRANS = Non_Sequential;
+        HWRITE = hold_write;
+        HSIZE = hold_size;
+        HBURST = hold_burst;
+        HPROT = hold_prot;
+      end
+    else
+      begin
+        HADDR = HADDR_M0;
+        HTRANS = HTRANS_M0;
+        HWRITE = HWRITE_M0;
+        HSIZE = HSIZE_M0;
+        HBURST = HBURST_M0;
+        HPROT = HPROT_M0;
+      end
+
+  // write data follows the owner of the data phase
+  assign HWDATA = ( dma_data_phase ) ? HWDATA_DMA : HWDATA_M0;
+
+  // ready signal to the processor
+  //  - a held transfer has not been issued yet so the processor must wait
+  //  - a processor transfer in the data phase completes with the bus
+  //  - otherwise a new processor transfer is accepted immediately when the
+  //    DMA has the bus (it is held) or with the bus when the processor has it
+  always_comb
+    if ( hold_valid )
+      HREADY_M0 = 0;
+    else if ( m0_data_phase )
+      HREADY_M0 = HREADY;
+    else if ( HGRANT_DMA )
+      HREADY_M0 = 1;
+    else
+      HREADY_M0 = HREADY;
+
+  // response follows the owner of the data phase
+  assign HRESP_M0 = m0_data_phase && HRESP;
+  assign HRESP_DMA = dma_data_phase && HRESP;
+
+  assign hold_capture = HREADY_M0 && HGRANT_DMA && ( HTRANS_M0 != No_Transfer );
+
+  // hold the processor transfer until the processor is granted the bus
+  always_ff @(posedge HCLK, negedge HRESETn)
+    if ( ! HRESETn )
+      begin
+        hold_valid <= '0;
+        hold_addr <= '0;
+        hold_size <= '0;
+        hold_burst <= '0;
+        hold_prot <= '0;
+        hold_write <= '0;
+      end
+    else if ( hold_capture )
+      begin
+        hold_valid <= 1;
+        hold_addr <= HADDR_M0;
+        hold_size <= HSIZE_M0;
+        hold_burst <= HBURST_M0;
+        hold_prot <= HPROT_M0;
+        hold_write <= HWRITE_M0;
+      end
+    else if ( hold_valid && HREADY && ! HGRANT_DMA )
+      hold_valid <= 0;   // held transfer has been accepted by the bus
+
+  // track which master owns the data phase
+  always_ff @(posedge HCLK, negedge HRESETn)
+    if ( ! HRESETn )
+      begin
+        m0_data_phase <= '0;
+        dma_data_phase <= '0;
+      end
+    else if ( HREADY )
+      begin
+        m0_data_phase <= ! HGRANT_DMA && ( HTRANS != No_Transfer );
+        dma_data_phase <= HGRANT_DMA && ( HTRANS != No_Transfer );
+      end
+
+  // grant changes only at the end of an address phase
+  always_ff @(posedge HCLK, negedge HRESETn)
+    if ( ! HRESETn )
+      HGRANT_DMA <= '0;
+    else if ( HREADY )
+      if ( HGRANT_DMA )
+        // hand the bus back to the processor if it has anything to do
+        HGRANT_DMA <= HBUSREQ_DMA && ! ( hold_valid || hold_capture || ( HTRANS_M0 != No_Transfer ) );
+      else
+        HGRANT_DMA <= HBUSREQ_DMA;
+
+endmodule
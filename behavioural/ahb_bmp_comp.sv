@@ -0,0 +1,512 @@
+// AHB-Lite BMP390 compensation pipeline (ahb_bmp_comp.sv)
+// This module computes the compensated temperature (t_lin) and pressure from
+// the raw BMP390 readings in hardware, giving bit-exact results with the
+// firmware compensation code (software/code/bmp390_comp.h).
+//
+// The calculation is run as a short microcode program on a resource shared
+// datapath: eight 64-bit working registers, one 64-bit adder (shared by all
+// operations), one shifter and a sequential shift-add multiplier which stops
+// as soon as the remaining multiplier bits are zero. A division by 10 is done
+// bit serially. The pressure terms that depend only on t_lin (offset,
+// sensitivity and the p9/p10 term) are kept between calculations, so a new
+// pressure with an unchanged temperature only runs the last part of the
+// calculation. Temperature (with the t_lin terms) takes ~160 clock cycles and
+// pressure ~210 clock cycles, during which the processor is free to do other work.
+//
+// Number of addressable locations : 13
+// Size of each addressable location : 32 bits
+// Supported transfer sizes : Word
+// Alignment of base address : Word aligned
+//
+// Address map :
+//   + 0 ~ + 20 :
+//     Read/Write
+//     Calibration registers, BMP390 registers 0x31~0x45 in order with
+//     register 0x31 in bits 7~0 of + 0 (bits 31~8 of + 20 are unused)
+//   + 24 :
+//     Read/Write
+//     Bits 23~0: raw temperature
+//   + 28 :
+//     Read/Write
+//     Bits 23~0: raw pressure
+//   + 32 :
+//     Write only
+//     Control register
+//       Bit 0: Start temperature compensation (updates t_lin and the t_lin terms)
+//       Bit 1: Start pressure compensation (uses the t_lin terms, after the
+//              temperature if bit 0 is also set)
+//       Bit 2: Update the t_lin terms only (after t_lin has been written)
+//   + 36 :
+//     Read only
+//     Status register
+//       Bit 0: Busy, flagged while a calculation is running
+//   + 40 :
+//     Read/Write
+//     t_lin (fits in 32 bits), may be written to restore a previous result
+//     (followed by control bit 2)
+//   + 44 :
+//     Read only
+//     Compensated temperature (t_lin >> 16)
+//   + 48 :
+//     Read only
+//     Compensated pressure (Pa)
+//
+// Registers must not be written while the pipeline is busy.
+
+module ahb_bmp_comp(
+
+  // AHB Global Signals
+  input HCLK,
+  input HRESETn,
+
+  // AHB Signals from Master to Slave
+  input [31:0] HADDR,
+  input [31:0] HWDATA,
+  input [2:0] HSIZE,
+  input [1:0] HTRANS,
+  input HWRITE,
+  input HREADY,
+  input HSEL,
+
+  // AHB Signals from Slave to Master
+  output logic [31:0] HRDATA,
+  output HREADYOUT
+
+);
+
+timeunit 1ns;
+timeprecision 100ps;
+
+  // AHB transfer codes needed in this module
+  localparam No_Transfer = 2'b0;
+
+  // Register addresses
+  localparam CALIB_LAST_REG = 4'b0101;
+  localparam UNCOMP_TEMP_REG = 4'b0110;
+  localparam UNCOMP_PRESS_REG = 4'b0111;
+  localparam CONTROL_REG = 4'b1000;
+  localparam STATUS_REG = 4'b1001;
+  localparam T_LIN_REG = 4'b1010;
+  localparam TEMPERATURE_REG = 4'b1011;
+  localparam PRESSURE_REG = 4'b1100;
+
+  // Microcode operations
+  localparam OP_MUL = 3'd0;    // dst = (a * b) post-shifted, b must fit in 32 bits
+  localparam OP_ADD = 3'd1;    // dst = (a + b) post-shifted
+  localparam OP_SUB = 3'd2;    // dst = (a - b) post-shifted
+  localparam OP_SHIFT = 3'd3;  // dst = a post-shifted
+  localparam OP_DIV10 = 3'd4;  // dst = a / 10 (rounded towards zero)
+
+  // Microcode operand sources (0~7 are the working registers)
+  localparam R_TLIN = 4'd0;
+  localparam R_PD1 = 4'd1;
+  localparam R_PD3 = 4'd2;
+  localparam R_OFF = 4'd3;
+  localparam R_SENS = 4'd4;
+  localparam R_RES = 4'd5;
+  localparam R_X = 4'd6;
+  localparam R_Y = 4'd7;
+  localparam S_PRESS = 4'd8;   // raw pressure
+  localparam S_TEMP = 4'd9;    // raw temperature
+  localparam S_COEF = 4'd10;   // coefficient selected by the coef field
+
+  // Microcode coefficients (sign or zero extended to 64 bits)
+  localparam C_T1 = 4'd0;      // t1 << 8
+  localparam C_T2 = 4'd1;
+  localparam C_T3 = 4'd2;
+  localparam C_P1 = 4'd3;      // p1 - 16384
+  localparam C_P2 = 4'd4;      // p2 - 16384
+  localparam C_P3 = 4'd5;
+  localparam C_P4 = 4'd6;
+  localparam C_P5 = 4'd7;
+  localparam C_P6 = 4'd8;
+  localparam C_P7 = 4'd9;
+  localparam C_P8 = 4'd10;
+  localparam C_P9 = 4'd11;
+  localparam C_P10 = 4'd12;
+  localparam C_P11 = 4'd13;
+  localparam C_TEN = 4'd14;    // 10
+
+  // Microcode program start addresses
+  localparam TEMP_START = 6'd0;
+  localparam TERMS_START = 6'd8;
+  localparam PRESS_START = 6'd28;
+
+  typedef struct packed {
+    logic [2:0] op;
+    logic [2:0] dst;
+    logic [3:0] src_a;
+    logic [3:0] src_b;
+    logic [3:0] coef;
+    logic shift_left;     // post-shift direction (right shifts are arithmetic)
+    logic [5:0] shift;    // post-shift distance
+    logic last;           // last operation of the program
+  } micro_op;
+
+  function automatic micro_op uop(input logic [2:0] op, input logic [3:0] dst, input logic [3:0] src_a,
+                                  input logic [3:0] src_b, input logic [3:0] coef,
+                                  input logic shift_left, input logic [5:0] shift, input logic last);
+    uop = '{op, dst[2:0], src_a, src_b, coef, shift_left, shift, last};
+  endfunction
+
+  // Microcode programs, following BMP390_compensate_temperature,
+  // BMP390_pressure_terms and BMP390_compensate_pressure_terms step by step
+  // (all arithmetic modulo 2^64)
+  function automatic micro_op microcode(input logic [5:0] pc);
+    case (pc)
+      // temperature
+      6'd0:  microcode = uop(OP_SUB,   R_PD1,  S_TEMP,  S_COEF,  C_T1,  0,  0, 0);  // pd1 = raw - t1 << 8
+      6'd1:  microcode = uop(OP_MUL,   R_X,    R_PD1,   S_COEF,  C_T2,  0,  0, 0);  // pd2 = t2 * pd1
+      6'd2:  microcode = uop(OP_MUL,   R_Y,    R_PD1,   R_PD1,   0,     0,  0, 0);  // pd3 = pd1 * pd1
+      6'd3:  microcode = uop(OP_MUL,   R_Y,    R_Y,     S_COEF,  C_T3,  0,  0, 0);  // pd4 = pd3 * t3
+      6'd4:  microcode = uop(OP_SHIFT, R_X,    R_X,     0,       0,     1, 18, 0);
+      6'd5:  microcode = uop(OP_ADD,   R_X,    R_X,     R_Y,     0,     0,  0, 0);  // pd5 = pd2 << 18 + pd4
+      6'd6:  microcode = uop(OP_SHIFT, R_TLIN, R_X,     0,       0,     0, 32, 1);  // t_lin = pd5 >> 32
+      // t_lin terms, offset
+      6'd8:  microcode = uop(OP_MUL,   R_PD1,  R_TLIN,  R_TLIN,  0,     0,  0, 0);  // pd1 = t_lin * t_lin
+      6'd9:  microcode = uop(OP_SHIFT, R_X,    R_PD1,   0,       0,     0,  6, 0);  // pd2 = pd1 >> 6
+      6'd10: microcode = uop(OP_MUL,   R_PD3,  R_X,     R_TLIN,  0,     0,  8, 0);  // pd3 = (pd2 * t_lin) >> 8
+      6'd11: microcode = uop(OP_MUL,   R_OFF,  R_PD3,   S_COEF,  C_P8,  0,  5, 0);  // (p8 * pd3) >> 5
+      6'd12: microcode = uop(OP_MUL,   R_X,    R_PD1,   S_COEF,  C_P7,  1,  4, 0);  // (p7 * pd1) << 4
+      6'd13: microcode = uop(OP_ADD,   R_OFF,  R_OFF,   R_X,     0,     0,  0, 0);
+      6'd14: microcode = uop(OP_MUL,   R_X,    R_TLIN,  S_COEF,  C_P6,  1, 22, 0);  // (p6 * t_lin) << 22
+      6'd15: microcode = uop(OP_ADD,   R_OFF,  R_OFF,   R_X,     0,     0,  0, 0);
+      6'd16: microcode = uop(OP_SHIFT, R_X,    S_COEF,  0,       C_P5,  1, 47, 0);  // p5 << 47
+      6'd17: microcode = uop(OP_ADD,   R_OFF,  R_OFF,   R_X,     0,     0,  2, 0);  // offset >> 2
+      // t_lin terms, sensitivity
+      6'd18: microcode = uop(OP_MUL,   R_SENS, R_PD3,   S_COEF,  C_P4,  0,  5, 0);  // (p4 * pd3) >> 5
+      6'd19: microcode = uop(OP_MUL,   R_X,    R_PD1,   S_COEF,  C_P3,  1,  2, 0);  // (p3 * pd1) << 2
+      6'd20: microcode = uop(OP_ADD,   R_SENS, R_SENS,  R_X,     0,     0,  0, 0);
+      6'd21: microcode = uop(OP_MUL,   R_X,    R_TLIN,  S_COEF,  C_P2,  1, 21, 0);  // ((p2 - 16384) * t_lin) << 21
+      6'd22: microcode = uop(OP_ADD,   R_SENS, R_SENS,  R_X,     0,     0,  0, 0);
+      6'd23: microcode = uop(OP_SHIFT, R_X,    S_COEF,  0,       C_P1,  1, 46, 0);  // (p1 - 16384) << 46
+      6'd24: microcode = uop(OP_ADD,   R_SENS, R_SENS,  R_X,     0,     0, 24, 0);  // sensitivity >> 24
+      // t_lin terms, p9/p10
+      6'd25: microcode = uop(OP_MUL,   R_PD3,  R_TLIN,  S_COEF,  C_P10, 0,  0, 0);  // p10 * t_lin
+      6'd26: microcode = uop(OP_SHIFT, R_Y,    S_COEF,  0,       C_P9,  1, 16, 0);  // p9 << 16
+      6'd27: microcode = uop(OP_ADD,   R_PD3,  R_PD3,   R_Y,     0,     0,  0, 1);
+      // pressure
+      6'd28: microcode = uop(OP_MUL,   R_RES,  R_SENS,  S_PRESS, 0,     0,  0, 0);  // sensitivity * raw
+      6'd29: microcode = uop(OP_MUL,   R_X,    R_PD3,   S_PRESS, 0,     0, 13, 0);  // (p9/p10 term * raw) >> 13
+      6'd30: microcode = uop(OP_DIV10, R_X,    R_X,     0,       0,     0,  0, 0);
+      6'd31: microcode = uop(OP_MUL,   R_X,    R_X,     S_PRESS, 0,     0,  9, 0);  // ((pd4 / 10) * raw) >> 9
+      6'd32: microcode = uop(OP_MUL,   R_X,    R_X,     S_COEF,  C_TEN, 0,  0, 0);  // pd5 * 10
+      6'd33: microcode = uop(OP_ADD,   R_RES,  R_RES,   R_X,     0,     0,  0, 0);
+      6'd34: microcode = uop(OP_MUL,   R_Y,    S_PRESS, S_PRESS, 0,     0,  0, 0);  // pd6 = raw * raw
+      6'd35: microcode = uop(OP_MUL,   R_Y,    R_Y,     S_COEF,  C_P11, 0, 16, 0);  // (p11 * pd6) >> 16
+      6'd36: microcode = uop(OP_MUL,   R_Y,    R_Y,     S_PRESS, 0,     0,  7, 0);  // (pd2 * raw) >> 7
+      6'd37: microcode = uop(OP_ADD,   R_RES,  R_RES,   R_Y,     0,     0,  0, 0);
+      6'd38: microcode = uop(OP_ADD,   R_RES,  R_RES,   R_OFF,   0,     0,  0, 1);  // + offset
+      default: microcode = uop(OP_SHIFT, R_X,  R_X,     0,       0,     0,  0, 1);
+    endcase
+  endfunction
+
+  logic write_enable, read_enable;
+  logic [3:0] word_address;
+
+  // programmer's model registers
+  logic [7:0] calib [0:23];
+  logic [23:0] uncomp_temp, uncomp_press;
+
+  // calibration coefficients
+  logic [15:0] t1, t2, p5, p6;
+  logic signed [15:0] p1, p2, p9;
+  logic signed [7:0] t3, p3, p4, p7, p8, p10, p11;
+
+  // datapath
+  enum logic [2:0] {IDLE, EXEC, MUL_ITER, DIV_ITER, DIV_DONE} comp_state;
+  logic [5:0] pc;
+  logic terms_pending, press_pending;
+  micro_op instr;
+  logic [63:0] work [0:7];
+  logic [63:0] coef_value, operand_a, operand_b;
+  logic [63:0] add_a, add_b, add_sum;
+  logic add_cin;
+  logic [63:0] shift_in, shift_out;
+  logic [63:0] mul_a, mul_acc;
+  logic [31:0] mul_b;
+  logic [63:0] div_q;
+  logic [3:0] div_rem;
+  logic [4:0] div_trial;
+  logic [5:0] div_count;
+  logic div_neg;
+  logic op_complete;
+  logic [63:0] op_result;
+
+  // AHB address decoding and control
+  always_ff @(posedge HCLK, negedge HRESETn)
+  if(!HRESETn)
+    begin
+      write_enable <= '0;
+      read_enable <= '0;
+      word_address <= '0;
+    end
+  else
+    if (HREADY && HSEL && (HTRANS != No_Transfer))
+      begin
+        write_enable <= HWRITE;
+        read_enable <= !HWRITE;
+        word_address <= HADDR[5:2];
+      end
+    else
+      begin
+        write_enable <= '0;
+        read_enable <= '0;
+        word_address <= '0;
+      end
+
+  //AHB read operation
+  always_comb
+  if(!read_enable)
+    HRDATA = '0;
+  else if(word_address <= CALIB_LAST_REG)
+    HRDATA = {calib[4 * word_address + 3], calib[4 * word_address + 2], calib[4 * word_address + 1], calib[4 * word_address]};
+  else
+    case (word_address)
+      UNCOMP_TEMP_REG:  HRDATA = {8'b0, uncomp_temp};
+      UNCOMP_PRESS_REG: HRDATA = {8'b0, uncomp_press};
+      STATUS_REG:       HRDATA = {31'b0, (comp_state != IDLE)};
+      T_LIN_REG:        HRDATA = work[R_TLIN][31:0];
+      TEMPERATURE_REG:  HRDATA = work[R_TLIN][47:16];
+      PRESSURE_REG:     HRDATA = {10'b0, work[R_RES][63:42]};
+      default:          HRDATA = 32'b0;
+    endcase
+
+  // Transfer Response - Single Cycle Operation (No Wait States)
+  assign HREADYOUT = '1;
+
+  // calibration coefficients
+  assign t1 = {calib[1], calib[0]};
+  assign t2 = {calib[3], calib[2]};
+  assign t3 = calib[4];
+  assign p1 = {calib[6], calib[5]};
+  assign p2 = {calib[8], calib[7]};
+  assign p3 = calib[9];
+  assign p4 = calib[10];
+  assign p5 = {calib[12], calib[11]};
+  assign p6 = {calib[14], calib[13]};
+  assign p7 = calib[15];
+  assign p8 = calib[16];
+  assign p9 = {calib[18], calib[17]};
+  assign p10 = calib[19];
+  assign p11 = calib[20];
+
+  assign instr = microcode(pc);
+
+  always_comb
+    case (instr.coef)
+      C_T1:    coef_value = {40'b0, t1, 8'b0};
+      C_T2:    coef_value = {48'b0, t2};
+      C_T3:    coef_value = 64'(t3);
+      C_P1:    coef_value = 64'(p1) - 64'd16384;
+      C_P2:    coef_value = 64'(p2) - 64'd16384;
+      C_P3:    coef_value = 64'(p3);
+      C_P4:    coef_value = 64'(p4);
+      C_P5:    coef_value = {48'b0, p5};
+      C_P6:    coef_value = {48'b0, p6};
+      C_P7:    coef_value = 64'(p7);
+      C_P8:    coef_value = 64'(p8);
+      C_P9:    coef_value = 64'(p9);
+      C_P10:   coef_value = 64'(p10);
+      C_P11:   coef_value = 64'(p11);
+      default: coef_value = 64'd10;
+    endcase
+
+  // operand selection
+  function automatic logic [63:0] source(input logic [3:0] src);
+    case (src)
+      S_PRESS: source = {40'b0, uncomp_press};
+      S_TEMP:  source = {40'b0, uncomp_temp};
+      S_COEF:  source = coef_value;
+      default: source = work[src[2:0]];
+    endcase
+  endfunction
+
+  always_comb
+  begin
+    operand_a = source(instr.src_a);
+    operand_b = source(instr.src_b);
+  end
+
+  // the only 64-bit adder, shared by all operations
+  //  EXEC add/sub : a + b, a + ~b + 1
+  //  EXEC mul/div : ~a + 1 (negate a when b or a is negative)
+  //  MUL_ITER     : partial product accumulation
+  //  DIV_DONE     : ~q + 1 (negate the quotient)
+  always_comb
+  begin
+    add_a = operand_a;
+    add_b = operand_b;
+    add_cin = 0;
+    case (comp_state)
+      EXEC:     case (instr.op)
+                  OP_SUB:   begin add_b = ~operand_b; add_cin = 1; end
+                  OP_MUL,
+                  OP_DIV10: begin add_a = ~operand_a; add_b = '0; add_cin = 1; end
+                  default:  ;
+                endcase
+      MUL_ITER: begin add_a = mul_acc; add_b = mul_a; end
+      DIV_DONE: begin add_a = ~div_q; add_b = '0; add_cin = 1; end
+      default:  ;
+    endcase
+  end
+
+  assign add_sum = add_a + add_b + add_cin;
+
+  // post-shifter
+  always_comb
+  begin
+    case (comp_state)
+      MUL_ITER: shift_in = mul_acc;
+      default:  shift_in = ( instr.op == OP_SHIFT ) ? operand_a : add_sum;
+    endcase
+    if (instr.shift_left)
+      shift_out = shift_in << instr.shift;
+    else
+      shift_out = $signed(shift_in) >>> instr.shift;
+  end
+
+  // operation complete, result ready to be written back
+  always_comb
+    case (comp_state)
+      EXEC:     op_complete = ( instr.op != OP_MUL ) && ( instr.op != OP_DIV10 );
+      MUL_ITER: op_complete = ( mul_b == 0 );
+      DIV_DONE: op_complete = 1;
+      default:  op_complete = 0;
+    endcase
+
+  assign op_result = ( comp_state == DIV_DONE ) ? ( ( div_neg ) ? add_sum : div_q ) : shift_out;
+
+  // restoring division step
+  assign div_trial = {div_rem, div_q[63]};
+
+  always_ff @(posedge HCLK, negedge HRESETn)
+  if(!HRESETn)
+    begin
+      for (int i = 0; i < 24; i++)
+        calib[i] <= '0;
+      uncomp_temp <= '0;
+      uncomp_press <= '0;
+      comp_state <= IDLE;
+      pc <= '0;
+      terms_pending <= '0;
+      press_pending <= '0;
+      for (int i = 0; i < 8; i++)
+        work[i] <= '0;
+      mul_a <= '0;
+      mul_b <= '0;
+      mul_acc <= '0;
+      div_q <= '0;
+      div_rem <= '0;
+      div_count <= '0;
+      div_neg <= '0;
+    end
+  else
+    begin
+
+      case(comp_state)
+        EXEC:     case(instr.op)
+                    OP_MUL:   begin
+                                // multiply by the magnitude of b, negating a instead
+                                mul_a <= ( operand_b[63] ) ? add_sum : operand_a;
+                                mul_b <= ( operand_b[63] ) ? -operand_b[31:0] : operand_b[31:0];
+                                mul_acc <= '0;
+                                comp_state <= MUL_ITER;
+                              end
+                    OP_DIV10: begin
+                                // divide the magnitude of a, negating the quotient afterwards
+                                div_neg <= operand_a[63];
+                                div_q <= ( operand_a[63] ) ? add_sum : operand_a;
+                                div_rem <= '0;
+                                div_count <= '0;
+                                comp_state <= DIV_ITER;
+                              end
+                    default:  ;
+                  endcase
+        MUL_ITER: if(mul_b != 0)
+                    begin
+                      if(mul_b[0])
+                        mul_acc <= add_sum;
+                      mul_a <= mul_a << 1;
+                      mul_b <= mul_b >> 1;
+                    end
+        DIV_ITER: begin
+                    if(div_trial >= 10)
+                      begin
+                        div_rem <= 4'(div_trial - 10);
+                        div_q <= {div_q[62:0], 1'b1};
+                      end
+                    else
+                      begin
+                        div_rem <= div_trial[3:0];
+                        div_q <= {div_q[62:0], 1'b0};
+                      end
+                    div_count <= div_count + 1;
+                    if(div_count == 63)
+                      comp_state <= DIV_DONE;
+                  end
+        default:  ;
+      endcase
+
+      // write back and move on to the next operation
+      if(op_complete)
+        begin
+          work[instr.dst] <= op_result;
+          if(!instr.last)
+            begin
+              pc <= pc + 1;
+              comp_state <= EXEC;
+            end
+          else if(terms_pending)
+            begin
+              pc <= TERMS_START;
+              terms_pending <= 0;
+              comp_state <= EXEC;
+            end
+          else if(press_pending)
+            begin
+              pc <= PRESS_START;
+              press_pending <= 0;
+              comp_state <= EXEC;
+            end
+          else
+            comp_state <= IDLE;
+        end
+
+      // AHB slave accesses
+      if(write_enable)
+        if(word_address <= CALIB_LAST_REG)
+          for (int i = 0; i < 4; i++)
+            calib[4 * word_address + i] <= HWDATA[8 * i +: 8];
+        else
+          case(word_address)
+            UNCOMP_TEMP_REG:  uncomp_temp <= HWDATA[23:0];
+            UNCOMP_PRESS_REG: uncomp_press <= HWDATA[23:0];
+            T_LIN_REG:        work[R_TLIN] <= 64'($signed(HWDATA));
+            CONTROL_REG:      if(HWDATA[0])
+                                begin
+                                  pc <= TEMP_START;
+                                  terms_pending <= 1;
+                                  press_pending <= HWDATA[1];
+                                  comp_state <= EXEC;
+                                end
+                              else if(HWDATA[2])
+                                begin
+                                  pc <= TERMS_START;
+                                  terms_pending <= 0;
+                                  press_pending <= HWDATA[1];
+                                  comp_state <= EXEC;
+                                end
+                              else if(HWDATA[1])
+                                begin
+                                  pc <= PRESS_START;
+                                  terms_pending <= 0;
+                                  press_pending <= 0;
+                                  comp_state <= EXEC;
+                                end
+            default: ;
+          endcase
+
+    end
+
+endmodule
@@ -1,7 +1,14 @@
-// AHB-Lite custom interface for I2C interface (ahb_i2c.sv)
-// This module interfaces with the simple i2c sensor module
+// AHB-Lite I2C interface for the BMP390 pressure sensor (ahb_bmp_i2c.sv)
+// This module is an I2C master with, besides single transfers started by
+// the master, three engines which work without the processor:
+//   a sequencer which reads the BMP390 pressure (and every so often the
+//   temperature) registers at a fixed period and latches the results,
+//   an accumulator which sums groups of 2^N raw pressures from the sequencer,
+//   a command queue which runs up to 8 register reads and writes (the
+//   sensor setup and calibration read) as one I2C sequence
+// (ahb_simple_i2c is the interface for the simple sensor)
 //
-// Number of addressable locations : 5
+// Number of addressable locations : 29
 // Size of each addressable location : 32 bits
 // Supported transfer sizes : Word
 // Alignment of base address : Word aligned
@@ -30,6 +37,60 @@
 //     Status register
 //       Bit 0: DataValid bit, flagged after a read operation is completed and while data is valid, reset when new I2C transfer is started
 //       Bit 1: Busy bit, flagged while the interface is not idle
+//       Bit 2: SampleReady bit, flagged when the sequencer latches a new sample, reset when Base address + 36 is read
+//       Bit 3: AccReady bit, flagged when the sequencer has summed 2^N pressure samples, reset when Base address + 44 is read
+//   Base addess + 28 :
+//     Read/Write
+//     Sequencer control register
+//       Bit 0: Auto enable, the sequencer reads registers 0x04~0x09 (pressure and temperature)
+//              every SEQ_PERIOD clock cycles without the master
+//       Bit 1: Interrupt enable, IRQ is raised while SampleReady is set (N = 0)
+//              or while AccReady is set (N > 0)
+//       Bit 4~2: N, raw pressure samples are summed in groups of 2^N (1 ~ 128)
+//       Bit 15~8: T, temperature interval, registers 0x07~0x09 (temperature) are only read
+//                 with one in every T + 1 sequencer reads, the others read 0x04~0x06 (pressure),
+//                 every read includes them until the temperature is other than 0x800000
+//   Base addess + 32 :
+//     Read/Write
+//     Sequencer period register
+//       Bit 23~0: number of HCLK cycles between the start of two sequencer reads
+//   Base addess + 36 :
+//     Read only
+//     Latched raw pressure
+//       Bit 23~0: raw pressure, Bit 31~24: sequence number
+//   Base addess + 40 :
+//     Read only
+//     Latched raw temperature
+//       Bit 23~0: raw temperature, Bit 31~24: sequence number of the read it was latched by
+//   Base addess + 44 :
+//     Read only
+//     Accumulated raw pressure (accumulate and dump decimation)
+//       Bit 30~0: sum of the last 2^N raw pressure samples, samples still at
+//                 the reset value 0x800000 (no conversion yet) are skipped
+//   Base addess + 48 :
+//     Read/Write
+//     Command queue control register
+//       Bit 0: Start (write), the queue runs entries 0 ~ last as one I2C sequence with a
+//              repeated start between entries, then stops. Busy (read) while waiting or running
+//       Bit 3~1: last, index of the last entry to run
+//       Bit 4: Interrupt enable, IRQ is raised while Done is set
+//       Bit 5: Done (read only), flagged when the queue has finished, reset when this register is read
+//       Bit 6: Error (read only), an entry was not acknowledged by its device and the queue was abandoned
+//       Bit 10~8: index of the entry being run (or that failed) (read only)
+//   Base addess + 64 ~ + 92 :
+//     Read/Write
+//     Command queue entries 0 ~ 7
+//       Bit 6~0: device address
+//       Bit 7: R/W bit, set high for a read, low for a write
+//       Bit 15~8: register address (writes go to consecutive registers, one register/data pair per byte)
+//       Bit 18~16: number of bytes - 1 (1 ~ 8 bytes)
+//       Bit 23~19: buffer slot, offset of the first byte in the command queue buffer
+//   Base addess + 96 ~ + 124 :
+//     Read/Write
+//     Command queue buffer, 32 bytes of write data and read data for the entries
+//
+//   The master should not start its own transfers while the sequencer or the queue is enabled.
+//   The queue takes priority over the sequencer, a sequencer read never starts between entries.
 
 module ahb_bmp_i2c(
   // AHB Global Signals
@@ -52,7 +113,11 @@ module ahb_bmp_i2c(
   //Non-AHB Signals
   output logic SCL,
   output logic SDA_out,
-  input SDA_in
+  input SDA_in,
+  output logic DataValid,  // read data valid (DMA trigger)
+  output IRQ,              // new sequencer sample or command queue done
+  output [23:0] Pressure,  // latched raw pressure of the last sequencer read
+  output logic NewSample   // flagged for one cycle when Pressure is updated
 );
 
 timeunit 1ns;
@@ -62,16 +127,30 @@ timeprecision 100ps;
   localparam No_Transfer = 2'b0;
 
   // Register addresses
-  localparam DEVICE_ADDR_REG = 3'b000;
-  localparam REG_ADDR_REG = 3'b001;
-  localparam READ_DATA_LOW_REG = 3'b010;
-  localparam READ_DATA_HIGH_REG = 3'b011;
-  localparam WRITE_DATA_REG = 3'b100;
-  localparam CONTROL_REG = 3'b101;
-  localparam STATUS_REG = 3'b110;
+  localparam DEVICE_ADDR_REG = 5'b00000;
+  localparam REG_ADDR_REG = 5'b00001;
+  localparam READ_DATA_LOW_REG = 5'b00010;
+  localparam READ_DATA_HIGH_REG = 5'b00011;
+  localparam WRITE_DATA_REG = 5'b00100;
+  localparam CONTROL_REG = 5'b00101;
+  localparam STATUS_REG = 5'b00110;
+  localparam SEQ_CTRL_REG = 5'b00111;
+  localparam SEQ_PERIOD_REG = 5'b01000;
+  localparam SEQ_PRESS_REG = 5'b01001;
+  localparam SEQ_TEMP_REG = 5'b01010;
+  localparam SEQ_ACC_REG = 5'b01011;
+  localparam QUEUE_CTRL_REG = 5'b01100;
+  localparam QUEUE_ENTRY_REGS = 2'b10;    // + 64 ~ + 92, word_address[4:3]
+  localparam QUEUE_BUFFER_REGS = 2'b11;   // + 96 ~ + 124, word_address[4:3]
+
+  // BMP390 pressure and temperature data registers read by the sequencer
+  localparam SEQ_DATA_ADDR = 8'h04;
+  localparam SEQ_NBYTES = 3'd5;    // 6 bytes (nbytes - 1)
+  localparam SEQ_PRESS_NBYTES = 3'd2;    // 3 bytes, pressure only
+  localparam DATA_RESET = 24'h80_0000;  // pressure or temperature before the first conversion
 
   logic write_enable, read_enable;
-  logic [2:0] word_address;
+  logic [4:0] word_address;
   
   // programmer's model registers
   logic [6:0] device_addr;
@@ -79,7 +158,54 @@ timeprecision 100ps;
   logic [7:0] read_data [0:5];
   logic [7:0] write_data [0:3];
   logic [4:0] control_reg;
-  logic [1:0] status_reg;
+  logic [3:0] status_reg;
+  logic [12:0] seq_ctrl;
+  logic [23:0] seq_period;
+  logic [23:0] seq_press, seq_temp;
+  logic [7:0] seq_number, seq_temp_number;
+  logic [30:0] acc_result;
+  logic [23:0] q_entries [0:7];
+  logic [7:0] q_buffer [0:31];
+  logic [2:0] q_last;
+  logic q_irq_enable;
+  
+  // sequencer variables
+  logic [23:0] seq_timer;
+  logic seq_request;
+  logic seq_start;
+  logic seq_active;
+  logic seq_done;
+  logic SampleReady;
+  logic [7:0] seq_temp_interval;
+  logic [7:0] seq_temp_count;
+  logic seq_read_temp;
+
+  // accumulator variables
+  logic [2:0] acc_log2;
+  logic [23:0] acc_sample;
+  logic [30:0] acc_sum;
+  logic [7:0] acc_count;
+  logic acc_dump;
+  logic AccReady;
+
+  // command queue variables
+  logic bus_free;
+  logic q_request;
+  logic q_start;
+  logic q_continue;
+  logic q_active;
+  logic [2:0] q_index;
+  logic [23:0] q_entry;
+  logic [6:0] q_device_addr;
+  logic q_read;
+  logic [7:0] q_reg_addr;
+  logic [2:0] q_nbytes;
+  logic [4:0] q_offset;
+  logic [4:0] q_buffer_index;
+  logic q_entry_end;
+  logic q_restart;
+  logic QueueDone;
+  logic QueueError;
   
   // I2C frame logic variables
   enum logic [2:0] {WRITE_DEVICE_ADDR, WRITE_REG_ADDR, WRITE_DATA, READ_REG_ADDR, READ_DEVICE_ADDR, READ_DATA} control_state;
@@ -93,10 +219,16 @@ timeprecision 100ps;
   logic I2C_read_op;
   logic SDA_start;
   logic [2:0] nbytes;
+  logic [7:0] read_reg_addr;
+  logic [6:0] cur_device_addr;
     
-  assign I2C_read_op = control_reg[0];
-  assign SDA_start = control_reg[1];
-  assign nbytes = {control_reg[4], control_reg[3], control_reg[2]} - 1;
+  // transfers started by the sequencer read SEQ_NBYTES (or SEQ_PRESS_NBYTES) from SEQ_DATA_ADDR,
+  // transfers started by the command queue follow the current queue entry
+  assign I2C_read_op = (seq_active) ? 1'b1 : (q_active) ? q_read : control_reg[0];
+  assign SDA_start = control_reg[1] || seq_start || q_start || q_continue;
+  assign nbytes = (seq_active) ? ( (seq_read_temp) ? SEQ_NBYTES : SEQ_PRESS_NBYTES ) : (q_active) ? q_nbytes : {control_reg[4], control_reg[3], control_reg[2]} - 1;
+  assign read_reg_addr = (seq_active) ? SEQ_DATA_ADDR : (q_active) ? q_reg_addr : reg_addr[0];
+  assign cur_device_addr = (q_active) ? q_device_addr : device_addr;
   
   // SDA, SCL generation variables
   enum logic[4:0] {SETUP, IDLE, START1, START2, DATA1, CLOCK1, DATA2, CLOCK2, END1, END2, RESTART1, RESTART2} gen_state;
@@ -124,7 +256,7 @@ timeprecision 100ps;
       begin
         write_enable <= HWRITE;
         read_enable <= !HWRITE;
-        word_address <= HADDR[4:2];
+        word_address <= HADDR[6:2];
       end
     else 
       begin
@@ -141,6 +273,12 @@ timeprecision 100ps;
       {reg_addr[3], reg_addr[2], reg_addr[1], reg_addr[0]} <= '0;
       {write_data[3], write_data[2], write_data[1], write_data[0]} <= '0;
       control_reg <= '0;
+      seq_ctrl <= '0;
+      seq_period <= '0;
+      q_last <= '0;
+      q_irq_enable <= 0;
+      for (int i = 0; i < 8; i++)
+        q_entries[i] <= '0;
     end
   else if (write_enable) 
     begin
@@ -149,7 +287,11 @@ timeprecision 100ps;
         REG_ADDR_REG:     {reg_addr[3], reg_addr[2], reg_addr[1], reg_addr[0]} <= HWDATA;
         WRITE_DATA_REG:   {write_data[3], write_data[2], write_data[1], write_data[0]} <= HWDATA;
         CONTROL_REG:      control_reg <= HWDATA[4:0];
-        default: ;
+        SEQ_CTRL_REG:     seq_ctrl <= {HWDATA[15:8], HWDATA[4:0]};
+        SEQ_PERIOD_REG:   seq_period <= HWDATA[23:0];
+        QUEUE_CTRL_REG:   {q_irq_enable, q_last} <= HWDATA[4:1];
+        default:          if (word_address[4:3] == QUEUE_ENTRY_REGS)
+                            q_entries[word_address[2:0]] <= HWDATA[23:0];
       endcase
     end
   else if (control_reg[1])
@@ -166,8 +308,20 @@ timeprecision 100ps;
         REG_ADDR_REG:        HRDATA = {reg_addr[3], reg_addr[2], reg_addr[1], reg_addr[0]};
         READ_DATA_LOW_REG:   HRDATA = {read_data[3], read_data[2], read_data[1], read_data[0]};
         READ_DATA_HIGH_REG:  HRDATA = {16'b0, read_data[5], read_data[4]};
-        STATUS_REG:          HRDATA = {30'b0, status_reg};
-        default:             HRDATA = 32'b0;
+        STATUS_REG:          HRDATA = {28'b0, status_reg};
+        SEQ_CTRL_REG:        HRDATA = {16'b0, seq_ctrl[12:5], 3'b0, seq_ctrl[4:0]};
+        SEQ_PERIOD_REG:      HRDATA = {8'b0, seq_period};
+        SEQ_PRESS_REG:       HRDATA = {seq_number, seq_press};
+        SEQ_TEMP_REG:        HRDATA = {seq_temp_number, seq_temp};
+        SEQ_ACC_REG:         HRDATA = {1'b0, acc_result};
+        QUEUE_CTRL_REG:      HRDATA = {21'b0, q_index, 1'b0, QueueError, QueueDone, q_irq_enable, q_last, (q_request || q_active)};
+        default:             if (word_address[4:3] == QUEUE_ENTRY_REGS)
+                               HRDATA = {8'b0, q_entries[word_address[2:0]]};
+                             else if (word_address[4:3] == QUEUE_BUFFER_REGS)
+                               HRDATA = {q_buffer[{word_address[2:0], 2'b11}], q_buffer[{word_address[2:0], 2'b10}],
+                                         q_buffer[{word_address[2:0], 2'b01}], q_buffer[{word_address[2:0], 2'b00}]};
+                             else
+                               HRDATA = 32'b0;
       endcase
     end
   
@@ -228,18 +382,19 @@ timeprecision 100ps;
       WRITE_DEVICE_ADDR:  begin
                             if(!read_ack)
 			      SDA_continue = 0;
-                            I2C_tx_data = {device_addr, 1'b0};
+                            I2C_tx_data = {cur_device_addr, 1'b0};
                           end
       WRITE_REG_ADDR:     begin
-                            I2C_tx_data = reg_addr[byte_counter];
+                            I2C_tx_data = (q_active) ? q_reg_addr + byte_counter : reg_addr[byte_counter];
 			    SDA_continue = 1;
                           end
-      WRITE_DATA:         I2C_tx_data = write_data[byte_counter];
+      WRITE_DATA:         I2C_tx_data = (q_active) ? q_buffer[q_buffer_index] : write_data[byte_counter];
       READ_REG_ADDR:      begin
-                            I2C_tx_data = reg_addr[0];
+                            I2C_tx_data = read_reg_addr;
+			    SDA_continue = 1;     // always followed by a repeated start (even for a single byte)
 			    SDA_restart = 1;
 			  end
-      READ_DEVICE_ADDR:   I2C_tx_data = {device_addr, 1'b1};
+      READ_DEVICE_ADDR:   I2C_tx_data = {cur_device_addr, 1'b1};
       READ_DATA:          I2C_write_flag = 0;
       default: ;
     endcase
@@ -263,7 +418,9 @@ timeprecision 100ps;
 	DATA1:   gen_state <= CLOCK1;
 	CLOCK1:  gen_state <= DATA2;
 	DATA2:   gen_state <= CLOCK2;
-	CLOCK2:  if((SDA_out_counter == 8) && (! SDA_continue))
+	CLOCK2:  if((SDA_out_counter == 8) && (! SDA_continue) && q_restart)
+		   gen_state <= RESTART1;     // next queue entry follows a repeated start
+		 else if((SDA_out_counter == 8) && (! SDA_continue))
 		   gen_state <= END1;
 		 else if((SDA_out_counter == 8) && (SDA_restart))
 		   gen_state <= RESTART1;
@@ -385,7 +542,7 @@ timeprecision 100ps;
       read_data[5] <= '0;
       read_ack <= 0;
     end
-  else if(I2C_read_enable && gen_state == CLOCK1)
+  else if(I2C_read_enable && gen_state == CLOCK1 && (SDA_out_counter == 8 || !q_active))  // queue read data goes to q_buffer
     begin
       case(SDA_out_counter)
       0: read_data[byte_counter][7] <= SDA_in;
@@ -402,15 +559,207 @@ timeprecision 100ps;
     end 
   
   // DataValid status logic
-  logic DataValid;
   always_ff @(negedge HCLK, negedge HRESETn)
   if(! HRESETn)
     DataValid <= 0;
   else
-    if ( byte_counter == nbytes && control_state == READ_DATA  && SDA_out_counter == 8 && gen_state == CLOCK2 )
+    if ( !q_active && byte_counter == nbytes && control_state == READ_DATA  && SDA_out_counter == 8 && gen_state == CLOCK2 )
       DataValid <= 1;
     else if ( SDA_start )
       DataValid <= 0;
   assign status_reg[0] = DataValid;
+  
+  // Sequencer
+  // starts a read of the pressure and temperature registers every seq_period cycles,
+  // a read that is due while the interface is busy starts as soon as it is idle.
+  // Temperature changes slowly, so only one in every seq_temp_interval + 1 reads
+  // includes it, the others read the 3 pressure bytes only (every read includes it
+  // while the temperature still reads DATA_RESET)
+  assign bus_free = (gen_state == IDLE) && (control_state == WRITE_DEVICE_ADDR) && !control_reg[1];
+  assign seq_start = seq_request && bus_free && !q_request && !q_active;
+  assign seq_done = seq_active && byte_counter == nbytes && control_state == READ_DATA  && SDA_out_counter == 8 && gen_state == CLOCK2;
+  
+  always_ff @(posedge HCLK, negedge HRESETn)
+  if(! HRESETn)
+    begin
+      seq_timer <= '0;
+      seq_request <= 0;
+      seq_active <= 0;
+      seq_read_temp <= 0;
+      seq_temp_count <= '0;
+    end
+  else
+    begin
+      if(! seq_ctrl[0])
+        begin
+          seq_timer <= '0;        // first read starts as soon as the sequencer is enabled
+          seq_request <= 0;
+          seq_temp_count <= '0;   // and includes the temperature
+        end
+      else if(seq_timer == 0)
+        begin
+          seq_timer <= seq_period;
+          seq_request <= 1;
+        end
+      else
+        seq_timer <= seq_timer - 1;
+      
+      if(seq_start)
+        begin
+          seq_request <= 0;
+          seq_active <= 1;
+          seq_read_temp <= (seq_temp_count == 0);
+          seq_temp_count <= (seq_temp_count == 0) ? seq_temp_interval : seq_temp_count - 1;
+        end
+      else if(gen_state == END2)   // stop condition, transfer is finished (or was not acknowledged)
+        seq_active <= 0;
+      
+      // until the first temperature conversion has completed every read includes the temperature
+      if(seq_ctrl[0] && seq_done && seq_read_temp && ({read_data[5], read_data[4], read_data[3]} == DATA_RESET))
+        seq_temp_count <= '0;
+    end
+  
+  // latch the result of each completed sequencer read
+  always_ff @(posedge HCLK, negedge HRESETn)
+  if(! HRESETn)
+    begin
+      seq_press <= '0;
+      seq_temp <= '0;
+      seq_number <= '0;
+      seq_temp_number <= '0;
+      SampleReady <= 0;
+      NewSample <= 0;
+    end
+  else
+    begin
+      NewSample <= seq_done;
+      if(seq_done)
+        begin
+          seq_press <= {read_data[2], read_data[1], read_data[0]};
+          if(seq_read_temp)
+            begin
+              seq_temp <= {read_data[5], read_data[4], read_data[3]};
+              seq_temp_number <= seq_number + 1;
+            end
+          seq_number <= seq_number + 1;
+          SampleReady <= 1;
+        end
+      else if(read_enable && word_address == SEQ_PRESS_REG)
+        SampleReady <= 0;
+    end
+  assign status_reg[2] = SampleReady;
+  assign Pressure = seq_press;
+  assign seq_temp_interval = seq_ctrl[12:5];
+  
+  
+  // accumulate and dump decimation of the raw pressure
+  // sums 2^N samples, then presents the sum (a lower noise pressure with N
+  // extra bits of resolution) and starts again from zero
+  assign acc_log2 = seq_ctrl[4:2];
+  assign acc_sample = {read_data[2], read_data[1], read_data[0]};
+  assign acc_dump = seq_ctrl[0] && seq_done && (acc_sample != DATA_RESET) && (acc_count >= (8'd1 << acc_log2) - 1);
+  
+  always_ff @(posedge HCLK, negedge HRESETn)
+  if(! HRESETn)
+    begin
+      acc_sum <= '0;
+      acc_count <= '0;
+      acc_result <= '0;
+      AccReady <= 0;
+    end
+  else
+    begin
+      if(! seq_ctrl[0])
+        begin
+          acc_sum <= '0;          // start a new sum when the sequencer is enabled again
+          acc_count <= '0;
+        end
+      else if(acc_dump)
+        begin
+          acc_result <= acc_sum + acc_sample;
+          acc_sum <= '0;
+          acc_count <= '0;
+        end
+      else if(seq_done && (acc_sample != DATA_RESET))
+        begin
+          acc_sum <= acc_sum + acc_sample;
+          acc_count <= acc_count + 1;
+        end
+      
+      if(acc_dump)
+        AccReady <= 1;
+      else if(read_enable && word_address == SEQ_ACC_REG)
+        AccReady <= 0;
+    end
+  assign status_reg[3] = AccReady;
+  
+  
+  // Command queue
+  // runs entries 0 ~ q_last back to back, the bus is only released (stop
+  // condition) after the last entry or when a device does not acknowledge
+  assign q_entry = q_entries[q_index];
+  assign q_device_addr = q_entry[6:0];
+  assign q_read = q_entry[7];
+  assign q_reg_addr = q_entry[15:8];
+  assign q_nbytes = q_entry[18:16];
+  assign q_offset = q_entry[23:19];
+  assign q_buffer_index = q_offset + byte_counter;
+  
+  assign q_start = q_request && bus_free && !q_active;
+  assign q_continue = q_active && bus_free;      // after the repeated start between entries
+  assign q_entry_end = (SDA_out_counter == 8) && (gen_state == CLOCK2) && (byte_counter == nbytes) &&
+                       ((control_state == WRITE_DATA) || (control_state == READ_DATA));
+  assign q_restart = q_active && q_entry_end && (q_index != q_last);
+  
+  always_ff @(posedge HCLK, negedge HRESETn)
+  if(! HRESETn)
+    begin
+      q_request <= 0;
+      q_active <= 0;
+      q_index <= '0;
+      QueueDone <= 0;
+      QueueError <= 0;
+    end
+  else
+    begin
+      if(write_enable && word_address == QUEUE_CTRL_REG && HWDATA[0])
+        begin
+          q_request <= 1;
+          QueueDone <= 0;
+          QueueError <= 0;
+        end
+      else if(q_start)
+        begin
+          q_request <= 0;
+          q_active <= 1;
+          q_index <= '0;
+        end
+      else if(q_active && gen_state == END2)   // stop condition, queue finished or abandoned
+        begin
+          q_active <= 0;
+          QueueDone <= 1;
+        end
+      else if(q_restart)
+        q_index <= q_index + 1;
+      else if(read_enable && word_address == QUEUE_CTRL_REG)
+        QueueDone <= 0;
+      
+      // device address not acknowledged (the transfer stops)
+      if(q_active && control_state == WRITE_DEVICE_ADDR && SDA_out_counter == 8 && gen_state == CLOCK2 && !read_ack)
+        QueueError <= 1;
+    end
+  
+  // command queue buffer, written by the master and by queue read entries
+  always_ff @(posedge HCLK, negedge HRESETn)
+  if(! HRESETn)
+    for (int i = 0; i < 32; i++)
+      q_buffer[i] <= '0;
+  else if(write_enable && word_address[4:3] == QUEUE_BUFFER_REGS)
+    {q_buffer[{word_address[2:0], 2'b11}], q_buffer[{word_address[2:0], 2'b10}],
+     q_buffer[{word_address[2:0], 2'b01}], q_buffer[{word_address[2:0], 2'b00}]} <= HWDATA;
+  else if(q_active && I2C_read_enable && gen_state == CLOCK1 && SDA_out_counter < 8)
+    q_buffer[q_buffer_index][7 - SDA_out_counter] <= SDA_in;
+  
+  assign IRQ = ( seq_ctrl[1] && ( (acc_log2 == 0) ? SampleReady : AccReady ) ) || ( q_irq_enable && QueueDone );
 
 endmodule
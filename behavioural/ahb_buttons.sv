@@ -2,27 +2,47 @@
 //  Iain McNally
 //  ECS, University of Soutampton
 //
-// This module is an AHB-Lite Slave containing three read-only locations
+// This module is an AHB-Lite Slave containing four read-only locations
+// for num_buttons buttons (active low)
 //
-// Number of addressable locations : 3
+// Number of addressable locations : 4
 // Size of each addressable location : 32 bits
 // Supported transfer sizes : Word
 // Alignment of base address : 16 bytes (4 words)
 //
 // Address map :
-//   Base addess + 0 : 
-//     Bit 0: Mode button is pressed 
-//     Bit 1: Trip button is pressed
-//     Bit 2: Both buttons (Mode and Trip) are pressed at the same time
-//   Base addess + 4 : 
-//     Bit 0: DataValid, this status bit is cleared when Buttons register is read by master 
+//   Base addess + 0 :
+//     Status of the last gesture (press and release of one or more buttons),
+//     cleared when read by master
+//     Bit i: Button i is pressed on its own (bit 0 Mode, bit 1 Trip)
+//     Bit num_buttons: More than one button is pressed at the same time (a chord,
+//                      the buttons are in the chord register)
+//     Bit num_buttons+1: Long press, the buttons have been held for long_press
+//                        samples (the gesture is reported then, not on release)
+//   Base addess + 4 :
+//     Bit 0: DataValid, this status bit is cleared when Buttons register is read by master
+//   Base addess + 8 :
+//     Chord register, bit i: button i was pressed during the last gesture
+//   Base addess + 12 :
+//     Bit i: Button i is pressed now (debounced)
+//
+// The buttons are all sampled together by one prescaled tick (every
+// sample_period clock cycles), a button changes state once its last
+// debounce samples agree. The prescaler only runs while a button is
+// pressed or has not settled, so nothing toggles while the buttons are idle.
+// A gesture ending while DataValid is set is not reported.
+//
+// IRQ follows DataValid, a gesture interrupts until it has been read.
 
 // For simplicity, this interface supports only 32-bit transfers.
-// The most significant 16 bits of the value read will always be 0
-// since there are only 16 switches.
 
 
-module ahb_buttons(
+module ahb_buttons #(
+  parameter num_buttons = 2,
+  parameter sample_period = 164,     // clock cycles between samples (5ms at 32.768kHz)
+  parameter debounce = 5,            // samples which must agree, the state changes with the next (25~30ms)
+  parameter long_press = 200         // samples a gesture must be held for a long press (1s)
+)(
 
   // AHB Global Signals
   input HCLK,
@@ -42,8 +62,8 @@ module ahb_buttons(
   output HREADYOUT,
 
   //Non-AHB Signals
-  input  nMode,
-  input  nTrip
+  input [num_buttons-1:0] nButtons,
+  output IRQ
 
 );
 
@@ -53,244 +73,140 @@ timeprecision 100ps;
   // AHB transfer codes needed in this module
   localparam No_Transfer = 2'b0;
 
-  // Storage for status bits 
+  // Storage for status bits
   logic       DataValid;
 
   //control signals are stored in registers
   logic read_enable;
   logic [1:0] word_address;
- 
-  logic [31:0] Status;
-
-  logic nMode_sync[0:1];
-  logic nTrip_sync[0:1];  
-
-  logic nMode_sync_dly;
-  logic nTrip_sync_dly;
-  logic nMode_sync_negedge;
-  logic nTrip_sync_negedge;
-  
-  // debouncing
-  enum logic [1:0] {IDLE, TRIG, WAIT, END} nMode_counter_state, nTrip_counter_state;
-  logic [9:0] nMode_counter, nTrip_counter;
-  logic nModeTrig;
-  logic nModeRelease;
-  logic nTripTrig;
-  logic nTripRelease;
-  
-  // trigger and valid transfer logic
-  logic nMode_trig;
-  logic nMode_nValid;
-  logic nTrip_trig;
-  logic nTrip_nValid;
-  
+
+  logic [num_buttons+1:0] Status;
+  logic [num_buttons-1:0] Chord;
+
+  logic [num_buttons-1:0] nButtons_sync[0:1];
+
+  // shared sampling tick
+  logic [$clog2(sample_period)-1:0] prescaler;
+  logic sampling, tick;
+
+  // debouncing, one shift register per button
+  logic [debounce-1:0] samples[num_buttons];
+  logic [num_buttons-1:0] pressed, settled;
+
+  // gesture
+  logic [num_buttons-1:0] gesture;
+  logic [$clog2(long_press+1)-1:0] held;
+  logic long_reported;
+  logic gesture_end, gesture_long;
+
   logic read_DataValid;
-  logic Both_reg;
-  logic nTrip_reg;  
-  logic nMode_reg;
-  
+
   // cross clock domain sync
   always_ff @(posedge HCLK, negedge HRESETn)
     if ( ! HRESETn )
       begin
-        nMode_sync[0] <= 1'b0;
-        nMode_sync[1] <= 1'b0;
-        nTrip_sync[0] <= 1'b0;
-        nTrip_sync[1] <= 1'b0;
+        nButtons_sync[0] <= '1;
+        nButtons_sync[1] <= '1;
       end
     else
       begin
-        nMode_sync[0] <= nMode;
-        nMode_sync[1] <= nMode_sync[0];
-        nTrip_sync[0] <= nTrip;
-        nTrip_sync[1] <= nTrip_sync[0];	  
+        nButtons_sync[0] <= nButtons;
+        nButtons_sync[1] <= nButtons_sync[0];
       end
 
-  // edge detection logic
+  // the prescaler runs while any button is pressed or has not settled (and for the
+  // sample ending a gesture)
+  assign sampling = ( pressed != '0 ) || ( settled != '1 ) || ( gesture != '0 );
+
   always_ff @(posedge HCLK, negedge HRESETn)
     if ( ! HRESETn )
-      begin
-        nMode_sync_dly <= 1'b0;
-        nTrip_sync_dly <= 1'b0;
-      end
+      prescaler <= '0;
+    else if ( ! sampling || tick )
+      prescaler <= '0;
     else
-      begin
-        nMode_sync_dly <= nMode_sync[1];
-        nTrip_sync_dly <= nTrip_sync[1];  
-      end
-  assign nMode_sync_negedge = nMode_sync_dly & ~nMode_sync[1]; 
-  assign nTrip_sync_negedge = nTrip_sync_dly & ~nTrip_sync[1];
-  assign nMode_sync_posedge = ~nMode_sync_dly & nMode_sync[1]; 
-  assign nTrip_sync_posedge = ~nTrip_sync_dly & nTrip_sync[1];
-  
-  // debouncing circuit for nMode
+      prescaler <= prescaler + 1;
+
+  assign tick = sampling && ( prescaler == sample_period - 1 );
+
+  // debouncing, a button is pressed or released once its last samples agree
   always_ff @(posedge HCLK, negedge HRESETn)
-    if( ! HRESETn )
-      begin
-        nMode_counter_state <= IDLE;
-	nMode_counter <= '0;
-      end
-    else
+    if ( ! HRESETn )
       begin
-        case(nMode_counter_state)
-	IDLE:  if((nMode_sync_negedge || nMode_sync_posedge) && ~DataValid)
-		 nMode_counter_state <= WAIT;
-        WAIT:  if(nMode_counter < 820)
-		 nMode_counter <= nMode_counter + 1;
-	       else
-	         begin
-		   nMode_counter <= '0;
-		   nMode_counter_state <= END;
-		 end
-	END:   nMode_counter_state <= IDLE;
-	default: nMode_counter_state <= IDLE;
-	endcase
+        for ( int i = 0; i < num_buttons; i++ )
+          samples[i] <= '0;
+        pressed <= '0;
       end
-  
+    else if ( tick )
+      for ( int i = 0; i < num_buttons; i++ )
+        begin
+          samples[i] <= { samples[i][debounce-2:0], ~nButtons_sync[1][i] };
+          if ( samples[i] == '1 )
+            pressed[i] <= 1'b1;
+          else if ( samples[i] == '0 )
+            pressed[i] <= 1'b0;
+        end
+
+  // a button has settled when its samples agree with its state and its input
+  // (a change of input starts the prescaler)
   always_comb
-    begin
-      nModeTrig = 0;
-      nModeRelease = 0;
-      
-      case(nMode_counter_state)
-      IDLE: if(nMode_sync_negedge && ~DataValid) nModeTrig = 1;
-            else if(nMode_sync_posedge && ~DataValid) nModeRelease = 1;
-      WAIT: ;
-      END:  if(nMode_trig && nMode_sync_dly) nModeRelease = 1;
-      default: ;
-      endcase
-    end
-    
-  // debouncing circuit for nTrip
+    for ( int i = 0; i < num_buttons; i++ )
+      settled[i] = ( samples[i] == {debounce{pressed[i]}} ) && ( nButtons_sync[1][i] == ! pressed[i] );
+
+  // a gesture lasts from the first button pressed to the last released, every
+  // button pressed in between is part of it
   always_ff @(posedge HCLK, negedge HRESETn)
-    if( ! HRESETn )
+    if ( ! HRESETn )
       begin
-        nTrip_counter_state <= IDLE;
-	nTrip_counter <= '0;
+        gesture <= '0;
+        held <= '0;
+        long_reported <= '0;
       end
-    else
+    else if ( tick )
+      if ( pressed == '0 )
+        begin
+          gesture <= '0;
+          held <= '0;
+          long_reported <= '0;
+        end
+      else
+        begin
+          gesture <= gesture | pressed;
+          if ( held != long_press )
+            held <= held + 1;
+          if ( gesture_long )
+            long_reported <= '1;
+        end
+
+  assign gesture_end = tick && ( pressed == '0 ) && ( gesture != '0 ) && ! long_reported;
+  assign gesture_long = tick && ( pressed != '0 ) && ( held == long_press - 1 ) && ! long_reported;
+
+  // report the gesture
+  always_ff @(posedge HCLK, negedge HRESETn)
+    if ( ! HRESETn )
       begin
-        case(nTrip_counter_state)
-	IDLE:  if((nTrip_sync_negedge || nTrip_sync_posedge) && ~DataValid)
-		 nTrip_counter_state <= WAIT;
-        WAIT:  if(nTrip_counter < 820)
-		 nTrip_counter <= nTrip_counter + 1;
-	       else
-	         begin
-		   nTrip_counter <= '0;
-		   nTrip_counter_state <= END;
-		 end
-	END:   nTrip_counter_state <= IDLE;
-	default: nTrip_counter_state <= IDLE;
-	endcase
+        Status <= '0;
+        Chord <= '0;
+        DataValid <= 1'b0;
       end
-  
-  always_comb
-    begin
-      nTripTrig = 0;
-      nTripRelease = 0;
-      
-      case(nTrip_counter_state)
-      IDLE: if(nTrip_sync_negedge && ~DataValid) nTripTrig = 1;
-            else if(nTrip_sync_posedge && ~DataValid) nTripRelease = 1;
-      WAIT: ;
-      END:  if(nTrip_trig && nTrip_sync_dly) nTripRelease = 1;
-      default: ;
-      endcase
-    end
-  
-  // update register values 
-  always_ff @(posedge HCLK, negedge HRESETn)
-    if( ! HRESETn )
+    else if ( read_DataValid )
       begin
-        nMode_trig <= '0;
-	nTrip_trig <= '0;
-	nMode_nValid <= 0;
-	nTrip_nValid <= 0;
+        Status <= '0;
+        DataValid <= 1'b0;
       end
-    else
+    else if ( ( gesture_end || gesture_long ) && ! DataValid )
       begin
-	if(read_DataValid)  // set back to valid after data valid is read out
-	  begin
-	    nMode_nValid <= 0;
-	    nTrip_nValid <= 0;
-	  end
-	else if(DataValid) // reset when datavalid
-	  begin
-	    nMode_trig <= 0;
-	    nTrip_trig <= 0;
-	    nMode_nValid <= 1;
-	    nTrip_nValid <= 1;
-	  end
-	  
-	// these will not trigger unless data is already invalid
-        if(nModeTrig)
-	  begin
-	    nMode_nValid <= 1;
-	    nMode_trig <= 1;
-	  end
-	if(nModeRelease) nMode_nValid <= 0;
-	
-	if(nTripTrig)
-	  begin
-	    nTrip_nValid <= 1;
-	    nTrip_trig <= 1;
-	  end 
-	if(nTripRelease) nTrip_nValid <= 0;
+        Chord <= gesture | pressed;
+        if ( $countones(gesture | pressed) > 1 )
+          Status <= { gesture_long, 1'b1, {num_buttons{1'b0}} };
+        else
+          Status <= { gesture_long, 1'b0, gesture | pressed };
+        DataValid <= 1'b1;
       end
-  
-  //Update the button values only when the appropriate button is pressed
-  always_ff @(posedge HCLK, negedge HRESETn)
-    if ( ! HRESETn )
-    begin
-        nMode_reg <= 1'b0;
-    end
-    else if (read_DataValid) begin
-        nMode_reg <= 1'b0;		
-	end
-    else if (nMode_trig & ~nTrip_trig & ~nMode_nValid & ~nTrip_nValid & ~DataValid) begin
-        nMode_reg <= 1'b1;		
-	end
-	
-  always_ff @(posedge HCLK, negedge HRESETn)
-    if ( ! HRESETn )
-    begin
-        nTrip_reg <= 1'b0;
-    end
-    else if (read_DataValid) begin
-        nTrip_reg <= 1'b0;		
-	end
-    else if (~nMode_trig & nTrip_trig & ~nMode_nValid & ~nTrip_nValid & ~DataValid) begin
-        nTrip_reg <= 1'b1;		
-	end
-
-  always_ff @(posedge HCLK, negedge HRESETn)
-    if ( ! HRESETn )
-    begin
-        Both_reg <= 1'b0;
-    end
-    else if (read_DataValid) begin
-        Both_reg <= 1'b0;		
-	end
-    else if (nMode_trig & nTrip_trig & ~nMode_nValid & ~nTrip_nValid & ~DataValid) begin
-        Both_reg <= 1'b1;		
-	end
-
-  // update datavalid register
-  always_ff @(posedge HCLK, negedge HRESETn)
-    if ( ! HRESETn )
-    begin
-        DataValid <= 1'b0;
-    end
-    else if (read_DataValid) begin
-        DataValid <= 1'b0;		
-	end
-    else if (nMode_reg | nTrip_reg | Both_reg) begin
-        DataValid <= 1'b1;		
-	end
 
   assign read_DataValid = read_enable && (word_address == 0);
 
+  assign IRQ = DataValid;
+
   //Generate the control signals in the address phase
   always_ff @(posedge HCLK, negedge HRESETn)
     if ( ! HRESETn )
@@ -311,9 +227,6 @@ timeprecision 100ps;
 
   //Act on control signals in the data phase
 
-  // define the bits in the status register
-  assign Status = { 29'd0, Both_reg,nTrip_reg,nMode_reg};
-
   // read
   always_comb
     if ( ! read_enable )
@@ -324,6 +237,8 @@ timeprecision 100ps;
       case (word_address)
         0 : HRDATA = Status;
         1 : HRDATA = {31'd0,DataValid};
+        2 : HRDATA = Chord;
+        3 : HRDATA = pressed;
         // unused address - returns zero
         default : HRDATA = '0;
       endcase
@@ -334,4 +249,3 @@ timeprecision 100ps;
 
 
 endmodule
-
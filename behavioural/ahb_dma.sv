@@ -0,0 +1,456 @@
+// AHB-Lite descriptor based DMA controller (ahb_dma.sv)
+// This module has an AHB-Lite slave interface for configuration and an
+// AHB master interface (connected through ahb_arbiter) to move data
+// between memory and peripherals without the processor
+//
+// Number of addressable locations : 3 per channel (up to 4 channels)
+// Size of each addressable location : 32 bits
+// Supported transfer sizes : Word
+// Alignment of base address : Word aligned
+//
+// Address map (channel n registers at Base address + 16*n) :
+//   + 0 :
+//     Read/Write
+//     Descriptor pointer, address of the next descriptor to be processed
+//   + 4 :
+//     Read/Write
+//     Control register
+//       Bit 0: Enable, set by master to start processing descriptors,
+//              cleared when a descriptor with next address 0 completes
+//       Bit 1: Trigger mode, wait for a rising edge of DREQ[n] (or a software
+//              trigger) before processing each descriptor
+//       Bit 2: Interrupt enable
+//       Bit 3: Software trigger, write only, reset after one cycle
+//   + 8 :
+//     Read only
+//     Status register
+//       Bit 15~0: Number of descriptors completed (wraps around)
+//       Bit 16: Done, flagged when a descriptor completes, reset when status is read
+//       Bit 17: Active, flagged while the engine is working on this channel
+//       Bit 18: Error, flagged when a transfer gets an ERROR response, reset when
+//               status is read (the channel is disabled and the descriptor pointer
+//               is left at the descriptor that failed)
+//
+// Descriptor format (4 words in memory, word aligned) :
+//   word 0 : Source address
+//   word 1 : Destination address
+//   word 2 : Control
+//              Bit 7~0: number of transfers
+//              Bit 9~8: transfer size (0 byte, 1 halfword, 2 word)
+//              Bit 10: increment source address after each transfer
+//              Bit 11: increment destination address after each transfer
+//              Bit 12: link, process the next descriptor immediately
+//                      (without waiting for a trigger or switching channel)
+//   word 3 : Next descriptor address (0 ends the chain)
+//
+// A circular descriptor list (last next address pointing back to the first
+// descriptor) with trigger mode streams data into a ring buffer.
+//
+// An ERROR response (HRESP_M) cancels the next address phase and aborts the
+// descriptor, the channel interrupt (if enabled) is raised as for Done.
+//
+// The altimeter firmware does not use it (the I2C sequencer and the LCD
+// interface already run without the processor), it is tested by ahb_dma_stim.
+
+module ahb_dma #(
+  parameter num_channels = 2
+)(
+
+  // AHB Global Signals
+  input HCLK,
+  input HRESETn,
+
+  // AHB Signals from Master to Slave
+  input [31:0] HADDR,
+  input [31:0] HWDATA,
+  input [2:0] HSIZE,
+  input [1:0] HTRANS,
+  input HWRITE,
+  input HREADY,
+  input HSEL,
+
+  // AHB Signals from Slave to Master
+  output logic [31:0] HRDATA,
+  output HREADYOUT,
+
+  // AHB Master Signals (to ahb_arbiter)
+  output logic [31:0] HADDR_M,
+  output logic [31:0] HWDATA_M,
+  output logic [1:0] HTRANS_M,
+  output logic [2:0] HSIZE_M,
+  output logic HWRITE_M,
+  output logic HBUSREQ_M,
+  input HGRANT_M,
+  input HREADY_M,
+  input HRESP_M,
+  input [31:0] HRDATA_M,
+
+  // Non-AHB Signals
+  input [num_channels-1:0] DREQ,   // per channel trigger
+  output IRQ
+
+);
+
+timeunit 1ns;
+timeprecision 100ps;
+
+  // AHB transfer codes needed in this module
+  localparam No_Transfer = 2'b00;
+  localparam Non_Sequential = 2'b10;
+
+  // Register addresses (within a channel)
+  localparam DESC_PTR_REG = 2'b00;
+  localparam CONTROL_REG = 2'b01;
+  localparam STATUS_REG = 2'b10;
+
+  logic write_enable, read_enable;
+  logic [3:0] word_address;
+  logic [1:0] reg_address;
+  logic [1:0] ch_address;
+
+  // programmer's model registers
+  logic [31:0] desc_ptr [0:num_channels-1];
+  logic [num_channels-1:0] ch_enable;
+  logic [num_channels-1:0] ch_trig_mode;
+  logic [num_channels-1:0] ch_irq_enable;
+  logic [num_channels-1:0] trig_pending;
+  logic [num_channels-1:0] done_flag;
+  logic [num_channels-1:0] error_flag;
+  logic [15:0] done_count [0:num_channels-1];
+
+  // trigger edge detection
+  logic [num_channels-1:0] DREQ_dly;
+  logic [num_channels-1:0] sw_trigger;
+  logic [num_channels-1:0] trig_taken;
+
+  // engine state
+  enum logic [2:0] {IDLE, FETCH, FETCH_WAIT, READ, WRITE, WRITE_WAIT} dma_state;
+  logic [1:0] cur_ch, last_ch, next_ch;
+  logic next_ch_found;
+  logic [num_channels-1:0] ch_ready;
+  logic [31:0] cur_desc;
+  logic [1:0] fetch_idx;
+  logic [31:0] cur_src, cur_dst, desc_next;
+  logic [1:0] desc_size;
+  logic desc_src_inc, desc_dst_inc, desc_link;
+  logic [7:0] count;
+  logic [31:0] data_buf;
+  logic [31:0] increment;
+
+  // master data phase tracking
+  logic addr_accept;
+  logic dphase_error;
+  logic dphase_valid, dphase_write, dphase_fetch;
+  logic [1:0] dphase_idx;
+  logic [1:0] dphase_lane;
+  logic [1:0] dphase_size;
+
+  assign reg_address = word_address[1:0];
+  assign ch_address = word_address[3:2];
+
+  // AHB address decoding and control
+  always_ff @(posedge HCLK, negedge HRESETn)
+  if(!HRESETn)
+    begin
+      write_enable <= '0;
+      read_enable <= '0;
+      word_address <= '0;
+    end
+  else
+    if (HREADY && HSEL && (HTRANS != No_Transfer))
+      begin
+        write_enable <= HWRITE;
+        read_enable <= !HWRITE;
+        word_address <= HADDR[5:2];
+      end
+    else
+      begin
+        write_enable <= '0;
+        read_enable <= '0;
+        word_address <= '0;
+      end
+
+  //AHB read operation
+  always_comb
+  if(!read_enable || (ch_address >= num_channels))
+    HRDATA = '0;
+  else
+    begin
+      case (reg_address)
+        DESC_PTR_REG:  HRDATA = desc_ptr[ch_address];
+        CONTROL_REG:   HRDATA = {29'b0, ch_irq_enable[ch_address], ch_trig_mode[ch_address], ch_enable[ch_address]};
+        STATUS_REG:    HRDATA = {13'b0, error_flag[ch_address], (dma_state != IDLE) && (cur_ch == ch_address), done_flag[ch_address], done_count[ch_address]};
+        default:       HRDATA = 32'b0;
+      endcase
+    end
+
+  // Transfer Response - Single Cycle Operation (No Wait States)
+  assign HREADYOUT = '1;
+
+  assign IRQ = |((done_flag | error_flag) & ch_irq_enable);
+
+  // trigger edge detection
+  always_ff @(posedge HCLK, negedge HRESETn)
+  if(!HRESETn)
+    DREQ_dly <= '0;
+  else
+    DREQ_dly <= DREQ;
+
+  // channels ready to run
+  always_comb
+    for (int i = 0; i < num_channels; i++)
+      ch_ready[i] = ch_enable[i] && (!ch_trig_mode[i] || trig_pending[i]);
+
+  // round robin channel selection, starting with the channel after the last one served
+  always_comb
+  begin
+    next_ch = last_ch;
+    next_ch_found = 0;
+    for (int i = 1; i <= num_channels; i++)
+      if (!next_ch_found && ch_ready[(last_ch + i) % num_channels])
+        begin
+          next_ch = (last_ch + i) % num_channels;
+          next_ch_found = 1;
+        end
+  end
+
+  // trigger consumed by the channel starting this cycle
+  always_comb
+  begin
+    trig_taken = '0;
+    if ((dma_state == IDLE) && next_ch_found)
+      trig_taken[next_ch] = 1;
+  end
+
+  assign increment = 32'd1 << desc_size;
+
+  // ERROR response to the transfer in the data phase (both cycles of it)
+  assign dphase_error = dphase_valid && HRESP_M;
+
+  // master address phase (nothing is started during an ERROR response)
+  always_comb
+  begin
+    HTRANS_M = No_Transfer;
+    HADDR_M = '0;
+    HWRITE_M = 0;
+    HSIZE_M = 3'b010;
+
+    if(!dphase_error)
+      case(dma_state)
+        FETCH:   begin
+                   HTRANS_M = Non_Sequential;
+                   HADDR_M = cur_desc + {fetch_idx, 2'b00};
+                 end
+        READ:    begin
+                   HTRANS_M = Non_Sequential;
+                   HADDR_M = cur_src;
+                   HSIZE_M = {1'b0, desc_size};
+                 end
+        WRITE:   begin
+                   HTRANS_M = Non_Sequential;
+                   HADDR_M = cur_dst;
+                   HWRITE_M = 1;
+                   HSIZE_M = {1'b0, desc_size};
+                 end
+        default: ;
+      endcase
+  end
+
+  assign HBUSREQ_M = (HTRANS_M != No_Transfer);
+  assign addr_accept = HBUSREQ_M && HGRANT_M && HREADY_M;
+
+  // write data is held in data_buf, already replicated across the byte lanes
+  assign HWDATA_M = data_buf;
+
+  // master data phase tracking
+  always_ff @(posedge HCLK, negedge HRESETn)
+  if(!HRESETn)
+    begin
+      dphase_valid <= '0;
+      dphase_write <= '0;
+      dphase_fetch <= '0;
+      dphase_idx <= '0;
+      dphase_lane <= '0;
+      dphase_size <= '0;
+    end
+  else if(HREADY_M)
+    begin
+      dphase_valid <= addr_accept;
+      if(addr_accept)
+        begin
+          dphase_write <= HWRITE_M;
+          dphase_fetch <= (dma_state == FETCH);
+          dphase_idx <= fetch_idx;
+          dphase_lane <= HADDR_M[1:0];
+          dphase_size <= HSIZE_M[1:0];
+        end
+    end
+
+  // capture read data at the end of the data phase
+  always_ff @(posedge HCLK, negedge HRESETn)
+  if(!HRESETn)
+    begin
+      data_buf <= '0;
+      desc_next <= '0;
+      desc_size <= '0;
+      desc_src_inc <= '0;
+      desc_dst_inc <= '0;
+      desc_link <= '0;
+    end
+  else if(HREADY_M && dphase_valid && !dphase_write)
+    if(dphase_fetch)
+      case(dphase_idx)
+        2:  begin
+              desc_size <= HRDATA_M[9:8];
+              desc_src_inc <= HRDATA_M[10];
+              desc_dst_inc <= HRDATA_M[11];
+              desc_link <= HRDATA_M[12];
+            end
+        3:  desc_next <= HRDATA_M;
+        default: ;   // words 0 and 1 are loaded into cur_src and cur_dst by the engine
+      endcase
+    else
+      // replicate the data read across all byte lanes so that the slave
+      // written to finds it in the lane selected by the destination address
+      case(dphase_size)
+        2'b00:   case(dphase_lane)
+                   2'd0:    data_buf <= {4{HRDATA_M[7:0]}};
+                   2'd1:    data_buf <= {4{HRDATA_M[15:8]}};
+                   2'd2:    data_buf <= {4{HRDATA_M[23:16]}};
+                   default: data_buf <= {4{HRDATA_M[31:24]}};
+                 endcase
+        2'b01:   data_buf <= (dphase_lane[1]) ? {2{HRDATA_M[31:16]}} : {2{HRDATA_M[15:0]}};
+        default: data_buf <= HRDATA_M;
+      endcase
+
+  // DMA engine and channel registers
+  always_ff @(posedge HCLK, negedge HRESETn)
+  if(!HRESETn)
+    begin
+      dma_state <= IDLE;
+      cur_ch <= '0;
+      last_ch <= '0;
+      cur_desc <= '0;
+      fetch_idx <= '0;
+      cur_src <= '0;
+      cur_dst <= '0;
+      count <= '0;
+      for (int i = 0; i < num_channels; i++)
+        begin
+          desc_ptr[i] <= '0;
+          done_count[i] <= '0;
+        end
+      ch_enable <= '0;
+      ch_trig_mode <= '0;
+      ch_irq_enable <= '0;
+      trig_pending <= '0;
+      done_flag <= '0;
+      error_flag <= '0;
+      sw_trigger <= '0;
+    end
+  else
+    begin
+      // latch triggers for enabled channels until a descriptor is started
+      // (masking with ch_enable also drops the false edge seen after reset
+      // for a DREQ input that is already high, such as the LCD idle signal)
+      trig_pending <= ((trig_pending & ~trig_taken) | (DREQ & ~DREQ_dly) | sw_trigger) & ch_enable;
+      sw_trigger <= '0;
+
+      // done and error flags are cleared when status is read (a descriptor completing in the same cycle sets them again)
+      if(read_enable && (ch_address < num_channels) && (reg_address == STATUS_REG))
+        begin
+          done_flag[ch_address] <= 0;
+          error_flag[ch_address] <= 0;
+        end
+
+      // words 0 and 1 of the descriptor
+      if(HREADY_M && dphase_valid && !dphase_write && dphase_fetch)
+        case(dphase_idx)
+          0:  cur_src <= HRDATA_M;
+          1:  cur_dst <= HRDATA_M;
+          2:  count <= HRDATA_M[7:0];
+          default: ;
+        endcase
+
+      case(dma_state)
+        IDLE:       if(next_ch_found)
+                      begin
+                        cur_ch <= next_ch;
+                        last_ch <= next_ch;
+                        cur_desc <= desc_ptr[next_ch];
+                        fetch_idx <= 0;
+                        dma_state <= FETCH;
+                      end
+        FETCH:      if(addr_accept)
+                      begin
+                        fetch_idx <= fetch_idx + 1;
+                        if(fetch_idx == 3)
+                          dma_state <= FETCH_WAIT;
+                      end
+        FETCH_WAIT: if(!dphase_valid)
+                      if(count == 0)
+                        dma_state <= WRITE_WAIT;
+                      else
+                        dma_state <= READ;
+        READ:       if(addr_accept)
+                      begin
+                        if(desc_src_inc) cur_src <= cur_src + increment;
+                        dma_state <= WRITE;
+                      end
+        WRITE:      if(addr_accept)
+                      begin
+                        if(desc_dst_inc) cur_dst <= cur_dst + increment;
+                        count <= count - 1;
+                        if(count == 1)
+                          dma_state <= WRITE_WAIT;
+                        else
+                          dma_state <= READ;
+                      end
+        WRITE_WAIT: if(!dphase_valid)
+                      begin
+                        // descriptor complete
+                        done_count[cur_ch] <= done_count[cur_ch] + 1;
+                        done_flag[cur_ch] <= 1;
+                        desc_ptr[cur_ch] <= desc_next;
+                        if(desc_next == 0)
+                          begin
+                            ch_enable[cur_ch] <= 0;
+                            dma_state <= IDLE;
+                          end
+                        else if(desc_link)
+                          begin
+                            cur_desc <= desc_next;
+                            fetch_idx <= 0;
+                            dma_state <= FETCH;
+                          end
+                        else
+                          dma_state <= IDLE;
+                      end
+        default:    dma_state <= IDLE;
+      endcase
+
+      // abort the descriptor at the end of an ERROR response
+      if(HREADY_M && dphase_error)
+        begin
+          error_flag[cur_ch] <= 1;
+          ch_enable[cur_ch] <= 0;
+          desc_ptr[cur_ch] <= cur_desc;
+          dma_state <= IDLE;
+        end
+
+      // AHB slave accesses (these take priority over the engine)
+      if(write_enable && (ch_address < num_channels))
+        case(reg_address)
+          DESC_PTR_REG: desc_ptr[ch_address] <= HWDATA;
+          CONTROL_REG:  begin
+                          ch_enable[ch_address] <= HWDATA[0];
+                          ch_trig_mode[ch_address] <= HWDATA[1];
+                          ch_irq_enable[ch_address] <= HWDATA[2];
+                          sw_trigger[ch_address] <= HWDATA[3];
+                        end
+          default: ;
+        endcase
+
+    end
+
+endmodule
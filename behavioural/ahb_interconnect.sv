@@ -1,13 +1,37 @@
+// AHB-Lite interconnect: address decoder, data phase register and read multiplexer
+//
+// The address map is given by the slave_base and slave_size parameter arrays
+// (entry i for the slave on HSEL_SIGNALS[i]). Each size must be a power of two
+// and each base a multiple of its size. A slave is selected when the address
+// bits above its size match its base, all slaves are compared in parallel
+// (there is no priority chain, so the decoder does not get slower as slaves
+// are added) and only the bits above each size reach the comparison logic.
+//
+// A slave which does not fill its region is given the number of bytes fitted
+// from its base in slave_fitted (the default is the whole region), the rest of
+// the region is unmapped. A slave fitting 0 bytes (one left out of the build)
+// is never selected. Only these slaves compare the bits below their size.
+//
+// Regions of the address map which belong to no slave are served by a
+// default slave inside this module: an IDLE or BUSY transfer gets a zero wait
+// state OKAY response, any other transfer gets the two cycle ERROR response
+// (HRESP high with HREADY low, then HRESP high with HREADY high).
+
 module ahb_interconnect #(
-  parameter num_slaves = 5
+  parameter num_slaves = 5,
+  // default map : ROM, RAM, buttons, LCD and I2C
+  parameter logic [num_slaves-1:0][31:0] slave_base = {32'h6000_0000, 32'h5000_0000, 32'h4000_0000, 32'h2000_0000, 32'h0000_0000},
+  parameter logic [num_slaves-1:0][31:0] slave_size = {32'h1000_0000, 32'h1000_0000, 32'h1000_0000, 32'h2000_0000, 32'h2000_0000},
+  parameter logic [num_slaves-1:0][31:0] slave_fitted = slave_size
 )(
   // global signals
   input HCLK,
   input HRESETn,
-   
+
   // input signals from master
   input [31:0] HADDR,
-  
+  input [1:0] HTRANS,
+
   // output signals to slaves
   output logic [num_slaves-1:0] HSEL_SIGNALS,
 
@@ -18,6 +42,7 @@ module ahb_interconnect #(
 
   // output signals to master
   output logic HREADY,
+  output logic HRESP,
   output logic [31:0] HRDATA
 
 );
@@ -28,26 +53,23 @@ timeprecision 100ps;
   logic [num_slaves-1:0] mux_sel;
   int i;
 
+  // default slave
+  enum logic [1:0] {OKAY, ERROR_FIRST, ERROR_SECOND} default_state;
+  logic unmapped_transfer;
+
 
   //-------------------------
-  // to customize this module for a different address map, change only this decoder part and the "num_slaves" parameter
-  
-  // this example decoder uses minimal decoding
-  // (each slave has multiple images in the address map and there are no unmapped regions )
+  // to customize this module for a different address map, change only the
+  // "num_slaves", "slave_base", "slave_size" and "slave_fitted" parameters
+
   always_comb
-    if ( HADDR < 32'h2000_0000 )
-      HSEL_SIGNALS = 1 << 0;
-    else if ( HADDR < 32'h4000_0000 )
-      HSEL_SIGNALS = 1 << 1;
-    else if ( HADDR < 32'h5000_0000 )
-      HSEL_SIGNALS = 1 << 2;
-    else if ( HADDR < 32'h6000_0000 )
-      HSEL_SIGNALS = 1 << 3;
-    else if ( HADDR < 32'h7000_0000 )
-      HSEL_SIGNALS = 1 << 4;
-    else
-      HSEL_SIGNALS = 0;
-  
+    for ( int n = 0; n < num_slaves; n++ )
+      HSEL_SIGNALS[n] = ( ( ( HADDR ^ slave_base[n] ) & ~( slave_size[n] - 1 ) ) == 0 ) &&
+                        ( ( slave_fitted[n] == slave_size[n] ) || ( ( HADDR & ( slave_size[n] - 1 ) ) < slave_fitted[n] ) );
+
+  // a transfer (NONSEQ or SEQ) to an address which selects no slave
+  assign unmapped_transfer = HTRANS[1] && ( HSEL_SIGNALS == 0 );
+
   //-------------------------
   // the code below should work for any number of slaves
 
@@ -57,14 +79,27 @@ timeprecision 100ps;
     else if( HREADY )
       mux_sel <= HSEL_SIGNALS;
 
+  always_ff @(posedge HCLK, negedge HRESETn)
+    if( ! HRESETn )
+      default_state <= OKAY;
+    else
+      case ( default_state )
+        ERROR_FIRST :  default_state <= ERROR_SECOND;
+        default :      if( HREADY && unmapped_transfer )
+                         default_state <= ERROR_FIRST;
+                       else
+                         default_state <= OKAY;
+      endcase
+
   always_comb
     begin
       // default values
       HREADY = 1;
+      HRESP = 0;
       HRDATA = 32'hDEADBEEF; // "hexspeak" to indicate an error has occured
-      
+
       // since num_slaves is a parameter all of this should be unrolled at compile time
-      
+
       for ( i = 0; i < num_slaves; i++ )
         if ( mux_sel == (1 << i) )
           begin
@@ -72,6 +107,15 @@ timeprecision 100ps;
             HRDATA = HRDATA_SIGNALS[i];
           end
 
+      // no slave is selected in the data phase of an error response
+      if ( default_state == ERROR_FIRST )
+        begin
+          HREADY = 0;
+          HRESP = 1;
+        end
+      else if ( default_state == ERROR_SECOND )
+        HRESP = 1;
+
     end
 
 endmodule
@@ -44,8 +44,8 @@ timeprecision 100ps;
 
   localparam No_Transfer = 2'b0;
 
-// Memory Array  
-  logic [31:0] memory[0:2293];
+// Memory Array (sized by MEMWIDTH, not by the image installed below)
+  logic [31:0] memory[0:(2**(MEMWIDTH-2)-1)];
 
 //control signals are stored in registers
   logic read_enable;
@@ -52,7 +52,8 @@ module ahb_simple_i2c(
   //Non-AHB Signals
   output logic SCL,
   output logic SDA_out,
-  input SDA_in
+  input SDA_in,
+  output logic DataValid   // read data valid (DMA trigger)
 );
 
 timeunit 1ns;
@@ -356,7 +357,6 @@ timeprecision 100ps;
     end 
   
   // DataValid status logic
-  logic DataValid;
   always_ff @(posedge HCLK, negedge HRESETn)
   if(! HRESETn)
     DataValid <= 0;
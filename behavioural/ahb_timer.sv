@@ -0,0 +1,222 @@
+// AHB-Lite real time clock / trip timer (ahb_timer.sv)
+// This module counts elapsed time in hardware so the firmware needs neither
+// an interrupt per second nor any division to display it. The time is kept
+// both as BCD hours, minutes and seconds (read straight onto the display)
+// and as a binary number of seconds (for time differences).
+//
+// HCLK is divided down by a sub-second prescaler of ticks_per_second clock
+// cycles. The counters only advance while the timer is running and can be
+// reset at any time without stopping it.
+//
+// Number of addressable locations : 5
+// Size of each addressable location : 32 bits
+// Supported transfer sizes : Word
+// Alignment of base address : Word aligned
+//
+// Address map :
+//   Base addess + 0 :
+//     Read/Write
+//     Control register
+//       Bit 0: Run, the counters advance while set
+//       Bit 1: Interrupt enable, IRQ follows the second flag
+//       Bit 2: Reset, write only, clears the time, the prescaler and the
+//              second flag (reads as 0)
+//   Base addess + 4 :
+//     Read only
+//     Time (BCD)
+//       Bits 3~0: seconds (units)
+//       Bits 7~4: seconds (tens)
+//       Bits 11~8: minutes (units)
+//       Bits 15~12: minutes (tens)
+//       Bits 19~16: hours (units)
+//       Bits 23~20: hours (tens), wraps around from 99:59:59 to 00:00:00
+//   Base addess + 8 :
+//     Read only
+//     Bits 15~0: Sub-second ticks, clock cycles since the last second (0 ~ ticks_per_second-1)
+//   Base addess + 12 :
+//     Read only
+//     Seconds since reset (binary, wraps around)
+//   Base addess + 16 :
+//     Read only
+//     Status register
+//       Bit 0: Second flag, set every second, reset when status is read
+
+module ahb_timer #(
+  parameter ticks_per_second = 32768    // HCLK frequency (Hz)
+)(
+
+  // AHB Global Signals
+  input HCLK,
+  input HRESETn,
+
+  // AHB Signals from Master to Slave
+  input [31:0] HADDR,
+  input [31:0] HWDATA,
+  input [2:0] HSIZE,
+  input [1:0] HTRANS,
+  input HWRITE,
+  input HREADY,
+  input HSEL,
+
+  // AHB Signals from Slave to Master
+  output logic [31:0] HRDATA,
+  output HREADYOUT,
+
+  // Non-AHB Signals
+  output IRQ
+
+);
+
+timeunit 1ns;
+timeprecision 100ps;
+
+  // AHB transfer codes needed in this module
+  localparam No_Transfer = 2'b0;
+
+  // Register addresses
+  localparam CONTROL_REG = 3'd0;
+  localparam TIME_REG = 3'd1;
+  localparam SUBSECOND_REG = 3'd2;
+  localparam SECONDS_REG = 3'd3;
+  localparam STATUS_REG = 3'd4;
+
+  logic write_enable, read_enable;
+  logic [2:0] word_address;
+
+  // programmer's model registers
+  logic run, irq_enable, second_flag;
+  logic [15:0] prescaler;
+  logic [31:0] seconds;
+  logic [3:0] sec_units, min_units, hour_units;
+  logic [3:0] sec_tens, min_tens, hour_tens;
+
+  logic reset_request, second_tick;
+
+  // AHB address decoding and control
+  always_ff @(posedge HCLK, negedge HRESETn)
+  if(!HRESETn)
+    begin
+      write_enable <= '0;
+      read_enable <= '0;
+      word_address <= '0;
+    end
+  else
+    if (HREADY && HSEL && (HTRANS != No_Transfer))
+      begin
+        write_enable <= HWRITE;
+        read_enable <= !HWRITE;
+        word_address <= HADDR[4:2];
+      end
+    else
+      begin
+        write_enable <= '0;
+        read_enable <= '0;
+        word_address <= '0;
+      end
+
+  //AHB read operation
+  always_comb
+  if(!read_enable)
+    HRDATA = '0;
+  else
+    case (word_address)
+      CONTROL_REG:   HRDATA = {30'b0, irq_enable, run};
+      TIME_REG:      HRDATA = {8'b0, hour_tens, hour_units, min_tens, min_units, sec_tens, sec_units};
+      SUBSECOND_REG: HRDATA = {16'b0, prescaler};
+      SECONDS_REG:   HRDATA = seconds;
+      STATUS_REG:    HRDATA = {31'b0, second_flag};
+      default:       HRDATA = 32'b0;
+    endcase
+
+  // control register
+  always_ff @(posedge HCLK, negedge HRESETn)
+  if(!HRESETn)
+    begin
+      run <= '0;
+      irq_enable <= '0;
+    end
+  else if(write_enable && (word_address == CONTROL_REG))
+    begin
+      run <= HWDATA[0];
+      irq_enable <= HWDATA[1];
+    end
+
+  assign reset_request = write_enable && (word_address == CONTROL_REG) && HWDATA[2];
+
+  // sub-second prescaler
+  assign second_tick = run && (prescaler == ticks_per_second - 1);
+
+  always_ff @(posedge HCLK, negedge HRESETn)
+  if(!HRESETn)
+    prescaler <= '0;
+  else if(reset_request || second_tick)
+    prescaler <= '0;
+  else if(run)
+    prescaler <= prescaler + 1;
+
+  // binary and BCD seconds, each BCD digit carries into the next one when it wraps
+  always_ff @(posedge HCLK, negedge HRESETn)
+  if(!HRESETn)
+    begin
+      seconds <= '0;
+      {hour_tens, hour_units, min_tens, min_units, sec_tens, sec_units} <= '0;
+    end
+  else if(reset_request)
+    begin
+      seconds <= '0;
+      {hour_tens, hour_units, min_tens, min_units, sec_tens, sec_units} <= '0;
+    end
+  else if(second_tick)
+    begin
+      seconds <= seconds + 1;
+
+      if(sec_units != 9)
+        sec_units <= sec_units + 1;
+      else
+        begin
+          sec_units <= 0;
+          if(sec_tens != 5)
+            sec_tens <= sec_tens + 1;
+          else
+            begin
+              sec_tens <= 0;
+              if(min_units != 9)
+                min_units <= min_units + 1;
+              else
+                begin
+                  min_units <= 0;
+                  if(min_tens != 5)
+                    min_tens <= min_tens + 1;
+                  else
+                    begin
+                      min_tens <= 0;
+                      if(hour_units != 9)
+                        hour_units <= hour_units + 1;
+                      else
+                        begin
+                          hour_units <= 0;
+                          hour_tens <= (hour_tens != 9) ? hour_tens + 1 : 4'd0;
+                        end
+                    end
+                end
+            end
+        end
+    end
+
+  // second flag, reset when the status register is read
+  always_ff @(posedge HCLK, negedge HRESETn)
+  if(!HRESETn)
+    second_flag <= '0;
+  else if(reset_request)
+    second_flag <= '0;
+  else if(second_tick)
+    second_flag <= '1;
+  else if(read_enable && (word_address == STATUS_REG))
+    second_flag <= '0;
+
+  assign IRQ = irq_enable && second_flag;
+
+  //Transfer Response
+  assign HREADYOUT = '1; //Single cycle Write & Read. Zero Wait state operations
+
+endmodule
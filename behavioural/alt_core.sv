@@ -32,11 +32,36 @@ module alt_core(
 timeunit 1ns;
 timeprecision 100ps;
 
-  soc soc1(.HCLK(Clock), .HRESETn(nReset),
+  // the I2C interface matching the sensor (options.sv)
+`ifdef use_simple_sensor
+  localparam simple_sensor = 1;
+`else
+  localparam simple_sensor = 0;
+`endif
+
+  // the compensation pipeline, of no use to the simple sensor (options.sv)
+`ifdef hardware_compensation
+  localparam hardware_compensation = !simple_sensor;
+`else
+  localparam hardware_compensation = 0;
+`endif
+
+  // the pressure alarm comparator, only built when the altimeter has an alarm
+`ifdef include_alarm
+  localparam alarm = 1;
+`else
+  localparam alarm = 0;
+`endif
+
+  wire DB_oe;
+
+  soc #(.hardware_compensation(hardware_compensation), .simple_sensor(simple_sensor), .alarm(alarm))
+      soc1(.HCLK(Clock), .HRESETn(nReset),
            .nMode(nMode), .nTrip(nTrip),
-           .RS(RS), .RnW(RnW), .E(E), .DB(DB_Out),
+           .RS(RS), .RnW(RnW), .E(E), .DB_in(DB_In), .DB_out(DB_Out), .DB_oe(DB_oe),
 	   .SCL(SCL), .SDA_out(SDA_Out), .SDA_in(SDA_In));
 
-assign DB_nEnable = '0;
+// the DB pad drivers are turned off while the LCD drives DB (busy flag and data reads)
+assign DB_nEnable = ~DB_oe;
 
 endmodule
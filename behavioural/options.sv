@@ -73,14 +73,25 @@
 
 // Uncomment the following line to indicate that your sports altimeter
 //  supports an Alarm buzzer
+//  (soc.sv then includes ahb_alarm, run software/gen_options_h.py to build
+//   the firmware with ALTITUDE_ALARM)
 //
 //`define include_alarm
 
 // Uncomment the following line to indicate that the altimeter sensor
 //  is a simple one which returns the pressure in Pascals
+//  (soc.sv then uses ahb_simple_i2c, run software/gen_options_h.py to build
+//   the firmware with SIMPLE_SENSOR)
 //
 //`define use_simple_sensor
 
+// Comment out the following line to leave out the ahb_bmp_comp compensation
+//  pipeline, the firmware then compensates the BMP390 readings in software
+//  (run software/gen_options_h.py to keep HARDWARE_COMPENSATION in step,
+//   ignored with use_simple_sensor which has nothing to compensate)
+//
+`define hardware_compensation
+
 // Uncomment ONE of the following lines to indicate that the alitimeter
 //  is designed for a specific purpose
 //  (the default is for a multi-purpose altimeter)
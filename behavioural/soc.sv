@@ -3,15 +3,36 @@
 //  ECS, University of Soutampton
 //
 //
-// This version supports 4 AHBLite slaves:
+// This version supports 2 AHBLite masters:
+//
+//  CORTEXM0DS        Processor
+//  ahb_dma           Descriptor based DMA controller
+//
+// sharing the bus through ahb_arbiter, and 9 AHBLite slaves:
 //
 //  ahb_rom           ROM
 //  ahb_ram           RAM
-//  ahb_switches      A handshaking interface to support input from switches and buttons
-//  ahb_out           An output interface supporting simultaneous update of data and valid signals
+//  ahb_buttons       A handshaking interface to support input from buttons
+//  ahb_lcd           LCD display interface
+//  ahb_bmp_i2c       I2C interface to the BMP390 pressure sensor
+//                    (or ahb_simple_i2c for a simple sensor returning Pascals)
+//  ahb_dma           DMA controller configuration registers
+//  ahb_bmp_comp      BMP390 compensation pipeline (optional)
+//  ahb_timer         Real time clock / trip timer
+//  ahb_alarm         Pressure threshold comparator (optional)
+//
+// A system reset request from the processor (SYSRESETREQ) or a lockup is a
+// warm reset: the processor and most of the peripherals are reset but not
+// the RAM contents (which are never reset), the trip timer or the I2C
+// interface (so a transfer to the sensor is never cut short). HRESETn resets
+// everything.
 //
 
-module soc(
+module soc #(
+  parameter hardware_compensation = 1,   // include ahb_bmp_comp (hardware_compensation)
+  parameter simple_sensor = 0,           // ahb_simple_i2c rather than ahb_bmp_i2c (use_simple_sensor)
+  parameter alarm = 1                    // include ahb_alarm (include_alarm)
+)(
 
   input HCLK, HRESETn,
   
@@ -23,7 +44,9 @@ module soc(
   output RS, // Register Select
   output RnW, // Read/Write
   output E, // Operation Enable
-  inout [7:0] DB, // 8-bit Data Bus
+  input [7:0] DB_in, // 8-bit Data Bus from the pads
+  output [7:0] DB_out, // 8-bit Data Bus to the pads
+  output DB_oe, // Data Bus output enable (low while the LCD drives DB)
   
   // I2C signals
   output SCL,
@@ -35,38 +58,70 @@ module soc(
 timeunit 1ns;
 timeprecision 100ps;
 
-  // Global & Master AHB Signals
+  // Global & Shared Bus AHB Signals
   wire [31:0] HADDR, HWDATA, HRDATA;
   wire [1:0] HTRANS;
   wire [2:0] HSIZE, HBURST;
   wire [3:0] HPROT;
   wire HWRITE, HMASTLOCK, HRESP, HREADY;
 
+  // Per-Master AHB Signals
+  wire [31:0] HADDR_M0, HWDATA_M0;
+  wire [1:0] HTRANS_M0;
+  wire [2:0] HSIZE_M0, HBURST_M0;
+  wire [3:0] HPROT_M0;
+  wire HWRITE_M0, HREADY_M0, HRESP_M0;
+
+  wire [31:0] HADDR_DMA, HWDATA_DMA;
+  wire [1:0] HTRANS_DMA;
+  wire [2:0] HSIZE_DMA;
+  wire HWRITE_DMA, HBUSREQ_DMA, HGRANT_DMA, HRESP_DMA;
+
   // Per-Slave AHB Signals
-  wire HSEL_ROM, HSEL_RAM, HSEL_BUTTON, HSEL_LCD, HSEL_I2C;
-  wire [31:0] HRDATA_ROM, HRDATA_RAM, HRDATA_BUTTON, HRDATA_LCD, HRDATA_I2C;
-  wire HREADYOUT_ROM, HREADYOUT_RAM, HREADYOUT_BUTTON, HREADYOUT_LCD, HREADYOUT_I2C;
+  wire HSEL_ROM, HSEL_RAM, HSEL_BUTTON, HSEL_LCD, HSEL_I2C, HSEL_DMA, HSEL_COMP, HSEL_TIMER, HSEL_ALARM;
+  wire [31:0] HRDATA_ROM, HRDATA_RAM, HRDATA_BUTTON, HRDATA_LCD, HRDATA_I2C, HRDATA_DMA, HRDATA_COMP, HRDATA_TIMER, HRDATA_ALARM;
+  wire HREADYOUT_ROM, HREADYOUT_RAM, HREADYOUT_BUTTON, HREADYOUT_LCD, HREADYOUT_I2C, HREADYOUT_DMA, HREADYOUT_COMP, HREADYOUT_TIMER, HREADYOUT_ALARM;
+
+  // DMA triggers and interrupts
+  wire I2C_DataValid, LCD_Busy, DMA_IRQ, I2C_IRQ, TIMER_IRQ, ALARM_IRQ, BUTTON_IRQ;
+
+  // Latched raw pressure from the I2C sequencer to the threshold comparator
+  wire [23:0] I2C_Pressure;
+  wire I2C_NewSample;
 
   // Non-AHB M0 Signals
   wire TXEV, RXEV, SLEEPING, SYSRESETREQ, NMI;
   wire [15:0] IRQ;
   wire LOCKUP;
   
-  // Set this to zero because simple slaves do not generate errors
-  assign HRESP = '0;
-
-  // Set all interrupt and event inputs to zero (unused in this design) 
+  // Warm reset, one clock cycle long (taking the reset away clears SYSRESETREQ)
+  logic SYSRESETn;
+
+  always_ff @(posedge HCLK, negedge HRESETn)
+    if ( ! HRESETn )
+      SYSRESETn <= '0;
+    else
+      SYSRESETn <= ! ( SYSRESETREQ || LOCKUP ) || ! SYSRESETn;
+
+  // The slaves do not generate errors, HRESP comes from the interconnect
+  // (ERROR response for transfers to unmapped addresses) and is passed by the
+  // arbiter to the master which made the transfer
+
+  // Set unused interrupt and event inputs to zero
+  //  IRQ 0: ahb_timer, IRQ 1: ahb_alarm, IRQ 2: ahb_dma, IRQ 3: ahb_buttons,
+  //  IRQ 15: ahb_bmp_i2c sequencer
   assign NMI = '0;
-  assign IRQ = {16'b0000_0000_0000_0000};
+  assign IRQ = {I2C_IRQ, 11'b000_0000_0000, BUTTON_IRQ, DMA_IRQ, ALARM_IRQ, TIMER_IRQ};
   assign RXEV = '0;
 
-  // Coretex M0 DesignStart is AHB Master
+  // Coretex M0 DesignStart is AHB Master 0
   CORTEXM0DS m0_1 (
 
     // AHB Signals
-    .HCLK, .HRESETn,
-    .HADDR, .HBURST, .HMASTLOCK, .HPROT, .HSIZE, .HTRANS, .HWDATA, .HWRITE,
-    .HRDATA, .HREADY, .HRESP,                                   
+    .HCLK, .HRESETn(SYSRESETn),
+    .HADDR(HADDR_M0), .HBURST(HBURST_M0), .HMASTLOCK, .HPROT(HPROT_M0), .HSIZE(HSIZE_M0),
+    .HTRANS(HTRANS_M0), .HWDATA(HWDATA_M0), .HWRITE(HWRITE_M0),
+    .HRDATA, .HREADY(HREADY_M0), .HRESP(HRESP_M0),
 
     // Non-AHB Signals
     .NMI, .IRQ, .TXEV, .RXEV, .LOCKUP, .SYSRESETREQ, .SLEEPING
@@ -74,14 +129,37 @@ timeprecision 100ps;
   );
 
 
-  // AHB interconnect including address decoder, register and multiplexer
-  ahb_interconnect interconnect_1 (
+  // Arbiter sharing the bus between the processor and the DMA controller
+  ahb_arbiter arbiter_1 (
+
+    .HCLK, .HRESETn(SYSRESETn),
+
+    .HADDR_M0, .HWDATA_M0, .HTRANS_M0, .HSIZE_M0, .HBURST_M0, .HPROT_M0, .HWRITE_M0, .HREADY_M0, .HRESP_M0,
 
-    .HCLK, .HRESETn, .HADDR, .HRDATA, .HREADY,
+    .HADDR_DMA, .HWDATA_DMA, .HTRANS_DMA, .HSIZE_DMA, .HWRITE_DMA, .HBUSREQ_DMA, .HGRANT_DMA, .HRESP_DMA,
 
-    .HSEL_SIGNALS({HSEL_I2C,HSEL_LCD,HSEL_BUTTON,HSEL_RAM,HSEL_ROM}),
-    .HRDATA_SIGNALS({HRDATA_I2C,HRDATA_LCD,HRDATA_BUTTON,HRDATA_RAM,HRDATA_ROM}),
-    .HREADYOUT_SIGNALS({HREADYOUT_I2C,HREADYOUT_LCD,HREADYOUT_BUTTON,HREADYOUT_RAM,HREADYOUT_ROM})
+    .HADDR, .HWDATA, .HTRANS, .HSIZE, .HBURST, .HPROT, .HWRITE, .HREADY, .HRESP
+
+  );
+
+
+  // AHB interconnect including address decoder, register and multiplexer
+  //  ROM 16kB, RAM 1kB (812 bytes fitted), 4kB for each peripheral, everything else is unmapped
+  //  (as are the rest of the RAM region and the COMP and ALARM regions when they are not built)
+  ahb_interconnect #(
+    .num_slaves(9),
+    //            ALARM          TIMER          COMP           DMA            I2C            LCD            BUTTON         RAM            ROM
+    .slave_base({32'hA000_0000, 32'h9000_0000, 32'h8000_0000, 32'h7000_0000, 32'h6000_0000, 32'h5000_0000, 32'h4000_0000, 32'h2000_0000, 32'h0000_0000}),
+    .slave_size({32'h0000_1000, 32'h0000_1000, 32'h0000_1000, 32'h0000_1000, 32'h0000_1000, 32'h0000_1000, 32'h0000_1000, 32'h0000_0400, 32'h0000_4000}),
+    .slave_fitted({alarm ? 32'h0000_1000 : 32'h0, 32'h0000_1000, hardware_compensation ? 32'h0000_1000 : 32'h0,
+                   32'h0000_1000, 32'h0000_1000, 32'h0000_1000, 32'h0000_1000, 32'h0000_032C, 32'h0000_4000})
+  ) interconnect_1 (
+
+    .HCLK, .HRESETn(SYSRESETn), .HADDR, .HTRANS, .HRDATA, .HREADY, .HRESP,
+
+    .HSEL_SIGNALS({HSEL_ALARM,HSEL_TIMER,HSEL_COMP,HSEL_DMA,HSEL_I2C,HSEL_LCD,HSEL_BUTTON,HSEL_RAM,HSEL_ROM}),
+    .HRDATA_SIGNALS({HRDATA_ALARM,HRDATA_TIMER,HRDATA_COMP,HRDATA_DMA,HRDATA_I2C,HRDATA_LCD,HRDATA_BUTTON,HRDATA_RAM,HRDATA_ROM}),
+    .HREADYOUT_SIGNALS({HREADYOUT_ALARM,HREADYOUT_TIMER,HREADYOUT_COMP,HREADYOUT_DMA,HREADYOUT_I2C,HREADYOUT_LCD,HREADYOUT_BUTTON,HREADYOUT_RAM,HREADYOUT_ROM})
 
   );
 
@@ -90,7 +168,7 @@ timeprecision 100ps;
         
   ahb_rom rom_1 (
 
-    .HCLK, .HRESETn, .HADDR, .HWDATA, .HSIZE, .HTRANS, .HWRITE, .HREADY,
+    .HCLK, .HRESETn(SYSRESETn), .HADDR, .HWDATA, .HSIZE, .HTRANS, .HWRITE, .HREADY,
     .HSEL(HSEL_ROM),
     .HRDATA(HRDATA_ROM), .HREADYOUT(HREADYOUT_ROM)
 
@@ -98,7 +176,7 @@ timeprecision 100ps;
 
   ahb_ram ram_1 (
 
-    .HCLK, .HRESETn, .HADDR, .HWDATA, .HSIZE, .HTRANS, .HWRITE, .HREADY,
+    .HCLK, .HRESETn(SYSRESETn), .HADDR, .HWDATA, .HSIZE, .HTRANS, .HWRITE, .HREADY,
     .HSEL(HSEL_RAM),
     .HRDATA(HRDATA_RAM), .HREADYOUT(HREADYOUT_RAM)
 
@@ -106,32 +184,124 @@ timeprecision 100ps;
   
   ahb_buttons buttons_1 (
 
-    .HCLK, .HRESETn, .HADDR, .HWDATA, .HSIZE, .HTRANS, .HWRITE, .HREADY,
+    .HCLK, .HRESETn(SYSRESETn), .HADDR, .HWDATA, .HSIZE, .HTRANS, .HWRITE, .HREADY,
     .HSEL(HSEL_BUTTON),
     .HRDATA(HRDATA_BUTTON), .HREADYOUT(HREADYOUT_BUTTON),
 
-    .nMode(nMode), .nTrip(nTrip)
+    .nButtons({nTrip, nMode}), .IRQ(BUTTON_IRQ)
   
   );
 
   ahb_lcd lcd_1 (
 
-    .HCLK, .HRESETn, .HADDR, .HWDATA, .HSIZE, .HTRANS, .HWRITE, .HREADY,
+    .HCLK, .HRESETn(SYSRESETn), .HADDR, .HWDATA, .HSIZE, .HTRANS, .HWRITE, .HREADY,
     .HSEL(HSEL_LCD),
     .HRDATA(HRDATA_LCD), .HREADYOUT(HREADYOUT_LCD),
 
-    .RS(RS), .RnW(RnW), .E(E), .DB(DB)
+    .RS(RS), .RnW(RnW), .E(E), .DB_in(DB_in), .DB_out(DB_out), .DB_oe(DB_oe),
+
+    .Busy(LCD_Busy)
 
   );
   
-  ahb_bmp_i2c sensor_1 (
+  // the simple interface has no sequencer, so no interrupt and no samples for the comparator
+  generate
+    if ( simple_sensor )
+      begin
+        ahb_simple_i2c sensor_1 (
+
+          .HCLK, .HRESETn, .HADDR, .HWDATA, .HSIZE, .HTRANS, .HWRITE, .HREADY,
+          .HSEL(HSEL_I2C),
+          .HRDATA(HRDATA_I2C), .HREADYOUT(HREADYOUT_I2C),
+
+          .SDA_in(SDA_in), .SDA_out(SDA_out), .SCL(SCL),
+
+          .DataValid(I2C_DataValid)
+
+        );
+
+        assign I2C_IRQ = '0;
+        assign I2C_Pressure = '0;
+        assign I2C_NewSample = '0;
+      end
+    else
+      ahb_bmp_i2c sensor_1 (
+
+        .HCLK, .HRESETn, .HADDR, .HWDATA, .HSIZE, .HTRANS, .HWRITE, .HREADY,
+        .HSEL(HSEL_I2C),
+        .HRDATA(HRDATA_I2C), .HREADYOUT(HREADYOUT_I2C),
+
+        .SDA_in(SDA_in), .SDA_out(SDA_out), .SCL(SCL),
+
+        .DataValid(I2C_DataValid), .IRQ(I2C_IRQ),
+
+        .Pressure(I2C_Pressure), .NewSample(I2C_NewSample)
+
+      );
+  endgenerate
+
+  // DMA channel 0 is triggered by new sensor data, channel 1 by the LCD becoming idle
+  ahb_dma dma_1 (
+
+    .HCLK, .HRESETn(SYSRESETn), .HADDR, .HWDATA, .HSIZE, .HTRANS, .HWRITE, .HREADY,
+    .HSEL(HSEL_DMA),
+    .HRDATA(HRDATA_DMA), .HREADYOUT(HREADYOUT_DMA),
+
+    .HADDR_M(HADDR_DMA), .HWDATA_M(HWDATA_DMA), .HTRANS_M(HTRANS_DMA), .HSIZE_M(HSIZE_DMA),
+    .HWRITE_M(HWRITE_DMA), .HBUSREQ_M(HBUSREQ_DMA), .HGRANT_M(HGRANT_DMA),
+    .HREADY_M(HREADY), .HRESP_M(HRESP_DMA), .HRDATA_M(HRDATA),
+
+    .DREQ({~LCD_Busy, I2C_DataValid}), .IRQ(DMA_IRQ)
+
+  );
+
+  // without the compensation pipeline its address range is unmapped (never selected)
+  generate
+    if ( hardware_compensation )
+      ahb_bmp_comp comp_1 (
+
+        .HCLK, .HRESETn(SYSRESETn), .HADDR, .HWDATA, .HSIZE, .HTRANS, .HWRITE, .HREADY,
+        .HSEL(HSEL_COMP),
+        .HRDATA(HRDATA_COMP), .HREADYOUT(HREADYOUT_COMP)
+
+      );
+    else
+      begin
+        assign HRDATA_COMP = '0;
+        assign HREADYOUT_COMP = '1;
+      end
+  endgenerate
+
+  // HCLK is the 32.768kHz clock, one second is 32768 clock cycles
+  ahb_timer timer_1 (
 
     .HCLK, .HRESETn, .HADDR, .HWDATA, .HSIZE, .HTRANS, .HWRITE, .HREADY,
-    .HSEL(HSEL_I2C),
-    .HRDATA(HRDATA_I2C), .HREADYOUT(HREADYOUT_I2C),
+    .HSEL(HSEL_TIMER),
+    .HRDATA(HRDATA_TIMER), .HREADYOUT(HREADYOUT_TIMER),
 
-    .SDA_in(SDA_in), .SDA_out(SDA_out), .SCL(SCL)
+    .IRQ(TIMER_IRQ)
 
   );
 
+  // compares every raw pressure read by the I2C sequencer
+  // (without the comparator its address range is unmapped)
+  generate
+    if ( alarm )
+      ahb_alarm alarm_1 (
+
+        .HCLK, .HRESETn(SYSRESETn), .HADDR, .HWDATA, .HSIZE, .HTRANS, .HWRITE, .HREADY,
+        .HSEL(HSEL_ALARM),
+        .HRDATA(HRDATA_ALARM), .HREADYOUT(HREADYOUT_ALARM),
+
+        .Pressure(I2C_Pressure), .NewSample(I2C_NewSample), .IRQ(ALARM_IRQ)
+
+      );
+    else
+      begin
+        assign HRDATA_ALARM = '0;
+        assign HREADYOUT_ALARM = '1;
+        assign ALARM_IRQ = '0;
+      end
+  endgenerate
+
 endmodule
@@ -0,0 +1,86 @@
+// Altitude look up table (altitude_lut.h)
+//
+// Generated by software/gen_altitude_lut.py from options.sv, do not edit.
+// Profile mountain_sports: 0 ~ 9000 m, interpolation error max 1.50 m, rms 0.81 m
+
+#ifndef ALTITUDE_LUT_H
+#define ALTITUDE_LUT_H
+
+#include <stdint.h>
+
+#define ALTITUDE_LUT_SIZE 69
+
+// {p/p0 << 14, altitude (m)} in increasing p/p0 order (const, kept in ROM)
+static const uint16_t altitude_lut[ALTITUDE_LUT_SIZE][2] = {
+  { 4968,  9000}, // p/p0 = 0.3032
+  { 4987,  8974}, // p/p0 = 0.3044
+  { 5128,  8786}, // p/p0 = 0.3130
+  { 5252,  8624}, // p/p0 = 0.3206
+  { 5392,  8445}, // p/p0 = 0.3291
+  { 5518,  8287}, // p/p0 = 0.3368
+  { 5639,  8138}, // p/p0 = 0.3442
+  { 5773,  7976}, // p/p0 = 0.3524
+  { 5907,  7817}, // p/p0 = 0.3605
+  { 6053,  7647}, // p/p0 = 0.3694
+  { 6233,  7442}, // p/p0 = 0.3804
+  { 6381,  7277}, // p/p0 = 0.3895
+  { 6542,  7101}, // p/p0 = 0.3993
+  { 6694,  6938}, // p/p0 = 0.4086
+  { 6870,  6753}, // p/p0 = 0.4193
+  { 7035,  6583}, // p/p0 = 0.4294
+  { 7345,  6273}, // p/p0 = 0.4483
+  { 7439,  6181}, // p/p0 = 0.4540
+  { 7509,  6113}, // p/p0 = 0.4583
+  { 7593,  6032}, // p/p0 = 0.4634
+  { 7681,  5948}, // p/p0 = 0.4688
+  { 7774,  5860}, // p/p0 = 0.4745
+  { 7883,  5758}, // p/p0 = 0.4811
+  { 7977,  5671}, // p/p0 = 0.4869
+  { 8097,  5561}, // p/p0 = 0.4942
+  { 8213,  5456}, // p/p0 = 0.5013
+  { 8318,  5362}, // p/p0 = 0.5077
+  { 8424,  5268}, // p/p0 = 0.5142
+  { 8530,  5175}, // p/p0 = 0.5206
+  { 8651,  5070}, // p/p0 = 0.5280
+  { 8805,  4938}, // p/p0 = 0.5374
+  { 8941,  4823}, // p/p0 = 0.5457
+  { 9127,  4668}, // p/p0 = 0.5571
+  { 9256,  4562}, // p/p0 = 0.5649
+  { 9410,  4437}, // p/p0 = 0.5743
+  { 9595,  4289}, // p/p0 = 0.5856
+  { 9751,  4166}, // p/p0 = 0.5952
+  { 9900,  4050}, // p/p0 = 0.6042
+  {10060,  3927}, // p/p0 = 0.6140
+  {10189,  3829}, // p/p0 = 0.6219
+  {10393,  3676}, // p/p0 = 0.6343
+  {10539,  3568}, // p/p0 = 0.6432
+  {10699,  3451}, // p/p0 = 0.6530
+  {10879,  3321}, // p/p0 = 0.6640
+  {11073,  3183}, // p/p0 = 0.6758
+  {11231,  3072}, // p/p0 = 0.6855
+  {11385,  2965}, // p/p0 = 0.6949
+  {11570,  2838}, // p/p0 = 0.7062
+  {11753,  2714}, // p/p0 = 0.7173
+  {11997,  2551}, // p/p0 = 0.7322
+  {12187,  2426}, // p/p0 = 0.7438
+  {12367,  2309}, // p/p0 = 0.7548
+  {12546,  2194}, // p/p0 = 0.7657
+  {12762,  2057}, // p/p0 = 0.7789
+  {12960,  1933}, // p/p0 = 0.7910
+  {13172,  1802}, // p/p0 = 0.8040
+  {13395,  1666}, // p/p0 = 0.8176
+  {13616,  1533}, // p/p0 = 0.8311
+  {13845,  1397}, // p/p0 = 0.8450
+  {14079,  1260}, // p/p0 = 0.8593
+  {14283,  1142}, // p/p0 = 0.8718
+  {14567,   980}, // p/p0 = 0.8891
+  {14791,   854}, // p/p0 = 0.9028
+  {15094,   686}, // p/p0 = 0.9213
+  {15343,   550}, // p/p0 = 0.9365
+  {15599,   412}, // p/p0 = 0.9521
+  {15885,   260}, // p/p0 = 0.9695
+  {16156,   118}, // p/p0 = 0.9861
+  {16384,     0}  // p/p0 = 1.0000
+};
+
+#endif
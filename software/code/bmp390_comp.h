@@ -0,0 +1,201 @@
+// BMP390 calibration data and compensation (bmp390_comp.h)
+//
+// Shared by the firmware (main.c), the reference model used to check the
+// ahb_bmp_comp compensation pipeline (testbench/bmp_comp_ref.c) and the
+// virtual platform (software/vp) so all are guaranteed to compute the same
+// results. Nothing in here accesses hardware.
+
+#ifndef BMP390_COMP_H
+#define BMP390_COMP_H
+
+#include <stdint.h>
+
+// calibration coefficients are held in BMP390 registers 0x31~0x45
+#define BMP390_CALIB_ADDR 0x31
+#define BMP390_CALIB_SIZE 21
+
+typedef struct {
+
+  uint16_t t1;
+  uint16_t t2;
+  int8_t   t3;
+  int16_t  p1;
+  int16_t  p2;
+  int8_t   p3;
+  int8_t   p4;
+  uint16_t p5;
+  uint16_t p6;
+  int8_t   p7;
+  int8_t   p8;
+  int16_t  p9;
+  int8_t   p10;
+  int8_t   p11;
+  int64_t  t_lin;
+
+} BMP390_calib_data;
+
+// unpack the calibration registers (in register order) into the coefficients
+static inline void BMP390_unpack_calib(const uint8_t* buffer, BMP390_calib_data* calib_data){
+
+  calib_data->t1 =  (uint16_t) ( ((uint16_t)(buffer[1]) << 8) | buffer[0] );
+  calib_data->t2 =  (uint16_t) ( ((uint16_t)(buffer[3]) << 8) | buffer[2] );
+  calib_data->t3 =  (int8_t)   ( buffer[4] );
+  calib_data->p1 =  (int16_t)  ( ((uint16_t)(buffer[6]) << 8) | buffer[5] );
+  calib_data->p2 =  (int16_t)  ( ((uint16_t)(buffer[8]) << 8) | buffer[7] );
+  calib_data->p3 =  (int8_t)   ( buffer[9] );
+  calib_data->p4 =  (int8_t)   ( buffer[10] );
+  calib_data->p5 =  (uint16_t) ( ((uint16_t)(buffer[12]) << 8) | buffer[11] );
+  calib_data->p6 =  (uint16_t) ( ((uint16_t)(buffer[14]) << 8) | buffer[13] );
+  calib_data->p7 =  (int8_t)   ( buffer[15] );
+  calib_data->p8 =  (int8_t)   ( buffer[16] );
+  calib_data->p9 =  (int16_t)  ( ((uint16_t)(buffer[18]) << 8) | buffer[17] );
+  calib_data->p10 = (int8_t)   ( buffer[19] );
+  calib_data->p11 = (int8_t)   ( buffer[20] );
+
+}
+
+static inline int64_t BMP390_compensate_temperature(uint32_t uncomp_temp, BMP390_calib_data* calib_data){
+
+  /* translated from bmp390 library by Shifeng Li */
+  /* https://github.com/libdriver/bmp390/blob/main/src/driver_bmp390.c */
+
+  uint64_t partial_data1;
+  uint64_t partial_data2;
+  uint64_t partial_data3;
+  int64_t partial_data4;
+  int64_t partial_data5;
+  int64_t partial_data6;
+  int64_t comp_temp;
+  
+  /* calculate compensate temperature */
+  partial_data1 = (uint64_t)(uncomp_temp - ((uint64_t)(calib_data->t1) << 8));
+  partial_data2 = (uint64_t)(calib_data->t2 * partial_data1);                           // need to divide by 2^30
+  partial_data3 = (uint64_t)(partial_data1 * partial_data1);
+  partial_data4 = (int64_t)(((int64_t)partial_data3) * ((int64_t)calib_data->t3));      // need to divide by 2^48
+  partial_data5 = ((int64_t)(((int64_t)partial_data2) << 18) + (int64_t)partial_data4); // need to divide by 2^48
+  partial_data6 = (int64_t)(((int64_t)partial_data5) >> 32);                            // need to divide by 2^16
+  
+  calib_data->t_lin = partial_data6;
+  
+  //comp_temp = (int64_t)((partial_data6 * 25)  >> 14);     // multiply by 100
+  comp_temp = (int64_t)(partial_data6  >> 16);
+  
+  return comp_temp;
+  
+}
+
+// pressure compensation terms depending only on t_lin, they only need to be
+// recalculated when the temperature (t_lin) changes
+typedef struct {
+
+  int64_t offset;        // offset >> 2, divide by 2^42
+  int64_t sensitivity;   // sensitivity >> 24, divide by 2^42
+  int64_t linear;        // p10 * t_lin + p9 << 16, divide by 2^64
+
+} BMP390_pressure_terms;
+
+static inline void BMP390_pressure_terms_update(const BMP390_calib_data* calib_data, BMP390_pressure_terms* terms){
+
+  /* translated from bmp390 library by Shifeng Li */
+  /* https://github.com/libdriver/bmp390/blob/main/src/driver_bmp390.c */
+
+  int64_t partial_data1;
+  int64_t partial_data2;
+  int64_t partial_data3;
+  int64_t partial_data4;
+  int64_t partial_data5;
+  int64_t partial_data6;
+  int64_t offset;
+  int64_t sensitivity;
+  
+  /* calculate offset and sensitivity */
+  partial_data1 = calib_data->t_lin * calib_data->t_lin;            // divide by 2^32
+  partial_data2 = partial_data1 >> 6;                               // divide by 2^26
+  partial_data3 = (partial_data2 * calib_data->t_lin) >> 8;         // divide by 2^34
+  partial_data4 = (calib_data->p8 * partial_data3) >> 5;            // divide by 2^44
+  partial_data5 = (calib_data->p7 * partial_data1) << 4;            // divide by 2^44
+  partial_data6 = (calib_data->p6 * calib_data->t_lin) << 22;       // divide by 2^44
+  offset = (int64_t)((int64_t)(calib_data->p5) << 47) + partial_data4 + partial_data5 + partial_data6; // divide by 2^44
+  
+  partial_data2 = (((int64_t)calib_data->p4) * partial_data3) >> 5;                          // divide by 2^66
+  partial_data4 = (calib_data->p3 * partial_data1) << 2;                                     // divide by 2^66
+  partial_data5 = ((int64_t)(calib_data->p2) - 16384) * ((int64_t)calib_data->t_lin) << 21;  // divide by 2^66
+  sensitivity = (((int64_t)(calib_data->p1) - 16384) << 46) + partial_data2 + partial_data4 + partial_data5; // divide by 2^66
+  
+  terms->offset = offset >> 2;                                                          // divide by 2^42
+  terms->sensitivity = sensitivity >> 24;                                               // divide by 2^42
+  terms->linear = (int64_t)(calib_data->p10) * (int64_t)(calib_data->t_lin) + ((int64_t)(calib_data->p9) << 16); // divide by 2^64
+  
+}
+
+static inline int64_t BMP390_compensate_pressure_terms(uint32_t uncomp_press, const BMP390_calib_data* calib_data,
+                                                       const BMP390_pressure_terms* terms){
+
+  int64_t partial_data1;
+  int64_t partial_data2;
+  int64_t partial_data3;
+  int64_t partial_data4;
+  int64_t partial_data5;
+  int64_t partial_data6;
+  uint64_t comp_press;
+  
+  /* calculate compensate pressure */
+  partial_data1 = terms->sensitivity * uncomp_press;                              // divide by 2^42
+  partial_data4 = (terms->linear * uncomp_press) >> 13;                           // divide by 2^51
+  partial_data5 = ((partial_data4 / 10) * uncomp_press) >> 9;                            // divide by 10 then multiply by 10 to avoid overflow
+  partial_data5 = (partial_data5 * 10);                                            // divide by 2^42   
+  partial_data6 = (int64_t)((uint64_t)uncomp_press * (uint64_t)uncomp_press);
+  partial_data2 = ((int64_t)(calib_data->p11) * (int64_t)(partial_data6)) >> 16;  // divide by 2^49
+  partial_data3 = (partial_data2 * uncomp_press) >> 7;                            // divide by 2^42
+  partial_data4 = terms->offset + partial_data1 + partial_data5 + partial_data3;  // divide by 2^42
+  
+  //comp_press = (((uint64_t)partial_data4 * 25) >> 40);     // multiply by 100
+  comp_press = ((uint64_t)partial_data4 >> 42);     // multiply by 100
+  
+  return comp_press;
+  
+}
+
+static inline int64_t BMP390_compensate_pressure(uint32_t uncomp_press, BMP390_calib_data* calib_data){
+
+  BMP390_pressure_terms terms;
+  
+  BMP390_pressure_terms_update(calib_data, &terms);
+  
+  return BMP390_compensate_pressure_terms(uncomp_press, calib_data, &terms);
+  
+}
+
+// raw pressure compensated to (within ~1Pa of) pressure_Pa at the current t_lin, the inverse of
+// BMP390_compensate_pressure_terms(). Starting from a recent raw reading (uncomp_hint) the error is
+// corrected along the chord through two readings 0x10000 apart, the compensation is so close to
+// linear that this converges in a few steps whichever way raw pressure changes with pressure.
+#define BMP390_UNCOMP_CHORD 0x10000
+#define BMP390_UNCOMP_STEPS 4
+
+static inline uint32_t BMP390_uncompensate_pressure_terms(int64_t pressure_Pa, uint32_t uncomp_hint,
+                                                          const BMP390_calib_data* calib_data,
+                                                          const BMP390_pressure_terms* terms){
+
+  int64_t uncomp, chord_Pa, error;
+
+  if(uncomp_hint > 0xFFFFFF - BMP390_UNCOMP_CHORD) uncomp_hint = 0xFFFFFF - BMP390_UNCOMP_CHORD;
+
+  chord_Pa = BMP390_compensate_pressure_terms(uncomp_hint + BMP390_UNCOMP_CHORD, calib_data, terms) -
+             BMP390_compensate_pressure_terms(uncomp_hint, calib_data, terms);
+  if(chord_Pa == 0) return uncomp_hint;
+
+  uncomp = uncomp_hint;
+  for(int i = 0; i < BMP390_UNCOMP_STEPS; i++){
+    error = pressure_Pa - BMP390_compensate_pressure_terms((uint32_t) uncomp, calib_data, terms);
+    if(error == 0) break;
+    uncomp += (error * BMP390_UNCOMP_CHORD) / chord_Pa;
+    if(uncomp < 0) uncomp = 0;
+    if(uncomp > 0xFFFFFF) uncomp = 0xFFFFFF;
+  }
+
+  return (uint32_t) uncomp;
+
+}
+
+#endif
@@ -17,6 +17,9 @@ extern uint32_t _etext;
 /* This is the main */
 extern int main (void);
 
+/* SysTick, the timebase of main (it uses no RAM so it can be started first) */
+extern void SysTick_Init (uint32_t ticks);
+
 /***************************************************************************/
 /*  ResetHandler                                                           */
 /*                                                                         */
@@ -27,12 +30,27 @@ void ResetHandler (void)
    uint32_t *pDest;
    uint32_t *pSrc;
    
+   /* start counting from reset, 32768 ticks for 1s at 32.768kHz
+      (main measures the time to the first display from here) */
+   SysTick_Init(32768);
+   
    /* Initialised data must be copied from ROM to RAM before calling main */
    pSrc = &_etext;
    pDest = &_sdata;
 
    if ( pSrc != pDest ) {
      /* this will only be run if there is any read-only memory */
+     /* copy four words per iteration (the compiler turns these into ldm/stm) */
+     while(pDest + 4 <= &_edata)
+     {
+        pDest[0] = pSrc[0];
+        pDest[1] = pSrc[1];
+        pDest[2] = pSrc[2];
+        pDest[3] = pSrc[3];
+        pDest += 4;
+        pSrc += 4;
+     }
+     /* copy any remaining words */
      while(pDest < &_edata)
      {
         *pDest++ = *pSrc++;
@@ -40,12 +58,22 @@ void ResetHandler (void)
    }
 
    /* BSS segment (if it exists) must be cleared before calling main */
+   /* sections are word aligned by the linker script so whole words can be cleared */
    pDest = &_sbss;
+   while(pDest + 4 <= &_ebss)
+   {
+      pDest[0] = 0;
+      pDest[1] = 0;
+      pDest[2] = 0;
+      pDest[3] = 0;
+      pDest += 4;
+   }
    while(pDest < &_ebss)
    {
       *pDest++ = 0;
    }
    
+   /* the .noinit section (retained across a warm reset) is left as it is */
    
    /* call main */       
    main();    
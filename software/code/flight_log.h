@@ -0,0 +1,194 @@
+// Delta encoded flight log (flight_log.h)
+//
+// Keeps the altitude history in a fixed ring of 4-bit fields (nibbles) so the
+// most samples fit in the little RAM there is. Each sample is stored as the
+// zig-zag encoded difference from the previous one:
+//
+//   0x0~0xE          : delta -7~+7 (one nibble)
+//   0xF, byte        : delta -127~+127 (three nibbles, byte 0x00~0xFE)
+//   0xF, 0xFF, int16 : keyframe, absolute altitude (seven nibbles)
+//
+// Every block of samples starts with a keyframe (at least every
+// FLIGHT_LOG_KEYFRAME samples and whenever a delta does not fit in a byte).
+// When the ring is full the oldest block is dropped, so appending is O(1).
+// With up to +-2 m between samples a 128 byte log holds ~200 samples, ~13
+// minutes at one sample every 4 seconds.
+//
+// Shared by the firmware (main.c) and host tools, nothing in here accesses
+// hardware.
+
+#ifndef FLIGHT_LOG_H
+#define FLIGHT_LOG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifndef FLIGHT_LOG_BYTES
+#define FLIGHT_LOG_BYTES 128      // ring size
+#endif
+#ifndef FLIGHT_LOG_KEYFRAME
+#define FLIGHT_LOG_KEYFRAME 32    // samples between keyframes
+#endif
+#define FLIGHT_LOG_KEYS 8         // blocks held, the oldest is also dropped when more are needed
+
+#define FLIGHT_LOG_NIBBLES (2 * FLIGHT_LOG_BYTES)
+#define FLIGHT_LOG_ESCAPE 0xF
+#define FLIGHT_LOG_KEY_MARK 0xFF
+
+typedef struct {
+
+  uint8_t  data[FLIGHT_LOG_BYTES];        // nibble n in bits 3~0 (n even) or 7~4 (n odd) of data[n / 2]
+  uint16_t head;                          // next nibble to be written
+  uint16_t key_pos[FLIGHT_LOG_KEYS];      // first nibble of each block (ring, oldest at key_first)
+  uint8_t  key_samples[FLIGHT_LOG_KEYS];  // samples in each block
+  uint8_t  key_first;
+  uint8_t  key_count;
+  uint16_t samples;                       // samples held
+  int16_t  last;                          // last altitude appended
+
+} flight_log;
+
+typedef struct {
+
+  uint16_t pos;
+  uint16_t remaining;
+  int16_t  altitude;
+
+} flight_log_cursor;
+
+static inline void flight_log_clear(flight_log* log){
+
+  log->head = 0;
+  log->key_first = 0;
+  log->key_count = 0;
+  log->samples = 0;
+  log->last = 0;
+
+}
+
+static inline void flight_log_put(flight_log* log, uint32_t nibble){
+
+  uint8_t* byte = &log->data[log->head >> 1];
+
+  if(log->head & 1)
+    *byte = (uint8_t) ((*byte & 0x0F) | (nibble << 4));
+  else
+    *byte = (uint8_t) ((*byte & 0xF0) | nibble);
+
+  log->head = (log->head + 1 == FLIGHT_LOG_NIBBLES) ? 0 : log->head + 1;
+
+}
+
+static inline uint32_t flight_log_get(const flight_log* log, uint16_t* pos){
+
+  uint32_t nibble = (log->data[*pos >> 1] >> ((*pos & 1) << 2)) & 0xF;
+
+  *pos = (*pos + 1 == FLIGHT_LOG_NIBBLES) ? 0 : *pos + 1;
+
+  return nibble;
+
+}
+
+static inline void flight_log_drop_oldest(flight_log* log){
+
+  log->samples -= log->key_samples[log->key_first];
+  log->key_first = (log->key_first + 1) % FLIGHT_LOG_KEYS;
+  log->key_count--;
+
+}
+
+// nibbles free in front of the oldest block (blocks are never empty, so head
+// reaching the oldest block means the ring is full)
+static inline uint32_t flight_log_free(const flight_log* log){
+
+  if(log->key_count == 0) return FLIGHT_LOG_NIBBLES;
+
+  return (log->key_pos[log->key_first] + FLIGHT_LOG_NIBBLES - log->head) % FLIGHT_LOG_NIBBLES;
+
+}
+
+static inline void flight_log_append(flight_log* log, int32_t altitude){
+
+  int32_t delta = altitude - log->last;
+  uint32_t zigzag = (delta < 0) ? (uint32_t)(-2 * delta - 1) : (uint32_t)(2 * delta);
+  uint32_t last_block = (log->key_first + log->key_count - 1) % FLIGHT_LOG_KEYS;
+  bool key = (log->key_count == 0) || (log->key_samples[last_block] >= FLIGHT_LOG_KEYFRAME) ||
+             (zigzag >= FLIGHT_LOG_KEY_MARK);
+  uint32_t nibbles = (key) ? 7 : (zigzag < FLIGHT_LOG_ESCAPE) ? 1 : 3;
+
+  // make room by dropping the oldest blocks (never the one being appended to,
+  // a block of at most 7 + 3 * (FLIGHT_LOG_KEYFRAME - 1) nibbles is much smaller than the ring)
+  if(key && log->key_count == FLIGHT_LOG_KEYS)
+    flight_log_drop_oldest(log);
+  while(flight_log_free(log) < nibbles)
+    flight_log_drop_oldest(log);
+
+  if(key){
+    last_block = (log->key_first + log->key_count) % FLIGHT_LOG_KEYS;
+    log->key_pos[last_block] = log->head;
+    log->key_samples[last_block] = 0;
+    log->key_count++;
+    flight_log_put(log, FLIGHT_LOG_ESCAPE);
+    flight_log_put(log, FLIGHT_LOG_KEY_MARK & 0xF);
+    flight_log_put(log, FLIGHT_LOG_KEY_MARK >> 4);
+    flight_log_put(log, altitude & 0xF);
+    flight_log_put(log, (altitude >> 4) & 0xF);
+    flight_log_put(log, (altitude >> 8) & 0xF);
+    flight_log_put(log, (altitude >> 12) & 0xF);
+  }
+  else if(nibbles == 1)
+    flight_log_put(log, zigzag);
+  else {
+    flight_log_put(log, FLIGHT_LOG_ESCAPE);
+    flight_log_put(log, zigzag & 0xF);
+    flight_log_put(log, zigzag >> 4);
+  }
+
+  log->key_samples[last_block]++;
+  log->samples++;
+  log->last = (int16_t) altitude;
+
+}
+
+// replay the log from the oldest sample
+static inline void flight_log_begin(const flight_log* log, flight_log_cursor* cursor){
+
+  cursor->pos = (log->key_count > 0) ? log->key_pos[log->key_first] : log->head;
+  cursor->remaining = log->samples;
+  cursor->altitude = 0;
+
+}
+
+// get the next sample, returns 0 when there are no more
+static inline bool flight_log_next(const flight_log* log, flight_log_cursor* cursor, int32_t* altitude){
+
+  uint32_t nibble, byte;
+
+  if(cursor->remaining == 0) return 0;
+
+  nibble = flight_log_get(log, &cursor->pos);
+  if(nibble != FLIGHT_LOG_ESCAPE)
+    byte = nibble;
+  else {
+    byte = flight_log_get(log, &cursor->pos);
+    byte |= flight_log_get(log, &cursor->pos) << 4;
+    if(byte == FLIGHT_LOG_KEY_MARK){
+      uint32_t value = flight_log_get(log, &cursor->pos);
+      value |= flight_log_get(log, &cursor->pos) << 4;
+      value |= flight_log_get(log, &cursor->pos) << 8;
+      value |= flight_log_get(log, &cursor->pos) << 12;
+      cursor->altitude = (int16_t) value;
+      byte = 0;
+    }
+  }
+
+  // undo the zig-zag encoding
+  cursor->altitude += (byte & 1) ? -(int32_t)((byte + 1) >> 1) : (int32_t)(byte >> 1);
+  cursor->remaining--;
+  *altitude = cursor->altitude;
+
+  return 1;
+
+}
+
+#endif
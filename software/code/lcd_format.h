@@ -0,0 +1,134 @@
+// Display formatter (lcd_format.h)
+//
+// Every display is described by a format: the 8 characters it always shows
+// (already packed into the two words written to the LCD interface, character
+// 0 in bits 7~0 of the first word) and which of them are digits. A number
+// (or a set of digits) is converted into those digit characters, the rest of
+// the display is left as it is.
+//
+// The Cortex-M0 has no divide instruction, so digits are found by repeated
+// subtraction of powers of ten (at most 9 per digit) rather than with / and %
+// (a library call each), and digit characters come from a 16 byte table.
+//
+// Nothing in here accesses hardware.
+
+#ifndef LCD_FORMAT_H
+#define LCD_FORMAT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// 4 characters packed as written to the LCD interface (leftmost character first)
+#define LCD_WORD(c0, c1, c2, c3) \
+  ((uint32_t)(c0) | ((uint32_t)(c1) << 8) | ((uint32_t)(c2) << 16) | ((uint32_t)(c3) << 24))
+
+#define LCD_LABEL   0x00   // character replaced by the label of the display
+#define LCD_NO_SIGN 8      // no sign character
+
+#define LCD_MAX_DIGITS 6
+
+typedef struct {
+
+  uint32_t text[2];   // characters 0~3 and 4~7 shown around the digits
+  uint8_t  digits;    // bit i set when character i is a digit (most significant leftmost)
+  uint8_t  power;     // power of ten of the least significant digit
+  uint8_t  blank;     // up to this many leading zero digits are shown blank
+  uint8_t  sign;      // character which is '-' for a negative number (LCD_NO_SIGN for none)
+
+} lcd_format;
+
+static const uint8_t lcd_hex_digits[16] = {
+  '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'A', 'B', 'C', 'D', 'E', 'F'
+};
+
+static const uint32_t lcd_powers_of_ten[LCD_MAX_DIGITS + 2] = {
+  1, 10, 100, 1000, 10000, 100000, 1000000, 10000000
+};
+
+// characters of a format with its digits (least significant first, 0~15) filled in
+static inline void lcd_format_digits(const lcd_format* format, const uint8_t* digits, uint8_t label,
+                                     uint32_t* words){
+
+  uint32_t shift, character;
+  uint8_t blank = format->blank;
+  int i, n;
+
+  words[0] = format->text[0];
+  words[1] = format->text[1];
+
+  // count the digit characters, the most significant digit is the leftmost one
+  n = 0;
+  for(i = 0; i < 8; i++)
+    if(format->digits & (1 << i)) n++;
+
+  for(i = 0; i < 8; i++){
+    shift = (i & 3) << 3;
+    if(format->digits & (1 << i)){
+      n--;
+      if(blank && n > 0 && digits[n] == 0){
+        blank--;
+        character = ' ';
+      }
+      else{
+        blank = 0;
+        character = lcd_hex_digits[digits[n] & 0xF];
+      }
+      words[i >> 2] = (words[i >> 2] & ~(0xFFu << shift)) | (character << shift);
+    }
+    else if(((words[i >> 2] >> shift) & 0xFF) == LCD_LABEL)
+      words[i >> 2] |= (uint32_t)label << shift;
+  }
+
+}
+
+// characters of a format showing a number (its magnitude and whether it is negative),
+// a magnitude too big for the digits shows all 9s
+static inline void lcd_format_number(const lcd_format* format, uint32_t magnitude, bool negative,
+                                     uint8_t label, uint32_t* words){
+
+  uint8_t digits[LCD_MAX_DIGITS];
+  uint32_t power, shift;
+  int i, n;
+
+  n = 0;
+  for(i = 0; i < 8; i++)
+    if(format->digits & (1 << i)) n++;
+
+  if(magnitude >= lcd_powers_of_ten[format->power + n])
+    magnitude = lcd_powers_of_ten[format->power + n] - 1;
+
+  // most significant digit first, whatever is below the least significant one is left over
+  for(i = n - 1; i >= 0; i--){
+    power = lcd_powers_of_ten[format->power + i];
+    digits[i] = 0;
+    while(magnitude >= power){
+      magnitude -= power;
+      digits[i]++;
+    }
+  }
+
+  lcd_format_digits(format, digits, label, words);
+
+  if(negative && format->sign != LCD_NO_SIGN){
+    shift = (format->sign & 3) << 3;
+    words[format->sign >> 2] = (words[format->sign >> 2] & ~(0xFFu << shift)) | ((uint32_t)'-' << shift);
+  }
+
+}
+
+// characters of a format showing BCD digits (one per nibble, least significant in bits 3~0)
+static inline void lcd_format_bcd(const lcd_format* format, uint32_t bcd, uint8_t label, uint32_t* words){
+
+  uint8_t digits[LCD_MAX_DIGITS];
+  int i;
+
+  for(i = 0; i < LCD_MAX_DIGITS; i++){
+    digits[i] = bcd & 0xF;
+    bcd >>= 4;
+  }
+
+  lcd_format_digits(format, digits, label, words);
+
+}
+
+#endif
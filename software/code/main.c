@@ -7,19 +7,48 @@
 #include <fptc.h>
 #include <ARMCM0.h>
 #include <core_cm0.h>
+#include "options.h"           // SIMPLE_SENSOR, HARDWARE_COMPENSATION and ALTITUDE_ALARM, ahead of retain.h
+#include "bmp390_comp.h"
+#include "altitude_lut.h"
+#include "flight_log.h"
+#include "trip_stats.h"
+#include "lcd_format.h"
+#include "retain.h"
 
 // Define the raw base address values for the i/o devices
 
 #define AHB_BUTTON_BASE                         0x40000000
 #define AHB_LCD_BASE                            0x50000000
 #define AHB_I2C_BASE                            0x60000000
+#define AHB_COMP_BASE                           0x80000000
+#define AHB_TIMER_BASE                          0x90000000
+#define AHB_ALARM_BASE                          0xA0000000
+
+// With ALTITUDE_ALARM (options.h, from include_alarm in options.sv) an ahb_alarm interrupt
+// shows the altitude when it leaves ALARM_MIN_ALTITUDE ~ ALARM_MAX_ALTITUDE (0 is no lower
+// limit), or the VSI when it moves by more than ALARM_RATE_STEP within ALARM_RATE_PERIOD_MS,
+// and the processor sleeps between SysTick interrupts
+#define ALARM_MIN_ALTITUDE 0
+#define ALARM_MAX_ALTITUDE 3000
+#define ALARM_RATE_STEP 30            // m
+#define ALARM_RATE_PERIOD_MS 10000
+
+// the simple sensor has nothing to compensate and no sequencer to feed the pressure alarm
+#ifdef SIMPLE_SENSOR
+#undef HARDWARE_COMPENSATION
+#ifdef ALTITUDE_ALARM
+#error "ALTITUDE_ALARM needs the ahb_bmp_i2c sequencer (SIMPLE_SENSOR is defined)"
+#endif
+#endif
 
 // Define pointers with correct type for access to 32-bit i/o devices
 //
 // The locations in the devices can then be accessed as:
 //   Button Interface
-//    BUTTON_REGS[0]: bit 0 -> mode, bit 1 -> trip, bit 2 -> both
+//    BUTTON_REGS[0]: bit 0 -> mode, bit 1 -> trip, bit 2 -> both, bit 3 -> long press (with the others)
 //    BUTTON_REGS[1]: bit 0 -> datavalid
+//    BUTTON_REGS[2]: buttons in the last press (bit 0 -> mode, bit 1 -> trip)
+//    BUTTON_REGS[3]: buttons pressed now (debounced)
 //   I2C
 //    I2C_REGS[0]: bits 7~0 -> device address
 //    I2C_REGS[1]: 4 sets of byte register addresses
@@ -27,45 +56,123 @@
 //    I2C_REGS[3]: upper 2 bytes from data read
 //    I2C_REGS[4]: 4 write bytes
 //    I2C_REGS[5]: bit 0 -> r/w, bit 1 -> start, bit 2~4 -> n bytes
-//    I2C_REGS[6]: bit 0 -> datavalid, bit 1 -> busy flag
+//    I2C_REGS[6]: bit 0 -> datavalid, bit 1 -> busy flag, bit 2 -> sample ready, bit 3 -> sum ready
+//    (ahb_simple_i2c stops here, it has neither the sample ready and sum ready bits nor the registers below)
+//    I2C_REGS[7]: bit 0 -> sequencer enable, bit 1 -> sequencer interrupt enable, bits 4~2 -> log2 samples summed,
+//                 bits 15~8 -> temperature interval (temperature read with one in every n + 1 samples)
+//    I2C_REGS[8]: bits 23~0 -> sequencer period (clock cycles)
+//    I2C_REGS[9]: bits 23~0 -> latched raw pressure, bits 31~24 -> sequence number
+//    I2C_REGS[10]: bits 23~0 -> latched raw temperature, bits 31~24 -> sequence number of the sample it was read with
+//    I2C_REGS[11]: bits 30~0 -> sum of the last 2^n raw pressures
+//    I2C_REGS[12]: bit 0 -> queue start/busy, bits 3~1 -> last entry, bit 4 -> queue interrupt enable,
+//                  bit 5 -> queue done, bit 6 -> queue error, bits 10~8 -> current entry
+//    I2C_REGS[16~23]: queue entries (see I2C_QUEUE_ENTRY)
+//    I2C_REGS[24~31]: 32 byte queue buffer
 //   LCD
 //    LCD_REGS[0]: contains characters to be written to DDRAM[3~0]
 //    LCD_REGS[1]: contains characters to be written to DDRAM[7~4]
 //    LCD_REGS[2]: 10 bits instruction code
-//    LCD_REGS[3]: bit 0 -> D/I, bit 1 -> enable
-//    LCD_REGS[4]: bit 0 -> busy flag
+//    LCD_REGS[3]: bit 0 -> D/I, bit 1 -> enable, bit 2 -> no busy check
+//    LCD_REGS[4]: bit 0 -> busy flag (set until the LCD has finished the transfer)
+//    LCD_REGS[5]: last byte read from the LCD
+//   Compensation pipeline
+//    COMP_REGS[0~5]: calibration registers 0x31~0x45 (0x31 in bits 7~0 of COMP_REGS[0])
+//    COMP_REGS[6]: bits 23~0 -> raw temperature
+//    COMP_REGS[7]: bits 23~0 -> raw pressure
+//    COMP_REGS[8]: bit 0 -> start temperature (and t_lin terms), bit 1 -> start pressure, bit 2 -> start t_lin terms
+//    COMP_REGS[9]: bit 0 -> busy flag
+//    COMP_REGS[10]: t_lin
+//    COMP_REGS[11]: compensated temperature
+//    COMP_REGS[12]: compensated pressure (Pa)
+//   Trip timer
+//    TIMER_REGS[0]: bit 0 -> run, bit 1 -> interrupt enable, bit 2 -> reset
+//    TIMER_REGS[1]: BCD time, bits 23~16 -> hours, bits 15~8 -> minutes, bits 7~0 -> seconds
+//    TIMER_REGS[2]: bits 15~0 -> clock cycles since the last second
+//    TIMER_REGS[3]: seconds since reset
+//    TIMER_REGS[4]: bit 0 -> second flag
+//   Pressure alarm
+//    ALARM_REGS[0]: bits 23~0 -> lower threshold (raw pressure)
+//    ALARM_REGS[1]: bits 23~0 -> upper threshold (raw pressure)
+//    ALARM_REGS[2]: bit 0 -> enable, bit 1 -> interrupt enable, bits 7~4 -> consecutive samples outside - 1
+//    ALARM_REGS[3]: bit 0 -> below lower threshold, bit 1 -> above upper threshold
+//    ALARM_REGS[4]: bits 23~0 -> last raw pressure compared
 //
-volatile uint32_t* BUTTON_REGS = (volatile uint32_t*) AHB_BUTTON_BASE;
-volatile uint32_t* LCD_REGS = (volatile uint32_t*) AHB_LCD_BASE;
-volatile uint32_t* I2C_REGS = (volatile uint32_t*) AHB_I2C_BASE;
+// (const pointers are kept in ROM rather than copied into RAM at reset)
+volatile uint32_t* const BUTTON_REGS = (volatile uint32_t*) AHB_BUTTON_BASE;
+volatile uint32_t* const LCD_REGS = (volatile uint32_t*) AHB_LCD_BASE;
+volatile uint32_t* const I2C_REGS = (volatile uint32_t*) AHB_I2C_BASE;
+volatile uint32_t* const COMP_REGS = (volatile uint32_t*) AHB_COMP_BASE;
+volatile uint32_t* const TIMER_REGS = (volatile uint32_t*) AHB_TIMER_BASE;
+volatile uint32_t* const ALARM_REGS = (volatile uint32_t*) AHB_ALARM_BASE;
 
 //////////////////////////////////////////////////////////////////
 // Global variables
 //////////////////////////////////////////////////////////////////
 
+#ifndef SIMPLE_SENSOR
+BMP390_calib_data calib_data_global;
+BMP390_pressure_terms pressure_terms_global;
+#endif
+
+#define VSI_QUEUE_SIZE 8
+
+// value of the BMP390 data registers before the first conversion has completed
+#define BMP390_DATA_RESET 0x800000
+
+// the simple sensor is read every SENSOR_PERIOD_MS, as often as the sequencer reads the BMP390
+#define SENSOR_PERIOD_MS 20
+
+// the displayed pressure is the mean of 2^PRESS_ACC_LOG2 sensor samples (summed by the I2C sequencer)
+#define PRESS_ACC_LOG2 2
+
+// temperature changes slowly, the sequencer only reads it with one in every TEMP_INTERVAL + 1
+// samples (0.5s), the others are 3 byte pressure only reads
+#define TEMP_INTERVAL 24
+
+// t_lin (and the pressure terms depending on it) is only recalculated when a new temperature
+// reading differs from the one it was calculated from by more than TEMP_THRESHOLD (raw, ~0.04C)
+// or has not been recalculated for TEMP_MAX_AGE temperature readings (10s)
+#define TEMP_THRESHOLD 2048
+#define TEMP_MAX_AGE 20
+
+// the altitude is added to the flight log every FLIGHT_LOG_INTERVAL_MS,
+// a replay shows each logged altitude for FLIGHT_LOG_REPLAY_MS
+#define FLIGHT_LOG_INTERVAL_MS 4000
+#define FLIGHT_LOG_REPLAY_MS 250
+
+flight_log flight_log_global;   // all zero is an empty log
+
+trip_stats trip_stats_global;   // reset with the trip timer
+
+// results worked out from the current sample (see the per-sample pipeline)
+#define SAMPLE_PRESSURE (1 << 0)
+#define SAMPLE_ALTITUDE (1 << 1)
+
 typedef struct {
 
-  uint16_t t1;
-  uint16_t t2;
-  int8_t   t3;
-  int16_t  p1;
-  int16_t  p2;
-  int8_t   p3;
-  int8_t   p4;
-  uint16_t p5;
-  uint16_t p6;
-  int8_t   p7;
-  int8_t   p8;
-  int16_t  p9;
-  int8_t   p10;
-  int8_t   p11;
-  int64_t  t_lin;
-
-} BMP390_calib_data;
+  uint32_t uncomp_pres;     // the pressure in Pa from the simple sensor
+#ifndef SIMPLE_SENSOR
+  uint32_t uncomp_temp;
+  bool     update_temp;     // t_lin is recalculated with the next pressure
+#endif
+  uint32_t p0;
+  uint32_t valid;           // SAMPLE_* results already worked out for this sample
+  int64_t  pressure_Pa;
+  uint32_t altitude;
+#ifndef SIMPLE_SENSOR
+  int64_t  temperature_C;   // unused
+#endif
 
-BMP390_calib_data calib_data_global;
+} sample_pipeline;
 
-#define VSI_QUEUE_SIZE 8
+sample_pipeline sample_global = { .p0 = 101325 };
+
+// calibration (BMP390 only), p0 and trip statistics kept across a warm reset (see retain.h)
+retained_state retained_global __attribute__((section(".noinit")));
+
+// reset-to-first-display time in SysTick ticks (32.768kHz), zero until the first pressure is shown
+// (SysTick is started by ResetHandler, so it includes the .data and .bss initialisation)
+volatile uint32_t boot_ticks = 0;
 
 //////////////////////////////////////////////////////////////////
 // Functions to access button interface
@@ -83,6 +190,16 @@ uint32_t buttons_read(void){
 
 }
 
+#define BUTTON_IRQn            ((IRQn_Type) 3)
+
+// the interrupt is held until the gesture is read, it is only there to end a WFI
+// so the handler turns it off and it is enabled again before the next one
+void BUTTON_IRQHandler(void){
+
+  NVIC_DisableIRQ(BUTTON_IRQn);
+
+}
+
 void button_wait_for_any_data(void) {
 
   // this is a 'busy wait'
@@ -180,6 +297,134 @@ void i2c_enable (uint32_t r_w, uint32_t nbytes){
 
 }
 
+// the sequencer, its sum and the command queue are only in ahb_bmp_i2c
+#ifndef SIMPLE_SENSOR
+
+bool i2c_sample_ready(void){
+
+  return (I2C_REGS[6] & 0x00000004);	// bit 2 sample ready
+
+}
+
+bool i2c_acc_ready(void){
+
+  return (I2C_REGS[6] & 0x00000008);	// bit 3 sum ready
+
+}
+
+// the sequencer reads pressure every period clock cycles (and temperature with one in every
+// temp_interval + 1 reads) and sums the raw pressure of 2^acc_log2 reads
+void i2c_auto_start(uint32_t period, uint32_t acc_log2, uint32_t temp_interval, bool irq_enable){
+
+  I2C_REGS[8] = period;
+  I2C_REGS[7] = 1 + (irq_enable << 1) + (acc_log2 << 2) + (temp_interval << 8);	// enable bit [0], interrupt enable bit [1], log2 samples [4:2], temperature interval [15:8]
+
+}
+
+void i2c_auto_stop(void){
+
+  I2C_REGS[7] = 0;
+
+}
+
+// the sequencer keeps running through a warm reset (not through a power on reset)
+bool i2c_auto_running(void){
+
+  return (I2C_REGS[7] & 0x00000001);	// enable bit [0]
+
+}
+
+// get the latest pressure latched by the sequencer and return its sequence number
+uint32_t i2c_auto_read(uint32_t* pressure){
+
+  uint32_t p = I2C_REGS[9];
+  
+  *pressure = p & 0x00FFFFFF;
+  
+  return p >> 24;
+
+}
+
+// get the latest temperature latched by the sequencer and return the sequence
+// number of the sample it was read with (it changes when a new temperature is read)
+uint32_t i2c_auto_temperature(uint32_t* temperature){
+
+  uint32_t t = I2C_REGS[10];
+  
+  *temperature = t & 0x00FFFFFF;
+  
+  return t >> 24;
+
+}
+
+// command queue entry: 1~8 bytes read from (or written to) consecutive registers of a device,
+// slot is the position of the first byte in the queue buffer
+#define I2C_QUEUE_ENTRY(device, reg, read, nbytes, slot) \
+  ((device) | ((read) << 7) | ((reg) << 8) | (((nbytes) - 1) << 16) | ((slot) << 19))
+#define I2C_QUEUE_READ   1
+#define I2C_QUEUE_WRITE  0
+
+// run entries[0]~entries[n - 1] as one I2C sequence (repeated start between entries)
+void i2c_queue_start(const uint32_t* entries, uint32_t n, bool irq_enable){
+
+  uint32_t i;
+  
+  for(i = 0; i < n; i++)
+    I2C_REGS[16 + i] = entries[i];
+  
+  I2C_REGS[12] = 1 + ((n - 1) << 1) + (irq_enable << 4);	// start bit [0], last entry [3:1], interrupt enable bit [4]
+
+}
+
+bool i2c_queue_busy(void){
+
+  return (I2C_REGS[12] & 0x00000001);	// bit 0 busy
+
+}
+
+// the queue buffer can only be accessed as words
+void i2c_queue_set_buffer(uint32_t slot, const uint8_t* data, uint32_t nbytes){
+
+  uint32_t i, shift, word = 0;
+  
+  for(i = 0; i < nbytes; i++){
+    shift = 8 * ((slot + i) % 4);
+    if(i == 0 || shift == 0) word = I2C_REGS[24 + (slot + i) / 4];
+    word = (word & ~(0xFF << shift)) | ((uint32_t)data[i] << shift);
+    if(shift == 24 || i == nbytes - 1) I2C_REGS[24 + (slot + i) / 4] = word;
+  }
+
+}
+
+void i2c_queue_get_buffer(uint32_t slot, uint8_t* data, uint32_t nbytes){
+
+  uint32_t i, shift, word = 0;
+  
+  for(i = 0; i < nbytes; i++){
+    shift = 8 * ((slot + i) % 4);
+    if(i == 0 || shift == 0) word = I2C_REGS[24 + (slot + i) / 4];
+    data[i] = (uint8_t) (word >> shift);
+  }
+
+}
+
+// get the mean of the last 2^acc_log2 raw pressures (rounded),
+// returns 0 if no new sum is ready (reading the sum clears sum ready)
+bool i2c_acc_read(uint32_t acc_log2, uint32_t* pressure){
+
+  uint32_t sum;
+  
+  if(!i2c_acc_ready()) return 0;
+  
+  sum = I2C_REGS[11];
+  *pressure = (sum + ((1 << acc_log2) >> 1)) >> acc_log2;
+  
+  return 1;
+
+}
+
+#endif
+
 //////////////////////////////////////////////////////////////////
 // Functions to access LCD interface
 //////////////////////////////////////////////////////////////////
@@ -234,16 +479,128 @@ void lcd_enable (bool d_i){
 }
 
 
+// an instruction sent before the LCD can report its busy flag (the wake up instructions)
+void lcd_enable_no_busy_check (void){
+  
+  LCD_REGS[3] = (1 << 2) + (1 << 1);	// no busy check bit [2], enable bit [1]
+
+}
+
+
 bool lcd_busy(void){
 
   return LCD_REGS[4];	// bit 0 busy
 
 }
 
+//////////////////////////////////////////////////////////////////
+// Functions to access compensation pipeline
+//////////////////////////////////////////////////////////////////
+
+#ifdef HARDWARE_COMPENSATION
+
+// load the BMP390 calibration registers (0x31~0x45, in register order)
+void comp_load_calib(const uint8_t* buffer){
+
+  uint32_t i, word;
+
+  for(i = 0; i < 6; i++){
+    word = 0;
+    for(uint32_t j = 0; j < 4 && (4 * i + j) < BMP390_CALIB_SIZE; j++)
+      word |= (uint32_t)buffer[4 * i + j] << (8 * j);
+    COMP_REGS[i] = word;
+  }
+
+}
+
+bool comp_busy(void){
+
+  return (COMP_REGS[9] & 0x00000001);	// bit 0 busy
+
+}
+
+// compensate pressure, after the temperature if update_temp is set (t_lin is then updated
+// as by the software version), otherwise with the t_lin terms kept by the pipeline
+int64_t comp_compensate(uint32_t uncomp_temp, uint32_t uncomp_press, bool update_temp, BMP390_calib_data* calib_data){
+
+  if(update_temp) COMP_REGS[6] = uncomp_temp;
+  COMP_REGS[7] = uncomp_press;
+  COMP_REGS[8] = update_temp + 0x2;	// temperature [0], pressure [1]
+
+  while(comp_busy());
+
+  if(update_temp) calib_data->t_lin = (int32_t) COMP_REGS[10];
+
+  return COMP_REGS[12];
+
+}
+
+#endif
+
+//////////////////////////////////////////////////////////////////
+// Functions to access trip timer
+//////////////////////////////////////////////////////////////////
+
+#define TIMER_RUN              (1 << 0)
+#define TIMER_IRQ_ENABLE       (1 << 1)
+#define TIMER_RESET            (1 << 2)
+
+// reset the time to 0:00:00 and keep it running
+void timer_restart(void){
+
+  TIMER_REGS[0] = TIMER_RUN | TIMER_RESET;
+
+}
+
+// elapsed time as BCD digits 0xHHMMSS
+uint32_t timer_read_bcd(void){
+
+  return TIMER_REGS[1];
+
+}
+
+uint32_t timer_read_seconds(void){
+
+  return TIMER_REGS[3];
+
+}
+
+//////////////////////////////////////////////////////////////////
+// Functions to access pressure alarm
+//////////////////////////////////////////////////////////////////
+
+#define ALARM_ENABLE           (1 << 0)
+#define ALARM_IRQ_ENABLE       (1 << 1)
+#define ALARM_FILTER(n)        ((n) << 4)   // n + 1 consecutive samples outside the window
+
+#define ALARM_IRQn             ((IRQn_Type) 1)
+
+// alarm status bits (ALARM_REGS[3]) collected by the interrupt handler
+volatile uint32_t alarm_status = 0;
+
+// compare every sequencer sample against the window between two raw pressures (in either order)
+void alarm_start(uint32_t raw_a, uint32_t raw_b){
+
+  ALARM_REGS[0] = (raw_a < raw_b) ? raw_a : raw_b;
+  ALARM_REGS[1] = (raw_a < raw_b) ? raw_b : raw_a;
+  ALARM_REGS[2] = ALARM_ENABLE | ALARM_IRQ_ENABLE | ALARM_FILTER(2);
+  NVIC_EnableIRQ(ALARM_IRQn);
+
+}
+
+// the alarm is one-shot, it is started again with the next window
+void ALARM_IRQHandler(void){
+
+  alarm_status |= ALARM_REGS[3];   // reading the status clears the interrupt
+  ALARM_REGS[2] = 0;
+
+}
+
 //////////////////////////////////////////////////////////////////
 // Delay function
 //////////////////////////////////////////////////////////////////
 
+// SysTick only provides the scheduling timebase (systick_ticks()), the trip time is kept by ahb_timer
 volatile uint32_t sys_tick_counter = 0;
 
 void SysTick_Handler(void) {
@@ -257,38 +614,48 @@ void SysTick_Init(uint32_t ticks) {
     SysTick->CTRL = SysTick_CTRL_CLKSOURCE_Msk | SysTick_CTRL_TICKINT_Msk | SysTick_CTRL_ENABLE_Msk;
 }
 
+// trip time in seconds (reset by the trip button)
 time_t time(time_t *t) {
-    time_t current_time = sys_tick_counter;
+    time_t current_time = timer_read_seconds();
     if (t) {
         *t = current_time;
     }
     return current_time;
 }
 
-/*
-void delay_ms(uint32_t ms) {
-    uint32_t start = sys_tick_counter;
-    uint32_t target_ticks = (ms * 1000) / 2136; // convert 2.168ms to 1000ms
-    
-    while ((sys_tick_counter - start) < target_ticks);
-}
-*/
+// convert milliseconds to SysTick ticks (32.768kHz clock), rounded up
+#define MS_TO_TICKS(ms) ((((ms) * 32768) + 999) / 1000)
 
-void delay_ms(uint32_t ms){
-  uint32_t start = SysTick->VAL;
-  uint32_t ticks = (ms * 32768 / 1000) ; // number of ticks to equal 1 millisecond on 32.768kHz clock
+// number of ticks since SysTick was started
+// (sys_tick_counter is read twice in case SysTick_Handler runs between the two reads)
+// if SysTick->VAL has already reloaded but SysTick_Handler has not run yet (interrupts
+// masked, or another handler running) the counter is one period behind VAL, which shows
+// up as the SysTick exception pending while VAL is still near the top of its range
+uint32_t systick_ticks(void){
+  uint32_t seconds, val, pending;
   
-  // start - SysTick->VAL is the amount of ticks that has elapsed
-  // added modulo SysTick->LOAD logic to deal with potential edge cases where SysTick->VAL underflows (resetted after hitting 0)
-  // adding SysTick->LOAD ensure the value never goes negative since working with unsigned integers
-  while ((SysTick->LOAD + start - SysTick->VAL) % SysTick->LOAD < ticks) ;
-} 
+  do {
+    seconds = sys_tick_counter;
+    val = SysTick->VAL;
+    pending = SCB->ICSR & SCB_ICSR_PENDSTSET_Msk;
+  } while (seconds != sys_tick_counter);
+  
+  if (pending && val > (SysTick->LOAD >> 1)) seconds++;
+  
+  return (seconds * (SysTick->LOAD + 1)) + (SysTick->LOAD - val);
+}
+
+// wait until an absolute deadline (in ticks) has passed
+// (other work can be done between setting the deadline and waiting for it)
+void delay_until(uint32_t deadline){
+  while ((int32_t)(systick_ticks() - deadline) < 0) ;
+}
 
 //////////////////////////////////////////////////////////////////
 // LCD Functions
 //////////////////////////////////////////////////////////////////
 
-// Busy wait, can be improved
+// Busy wait, the interface is busy until the LCD is ready for the next transfer
 void lcd_wait_not_busy(void) {
   while(lcd_busy()) ;
   return;
@@ -307,18 +674,24 @@ void lcd_refresh_display(void) {
   lcd_enable(1);
 }
 
-void lcd_init(void) {
+// power_on is the tick count at which power was applied, any time already spent
+// since then (e.g. configuring the sensor) is deducted from the first wait
+void lcd_init(uint32_t power_on) {
   // This part of the code is translated from LCD datasheet
-  delay_ms(50);                    //Wait >40 msec after power is applied
+  uint32_t deadline = power_on + MS_TO_TICKS(50);
+  delay_until(deadline);           //Wait >40 msec after power is applied
   lcd_set_instruction(0, 0, 0x30); //command 0x30 = Wake up
-  lcd_enable(0);
-  delay_ms(5);                    //must wait 5ms, busy flag not available
+  lcd_enable_no_busy_check();
+  deadline = systick_ticks() + MS_TO_TICKS(5);
+  delay_until(deadline);           //must wait 5ms, busy flag not available
   lcd_set_instruction(0, 0, 0x30); //command 0x30 = Wake up #2
-  lcd_enable(0);
-  delay_ms(1);                     //must wait 160us, busy flag not available
+  lcd_enable_no_busy_check();
+  deadline = systick_ticks() + MS_TO_TICKS(1);
+  delay_until(deadline);           //must wait 160us, busy flag not available
   lcd_set_instruction(0, 0, 0x30); //command 0x30 = Wake up #3
-  lcd_enable(0);
-  delay_ms(1);                     //must wait 160us, busy flag not available
+  lcd_enable_no_busy_check();
+  deadline = systick_ticks() + MS_TO_TICKS(1);
+  delay_until(deadline);           //must wait 160us, busy flag not available
 
   lcd_send_command(0, 0, 0x38); //Function set: 8-bit/2-line
   lcd_send_command(0, 0, 0x08); //Display OFF
@@ -327,453 +700,211 @@ void lcd_init(void) {
   lcd_send_command(0, 0, 0x0c); //Display ON; Cursor OFF
 }
 
-uint8_t lcd_digit_to_uint8 (uint32_t digit){
-  uint8_t retval;
-
-  switch (digit){
-    case 0:  retval = 0x30;
-             break;
-    case 1:  retval = 0x31;
-             break;
-    case 2:  retval = 0x32;
-             break;
-    case 3:  retval = 0x33;
-             break;
-    case 4:  retval = 0x34;
-             break;
-    case 5:  retval = 0x35;
-             break;
-    case 6:  retval = 0x36;
-             break;
-    case 7:  retval = 0x37;
-             break;
-    case 8:  retval = 0x38;
-             break;
-    case 9:  retval = 0x39;
-             break;
-    case 10:  retval = 0x41;
-             break;
-    case 11:  retval = 0x42;
-             break;
-    case 12:  retval = 0x43;
-             break;
-    case 13:  retval = 0x44;
-             break;
-    case 14:  retval = 0x45;
-             break;
-    case 15:  retval = 0x46;
-             break;
-    default: retval = 0x20;
-             break;
-  }
-  
-  return retval;
+// Display formats (see lcd_format.h)
+// address 0 corresponds to leftmost character on LCD display, 7 corresponds to rightmost character
+
+// [ ][1][0][1][3][ ][m][b], pressure in Pa shown in millibars
+static const lcd_format lcd_pressure_format = {
+  { LCD_WORD(' ', '0', '0', '0'), LCD_WORD('0', ' ', 'm', 'b') }, 0x1E, 2, 3, LCD_NO_SIGN
+};
+
+// [-][9][9][9][9][ ][m][ ]
+static const lcd_format lcd_altitude_format = {
+  { LCD_WORD(' ', '0', '0', '0'), LCD_WORD('0', ' ', 'm', ' ') }, 0x1E, 0, 3, 0
+};
+
+// [label][9][9][9][9][ ][m][ ] (trip statistics)
+static const lcd_format lcd_labelled_altitude_format = {
+  { LCD_WORD(LCD_LABEL, '0', '0', '0'), LCD_WORD('0', ' ', 'm', ' ') }, 0x1E, 0, 3, LCD_NO_SIGN
+};
+
+// [H][H][:][M][M][:][S][S], a leading zero hour is left blank
+static const lcd_format lcd_timer_format = {
+  { LCD_WORD('0', '0', ':', '0'), LCD_WORD('0', ':', '0', '0') }, 0xDB, 0, 1, LCD_NO_SIGN
+};
+
+// [+-][9][.][9][9][m][/][s], in hundredths of m/s
+static const lcd_format lcd_vsi_format = {
+  { LCD_WORD(' ', '0', '.', '0'), LCD_WORD('0', 'm', '/', 's') }, 0x1A, 0, 0, 0
+};
+
+// [label][+-][9][.][9][m][/][s], in tenths of m/s (trip statistics)
+static const lcd_format lcd_labelled_vsi_format = {
+  { LCD_WORD(LCD_LABEL, '+', '0', '.'), LCD_WORD('0', 'm', '/', 's') }, 0x14, 0, 0, 1
+};
+
+// [1][0][1][3][2][5][P][a]
+static const lcd_format lcd_pressure_init_format = {
+  { LCD_WORD('0', '0', '0', '0'), LCD_WORD('0', '0', 'P', 'a') }, 0x3F, 0, 0, LCD_NO_SIGN
+};
+
+// [ ][9][9][9][9][ ][m][ ]
+static const lcd_format lcd_altitude_init_format = {
+  { LCD_WORD(' ', '0', '0', '0'), LCD_WORD('0', ' ', 'm', ' ') }, 0x1E, 0, 0, LCD_NO_SIGN
+};
+
+void lcd_set_characters(const uint32_t* words){
+  lcd_set_higher_characters(words[1]);
+  lcd_set_lower_characters(words[0]);
 }
 
 void lcd_set_pressure_display (uint32_t pressure){
-  uint8_t lcd_char[8];
-  
-  // get digits of pressure
-  uint32_t hundred_thousands, ten_thousands, thousands, hundreds;
-  hundred_thousands = (pressure % 1000000) / 100000;
-  ten_thousands = (pressure % 100000) / 10000;
-  thousands = (pressure % 10000) / 1000;
-  hundreds = (pressure % 1000) / 100;
-  
-  // remove preceding zeroes where applicable
-  if(hundred_thousands == 0) {
-    hundred_thousands = 16; // remove first digit display instead of displaying 0
-                            // setting the number to not 0~9 make LCD display blank
-    if(ten_thousands == 0){		    
-      ten_thousands = 16;
-      
-      if(thousands == 0){
-        thousands = 16;
-	
-	// there is no need to check for hundreds = 0 case, just display 0 millibars instead of blank
-      }
-    }
-  }
+  uint32_t words[2];
   
-  // set display: [ ][1][0][1][3][ ][m][b]
-  // address 0 corresponds to leftmost character on LCD display, 7 corresponds to rightmost character
-  lcd_char[0] = 0x20;
-  lcd_char[1] = lcd_digit_to_uint8(hundred_thousands); 
-  lcd_char[2] = lcd_digit_to_uint8(ten_thousands);
-  lcd_char[3] = lcd_digit_to_uint8(thousands); 
-  lcd_char[4] = lcd_digit_to_uint8(hundreds);
-  lcd_char[5] = 0x20; 
-  lcd_char[6] = 0x6D;
-  lcd_char[7] = 0x62; 
-  
-  uint32_t higher_char, lower_char;
-  higher_char = (lcd_char[7] << 24) + (lcd_char[6] << 16) + (lcd_char[5] << 8) + lcd_char[4];
-  lower_char = (lcd_char[3] << 24) + (lcd_char[2] << 16) + (lcd_char[1] << 8) + lcd_char[0];
-  
-  lcd_set_higher_characters(higher_char);
-  lcd_set_lower_characters(lower_char);
-}
-
-void lcd_set_altitude_display (uint32_t altitude){
-  uint8_t lcd_char[8];
-  
-  // get digits of altitude
-  uint32_t thousands, hundreds, tens, ones;
-  thousands = (altitude % 10000) / 1000;
-  hundreds = (altitude % 1000) / 100;
-  tens = (altitude % 100) / 10;
-  ones = altitude % 10;
-  
-  // remove preceding zeroes where applicable
-  if(thousands == 0) {
-    thousands = 16; // remove first digit display instead of displaying 0
-                            // setting the number to not 0~9 make LCD display blank
-    if(hundreds == 0){		    
-      hundreds = 16;
-      
-      if(tens == 0){
-        tens = 16;
-	
-	// there is no need to check for ones = 0 case, just display 0 meters
-      }
-    }
-  }
-  
-  // set display: [ ][9][9][9][9][ ][m][ ]
-  // address 0 corresponds to leftmost character on LCD display, 7 corresponds to rightmost character
-  lcd_char[0] = 0x20;
-  lcd_char[1] = lcd_digit_to_uint8(thousands); 
-  lcd_char[2] = lcd_digit_to_uint8(hundreds);
-  lcd_char[3] = lcd_digit_to_uint8(tens); 
-  lcd_char[4] = lcd_digit_to_uint8(ones);
-  lcd_char[5] = 0x20; 
-  lcd_char[6] = 0x6D;
-  lcd_char[7] = 0x20; 
+  lcd_format_number(&lcd_pressure_format, pressure, 0, 0, words);
+  lcd_set_characters(words);
+}
+
+// altitude (m) with a label character in front (trip statistics)
+void lcd_set_labelled_altitude_display (uint8_t label, int32_t altitude){
+  uint32_t words[2];
   
-  uint32_t higher_char, lower_char;
-  higher_char = (lcd_char[7] << 24) + (lcd_char[6] << 16) + (lcd_char[5] << 8) + lcd_char[4];
-  lower_char = (lcd_char[3] << 24) + (lcd_char[2] << 16) + (lcd_char[1] << 8) + lcd_char[0];
+  lcd_format_number(&lcd_labelled_altitude_format, (altitude < 0) ? -altitude : altitude, 0, label, words);
+  lcd_set_characters(words);
+}
+
+void lcd_set_altitude_display (int32_t altitude){
+  uint32_t words[2];
   
-  lcd_set_higher_characters(higher_char);
-  lcd_set_lower_characters(lower_char);
+  lcd_format_number(&lcd_altitude_format, (altitude < 0) ? -altitude : altitude, altitude < 0, 0, words);
+  lcd_set_characters(words);
 }
 
-void lcd_set_timer_display(time_t seconds) {
-  uint8_t lcd_char[8];
-    
-  // Calculate hours, minutes and seconds
-  uint32_t hours = seconds / 3600;
-  uint32_t minutes = (seconds % 3600) / 60;
-  uint32_t sec = seconds % 60;
-
-  // Handle hours, minutes and seconds as digits
-  //uint32_t hour_tens = hours / 10;
-  uint32_t hour_ones = hours % 10;
-    
-  uint32_t minute_tens = minutes / 10;
-  uint32_t minute_ones = minutes % 10;
-    
-  uint32_t second_tens = sec / 10;
-  uint32_t second_ones = sec % 10;
-    
-  // Set display:
-  // LCD format: [ ][H][:][M][M][:][S][S]
-  // address 0 corresponds to leftmost character on LCD display, 7 corresponds to rightmost character
-  lcd_char[0] = 0x20;  // Maximum range up to 9 hours
-  //lcd_char[0] = lcd_digit_to_uint8(hour_tens);  // Tens place of hours, uncomment to set
-  lcd_char[1] = lcd_digit_to_uint8(hour_ones);  // Ones place of hours
-  lcd_char[2] = 0x3A;  // Colon (':')
-  lcd_char[3] = lcd_digit_to_uint8(minute_tens);  // Tens place of minutes
-  lcd_char[4] = lcd_digit_to_uint8(minute_ones);  // Ones place of minutes
-  lcd_char[5] = 0x3A;  // Colon (':')
-  lcd_char[6] = lcd_digit_to_uint8(second_tens);  // Tens place of seconds
-  lcd_char[7] = lcd_digit_to_uint8(second_ones);  // Ones place of seconds
-    
-  // Set the higher and lower 32-bit LCD registers
-  uint32_t higher_char = (lcd_char[7] << 24) + (lcd_char[6] << 16) + (lcd_char[5] << 8) + lcd_char[4];
-  uint32_t lower_char = (lcd_char[3] << 24) + (lcd_char[2] << 16) + (lcd_char[1] << 8) + lcd_char[0];
-    
-  // Display the characters on the LCD
-  lcd_set_higher_characters(higher_char);
-  lcd_set_lower_characters(lower_char);
+// the time is read as BCD digits (0xHHMMSS) from ahb_timer, so no conversion is needed
+void lcd_set_timer_display(uint32_t bcd) {
+  uint32_t words[2];
+  
+  lcd_format_bcd(&lcd_timer_format, bcd, 0, words);
+  lcd_set_characters(words);
 }
 
-void lcd_set_vsi_display (fpt velocity_in){
-  uint8_t lcd_char[8];
+void lcd_set_vsi_display (fpt velocity){
+  uint32_t words[2];
+  bool negative_sign = velocity < 0;
   
-  // get digits of velocity (multiply before right shifting back to decimal to set tenths to ones place etc)
-  bool negative_sign = velocity_in & 0x80000000;//msb
+  if(negative_sign)
+    velocity = -velocity;
   
-  fpt velocity = velocity_in;
+  // (multiply before right shifting back to keep the hundredths)
+  lcd_format_number(&lcd_vsi_format, (velocity * 100) >> FPT_FBITS, negative_sign, 0, words);
+  lcd_set_characters(words);
+}
+
+// vertical speed (m/s) to one decimal place with a label character in front (trip statistics)
+void lcd_set_labelled_vsi_display (uint8_t label, fpt velocity){
+  uint32_t words[2];
+  bool negative_sign = velocity < 0;
   
   if(negative_sign)
-    velocity = -1 * velocity;
-    
-  uint32_t ones, tenths, hundredths;
-  ones = (velocity >> 14) % 10;
-  tenths = ((velocity * 10) >> 14) % 10;
-  hundredths = ((velocity * 100) >> 14) % 10;
+    velocity = -velocity;
   
-  // set display: [+-][9][.][9][9][m][/][s]
-  // address 0 corresponds to leftmost character on LCD display, 7 corresponds to rightmost character
-  if(negative_sign)
-    lcd_char[0] = 0x2D;
-  else
-    lcd_char[0] = 0x20;
-  lcd_char[1] = lcd_digit_to_uint8(ones); 
-  lcd_char[2] = 0x2E;
-  lcd_char[3] = lcd_digit_to_uint8(tenths); 
-  lcd_char[4] = lcd_digit_to_uint8(hundredths);
-  lcd_char[5] = 0x6D; 
-  lcd_char[6] = 0x2F;
-  lcd_char[7] = 0x73; 
-  
-  uint32_t higher_char, lower_char;
-  higher_char = (lcd_char[7] << 24) + (lcd_char[6] << 16) + (lcd_char[5] << 8) + lcd_char[4];
-  lower_char = (lcd_char[3] << 24) + (lcd_char[2] << 16) + (lcd_char[1] << 8) + lcd_char[0];
-  
-  lcd_set_higher_characters(higher_char);
-  lcd_set_lower_characters(lower_char);
-}
-
-void lcd_set_pressure_init_display (uint8_t *buffer){
-  uint8_t lcd_char[8];
-  
-  // set display: [1][0][1][3][2][5][P][a]
-  // address 0 corresponds to leftmost character on LCD display, 7 corresponds to rightmost character
-  lcd_char[0] = lcd_digit_to_uint8(buffer[5]); 
-  lcd_char[1] = lcd_digit_to_uint8(buffer[4]); 
-  lcd_char[2] = lcd_digit_to_uint8(buffer[3]); 
-  lcd_char[3] = lcd_digit_to_uint8(buffer[2]); 
-  lcd_char[4] = lcd_digit_to_uint8(buffer[1]); 
-  lcd_char[5] = lcd_digit_to_uint8(buffer[0]); 
-  lcd_char[6] = 0x50;
-  lcd_char[7] = 0x61; 
-  
-  uint32_t higher_char, lower_char;
-  higher_char = (lcd_char[7] << 24) + (lcd_char[6] << 16) + (lcd_char[5] << 8) + lcd_char[4];
-  lower_char = (lcd_char[3] << 24) + (lcd_char[2] << 16) + (lcd_char[1] << 8) + lcd_char[0];
-  
-  lcd_set_higher_characters(higher_char);
-  lcd_set_lower_characters(lower_char);
-}
-
-void lcd_set_altitude_init_display (uint8_t *buffer){
-  uint8_t lcd_char[8];
-  
-  // set display: [ ][9][9][9][9][ ][m][ ]
-  // address 0 corresponds to leftmost character on LCD display, 7 corresponds to rightmost character
-  lcd_char[0] = 0x20; 
-  lcd_char[1] = lcd_digit_to_uint8(buffer[3]); 
-  lcd_char[2] = lcd_digit_to_uint8(buffer[2]); 
-  lcd_char[3] = lcd_digit_to_uint8(buffer[1]); 
-  lcd_char[4] = lcd_digit_to_uint8(buffer[0]); 
-  lcd_char[5] = 0x20; 
-  lcd_char[6] = 0x6D;
-  lcd_char[7] = 0x20; 
-  
-  uint32_t higher_char, lower_char;
-  higher_char = (lcd_char[7] << 24) + (lcd_char[6] << 16) + (lcd_char[5] << 8) + lcd_char[4];
-  lower_char = (lcd_char[3] << 24) + (lcd_char[2] << 16) + (lcd_char[1] << 8) + lcd_char[0];
-  
-  lcd_set_higher_characters(higher_char);
-  lcd_set_lower_characters(lower_char);
+  // capped at 9.9 m/s by the format
+  lcd_format_number(&lcd_labelled_vsi_format, fpt2i(velocity * 10), negative_sign, label, words);
+  lcd_set_characters(words);
+}
+
+// digits[0] is the least significant digit
+void lcd_set_pressure_init_display (uint8_t *digits){
+  uint32_t words[2];
+  
+  lcd_format_digits(&lcd_pressure_init_format, digits, 0, words);
+  lcd_set_characters(words);
+}
+
+void lcd_set_altitude_init_display (uint8_t *digits){
+  uint32_t words[2];
+  
+  lcd_format_digits(&lcd_altitude_init_format, digits, 0, words);
+  lcd_set_characters(words);
 }
 
 //////////////////////////////////////////////////////////////////
 // BMP Functions
 //////////////////////////////////////////////////////////////////
 
-void BMP390_init(void){
+#ifndef SIMPLE_SENSOR
 
-  // set target address and enable read
-  // pwr_ctrl register 0x1b set to normal mode, enable 0x33;
-  // osr 0x1c set to osr_t 000, osr_p 010;
-  // odr 0x1d set to odr 010, 50 hz;
-  // odr 0x1f set to odr 010, coef 3;
-  i2c_set_register_address(0, 0x1D, 0x1C, 0x1B);
-  i2c_set_write_data(0, 0x02, 0x02, 0x33);
-  
-  i2c_enable(0, 3);
+#define BMP390_DEVICE_ADDR 0x77     // 0b1110111
 
-  while(i2c_busy());
-}
+// the BMP390 is configured and its calibration read by one command queue run
+//   pwr_ctrl register 0x1b set to normal mode, enable 0x33;
+//   osr 0x1c set to osr_t 000, osr_p 010;
+//   odr 0x1d set to odr 010, 50 hz;
+//   calibration registers 0x31~0x45 read into queue buffer slots 0~20
+#define BMP390_CONFIG_SLOT 24
 
-void BMP390_read_data(uint8_t address, uint8_t* data, uint8_t nbytes){
+const uint32_t BMP390_setup_queue[4] = {
+  I2C_QUEUE_ENTRY(BMP390_DEVICE_ADDR, 0x1B, I2C_QUEUE_WRITE, 3, BMP390_CONFIG_SLOT),
+  I2C_QUEUE_ENTRY(BMP390_DEVICE_ADDR, BMP390_CALIB_ADDR, I2C_QUEUE_READ, 8, 0),
+  I2C_QUEUE_ENTRY(BMP390_DEVICE_ADDR, BMP390_CALIB_ADDR + 8, I2C_QUEUE_READ, 8, 8),
+  I2C_QUEUE_ENTRY(BMP390_DEVICE_ADDR, BMP390_CALIB_ADDR + 16, I2C_QUEUE_READ, 5, 16)
+};
 
-  uint32_t i;
-  uint32_t lower_bytes, higher_bytes;
-  
-  // set target address and enable read
-  i2c_set_register_address(0, 0, 0, address);
-  
-  // wait for not busy to enable read
-  while(i2c_busy());
-  i2c_enable(1, nbytes);
-  
-  // wait until data is valid
-  while(!i2c_valid());
+// start the setup queue without waiting for it to complete
+// (BMP390_setup_finish() collects the calibration)
+void BMP390_setup_start(void){
+
+  static const uint8_t config[3] = {0x33, 0x02, 0x02};
   
-  // read from target registers
-  // only consider lower bytes
-  if( nbytes < 4 ){
-    lower_bytes = i2c_get_lower_read_data();
-    uint32_t mask = 0x000000FF;
-    
-    for(i = 0; i < nbytes; i++){
-      data[i] = (uint8_t) ((lower_bytes & (mask << (8 * i))) >> (8 * i));
-    }
-  }
-  else{
-    lower_bytes = i2c_get_lower_read_data();
-    higher_bytes = i2c_get_higher_read_data();
-    uint32_t mask = 0x000000FF;
-    
-    for(i = 0; i < nbytes; i++){
-      if(i < 4)
-        data[i] = (uint8_t) ((lower_bytes & (mask << (8 * i))) >> (8 * i));
-      else
-        data[i] = (uint8_t) ((higher_bytes & (mask << (8 * (i - 4)))) >> (8 * (i - 4)));
-    }
-  }  
+  i2c_queue_set_buffer(BMP390_CONFIG_SLOT, config, 3);
+  i2c_queue_start(BMP390_setup_queue, 4, 0);
 
 }
 
-void BMP390_get_calib_coeff(BMP390_calib_data* calib_data){
-
-  uint8_t buffer[6];
-
-  // get T1, T2, T3 coefficients
-  BMP390_read_data(0x31, buffer, 5);
-  calib_data->t1 = (uint16_t) ( ((uint16_t)(buffer[1]) << 8) | buffer[0] );
-  calib_data->t2 = (uint16_t) ( ((uint16_t)(buffer[3]) << 8) | buffer[2] );
-  calib_data->t3 = (int8_t)   ( buffer[4] );
-  
-  // get P1, P2, P3, P4 coefficients
-  BMP390_read_data(0x36, buffer, 6);
-  calib_data->p1 = (int16_t) ( ((uint16_t)(buffer[1]) << 8) | buffer[0] );
-  calib_data->p2 = (int16_t) ( ((uint16_t)(buffer[3]) << 8) | buffer[2] );
-  calib_data->p3 = (int8_t)  ( buffer[4] );
-  calib_data->p4 = (int8_t)  ( buffer[5] );
-  
-  // get P5, P6, P7, P8 coefficients
-  BMP390_read_data(0x3C, buffer, 6);
-  calib_data->p5 = (uint16_t) ( ((uint16_t)(buffer[1]) << 8) | buffer[0] );
-  calib_data->p6 = (uint16_t) ( ((uint16_t)(buffer[3]) << 8) | buffer[2] );
-  calib_data->p7 = (int8_t)   ( buffer[4] );
-  calib_data->p8 = (int8_t)   ( buffer[5] );
+// wait for the setup queue and collect the calibration registers (in register order)
+void BMP390_setup_finish(uint8_t* buffer){
 
-  // get P9, P10, P11 coefficients
-  BMP390_read_data(0x42, buffer, 4);
-  calib_data->p9 =  (int16_t) ( ((uint16_t)(buffer[1]) << 8) | buffer[0] );
-  calib_data->p10 = (int8_t)  ( buffer[2] );
-  calib_data->p11 = (int8_t)  ( buffer[3] );
+  while(i2c_queue_busy());
   
+  i2c_queue_get_buffer(0, buffer, BMP390_CALIB_SIZE);
+
 }
 
-int64_t BMP390_compensate_temperature(uint32_t uncomp_temp, BMP390_calib_data* calib_data){
+void BMP390_load_calib(const uint8_t* buffer, BMP390_calib_data* calib_data){
 
-  /* translated from bmp390 library by Shifeng Li */
-  /* https://github.com/libdriver/bmp390/blob/main/src/driver_bmp390.c */
+  BMP390_unpack_calib(buffer, calib_data);
+#ifdef HARDWARE_COMPENSATION
+  comp_load_calib(buffer);
+#endif
 
-  uint64_t partial_data1;
-  uint64_t partial_data2;
-  uint64_t partial_data3;
-  int64_t partial_data4;
-  int64_t partial_data5;
-  int64_t partial_data6;
-  int64_t comp_temp;
-  
-  /* calculate compensate temperature */
-  partial_data1 = (uint64_t)(uncomp_temp - ((uint64_t)(calib_data->t1) << 8));
-  partial_data2 = (uint64_t)(calib_data->t2 * partial_data1);                           // need to divide by 2^30
-  partial_data3 = (uint64_t)(partial_data1 * partial_data1);
-  partial_data4 = (int64_t)(((int64_t)partial_data3) * ((int64_t)calib_data->t3));      // need to divide by 2^48
-  partial_data5 = ((int64_t)(((int64_t)partial_data2) << 18) + (int64_t)partial_data4); // need to divide by 2^48
-  partial_data6 = (int64_t)(((int64_t)partial_data5) >> 32);                            // need to divide by 2^16
-  
-  calib_data->t_lin = partial_data6;
-  
-  //comp_temp = (int64_t)((partial_data6 * 25)  >> 14);     // multiply by 100
-  comp_temp = (int64_t)(partial_data6  >> 16);
-  
-  return comp_temp;
-  
 }
 
-int64_t BMP390_compensate_pressure(uint32_t uncomp_press, BMP390_calib_data* calib_data){
+// t_lin is only recalculated from a new temperature reading which has moved by more than
+// TEMP_THRESHOLD from the last one used, or after TEMP_MAX_AGE readings, returns 1 (and the
+// raw temperature) when it is due
+uint32_t t_lin_temp;                 // raw temperature t_lin was calculated from
+uint32_t t_lin_age = TEMP_MAX_AGE;   // temperature readings since (forces the first one)
+uint32_t t_lin_sequence = 0x100;     // sequence number of the last temperature reading
 
-  /* translated from bmp390 library by Shifeng Li */
-  /* https://github.com/libdriver/bmp390/blob/main/src/driver_bmp390.c */
+bool BMP390_temperature_due(uint32_t* uncomp_temp){
 
-  int64_t partial_data1;
-  int64_t partial_data2;
-  int64_t partial_data3;
-  int64_t partial_data4;
-  int64_t partial_data5;
-  int64_t partial_data6;
-  int64_t offset;
-  int64_t sensitivity;
-  uint64_t comp_press;
+  uint32_t sequence = i2c_auto_temperature(uncomp_temp);
   
-  /* calculate compensate pressure */
-  partial_data1 = calib_data->t_lin * calib_data->t_lin;            // divide by 2^32
-  partial_data2 = partial_data1 >> 6;                               // divide by 2^26
-  partial_data3 = (partial_data2 * calib_data->t_lin) >> 8;         // divide by 2^34
-  partial_data4 = (calib_data->p8 * partial_data3) >> 5;            // divide by 2^44
-  partial_data5 = (calib_data->p7 * partial_data1) << 4;            // divide by 2^44
-  partial_data6 = (calib_data->p6 * calib_data->t_lin) << 22;       // divide by 2^44
-  offset = (int64_t)((int64_t)(calib_data->p5) << 47) + partial_data4 + partial_data5 + partial_data6; // divide by 2^44
+  if(sequence == t_lin_sequence) return 0;  // no new temperature reading
   
-  partial_data2 = (((int64_t)calib_data->p4) * partial_data3) >> 5;                          // divide by 2^66
-  partial_data4 = (calib_data->p3 * partial_data1) << 2;                                     // divide by 2^66
-  partial_data5 = ((int64_t)(calib_data->p2) - 16384) * ((int64_t)calib_data->t_lin) << 21;  // divide by 2^66
-  sensitivity = (((int64_t)(calib_data->p1) - 16384) << 46) + partial_data2 + partial_data4 + partial_data5; // divide by 2^66
+  /* no conversion has completed yet, the sequencer keeps reading the temperature until one has */
+  if(*uncomp_temp == BMP390_DATA_RESET) return 0;
+  t_lin_sequence = sequence;
   
-  partial_data1 = (sensitivity >> 24) * uncomp_press;                             // divide by 2^42
-  partial_data2 = (int64_t)(calib_data->p10) * (int64_t)(calib_data->t_lin);      // divide by 2^64
-  partial_data3 = partial_data2 + ((int64_t)(calib_data->p9) << 16);              // divide by 2^64
-  partial_data4 = (partial_data3 * uncomp_press) >> 13;                           // divide by 2^51
-  partial_data5 = ((partial_data4 / 10) * uncomp_press) >> 9;                            // divide by 10 then multiply by 10 to avoid overflow
-  partial_data5 = (partial_data5 * 10);                                            // divide by 2^42   
-  partial_data6 = (int64_t)((uint64_t)uncomp_press * (uint64_t)uncomp_press);
-  partial_data2 = ((int64_t)(calib_data->p11) * (int64_t)(partial_data6)) >> 16;  // divide by 2^49
-  partial_data3 = (partial_data2 * uncomp_press) >> 7;                            // divide by 2^42
-  partial_data4 = (offset >> 2) + partial_data1 + partial_data5 + partial_data3;  // divide by 2^42
+  if(++t_lin_age < TEMP_MAX_AGE &&
+     *uncomp_temp <= t_lin_temp + TEMP_THRESHOLD && *uncomp_temp + TEMP_THRESHOLD >= t_lin_temp)
+    return 0;
   
-  //comp_press = (((uint64_t)partial_data4 * 25) >> 40);     // multiply by 100
-  comp_press = ((uint64_t)partial_data4 >> 42);     // multiply by 100
-  
-  return comp_press;
+  t_lin_temp = *uncomp_temp;
+  t_lin_age = 0;
   
+  return 1;
+
 }
 
+#endif
+
 //////////////////////////////////////////////////////////////////
 // Algorithms, altitude and velocity calculation
 //////////////////////////////////////////////////////////////////
 
-uint32_t altitude_lut [20][2] = {
-  {3742, 10876}, // p/p0 = 0.2273
-  {4026, 10377}, // p/p0 = 0.2457
-  {4353,  9869}, // p/p0 = 0.2657
-  {4705,  9356}, // p/p0 = 0.2872
-  {5087,  8833}, // p/p0 = 0.3105
-  {5500,  8303}, // p/p0 = 0.3357
-  {5946,  7766}, // p/p0 = 0.3629
-  {6427,  7221}, // p/p0 = 0.3923
-  {6948,  6667}, // p/p0 = 0.4241
-  {7512,  6105}, // p/p0 = 0.4585
-  {8122,  5534}, // p/p0 = 0.4957
-  {8780,  4955}, // p/p0 = 0.5359
-  {9493,  4367}, // p/p0 = 0.5794
-  {10263, 3770}, // p/p0 = 0.6264
-  {11094, 3166}, // p/p0 = 0.6771
-  {11995, 2550}, // p/p0 = 0.7321
-  {12966, 1927}, // p/p0 = 0.7914
-  {14018, 1294}, // p/p0 = 0.8556
-  {15155,  652}, // p/p0 = 0.9250
-  {16384,    0}  // p/p0 = 1.0000
-};
+// altitude_lut (in ROM) is generated for the sport profile selected in options.sv,
+// see software/gen_altitude_lut.py
 
 uint32_t calculate_altitude(uint32_t p, uint32_t p0){
 
@@ -792,23 +923,86 @@ uint32_t calculate_altitude(uint32_t p, uint32_t p0){
   /* deal with edge cases first (the values outside of lut are capped to maximum and minimum values */
   if (pres_fraction < altitude_lut[0][0])
     altitude_estimate = altitude_lut[0][1];
-  else if (pres_fraction >= altitude_lut[19][0])
-    altitude_estimate = altitude_lut[19][1];
+  else if (pres_fraction >= altitude_lut[ALTITUDE_LUT_SIZE - 1][0])
+    altitude_estimate = altitude_lut[ALTITUDE_LUT_SIZE - 1][1];
+  else {
+    /* binary search for the segment lut[i] <= pres_fraction < lut[i+1] */
+    int i = 0, j = ALTITUDE_LUT_SIZE - 1;
+    while (j - i > 1) {
+      int k = (i + j) >> 1;
+      if (pres_fraction >= altitude_lut[k][0])
+        i = k;
+      else
+        j = k;
+    }
+    int p1 = altitude_lut[i][0];
+    int p2 = altitude_lut[i+1][0];
+    int h1 = altitude_lut[i][1]; 
+    int h2 = altitude_lut[i+1][1];
+    altitude_estimate = h1 + (pres_fraction-p1)*(h2-h1)/(p2-p1);
+  }
+    
+  return altitude_estimate;
+}
+
+// inverse of calculate_altitude(), (p/p0) << 14 at an altitude
+int altitude_to_fraction(uint32_t altitude){
+
+  int pres_fraction_estimate = altitude_lut[ALTITUDE_LUT_SIZE - 1][0];
+
+  if (altitude >= altitude_lut[0][1])
+    pres_fraction_estimate = altitude_lut[0][0];
+  else if (altitude < altitude_lut[ALTITUDE_LUT_SIZE - 1][1])
+    pres_fraction_estimate = altitude_lut[ALTITUDE_LUT_SIZE - 1][0];
   else
-    for(int i=0; i<19; i++){
-      if(pres_fraction >= altitude_lut[i][0] && pres_fraction < altitude_lut[i+1][0]){
+    for(int i=0; i<ALTITUDE_LUT_SIZE - 1; i++){
+      if(altitude < altitude_lut[i][1] && altitude >= altitude_lut[i+1][1]){
         int p1 = altitude_lut[i][0];
         int p2 = altitude_lut[i+1][0];
         int h1 = altitude_lut[i][1]; 
         int h2 = altitude_lut[i+1][1];
-        altitude_estimate = h1 + (pres_fraction-p1)*(h2-h1)/(p2-p1);
-                
+        pres_fraction_estimate = p1 + ((int)altitude-h1)*(p2-p1)/(h2-h1);
+          
         break;
       }
     }
-    
-  return altitude_estimate;
+
+  return pres_fraction_estimate;
+}
+
+#ifdef ALTITUDE_ALARM
+// convert altitude limits into raw pressure thresholds at the current temperature (t_lin) and
+// start the alarm, uncomp_press is a recent raw pressure reading
+// (a min_altitude of 0 leaves the top of the window at the 1250 hPa the sensor can read,
+// as the altitude cannot go below 0 and a pressure above p0 must not raise the alarm)
+void alarm_set_altitude_limits(uint32_t min_altitude, uint32_t max_altitude, uint32_t p0, uint32_t uncomp_press){
+
+  BMP390_pressure_terms terms;
+  int64_t highest_Pa = (min_altitude == 0) ? 125000 : ((int64_t)p0 * altitude_to_fraction(min_altitude)) >> 14;
+  int64_t lowest_Pa = ((int64_t)p0 * altitude_to_fraction(max_altitude)) >> 14;
+
+  BMP390_pressure_terms_update(&calib_data_global, &terms);
+
+  alarm_start(BMP390_uncompensate_pressure_terms(highest_Pa, uncomp_press, &calib_data_global, &terms),
+              BMP390_uncompensate_pressure_terms(lowest_Pa, uncomp_press, &calib_data_global, &terms));
+
+}
+
+// centre the window on the current altitude for the rate limit, narrowed to the altitude
+// limits while the altitude is within them (outside them only the rate limit applies, so
+// the alarm is not raised again by every sample)
+void alarm_set_window(uint32_t altitude, uint32_t p0, uint32_t uncomp_press){
+
+  uint32_t low = (altitude > ALARM_RATE_STEP) ? altitude - ALARM_RATE_STEP : 0;
+  uint32_t high = altitude + ALARM_RATE_STEP;
+
+  if(altitude >= ALARM_MIN_ALTITUDE && low < ALARM_MIN_ALTITUDE) low = ALARM_MIN_ALTITUDE;
+  if(altitude <= ALARM_MAX_ALTITUDE && high > ALARM_MAX_ALTITUDE) high = ALARM_MAX_ALTITUDE;
+
+  alarm_set_altitude_limits(low, high, p0, uncomp_press);
+
 }
+#endif
 
 fpt previous_altitude = i2fpt(0);
 uint32_t previous_time = 1234567;
@@ -818,12 +1012,12 @@ fpt instant_vsi = i2fpt(0);
 
 fpt kalman_state = i2fpt(0);      // Estimated vertical speed
 fpt kalman_p = i2fpt(1);          // Estimation error covariance
-fpt kalman_q = fl2fpt(0.001);     // Process noise covariance
-fpt kalman_r = fl2fpt(0.1);       // Measurement noise covariance
+const fpt kalman_q = fl2fpt(0.001);     // Process noise covariance
+const fpt kalman_r = fl2fpt(0.1);       // Measurement noise covariance
 fpt kalman_k = i2fpt(0);          // Kalman gain
 
 fpt iir_state = i2fpt(0);          
-fpt alpha = fl2fpt(0.15);
+const fpt alpha = fl2fpt(0.15);
 
 
 typedef struct {
@@ -888,6 +1082,266 @@ fpt calculate_vertical_speed(fpt current_altitude)
 }
 
 
+// the VSI history takes an altitude when calculate_vertical_speed() will use it
+// (the first one and then once more than a second of trip time has gone by)
+bool vertical_speed_due(void){
+  return previous_time == 1234567 || time(NULL) - previous_time > 1;
+}
+
+
+//////////////////////////////////////////////////////////////////
+// Sensor backend
+//////////////////////////////////////////////////////////////////
+
+// The sensor is chosen at compile time (SIMPLE_SENSOR) and the rest of the firmware only
+// goes through these inline functions, so there is no dispatch at run time and the backend
+// not chosen (its code and its RAM) is not in the build:
+//   sensor_start()       configure the sensor and start sampling (cold start)
+//   sensor_finish()      wait for the configuration and for the first sample
+//   sensor_warm_start()  pick up a sensor still sampling after a warm reset (returns 0 if not)
+//   sensor_sample()      a new reading (returns 0 if there is none yet)
+//   sensor_new_sample()  work to be done with every reading
+//   sensor_pressure()    the pressure of a reading (Pa)
+
+#ifndef SIMPLE_SENSOR
+
+// The BMP390 is configured by the command queue and read by the I2C sequencer, its readings
+// are compensated with the calibration and the temperature.
+
+static inline void sensor_start(void){
+
+  i2c_set_device_address(BMP390_DEVICE_ADDR);  // used by the sequencer
+  BMP390_setup_start();
+  
+  /* from now on the I2C sequencer reads the sensor every 20ms (50Hz output data rate),
+     the first read follows the setup queue while the LCD is woken up and configured */
+  i2c_auto_start(MS_TO_TICKS(SENSOR_PERIOD_MS), PRESS_ACC_LOG2, TEMP_INTERVAL, 0);
+
+}
+
+static inline void sensor_finish(void){
+
+  BMP390_setup_finish(retained_global.calib);
+  BMP390_load_calib(retained_global.calib, &calib_data_global);
+  
+  while(!i2c_sample_ready());
+
+}
+
+// the sensor, its configuration and the sequencer are untouched by a warm reset,
+// only the calibration has to be restored
+static inline bool sensor_warm_start(void){
+
+  if(!i2c_auto_running()) return 0;
+  
+  BMP390_load_calib(retained_global.calib, &calib_data_global);
+  
+  while(!i2c_sample_ready());
+  
+  return 1;
+
+}
+
+// the first reading is a single sample (no extra boot delay), after that the
+// mean of 2^PRESS_ACC_LOG2 samples summed by the sequencer (no waiting)
+static inline bool sensor_sample(bool first, uint32_t* uncomp_pres){
+
+  if(!first) return i2c_acc_read(PRESS_ACC_LOG2, uncomp_pres);
+  
+  uint32_t uncomp_temp;
+  
+  /* no conversion has completed yet while the data registers still hold their reset value,
+     the pressure cannot be compensated before there is a temperature */
+  i2c_auto_read(uncomp_pres);
+  i2c_auto_temperature(&uncomp_temp);
+  return (*uncomp_pres != BMP390_DATA_RESET && uncomp_temp != BMP390_DATA_RESET);
+
+}
+
+// the temperature dependent part of the compensation is cached and only recalculated
+// when the temperature has changed, which is remembered until a pressure is needed
+static inline void sensor_new_sample(sample_pipeline* sample){
+
+  uint32_t uncomp_temp;
+  
+  if(BMP390_temperature_due(&uncomp_temp)){
+    sample->uncomp_temp = uncomp_temp;
+    sample->update_temp = 1;
+  }
+
+}
+
+static inline int64_t sensor_pressure(sample_pipeline* sample){
+
+  int64_t pressure_Pa;
+  
+#ifdef HARDWARE_COMPENSATION
+  pressure_Pa = comp_compensate(sample->uncomp_temp, sample->uncomp_pres, sample->update_temp, &calib_data_global);
+  if(sample->update_temp) sample->temperature_C = calib_data_global.t_lin >> 16;
+#else
+  if(sample->update_temp){
+    sample->temperature_C = BMP390_compensate_temperature(sample->uncomp_temp, &calib_data_global);
+    BMP390_pressure_terms_update(&calib_data_global, &pressure_terms_global);
+  }
+  pressure_Pa = BMP390_compensate_pressure_terms(sample->uncomp_pres, &calib_data_global, &pressure_terms_global);
+#endif
+  
+  sample->update_temp = 0;
+  return pressure_Pa;
+
+}
+
+#else
+
+// The simple sensor needs no configuration and returns the pressure in Pa (SIMPLE_SENSOR_NBYTES
+// bytes, least significant first) from every read. ahb_simple_i2c has no sequencer, so a single
+// read is started every SENSOR_PERIOD_MS and collected once the interface is idle again.
+
+#define SIMPLE_SENSOR_DEVICE_ADDR 0x77
+#define SIMPLE_SENSOR_NBYTES 3
+
+uint32_t sensor_deadline = 0;   // when the next read is due (SysTick ticks)
+bool sensor_reading = 0;        // a read has been started and not yet collected
+
+static inline void sensor_start(void){
+
+  i2c_set_device_address(SIMPLE_SENSOR_DEVICE_ADDR);
+  sensor_deadline = systick_ticks();
+
+}
+
+static inline void sensor_finish(void){
+
+}
+
+// nothing is lost with a warm reset, a read still in progress is waited for
+static inline bool sensor_warm_start(void){
+
+  sensor_start();
+  
+  return 1;
+
+}
+
+static inline bool sensor_sample(bool first, uint32_t* uncomp_pres){
+
+  uint32_t now;
+  
+  (void) first;
+  
+  if(i2c_busy()) return 0;
+  
+  if(sensor_reading){
+    sensor_reading = 0;
+    /* DataValid is not set if the sensor did not acknowledge, it is read again when due */
+    if(i2c_valid()){
+      *uncomp_pres = i2c_get_lower_read_data() & ((1 << (8 * SIMPLE_SENSOR_NBYTES)) - 1);
+      return 1;
+    }
+  }
+  
+  now = systick_ticks();
+  if((int32_t)(now - sensor_deadline) >= 0){
+    sensor_deadline = now + MS_TO_TICKS(SENSOR_PERIOD_MS);
+    i2c_enable(1, SIMPLE_SENSOR_NBYTES);
+    sensor_reading = 1;
+  }
+  
+  return 0;
+
+}
+
+static inline void sensor_new_sample(sample_pipeline* sample){
+
+  (void) sample;
+
+}
+
+static inline int64_t sensor_pressure(sample_pipeline* sample){
+
+  return sample->uncomp_pres;
+
+}
+
+#endif
+
+//////////////////////////////////////////////////////////////////
+// Per-sample pipeline
+//////////////////////////////////////////////////////////////////
+
+// Every result is worked out the first time something asks for it after a new sample
+// (the display mode shown, the VSI history, the flight log or the alarm) and then kept
+// until the next sample, so e.g. the pressure display never pays for the altitude.
+
+void sample_new(sample_pipeline* sample, uint32_t uncomp_pres){
+  sample->uncomp_pres = uncomp_pres;
+  sample->valid = 0;
+  
+  sensor_new_sample(sample);
+}
+
+int64_t sample_pressure(sample_pipeline* sample){
+  if(sample->valid & SAMPLE_PRESSURE) return sample->pressure_Pa;
+  
+  sample->pressure_Pa = sensor_pressure(sample);
+  
+  sample->valid |= SAMPLE_PRESSURE;
+  return sample->pressure_Pa;
+}
+
+uint32_t sample_altitude(sample_pipeline* sample){
+  if(sample->valid & SAMPLE_ALTITUDE) return sample->altitude;
+  
+  sample->altitude = calculate_altitude(sample_pressure(sample), sample->p0);
+  if(sample->altitude > 9999) sample->altitude = 9999;
+  
+  sample->valid |= SAMPLE_ALTITUDE;
+  return sample->altitude;
+}
+
+// the altitude of the current sample is worked out again with the new p0
+void sample_set_p0(sample_pipeline* sample, uint32_t p0){
+  sample->p0 = p0;
+  sample->valid &= ~SAMPLE_ALTITUDE;
+}
+
+// keep p0 and the trip statistics for a warm restart (the BMP390 calibration is kept from the start)
+void retain_save(void){
+  retained_global.p0 = sample_global.p0;
+  retained_global.trip = trip_stats_global;
+  retain_seal(&retained_global);
+}
+
+
+//////////////////////////////////////////////////////////////////
+// Flight log
+//////////////////////////////////////////////////////////////////
+
+// show the logged altitudes from the oldest, FLIGHT_LOG_REPLAY_MS each,
+// any button stops the replay
+void flight_log_replay(const flight_log* log){
+  flight_log_cursor cursor;
+  int32_t altitude;
+  uint32_t deadline;
+  
+  flight_log_begin(log, &cursor);
+  
+  while(flight_log_next(log, &cursor, &altitude)){
+    lcd_set_altitude_display(altitude);
+    
+    /* update display */
+    while(lcd_busy()) ;
+    lcd_refresh_display();
+    
+    deadline = systick_ticks() + MS_TO_TICKS(FLIGHT_LOG_REPLAY_MS);
+    while((int32_t)(systick_ticks() - deadline) < 0)
+      if(buttons_valid()){
+        buttons_read();
+        return;
+      }
+  }
+}
+
 //////////////////////////////////////////////////////////////////
 // Pressure and Altitude initialisation
 //////////////////////////////////////////////////////////////////
@@ -991,49 +1445,88 @@ uint32_t altitude_initialisation(void){
 
 int main(void) {
   
-  /* 32.768kHz -> 32768 ticks for 1s
-     sys_tick_counter global variable or time(NULL) returns time since program starts in seconds
+  /* SysTick has been running since ResetHandler (32768 ticks for 1s at 32.768kHz)
+     systick_ticks() is the scheduling timebase, time(NULL) returns the trip time in seconds
+     (kept by ahb_timer, counting from power on until the trip button is pressed)
   */
-  SysTick_Init(32768);  
+  const uint32_t power_on = 0;
   
-  uint8_t read_buffer[6] = {0, 0, 0, 0, 0, 0};
-  
-  lcd_init();
-  
-  /* initialize bmp sensor */
-  i2c_set_device_address(0x77);                // Device address = 0b1110111 for bmp390 pressure sensor
-  BMP390_init();
-  BMP390_get_calib_coeff(&calib_data_global);
+  if(retain_valid(&retained_global) && sensor_warm_start()){
+    /* warm restart: the sensor, the LCD and the trip timer have kept their configuration
+       and the sensor has kept being read, only what was in the reset peripherals is restored */
+    sample_set_p0(&sample_global, retained_global.p0);
+    trip_stats_global = retained_global.trip;
+  }
+  else{
+    timer_restart();
+    
+    /* initialize the sensor while the LCD is still powering up
+       (the BMP390 setup queue and the sequencer both run without the processor) */
+    sensor_start();
+    
+    lcd_init(power_on);
+    
+    sensor_finish();
+    retain_save();
+  }
   
   /* variables for event loop */
   uint32_t buttons_pressed;
   bool nmode_pressed, ntrip_pressed, both_pressed;
-  uint32_t display_mode = 0;  // current mode, 0 pressure, 1 altitude, 2 trip timer, 3 VSI, 4 initialisation
-  uint32_t p0 = 101325;
-  uint32_t altitude = 0;
+  uint32_t display_mode = 0;  // current mode, 0 pressure, 1 altitude, 2 trip timer, 3 VSI,
+                              // 4~10 trip statistics (highest, lowest, ascent, descent, peak climb, peak sink, average VSI)
+  uint32_t altitude;
   fpt velocity = 0;
-  uint32_t uncomp_pres, uncomp_temp;
-  int64_t pressure_Pa;
-  int64_t temperature_C;
+  uint32_t uncomp_pres;
+  bool sampled = 0, new_sample;
+  uint32_t log_ticks = 0, now;
+#ifdef ALTITUDE_ALARM
+  uint32_t alarm_p0 = 0, alarm_ticks = 0;
+  bool alarm_armed = 0;
+#endif
 
   // repeat forever (embedded programs generally do not terminate)
   while(1){
-    /* read pressure (lower 3 bytes) + temperature (higher 3 bytes), and compensate readings */
-    BMP390_read_data(0x04, read_buffer, 6);
-    uncomp_pres = ((uint32_t) (read_buffer[2]) << 16) + ((uint32_t) (read_buffer[1]) << 8) + (uint32_t) (read_buffer[0]);
-    uncomp_temp = ((uint32_t) (read_buffer[5]) << 16) + ((uint32_t) (read_buffer[4]) << 8) + (uint32_t) (read_buffer[3]);
-    
-    temperature_C = BMP390_compensate_temperature(uncomp_temp, &calib_data_global); // temperature is unused
-    pressure_Pa = BMP390_compensate_pressure(uncomp_pres, &calib_data_global);
-    //pressure_Pa = uncomp_temp;
+    new_sample = sensor_sample(!sampled, &uncomp_pres);
     
-    /* altitude and velocity calculation algorithms */
-    altitude = calculate_altitude(pressure_Pa, p0);
-    velocity = calculate_vertical_speed(i2fpt(altitude));
+    /* there is nothing valid to display before the first reading */
+    if(!sampled && !new_sample) continue;
     
-    /* cap values before display */
-    if(altitude > 9999) altitude = 9999;
-    if(altitude < 0) altitude = 0;
+    /* a new sample only starts the pipeline, the results are worked out as they are needed */
+    if(new_sample){
+      sampled = 1;
+      sample_new(&sample_global, uncomp_pres);
+      now = systick_ticks();
+      
+#ifdef ALTITUDE_ALARM
+      /* the raw pressure thresholds depend on the temperature and p0 and the window follows
+         the altitude every ALARM_RATE_PERIOD_MS (and after an alarm, which stops the comparator),
+         the comparator checks every sample in between without the processor */
+      if(!alarm_armed || sample_global.update_temp || sample_global.p0 != alarm_p0 ||
+         now - alarm_ticks >= MS_TO_TICKS(ALARM_RATE_PERIOD_MS)){
+        sample_pressure(&sample_global);  // recalculates t_lin
+        alarm_p0 = sample_global.p0;
+        alarm_ticks = now;
+        alarm_armed = 1;
+        alarm_set_window(sample_altitude(&sample_global), alarm_p0, uncomp_pres);
+      }
+#endif
+      
+      /* the VSI history and the trip statistics at the VSI cadence */
+      if(vertical_speed_due()){
+        altitude = sample_altitude(&sample_global);
+        velocity = calculate_vertical_speed(i2fpt(altitude));
+        trip_stats_update(&trip_stats_global, altitude, velocity);
+      }
+      
+      /* log the altitude every FLIGHT_LOG_INTERVAL_MS (the first sample is always logged,
+         as is the first one after the trip timer has been reset) */
+      if(flight_log_global.samples == 0 || now - log_ticks >= MS_TO_TICKS(FLIGHT_LOG_INTERVAL_MS)){
+        log_ticks = now;
+        flight_log_append(&flight_log_global, sample_altitude(&sample_global));
+        retain_save();  // the trip statistics at the same cadence
+      }
+    }
   
     /* check for button being pressed */
     nmode_pressed = 0;
@@ -1055,62 +1548,107 @@ int main(void) {
 	        break;
 	case 2: display_mode = 3; // trip timer -> vsi
 	        break;
-	case 3: display_mode = 0; // vsi -> pressure
+	case 3: display_mode = 4; // vsi -> highest altitude
+	        break;
+	case 4: display_mode = 5; // highest -> lowest altitude
+	        break;
+	case 5: display_mode = 6; // lowest altitude -> ascent
+	        break;
+	case 6: display_mode = 7; // ascent -> descent
+	        break;
+	case 7: display_mode = 8; // descent -> peak climb
+	        break;
+	case 8: display_mode = 9; // peak climb -> peak sink
+	        break;
+	case 9: display_mode = 10; // peak sink -> average vsi
+	        break;
+	case 10: display_mode = 0; // average vsi -> pressure
 	        break;
         default: display_mode = 0;
 	        break;
       }
     }
     
-    if(ntrip_pressed){   // reset trip timer to 0 (just reset sys_tick_timer)
-      sys_tick_counter = 0;
+    if(ntrip_pressed){   // reset trip timer to 0 and the trip statistics
+      timer_restart();
+      previous_time = 1234567;  // the vsi time difference restarts from the new trip time
+      trip_stats_reset(&trip_stats_global);
+      retain_save();
     }
     
     if(both_pressed){   
       if(display_mode == 0){
-        p0 = pressure_initialisation();
+        sample_set_p0(&sample_global, pressure_initialisation());
+        retain_save();
       }
       if(display_mode == 1){
         uint32_t altitude_init = altitude_initialisation();
-        int pres_fraction_estimate;
 	
 	// inverse of altitude algorithm
-        if (altitude_init >= altitude_lut[0][1])
-          pres_fraction_estimate = altitude_lut[0][0];
-        else if (altitude_init < altitude_lut[19][1])
-          pres_fraction_estimate = altitude_lut[19][0];
-        else
-          for(int i=0; i<19; i++){
-            if(altitude_init < altitude_lut[i][1] && altitude_init >= altitude_lut[i+1][1]){
-              int p1 = altitude_lut[i][0];
-              int p2 = altitude_lut[i+1][0];
-              int h1 = altitude_lut[i][1]; 
-              int h2 = altitude_lut[i+1][1];
-              pres_fraction_estimate = p1 + ((int)altitude_init-h1)*(p2-p1)/(h2-h1);
-                
-              break;
-            }
-          }
-	  
-	p0 = (pressure_Pa << 14) / pres_fraction_estimate;
+	sample_set_p0(&sample_global, (sample_pressure(&sample_global) << 14) / altitude_to_fraction(altitude_init));
+        retain_save();
+      }
+      if(display_mode == 2){
+        flight_log_replay(&flight_log_global);
       }
     }
     
+#ifdef ALTITUDE_ALARM
+    /* show the altitude when a limit has been crossed, otherwise the rate limit was exceeded
+       and the VSI is shown, the window is set again with the next sample */
+    if(alarm_status){
+      alarm_status = 0;
+      alarm_armed = 0;
+      altitude = sample_altitude(&sample_global);
+      if(altitude < ALARM_MIN_ALTITUDE || altitude > ALARM_MAX_ALTITUDE)
+        display_mode = 1;
+      else
+        display_mode = 3;
+    }
+#endif
+    
     /* set lcd values */
     switch(display_mode){
-      case 0: lcd_set_pressure_display(pressure_Pa);
+      case 0: lcd_set_pressure_display(sample_pressure(&sample_global));
               break;
-      case 1: lcd_set_altitude_display(altitude);
+      case 1: lcd_set_altitude_display(sample_altitude(&sample_global));
               break;
-      case 2: lcd_set_timer_display(time(NULL));
+      case 2: lcd_set_timer_display(timer_read_bcd());
               break;
       case 3: lcd_set_vsi_display(velocity);
               break;
+      case 4: lcd_set_labelled_altitude_display(0x48, trip_stats_global.max_altitude);  // H
+              break;
+      case 5: lcd_set_labelled_altitude_display(0x4C, trip_stats_global.min_altitude);  // L
+              break;
+      case 6: lcd_set_labelled_altitude_display(0x5E, trip_stats_global.ascent);   // ^
+              break;
+      case 7: lcd_set_labelled_altitude_display(0x76, trip_stats_global.descent); // v
+              break;
+      case 8: lcd_set_labelled_vsi_display(0x5E, trip_stats_global.peak_climb);  // ^
+              break;
+      case 9: lcd_set_labelled_vsi_display(0x76, trip_stats_global.peak_sink);   // v
+              break;
+      case 10: lcd_set_labelled_vsi_display(0x61, trip_stats_average_vsi(&trip_stats_global, time(NULL)));  // a
+              break;
     }
     
     /* update display */
     while(lcd_busy()) ;
     lcd_refresh_display();
+    
+    /* record how long it took from power on to the first valid display */
+    if(boot_ticks == 0) boot_ticks = systick_ticks() - power_on;
+    
+#ifdef ALTITUDE_ALARM
+    /* sleep until the next SysTick (once a second), the alarm or a button, the comparator
+       watches the altitude meanwhile and ahb_buttons holds a press until it is read
+       (with interrupts masked an interrupt arriving after the check still ends the WFI) */
+    __disable_irq();
+    NVIC_EnableIRQ(BUTTON_IRQn);
+    if(!alarm_status && !buttons_valid()) __WFI();
+    __enable_irq();
+#endif
   }
 }
 
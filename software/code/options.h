@@ -0,0 +1,23 @@
+// Firmware compile time options (options.h)
+//
+// Generated by software/gen_options_h.py from options.sv, do not edit.
+
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+// read a simple sensor which returns the pressure in Pascals through
+// ahb_simple_i2c rather than the BMP390 through ahb_bmp_i2c
+// (use_simple_sensor not defined)
+#undef SIMPLE_SENSOR
+
+// compensate the sensor readings with the ahb_bmp_comp pipeline rather
+// than in software
+// (`define hardware_compensation)
+#define HARDWARE_COMPENSATION
+
+// raise an alarm (ahb_alarm interrupt) when the altitude leaves
+// ALARM_MIN_ALTITUDE ~ ALARM_MAX_ALTITUDE or changes faster than the rate limit
+// (include_alarm not defined)
+#undef ALTITUDE_ALARM
+
+#endif
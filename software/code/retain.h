@@ -0,0 +1,75 @@
+// Retained state (retain.h)
+//
+// State kept in RAM across a warm reset (a system reset request or a
+// processor lockup), which resets the processor and the peripherals but
+// neither the RAM nor the trip timer. It lives in the .noinit section, which
+// crt.c does not clear, so after power on it holds whatever the RAM powered
+// up with. A magic value and a CRC over the rest tell a warm start (the state
+// can be used as it is) from a cold one.
+//
+// The CRC is CRC-16/CCITT (polynomial 0x1021, initial value 0xFFFF) worked
+// out a nibble at a time from a 16 entry table.
+//
+// There is no calibration to keep for the simple sensor (SIMPLE_SENSOR, from
+// options.h which has to be included before this).
+//
+// Nothing in here accesses hardware.
+
+#ifndef RETAIN_H
+#define RETAIN_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "bmp390_comp.h"
+#include "trip_stats.h"
+
+#define RETAIN_MAGIC 0x5741524D   // "WARM"
+
+typedef struct {
+
+  uint32_t   magic;
+#ifndef SIMPLE_SENSOR
+  uint8_t    calib[BMP390_CALIB_SIZE + 3];   // calibration registers as read (padded to a word)
+#endif
+  uint32_t   p0;
+  trip_stats trip;
+  uint16_t   crc;                            // over everything above
+
+} retained_state;
+
+static const uint16_t retain_crc_table[16] = {
+  0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+  0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+};
+
+static inline uint16_t retain_crc(const uint8_t* data, uint32_t nbytes){
+
+  uint16_t crc = 0xFFFF;
+
+  while(nbytes--){
+    crc = (crc << 4) ^ retain_crc_table[(crc >> 12) ^ (*data >> 4)];
+    crc = (crc << 4) ^ retain_crc_table[(crc >> 12) ^ (*data & 0xF)];
+    data++;
+  }
+
+  return crc;
+
+}
+
+static inline bool retain_valid(const retained_state* state){
+
+  return state->magic == RETAIN_MAGIC &&
+         state->crc == retain_crc((const uint8_t*) state, offsetof(retained_state, crc));
+
+}
+
+// to be called after every change, until then a reset is taken as a cold start
+static inline void retain_seal(retained_state* state){
+
+  state->magic = RETAIN_MAGIC;
+  state->crc = retain_crc((const uint8_t*) state, offsetof(retained_state, crc));
+
+}
+
+#endif
@@ -0,0 +1,86 @@
+// Trip statistics (trip_stats.h)
+//
+// Highest and lowest altitude, total ascent and descent, peak climb and sink
+// rate and average vertical speed since the trip was reset. Everything is
+// updated once per altitude sample in constant time, no history is kept.
+//
+// Ascent and descent are only counted once the altitude has moved at least
+// TRIP_HYSTERESIS metres from where it was last counted, so sensor noise
+// while standing still does not add up.
+//
+// Nothing in here accesses hardware.
+
+#ifndef TRIP_STATS_H
+#define TRIP_STATS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <fptc.h>
+
+#define TRIP_HYSTERESIS 3   // metres
+
+typedef struct {
+
+  bool     started;
+  int32_t  max_altitude;
+  int32_t  min_altitude;
+  int32_t  reference;       // altitude ascent and descent were last counted at
+  uint32_t ascent;
+  uint32_t descent;
+  fpt      peak_climb;      // highest vertical speed (m/s)
+  fpt      peak_sink;       // lowest vertical speed (m/s)
+  int32_t  start_altitude;
+  int32_t  last_altitude;
+
+} trip_stats;
+
+// everything reads zero (as displayed) until the first update of the new trip
+static inline void trip_stats_reset(trip_stats* stats){
+
+  *stats = (trip_stats){0};
+
+}
+
+static inline void trip_stats_update(trip_stats* stats, int32_t altitude, fpt vsi){
+
+  if(!stats->started){
+    stats->started = 1;
+    stats->max_altitude = altitude;
+    stats->min_altitude = altitude;
+    stats->reference = altitude;
+    stats->ascent = 0;
+    stats->descent = 0;
+    stats->peak_climb = vsi;
+    stats->peak_sink = vsi;
+    stats->start_altitude = altitude;
+  }
+
+  if(altitude > stats->max_altitude) stats->max_altitude = altitude;
+  if(altitude < stats->min_altitude) stats->min_altitude = altitude;
+
+  if(altitude >= stats->reference + TRIP_HYSTERESIS){
+    stats->ascent += altitude - stats->reference;
+    stats->reference = altitude;
+  }
+  else if(altitude <= stats->reference - TRIP_HYSTERESIS){
+    stats->descent += stats->reference - altitude;
+    stats->reference = altitude;
+  }
+
+  if(vsi > stats->peak_climb) stats->peak_climb = vsi;
+  if(vsi < stats->peak_sink) stats->peak_sink = vsi;
+
+  stats->last_altitude = altitude;
+
+}
+
+// average vertical speed (m/s) over a trip of seconds
+static inline fpt trip_stats_average_vsi(const trip_stats* stats, uint32_t seconds){
+
+  if(!stats->started || seconds == 0) return i2fpt(0);
+
+  return fpt_div(i2fpt(stats->last_altitude - stats->start_altitude), i2fpt(seconds));
+
+}
+
+#endif
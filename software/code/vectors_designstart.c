@@ -55,6 +55,10 @@ void PendSV_Handler (void) __attribute__((weak));
 void SysTick_Handler (void) __attribute__((weak));
 
 void WAKEUP_IRQHandler (void) __attribute__((weak));
+void TIMER_IRQHandler (void) __attribute__((weak));
+void ALARM_IRQHandler (void) __attribute__((weak));
+void DMA_IRQHandler (void) __attribute__((weak));
+void BUTTON_IRQHandler (void) __attribute__((weak));
 void C_CAN_IRQHandler (void) __attribute__((weak));
 void SSP1_IRQHandler (void) __attribute__((weak));
 void I2C_IRQHandler (void) __attribute__((weak));
@@ -95,10 +99,10 @@ void (* const gVectors[])(void) =
    PendSV_Handler,
    SysTick_Handler,
 
-   WAKEUP_IRQHandler,
-   WAKEUP_IRQHandler,
-   WAKEUP_IRQHandler,
-   WAKEUP_IRQHandler,
+   TIMER_IRQHandler,    /* IRQ 0: ahb_timer */
+   ALARM_IRQHandler,    /* IRQ 1: ahb_alarm */
+   DMA_IRQHandler,      /* IRQ 2: ahb_dma */
+   BUTTON_IRQHandler,   /* IRQ 3: ahb_buttons */
    WAKEUP_IRQHandler,
    WAKEUP_IRQHandler,
    WAKEUP_IRQHandler,
@@ -142,6 +146,10 @@ void PendSV_Handler (void) { while(1); }
 void SysTick_Handler (void) { while(1); }
 
 void WAKEUP_IRQHandler (void) { while(1); }
+void TIMER_IRQHandler (void) { while(1); }
+void ALARM_IRQHandler (void) { while(1); }
+void DMA_IRQHandler (void) { while(1); }
+void BUTTON_IRQHandler (void) { while(1); }
 void C_CAN_IRQHandler (void) { while(1); }
 void SSP1_IRQHandler (void) { while(1); }
 void I2C_IRQHandler (void) { while(1); }
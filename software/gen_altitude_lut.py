@@ -0,0 +1,164 @@
+#! /usr/bin/env python3
+#
+# gen_altitude_lut.py
+#
+#   Generates code/altitude_lut.h, the table used by calculate_altitude() in
+#   main.c, from the barometric formula
+#
+#     height = Tb/L [1 - (p/p0)^(R L / g M)]
+#
+#   The sport profile selected in options.sv decides the altitude range and the
+#   largest interpolation error allowed. Breakpoints are placed as far apart as
+#   the error allows, so each profile gets the precision it needs with as few
+#   entries as possible. The error is measured with the same integer arithmetic
+#   as calculate_altitude() over every p/p0 value it can see.
+#
+#   Usage: gen_altitude_lut.py [<options_file> [<output_file>]]
+#          (run from this directory, defaults ../behavioural/options.sv and
+#           code/altitude_lut.h)
+#
+#   The table must be regenerated whenever the sport profile is changed.
+
+import math
+import re
+import sys
+
+# constants of the barometric formula (as in calculate_altitude())
+TB = 288.15        # sea level temperature (K)
+L = 0.0065         # temperature lapse rate (K/m)
+G = 9.81           # gravitational acceleration (m/s^2)
+M = 0.02896968     # molar mass of dry air (kg/mol)
+R = 8.31432        # universal gas constant (J/(mol K))
+EXPONENT = R * L / (G * M)
+
+# p/p0 is held as an integer, left shifted by FRACTION_SHIFT
+FRACTION_SHIFT = 14
+FRACTION_ONE = 1 << FRACTION_SHIFT
+
+# sport profiles: highest altitude (m) and largest error (m) of the interpolated
+# altitude, which includes ~1 m from whole metre entries and truncating division
+PROFILES = {
+    # walking, climbing and skiing, slow changes read at rest, up to the
+    # highest summits
+    'mountain_sports': {'max_altitude': 9000, 'max_error': 1.5},
+    # paragliding, gliding and skydiving, large fast changes, up to typical
+    # oxygen-assisted altitudes
+    'aerial_sports': {'max_altitude': 12000, 'max_error': 4.0},
+    # multi-purpose (neither selected)
+    'default': {'max_altitude': 11000, 'max_error': 2.0},
+}
+
+
+def altitude(fraction):
+    """exact altitude (m) for an integer p/p0 fraction"""
+    return TB / L * (1.0 - math.pow(fraction / FRACTION_ONE, EXPONENT))
+
+
+def fraction_at(height):
+    """integer p/p0 fraction at (or just above) an altitude"""
+    return int(math.ceil(FRACTION_ONE * math.pow(1.0 - height * L / TB, 1.0 / EXPONENT)))
+
+
+def interpolate(fraction, p1, h1, p2, h2):
+    """calculate_altitude() interpolation (C integer division truncates towards zero)"""
+    num = (fraction - p1) * (h2 - h1)
+    den = p2 - p1
+    q = abs(num) // den
+    return h1 + (q if num >= 0 else -q)
+
+
+def segment_error(p1, h1, p2, h2):
+    return max(abs(interpolate(f, p1, h1, p2, h2) - altitude(f)) for f in range(p1, p2))
+
+
+def build_table(max_altitude, max_error):
+    """greedy breakpoint placement, from p/p0 = 1 (0 m) down to max_altitude"""
+    lowest = fraction_at(max_altitude)
+    table = [(FRACTION_ONE, 0)]
+    while table[-1][0] > lowest:
+        p2, h2 = table[-1]
+        best = p2 - 1
+        p1 = p2 - 1
+        while p1 >= lowest:
+            h1 = int(round(altitude(p1)))
+            if segment_error(p1, h1, p2, h2) > max_error:
+                break
+            best = p1
+            p1 -= 1
+        table.append((best, int(round(altitude(best)))))
+    table.reverse()
+    return table
+
+
+def report(table):
+    """largest and rms error against the exact formula over the table range"""
+    worst, worst_fraction, total, count = 0.0, 0, 0.0, 0
+    for (p1, h1), (p2, h2) in zip(table, table[1:]):
+        for f in range(p1, p2):
+            e = interpolate(f, p1, h1, p2, h2) - altitude(f)
+            total += e * e
+            count += 1
+            if abs(e) > abs(worst):
+                worst, worst_fraction = e, f
+    return worst, worst_fraction, math.sqrt(total / count)
+
+
+def sport_profile(options_file):
+    """profile selected by an uncommented `define in options.sv"""
+    with open(options_file) as f:
+        for line in f:
+            m = re.match(r'\s*`define\s+(mountain_sports|aerial_sports)\b', line)
+            if m:
+                return m.group(1)
+    return 'default'
+
+
+def main():
+    if len(sys.argv) > 3:
+        print("\nERROR - too many arguments")
+        print("\nUsage: gen_altitude_lut.py [<options_file> [<output_file>]]")
+        sys.exit(1)
+
+    options_file = sys.argv[1] if len(sys.argv) > 1 else '../behavioural/options.sv'
+    output_file = sys.argv[2] if len(sys.argv) > 2 else 'code/altitude_lut.h'
+
+    profile = sport_profile(options_file)
+    limits = PROFILES[profile]
+    table = build_table(limits['max_altitude'], limits['max_error'])
+    worst, worst_fraction, rms = report(table)
+
+    print("Profile %s: 0 ~ %d m, %d entries" % (profile, table[0][1], len(table)))
+    print("Interpolation error: max %.2f m (p/p0 = %.4f), rms %.2f m"
+          % (worst, worst_fraction / FRACTION_ONE, rms))
+    print("Altitude step of one p/p0 LSB: %.2f m at 0 m, %.2f m at %d m"
+          % (altitude(FRACTION_ONE - 1), altitude(table[0][0]) - altitude(table[0][0] + 1), table[0][1]))
+
+    with open(output_file, 'w') as f:
+        f.write("// Altitude look up table (altitude_lut.h)\n")
+        f.write("//\n")
+        f.write("// Generated by software/gen_altitude_lut.py from options.sv, do not edit.\n")
+        f.write("// Profile %s: 0 ~ %d m, interpolation error max %.2f m, rms %.2f m\n"
+                % (profile, table[0][1], abs(worst), rms))
+        f.write("\n")
+        f.write("#ifndef ALTITUDE_LUT_H\n")
+        f.write("#define ALTITUDE_LUT_H\n")
+        f.write("\n")
+        f.write("#include <stdint.h>\n")
+        f.write("\n")
+        f.write("#define ALTITUDE_LUT_SIZE %d\n" % len(table))
+        f.write("\n")
+        f.write("// {p/p0 << %d, altitude (m)} in increasing p/p0 order (const, kept in ROM)\n"
+                % FRACTION_SHIFT)
+        f.write("static const uint16_t altitude_lut[ALTITUDE_LUT_SIZE][2] = {\n")
+        for i, (p, h) in enumerate(table):
+            f.write("  {%5d, %5d}%s // p/p0 = %.4f\n"
+                    % (p, h, ',' if i < len(table) - 1 else ' ', p / FRACTION_ONE))
+        f.write("};\n")
+        f.write("\n")
+        f.write("#endif\n")
+
+    print("Writing '%s'" % output_file)
+
+
+if __name__ == '__main__':
+    main()
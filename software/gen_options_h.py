@@ -0,0 +1,78 @@
+#! /usr/bin/env python3
+#
+# gen_options_h.py
+#
+#   Generates code/options.h, the firmware compile time options, from the
+#   hardware options in options.sv, so the firmware is always built for the
+#   SoC that alt_core.sv builds from the same file.
+#
+#   Usage: gen_options_h.py [<options_file> [<output_file>]]
+#          (run from this directory, defaults ../behavioural/options.sv and
+#           code/options.h)
+#
+#   The header must be regenerated whenever options.sv is changed.
+
+import re
+import sys
+
+# options.sv `define -> firmware #define, and what it selects
+OPTIONS = [
+    ('use_simple_sensor', 'SIMPLE_SENSOR',
+     'read a simple sensor which returns the pressure in Pascals through\n'
+     '// ahb_simple_i2c rather than the BMP390 through ahb_bmp_i2c'),
+    ('hardware_compensation', 'HARDWARE_COMPENSATION',
+     'compensate the sensor readings with the ahb_bmp_comp pipeline rather\n'
+     '// than in software'),
+    ('include_alarm', 'ALTITUDE_ALARM',
+     'raise an alarm (ahb_alarm interrupt) when the altitude leaves\n'
+     '// ALARM_MIN_ALTITUDE ~ ALARM_MAX_ALTITUDE or changes faster than the rate limit'),
+]
+
+
+def defined(options_file):
+    """names of the uncommented `defines in options.sv"""
+    names = set()
+    with open(options_file) as f:
+        for line in f:
+            m = re.match(r'\s*`define\s+(\w+)', line)
+            if m:
+                names.add(m.group(1))
+    return names
+
+
+def main():
+    if len(sys.argv) > 3:
+        print("\nERROR - too many arguments")
+        print("\nUsage: gen_options_h.py [<options_file> [<output_file>]]")
+        sys.exit(1)
+
+    options_file = sys.argv[1] if len(sys.argv) > 1 else '../behavioural/options.sv'
+    output_file = sys.argv[2] if len(sys.argv) > 2 else 'code/options.h'
+
+    names = defined(options_file)
+
+    with open(output_file, 'w') as f:
+        f.write("// Firmware compile time options (options.h)\n")
+        f.write("//\n")
+        f.write("// Generated by software/gen_options_h.py from options.sv, do not edit.\n")
+        f.write("\n")
+        f.write("#ifndef OPTIONS_H\n")
+        f.write("#define OPTIONS_H\n")
+        for option, macro, description in OPTIONS:
+            f.write("\n")
+            f.write("// %s\n" % description)
+            if option in names:
+                f.write("// (`define %s)\n" % option)
+                f.write("#define %s\n" % macro)
+            else:
+                f.write("// (%s not defined)\n" % option)
+                f.write("#undef %s\n" % macro)
+            print("%-24s %s" % (option, macro if option in names else '-'))
+        f.write("\n")
+        f.write("#endif\n")
+
+    print("Writing '%s'" % output_file)
+
+
+if __name__ == '__main__':
+    main()
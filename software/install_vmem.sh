@@ -22,9 +22,20 @@ fi
     if grep '^// BEGIN CUSTOM$' $rom_file > /dev/null &&
        grep '^// END CUSTOM$' $rom_file > /dev/null
     then
+      # the image must fit the ROM array (2**MEMWIDTH bytes)
+      memwidth=`sed -n -e 's/^ *parameter MEMWIDTH *= *\([0-9]*\).*$/\1/p' $rom_file`
+      rom_words=$(( 1 << ( ${memwidth:-14} - 2 ) ))
+      image_words=`grep -c 'assign memory' code.vmem`
+      if [ "$image_words" -gt "$rom_words" ]
+      then
+        printf "\nERROR - code.vmem has $image_words words, the ROM only $rom_words\n"
+        exit 1
+      fi
       printf "Creating custom ROM file\n"
       sed -e  '/^.. BEGIN CUSTOM$/,$ d' $rom_file > rom.sv
       printf "// BEGIN CUSTOM\n\n" >> rom.sv
+      sources=`git describe --always --dirty 2>/dev/null`
+      printf "// code.vmem ($image_words words) built from ${sources:-untracked sources}\n\n" >> rom.sv
       cat code.vmem >> rom.sv
       printf "\n// END CUSTOM\n" >> rom.sv
       sed -e  '1,/^.. END CUSTOM$/ d' $rom_file >> rom.sv
@@ -0,0 +1,162 @@
+#! /usr/bin/env python3
+#
+# ram_report.py
+#
+#   RAM footprint report and budget check for the firmware.
+#
+#   Lists what is placed in .data, .bss and .noinit (from the linker map) and
+#   works out the worst case stack depth (from the compiler's call graph). It
+#   fails (exit status 1) if .data + .bss + .noinit + worst case stack does not
+#   fit in the RAM region of soc.ld.
+#
+#   The firmware must be built with
+#     -fcallgraph-info=su        (gcc 10 or later, writes a .ci file per source)
+#     -Wl,-Map=code.map          (linker map)
+#   and -fdata-sections for a per variable breakdown of .data and .bss.
+#
+#   Usage: ram_report.py <map_file> <ci_file> [<ci_file> ...] [--ld <linker_script>]
+#          (run from this directory, default linker script soc.ld)
+#
+#   Stack depth is the deepest call chain from ResetHandler plus the deepest
+#   chain of every exception handler (each with its 32 byte exception frame),
+#   as if all handlers could nest. Functions the call graph knows nothing about
+#   (e.g. libgcc helpers) are counted as UNKNOWN_STACK bytes and listed.
+
+import re
+import sys
+
+EXCEPTION_FRAME = 32   # r0~r3, r12, lr, pc, xpsr stacked on exception entry
+UNKNOWN_STACK = 64     # allowance for functions without call graph information
+
+
+def size(text):
+    """linker script number (decimal, hex or with a K/M suffix)"""
+    m = re.match(r'(0x[0-9a-fA-F]+|\d+)([KM]?)$', text)
+    value = int(m.group(1), 0)
+    return value * {'': 1, 'K': 1024, 'M': 1024 * 1024}[m.group(2)]
+
+
+def ram_region(ld_file):
+    with open(ld_file) as f:
+        m = re.search(r'RAM\s*\([^)]*\)\s*:\s*ORIGIN\s*=\s*(\w+)\s*,\s*LENGTH\s*=\s*(\w+)', f.read())
+    return size(m.group(1)), size(m.group(2))
+
+
+def map_sections(map_file):
+    """output section sizes and the input sections placed in .data, .bss and .noinit"""
+    outputs = {}
+    inputs = []
+    current = None
+    pending = None
+    started = False
+    with open(map_file) as f:
+        for line in f:
+            line = line.rstrip('\n')
+            if line.startswith('Linker script and memory map'):
+                started = True
+                continue
+            if not started:
+                continue
+            if pending is not None:      # long names are wrapped onto a second line
+                line = pending + line
+                pending = None
+            m = re.match(r'^(\.\S+)\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)', line)
+            if m:
+                current = m.group(1)
+                outputs[current] = int(m.group(3), 16)
+                continue
+            if re.match(r'^ ?(\.\S+|COMMON)$', line):
+                pending = line
+                continue
+            m = re.match(r'^ (\.\S+|COMMON)\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)\s+(\S+)', line)
+            if m and current in ('.data', '.bss', '.noinit') and int(m.group(3), 16) > 0:
+                inputs.append((current, m.group(1), int(m.group(3), 16), m.group(4)))
+    return outputs, inputs
+
+
+def call_graph(ci_files):
+    """own stack use of each function and the functions it calls"""
+    frames = {}
+    calls = {}
+    for ci_file in ci_files:
+        with open(ci_file) as f:
+            for line in f:
+                m = re.match(r'node: \{ title: "([^"]+)" label: "[^"]*?(\d+) bytes \(([^)]*)\)', line)
+                if m:
+                    frames[m.group(1)] = (int(m.group(2)), m.group(3))
+                    continue
+                m = re.match(r'edge: \{ sourcename: "([^"]+)" targetname: "([^"]+)"', line)
+                if m:
+                    calls.setdefault(m.group(1), set()).add(m.group(2))
+    return frames, calls
+
+
+def deepest(function, frames, calls, unknown, chain=()):
+    """deepest stack use starting at function, and the call chain reaching it"""
+    if function in chain:
+        sys.exit("ERROR - recursion through %s, stack depth is unbounded" % function)
+    if function not in frames:
+        unknown.add(function)
+        return UNKNOWN_STACK, [function]
+    own, kind = frames[function]
+    if kind != 'static':
+        print("Warning: %s has %s stack use" % (function, kind))
+    depth, path = 0, []
+    for callee in sorted(calls.get(function, ())):
+        d, p = deepest(callee, frames, calls, unknown, chain + (function,))
+        if d > depth:
+            depth, path = d, p
+    return own + depth, [function] + path
+
+
+def main():
+    args = sys.argv[1:]
+    ld_file = 'soc.ld'
+    if '--ld' in args:
+        i = args.index('--ld')
+        ld_file = args[i + 1]
+        del args[i:i + 2]
+    if len(args) < 2:
+        print("\nUsage: ram_report.py <map_file> <ci_file> [<ci_file> ...] [--ld <linker_script>]")
+        sys.exit(1)
+
+    origin, length = ram_region(ld_file)
+    outputs, inputs = map_sections(args[0])
+    frames, calls = call_graph(args[1:])
+
+    data = outputs.get('.data', 0)
+    bss = outputs.get('.bss', 0)
+    noinit = outputs.get('.noinit', 0)
+
+    print("RAM 0x%08x, %d bytes (%s)" % (origin, length, ld_file))
+    print("")
+    print("  %-32s %6s  %s" % ("section", "bytes", "object"))
+    for section, name, n, obj in sorted(inputs, key=lambda x: -x[2]):
+        print("  %-32s %6d  %s" % (name, n, obj))
+    print("")
+
+    unknown = set()
+    stack, path = deepest('ResetHandler', frames, calls, unknown)
+    print("Stack, ResetHandler: %d bytes (%s)" % (stack, ' > '.join(path)))
+    for handler in sorted(f for f in frames if f.endswith('_Handler') or f.endswith('_IRQHandler')):
+        d, p = deepest(handler, frames, calls, unknown)
+        print("Stack, %s: %d + %d bytes (%s)" % (handler, EXCEPTION_FRAME, d, ' > '.join(p)))
+        stack += EXCEPTION_FRAME + d
+    for function in sorted(unknown):
+        print("Warning: no call graph information for %s, counted as %d bytes" % (function, UNKNOWN_STACK))
+    print("")
+
+    total = data + bss + noinit + stack
+    print("  .data  %6d" % data)
+    print("  .bss   %6d" % bss)
+    print("  .noinit %5d" % noinit)
+    print("  stack  %6d (worst case)" % stack)
+    print("  total  %6d of %d bytes, %d free" % (total, length, length - total))
+
+    if total > length:
+        print("\nERROR - RAM budget exceeded by %d bytes" % (total - length))
+        sys.exit(1)
+
+
+if __name__ == '__main__':
+    main()
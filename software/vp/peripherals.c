@@ -0,0 +1,1097 @@
+// Memory and peripheral models (peripherals.c)
+//
+// ROM, RAM and the AHB slaves of soc.sv as seen by the firmware, following
+// the register maps at the top of their RTL. Each model keeps its registers
+// and works out when things happen from the cycle count instead of clocking
+// the logic:
+//
+//   ahb_buttons   presses from the button script, reported 6 samples (the
+//                 debounce) after the change, long presses after 200 samples
+//   ahb_lcd       with the HD44780 behind it, every transfer followed by busy
+//                 flag reads as by the RTL, 37us (1.52ms for clear display and
+//                 return home) busy after each write
+//   ahb_bmp_i2c   master transfers, the sequencer (with the accumulator) and the
+//                 command queue, 36 clock cycles per byte, talking to a BMP390
+//                 converting the scenario pressure (or, with vp_simple_sensor,
+//                 ahb_simple_i2c with only the master transfers, talking to a
+//                 sensor which returns the pressure in Pa from every read)
+//   ahb_bmp_comp  results from bmp390_comp.h, busy for the pipeline latency
+//   ahb_timer     and ahb_alarm
+//
+// ahb_dma is not modelled (the firmware does not start it), its registers
+// read as 0. An unmapped address is a bus error.
+//
+// A warm reset (peripherals_reset(0)) leaves the trip timer and the I2C
+// interface alone as in soc.sv, the LCD and the sensor are outside the SoC.
+
+#include <stdio.h>
+#include <string.h>
+#include "vp.h"
+#include "../code/bmp390_comp.h"
+
+uint8_t rom[ROM_SIZE];
+uint8_t ram[RAM_SIZE];
+
+// typical calibration, as bmp390_model.sv
+const uint32_t bmp390_calib[6] = { 0x4A926B8A, 0xF7FFFEF9, 0xB40212FF, 0x035D5C5F, 0x063E80FA, 0x000000C9 };
+
+//////////////////////////////////////////////////////////////////
+// Buttons (ahb_buttons)
+//////////////////////////////////////////////////////////////////
+
+#define BUTTON_SAMPLE_PERIOD 164                          // clock cycles
+#define BUTTON_DELAY         (6 * BUTTON_SAMPLE_PERIOD)   // debounce, 5 samples agree then the next
+#define BUTTON_LONG_PRESS    (200 * BUTTON_SAMPLE_PERIOD)
+#define BUTTON_MAX_PRESSES   1024
+
+typedef struct {
+  uint64_t start, end;
+  uint32_t mask;
+  bool     reported;
+} button_press;
+
+static struct {
+
+  button_press presses[BUTTON_MAX_PRESSES];
+  int      npresses, next;
+  uint32_t status, chord;
+  bool     data_valid;
+
+} buttons;
+
+void buttons_press(uint64_t start, uint64_t end, uint32_t mask){
+
+  button_press* press;
+
+  if(buttons.npresses == BUTTON_MAX_PRESSES){
+    fprintf(stderr, "vp: too many button presses, the rest are ignored\n");
+    return;
+  }
+
+  press = &buttons.presses[buttons.npresses++];
+  press->start = start;
+  press->end = end;
+  press->mask = mask;
+  press->reported = 0;
+  vp_schedule(start);
+
+}
+
+// when the gesture is reported, at the long press or after the release
+static uint64_t button_report_at(const button_press* press){
+
+  if(press->end - press->start >= BUTTON_LONG_PRESS)
+    return press->start + BUTTON_DELAY + BUTTON_LONG_PRESS;
+
+  return press->end + BUTTON_DELAY;
+
+}
+
+// IRQ follows DataValid
+static void buttons_irq(void){
+
+  if(buttons.data_valid) vp_irq_lines |= 1 << IRQ_BUTTON;
+  else vp_irq_lines &= ~(1u << IRQ_BUTTON);
+
+}
+
+static void buttons_update(void){
+
+  button_press* press;
+  uint64_t at;
+
+  // presses are in time order, a gesture ending while DataValid is set is lost
+  while(buttons.next < buttons.npresses){
+    press = &buttons.presses[buttons.next];
+    at = button_report_at(press);
+    if(vp_cycles < at){
+      vp_schedule(at);
+      break;
+    }
+    if(!buttons.data_valid){
+      buttons.chord = press->mask;
+      buttons.status = (press->mask & (press->mask - 1)) ? (1 << 2) : press->mask;
+      if(press->end - press->start >= BUTTON_LONG_PRESS) buttons.status |= 1 << 3;
+      buttons.data_valid = 1;
+    }
+    buttons.next++;
+  }
+
+  buttons_irq();
+
+}
+
+// debounced state of the buttons now
+static uint32_t buttons_pressed(void){
+
+  uint32_t pressed = 0;
+  int i;
+
+  for(i = 0; i < buttons.npresses; i++)
+    if(vp_cycles >= buttons.presses[i].start + BUTTON_DELAY &&
+       vp_cycles < buttons.presses[i].end + BUTTON_DELAY)
+      pressed |= buttons.presses[i].mask;
+
+  return pressed;
+
+}
+
+static uint32_t buttons_read(uint32_t offset){
+
+  uint32_t value;
+
+  buttons_update();
+
+  switch(offset){
+    case 0x0:
+      value = buttons.status;
+      buttons.status = 0;
+      buttons.data_valid = 0;
+      buttons_irq();
+      return value;
+    case 0x4: return buttons.data_valid;
+    case 0x8: return buttons.chord;
+    case 0xC: return buttons_pressed();
+  }
+
+  return 0;
+
+}
+
+//////////////////////////////////////////////////////////////////
+// LCD (ahb_lcd and the HD44780)
+//////////////////////////////////////////////////////////////////
+
+// HD44780 bus timing (ns), as the ahb_lcd parameters
+#define LCD_T_SETUP 140
+#define LCD_T_PULSE 450
+#define LCD_T_HOLD  20
+#define LCD_T_CYCLE 1000
+
+static struct {
+
+  // ahb_lcd
+  uint32_t chars[2];
+  uint32_t inst;
+  uint32_t read;
+  uint64_t busy_until;
+
+  // HD44780
+  uint8_t  ddram[80];
+  uint8_t  address;
+  uint64_t lcd_busy_until;
+  char     text[9];
+  uint32_t changes;
+
+} lcd;
+
+static uint32_t ns_to_cycles(uint32_t ns){
+
+  uint64_t cycles = ((uint64_t) ns * vp_frequency + 999999999) / 1000000000;
+
+  return cycles ? cycles : 1;
+
+}
+
+// the HD44780 reading (RS and R/W set) or written (R/W clear) at a cycle
+static uint8_t hd44780_read(bool rs, uint64_t at){
+
+  if(rs) return lcd.ddram[lcd.address];
+
+  return (at < lcd.lcd_busy_until ? 0x80 : 0) | lcd.address;
+
+}
+
+static void hd44780_write(bool rs, uint8_t data, uint64_t at){
+
+  uint32_t busy_ns = 37000;
+
+  if(rs){
+    lcd.ddram[lcd.address] = data;
+    lcd.address = (lcd.address == 79) ? 0 : lcd.address + 1;
+  }
+  else if(data & 0x80)
+    lcd.address = data & 0x7F;
+  else if(data == 0x01){
+    memset(lcd.ddram, ' ', sizeof(lcd.ddram));
+    lcd.address = 0;
+    busy_ns = 1520000;
+  }
+  else if((data & 0xFE) == 0x02){
+    lcd.address = 0;
+    busy_ns = 1520000;
+  }
+
+  lcd.lcd_busy_until = at + (uint64_t) (busy_ns / 1000.0 * vp_frequency / 1000000.0 + 0.999);
+
+}
+
+// one ahb_lcd transfer (setup, enable and hold) starting at cycle t, followed by busy
+// flag reads until the LCD is ready when poll is set, returns the cycle after the last
+static uint64_t lcd_transfer(uint64_t t, bool rs, bool rnw, uint8_t data, bool poll){
+
+  uint32_t setup = ns_to_cycles(LCD_T_SETUP);
+  uint32_t pulse = ns_to_cycles(LCD_T_PULSE);
+  uint32_t hold = ns_to_cycles(LCD_T_HOLD);
+  uint32_t cycle = ns_to_cycles(LCD_T_CYCLE);
+
+  if(hold < cycle - setup - pulse && cycle > setup + pulse) hold = cycle - setup - pulse;
+
+  // data is taken (or read back) as E falls
+  if(rnw) lcd.read = hd44780_read(rs, t + setup + pulse);
+  else    hd44780_write(rs, data, t + setup + pulse);
+  t += setup + pulse + hold;
+
+  if(poll)
+    do{
+      lcd.read = hd44780_read(0, t + setup + pulse);
+      t += setup + pulse + hold;
+    } while(lcd.read & 0x80);
+
+  return t;
+
+}
+
+static void lcd_start(uint32_t control){
+
+  uint64_t t = vp_cycles + 1;
+  int i;
+
+  if(vp_cycles < lcd.busy_until) return;   // ignored by the RTL until it is idle again
+
+  if(control & 1){
+    t = lcd_transfer(t, 0, 0, 0x80, 1);
+    for(i = 0; i < 8; i++)
+      t = lcd_transfer(t, 1, 0, lcd.chars[i / 4] >> (8 * (i % 4)), 1);
+  }
+  else
+    t = lcd_transfer(t, (lcd.inst >> 9) & 1, (lcd.inst >> 8) & 1, lcd.inst,
+                     !(control & 4) && ((lcd.inst >> 8) & 3) != 1);
+
+  lcd.busy_until = t;
+
+  for(i = 0; i < 8; i++)
+    if(lcd.text[i] != (char) lcd.ddram[i]) break;
+  if(i < 8){
+    memcpy(lcd.text, lcd.ddram, 8);
+    lcd.changes++;
+  }
+
+}
+
+static uint32_t lcd_read(uint32_t offset){
+
+  switch(offset){
+    case 0x00: return lcd.chars[0];
+    case 0x04: return lcd.chars[1];
+    case 0x08: return lcd.inst;
+    case 0x10: return vp_cycles < lcd.busy_until;
+    case 0x14: return lcd.read;
+  }
+
+  return 0;
+
+}
+
+static void lcd_write(uint32_t offset, uint32_t value){
+
+  switch(offset){
+    case 0x00: lcd.chars[0] = value; break;
+    case 0x04: lcd.chars[1] = value; break;
+    case 0x08: lcd.inst = value & 0x3FF; break;
+    case 0x0C: if(value & 2) lcd_start(value); break;
+  }
+
+}
+
+const char* lcd_text(void){
+
+  return lcd.text;
+
+}
+
+uint32_t lcd_changes(void){
+
+  return lcd.changes;
+
+}
+
+//////////////////////////////////////////////////////////////////
+// BMP390
+//////////////////////////////////////////////////////////////////
+
+#define BMP390_ADDRESS    0x77
+#define BMP390_DATA_RESET 0x800000
+
+static struct {
+
+  uint8_t pwr_ctrl, osr, odr;
+  uint32_t press, temp;      // sampled at the start of a read
+
+} bmp390;
+
+static void bmp390_sample(void){
+
+  if((bmp390.pwr_ctrl & 0x30) == 0x30){
+    bmp390.press = scenario_uncomp_press(vp_cycles) & 0xFFFFFF;
+    bmp390.temp = scenario_uncomp_temp(vp_cycles) & 0xFFFFFF;
+  }
+  else{
+    bmp390.press = BMP390_DATA_RESET;
+    bmp390.temp = BMP390_DATA_RESET;
+  }
+
+}
+
+static uint8_t bmp390_read(uint8_t address){
+
+  if(address == 0x00) return 0x60;
+  if(address >= 0x04 && address <= 0x06) return bmp390.press >> (8 * (address - 0x04));
+  if(address >= 0x07 && address <= 0x09) return bmp390.temp >> (8 * (address - 0x07));
+  if(address == 0x1B) return bmp390.pwr_ctrl;
+  if(address == 0x1C) return bmp390.osr;
+  if(address == 0x1D) return bmp390.odr;
+  if(address >= 0x31 && address <= 0x45)
+    return bmp390_calib[(address - 0x31) / 4] >> (8 * ((address - 0x31) % 4));
+
+  return 0;
+
+}
+
+static void bmp390_write(uint8_t address, uint8_t data){
+
+  if(address == 0x1B) bmp390.pwr_ctrl = data;
+  if(address == 0x1C) bmp390.osr = data;
+  if(address == 0x1D) bmp390.odr = data;
+
+}
+
+//////////////////////////////////////////////////////////////////
+// Alarm (ahb_alarm)
+//////////////////////////////////////////////////////////////////
+
+static struct {
+
+  uint32_t lower, upper, control, last;
+  uint32_t outside_count;
+  bool     below, above;
+
+} alarm;
+
+static void alarm_irq(void){
+
+  if((alarm.control & 2) && (alarm.below || alarm.above)) vp_irq_lines |= 1 << IRQ_ALARM;
+  else vp_irq_lines &= ~(1u << IRQ_ALARM);
+
+}
+
+// a new sample latched by the sequencer
+static void alarm_sample(uint32_t pressure){
+
+  bool low = pressure < alarm.lower, high = pressure > alarm.upper;
+  uint32_t filter = (alarm.control >> 4) & 0xF;
+
+  if(!(alarm.control & 1) || pressure == BMP390_DATA_RESET) return;
+
+  alarm.last = pressure;
+  if((low || high) && alarm.outside_count == filter){
+    alarm.below |= low;
+    alarm.above |= high;
+  }
+  if(!low && !high) alarm.outside_count = 0;
+  else if(alarm.outside_count != filter) alarm.outside_count++;
+
+  alarm_irq();
+
+}
+
+static uint32_t alarm_read(uint32_t offset){
+
+  uint32_t value;
+
+  switch(offset){
+    case 0x00: return alarm.lower;
+    case 0x04: return alarm.upper;
+    case 0x08: return alarm.control;
+    case 0x0C:
+      value = (alarm.above << 1) | alarm.below;
+      alarm.below = alarm.above = 0;
+      alarm_irq();
+      return value;
+    case 0x10: return alarm.last;
+  }
+
+  return 0;
+
+}
+
+static void alarm_write(uint32_t offset, uint32_t value){
+
+  switch(offset){
+    case 0x00: alarm.lower = value & 0xFFFFFF; break;
+    case 0x04: alarm.upper = value & 0xFFFFFF; break;
+    case 0x08:
+      alarm.control = value & 0xF3;
+      if(!(value & 1)) alarm.outside_count = 0;
+      alarm_irq();
+      break;
+  }
+
+}
+
+//////////////////////////////////////////////////////////////////
+// I2C (ahb_bmp_i2c)
+//////////////////////////////////////////////////////////////////
+
+#define I2C_BYTE_CYCLES     36   // 8 data bits and the acknowledge, 4 clock cycles each
+#define I2C_FRAME_CYCLES    6    // start, stop and back to idle
+#define I2C_RESTART_CYCLES  2
+
+typedef enum { I2C_IDLE, I2C_MASTER, I2C_SEQUENCER, I2C_QUEUE } i2c_user;
+
+static struct {
+
+  // programmer's model
+  uint32_t device_addr, reg_addr, write_data, control;
+  uint8_t  read_data[6];
+  bool     data_valid, sample_ready, acc_ready;
+  uint32_t seq_ctrl, seq_period;
+  uint32_t seq_press, seq_temp, seq_number, seq_temp_number;
+  uint32_t acc_sum, acc_count, acc_result;
+  uint32_t q_entries[8], q_last, q_index;
+  uint8_t  q_buffer[32];
+  bool     q_irq_enable, q_done, q_error;
+
+  // requests waiting for the bus
+  bool     master_request, q_request, seq_request;
+  uint64_t seq_next;
+  uint32_t seq_temp_count;
+
+  // transfer in progress, its results are taken when it ends
+  i2c_user user;
+  uint64_t done_at;
+  bool     ack, seq_read_temp;
+  uint8_t  data[6];
+
+} i2c;
+
+static void i2c_irq(void){
+
+  bool ready = ((i2c.seq_ctrl >> 2) & 7) ? i2c.acc_ready : i2c.sample_ready;
+
+  if(((i2c.seq_ctrl & 2) && ready) || (i2c.q_irq_enable && i2c.q_done)) vp_irq_lines |= 1 << IRQ_I2C;
+  else vp_irq_lines &= ~(1u << IRQ_I2C);
+
+}
+
+// a read of n registers from address (device address, register, repeated start,
+// device address, data), returns the clock cycles it takes
+static uint32_t i2c_read(uint32_t device, uint8_t address, uint8_t* data, int n){
+
+  int i;
+
+  if(device != BMP390_ADDRESS){
+    i2c.ack = 0;
+    return I2C_FRAME_CYCLES + I2C_BYTE_CYCLES;
+  }
+
+  bmp390_sample();
+  for(i = 0; i < n; i++)
+    data[i] = bmp390_read(address + i);
+
+  return I2C_RESTART_CYCLES + (3 + n) * I2C_BYTE_CYCLES;
+
+}
+
+// a read from the simple sensor (device address and data, there is no register address),
+// the pressure in Pa least significant byte first
+static uint32_t i2c_simple_read(uint32_t device, uint8_t* data, int n){
+
+  uint32_t pressure = scenario_pressure(vp_cycles);
+  int i;
+
+  if(device != BMP390_ADDRESS){
+    i2c.ack = 0;
+    return I2C_FRAME_CYCLES + I2C_BYTE_CYCLES;
+  }
+
+  for(i = 0; i < n; i++)
+    data[i] = (i < 4) ? pressure >> (8 * i) : 0;
+
+  return (1 + n) * I2C_BYTE_CYCLES;
+
+}
+
+// a write of n register/data pairs
+static uint32_t i2c_write(uint32_t device, const uint8_t* address, int address_step, const uint8_t* data, int n){
+
+  int i;
+
+  if(device != BMP390_ADDRESS){
+    i2c.ack = 0;
+    return I2C_FRAME_CYCLES + I2C_BYTE_CYCLES;
+  }
+
+  for(i = 0; i < n; i++)
+    bmp390_write(address_step ? address[0] + i : address[i], data[i]);
+
+  return (1 + 2 * n) * I2C_BYTE_CYCLES;
+
+}
+
+static void i2c_start(i2c_user user){
+
+  uint32_t cycles = I2C_FRAME_CYCLES, entry, n, i;
+  uint8_t address[4], data[8];
+
+  i2c.user = user;
+  i2c.ack = 1;
+  i2c.data_valid = 0;
+
+  switch(user){
+
+    case I2C_MASTER:
+      i2c.master_request = 0;
+      n = ((i2c.control >> 2) & 7) + 1;
+      if((i2c.control & 1) && vp_simple_sensor)
+        cycles += i2c_simple_read(i2c.device_addr, i2c.data, n > 6 ? 6 : n);
+      else if(i2c.control & 1)
+        cycles += i2c_read(i2c.device_addr, i2c.reg_addr, i2c.data, n > 6 ? 6 : n);
+      else{
+        for(i = 0; i < 4; i++){
+          address[i] = i2c.reg_addr >> (8 * i);
+          data[i] = i2c.write_data >> (8 * i);
+        }
+        cycles += i2c_write(i2c.device_addr, address, 0, data, n > 4 ? 4 : n);
+      }
+      break;
+
+    case I2C_SEQUENCER:
+      i2c.seq_request = 0;
+      i2c.seq_read_temp = (i2c.seq_temp_count == 0);
+      i2c.seq_temp_count = i2c.seq_read_temp ? (i2c.seq_ctrl >> 8) & 0xFF : i2c.seq_temp_count - 1;
+      cycles += i2c_read(i2c.device_addr, 0x04, i2c.data, i2c.seq_read_temp ? 6 : 3);
+      break;
+
+    case I2C_QUEUE:
+      // entries run back to back with a repeated start, results go to the queue buffer
+      i2c.q_request = 0;
+      for(i2c.q_index = 0; ; i2c.q_index++){
+        entry = i2c.q_entries[i2c.q_index];
+        n = ((entry >> 16) & 7) + 1;
+        if(entry & 0x80){
+          cycles += i2c_read(entry & 0x7F, entry >> 8, data, n);
+          for(i = 0; i < n && i2c.ack; i++)
+            i2c.q_buffer[(((entry >> 19) & 0x1F) + i) & 0x1F] = data[i];
+        }
+        else{
+          for(i = 0; i < n; i++)
+            data[i] = i2c.q_buffer[(((entry >> 19) & 0x1F) + i) & 0x1F];
+          address[0] = entry >> 8;
+          cycles += i2c_write(entry & 0x7F, address, 1, data, n);
+        }
+        if(!i2c.ack){
+          i2c.q_error = 1;
+          break;
+        }
+        if(i2c.q_index == i2c.q_last) break;
+        cycles += I2C_RESTART_CYCLES;
+      }
+      break;
+
+    default:
+      break;
+
+  }
+
+  i2c.done_at = vp_cycles + cycles;
+  vp_schedule(i2c.done_at);
+
+}
+
+static void i2c_finish(void){
+
+  uint32_t sample, acc_log2 = (i2c.seq_ctrl >> 2) & 7;
+
+  switch(i2c.user){
+
+    case I2C_MASTER:
+      if(i2c.ack && (i2c.control & 1)){
+        memcpy(i2c.read_data, i2c.data, 6);
+        i2c.data_valid = 1;
+      }
+      break;
+
+    case I2C_SEQUENCER:
+      if(!i2c.ack) break;
+      memcpy(i2c.read_data, i2c.data, i2c.seq_read_temp ? 6 : 3);
+      i2c.data_valid = 1;
+      sample = i2c.data[0] | (i2c.data[1] << 8) | (i2c.data[2] << 16);
+      i2c.seq_press = sample;
+      if(i2c.seq_read_temp){
+        i2c.seq_temp = i2c.data[3] | (i2c.data[4] << 8) | (i2c.data[5] << 16);
+        i2c.seq_temp_number = (i2c.seq_number + 1) & 0xFF;
+      }
+      i2c.seq_number = (i2c.seq_number + 1) & 0xFF;
+      i2c.sample_ready = 1;
+      // accumulate and dump, samples still at the reset value are skipped
+      if((i2c.seq_ctrl & 1) && sample != BMP390_DATA_RESET){
+        if(i2c.acc_count >= (1u << acc_log2) - 1){
+          i2c.acc_result = i2c.acc_sum + sample;
+          i2c.acc_sum = 0;
+          i2c.acc_count = 0;
+          i2c.acc_ready = 1;
+        }
+        else{
+          i2c.acc_sum += sample;
+          i2c.acc_count++;
+        }
+      }
+      alarm_sample(sample);
+      break;
+
+    case I2C_QUEUE:
+      i2c.q_done = 1;
+      break;
+
+    default:
+      break;
+
+  }
+
+  i2c.user = I2C_IDLE;
+  i2c_irq();
+
+}
+
+static void i2c_update(void){
+
+  uint64_t period = (uint64_t) i2c.seq_period + 1;
+
+  if(i2c.user != I2C_IDLE){
+    if(vp_cycles < i2c.done_at){
+      vp_schedule(i2c.done_at);
+      return;
+    }
+    i2c_finish();
+  }
+
+  // the sequencer asks for a read every seq_period + 1 clock cycles
+  if(i2c.seq_ctrl & 1){
+    if(vp_cycles >= i2c.seq_next){
+      i2c.seq_request = 1;
+      i2c.seq_next += period * ((vp_cycles - i2c.seq_next) / period + 1);
+    }
+    vp_schedule(i2c.seq_next);
+  }
+
+  // the master first, then the queue, then the sequencer
+  if(i2c.master_request) i2c_start(I2C_MASTER);
+  else if(i2c.q_request) i2c_start(I2C_QUEUE);
+  else if(i2c.seq_request) i2c_start(I2C_SEQUENCER);
+
+}
+
+static uint32_t i2c_read_register(uint32_t offset){
+
+  uint32_t value, word = offset >> 2, i;
+
+  i2c_update();
+
+  // ahb_simple_i2c stops at the status register
+  if(vp_simple_sensor && word > 6) return 0;
+
+  switch(word){
+    case 0: return i2c.device_addr;
+    case 1: return i2c.reg_addr;
+    case 2: return i2c.read_data[0] | (i2c.read_data[1] << 8) | (i2c.read_data[2] << 16) | ((uint32_t) i2c.read_data[3] << 24);
+    case 3: return i2c.read_data[4] | (i2c.read_data[5] << 8);
+    case 6:
+      return i2c.data_valid | ((i2c.user != I2C_IDLE) << 1) | (i2c.sample_ready << 2) | (i2c.acc_ready << 3);
+    case 7: return i2c.seq_ctrl;
+    case 8: return i2c.seq_period;
+    case 9:
+      i2c.sample_ready = 0;
+      i2c_irq();
+      return (i2c.seq_number << 24) | i2c.seq_press;
+    case 10: return (i2c.seq_temp_number << 24) | i2c.seq_temp;
+    case 11:
+      i2c.acc_ready = 0;
+      i2c_irq();
+      return i2c.acc_result;
+    case 12:
+      value = (i2c.q_index << 8) | (i2c.q_error << 6) | (i2c.q_done << 5) | (i2c.q_irq_enable << 4) |
+              (i2c.q_last << 1) | (i2c.q_request || i2c.user == I2C_QUEUE);
+      i2c.q_done = 0;
+      i2c_irq();
+      return value;
+  }
+
+  if(word >= 16 && word < 24) return i2c.q_entries[word - 16];
+
+  if(word >= 24 && word < 32){
+    for(value = 0, i = 0; i < 4; i++)
+      value |= (uint32_t) i2c.q_buffer[4 * (word - 24) + i] << (8 * i);
+    return value;
+  }
+
+  return 0;
+
+}
+
+static void i2c_write_register(uint32_t offset, uint32_t value){
+
+  uint32_t word = offset >> 2, i;
+
+  i2c_update();
+
+  if(vp_simple_sensor && word > 6) return;
+
+  switch(word){
+    case 0: i2c.device_addr = value & 0x7F; break;
+    case 1: i2c.reg_addr = value; break;
+    case 4: i2c.write_data = value; break;
+    case 5:
+      i2c.control = value & 0x1F;
+      if(value & 2) i2c.master_request = 1;
+      break;
+    case 7:
+      if((value & 1) && !(i2c.seq_ctrl & 1)){
+        // the first read starts as soon as the sequencer is enabled and includes the temperature
+        i2c.seq_next = vp_cycles + 1;
+        i2c.seq_temp_count = 0;
+        i2c.acc_sum = 0;
+        i2c.acc_count = 0;
+      }
+      if(!(value & 1)) i2c.seq_request = 0;
+      i2c.seq_ctrl = value & 0xFF1F;
+      break;
+    case 8: i2c.seq_period = value & 0xFFFFFF; break;
+    case 12:
+      i2c.q_last = (value >> 1) & 7;
+      i2c.q_irq_enable = (value >> 4) & 1;
+      if(value & 1){
+        i2c.q_request = 1;
+        i2c.q_done = 0;
+        i2c.q_error = 0;
+      }
+      break;
+  }
+
+  if(word >= 16 && word < 24) i2c.q_entries[word - 16] = value & 0xFFFFFF;
+
+  if(word >= 24 && word < 32)
+    for(i = 0; i < 4; i++)
+      i2c.q_buffer[4 * (word - 24) + i] = value >> (8 * i);
+
+  i2c_irq();
+  vp_schedule(vp_cycles + 1);
+
+}
+
+//////////////////////////////////////////////////////////////////
+// Compensation pipeline (ahb_bmp_comp)
+//////////////////////////////////////////////////////////////////
+
+#define COMP_TEMPERATURE_CYCLES 160
+#define COMP_TERMS_CYCLES       100
+#define COMP_PRESSURE_CYCLES    210
+
+static struct {
+
+  uint32_t calib[6], uncomp_temp, uncomp_press;
+  int64_t  t_lin, pressure;
+  uint64_t busy_until;
+  BMP390_calib_data     data;
+  BMP390_pressure_terms terms;
+
+} comp;
+
+static void comp_start(uint32_t control){
+
+  uint8_t buffer[24];
+  uint32_t cycles = 0;
+  int i;
+
+  for(i = 0; i < 24; i++)
+    buffer[i] = comp.calib[i / 4] >> (8 * (i % 4));
+  BMP390_unpack_calib(buffer, &comp.data);
+  comp.data.t_lin = comp.t_lin;
+
+  if(control & 1){
+    BMP390_compensate_temperature(comp.uncomp_temp, &comp.data);
+    comp.t_lin = comp.data.t_lin;
+    BMP390_pressure_terms_update(&comp.data, &comp.terms);
+    cycles += COMP_TEMPERATURE_CYCLES;
+  }
+  else if(control & 4){
+    BMP390_pressure_terms_update(&comp.data, &comp.terms);
+    cycles += COMP_TERMS_CYCLES;
+  }
+
+  if(control & 2){
+    comp.pressure = BMP390_compensate_pressure_terms(comp.uncomp_press, &comp.data, &comp.terms);
+    cycles += COMP_PRESSURE_CYCLES;
+  }
+
+  comp.busy_until = vp_cycles + cycles;
+
+}
+
+static uint32_t comp_read(uint32_t offset){
+
+  uint32_t word = offset >> 2;
+
+  if(word < 6) return comp.calib[word];
+
+  switch(word){
+    case 6:  return comp.uncomp_temp;
+    case 7:  return comp.uncomp_press;
+    case 9:  return vp_cycles < comp.busy_until;
+    case 10: return (uint32_t) comp.t_lin;
+    case 11: return (uint32_t) (comp.t_lin >> 16);
+    case 12: return (uint32_t) comp.pressure;
+  }
+
+  return 0;
+
+}
+
+static void comp_write(uint32_t offset, uint32_t value){
+
+  uint32_t word = offset >> 2;
+
+  if(word < 6) comp.calib[word] = value;
+
+  switch(word){
+    case 6:  comp.uncomp_temp = value & 0xFFFFFF; break;
+    case 7:  comp.uncomp_press = value & 0xFFFFFF; break;
+    case 8:  comp_start(value); break;
+    case 10: comp.t_lin = (int32_t) value; break;
+  }
+
+}
+
+//////////////////////////////////////////////////////////////////
+// Trip timer (ahb_timer)
+//////////////////////////////////////////////////////////////////
+
+static struct {
+
+  uint32_t control;
+  uint64_t ticks;          // counted up to since
+  uint64_t since;
+  uint64_t flag_seconds;   // seconds when the second flag was last cleared
+
+} timer;
+
+static uint64_t timer_ticks(void){
+
+  return timer.ticks + ((timer.control & 1) ? vp_cycles - timer.since : 0);
+
+}
+
+static bool timer_flag(void){
+
+  return timer_ticks() / vp_frequency != timer.flag_seconds;
+
+}
+
+static void timer_irq(void){
+
+  if((timer.control & 2) && timer_flag()) vp_irq_lines |= 1 << IRQ_TIMER;
+  else vp_irq_lines &= ~(1u << IRQ_TIMER);
+
+}
+
+static void timer_update(void){
+
+  timer_irq();
+
+  // the next second, while it can raise the interrupt
+  if((timer.control & 3) == 3)
+    vp_schedule(vp_cycles + vp_frequency - timer_ticks() % vp_frequency);
+
+}
+
+static uint32_t bcd2(uint32_t n){
+
+  return ((n / 10) << 4) | (n % 10);
+
+}
+
+static uint32_t timer_read(uint32_t offset){
+
+  uint64_t ticks = timer_ticks(), seconds = ticks / vp_frequency;
+  uint32_t value;
+
+  switch(offset){
+    case 0x00: return timer.control;
+    case 0x04:
+      return (bcd2((seconds / 3600) % 100) << 16) | (bcd2((seconds / 60) % 60) << 8) | bcd2(seconds % 60);
+    case 0x08: return (uint32_t) (ticks % vp_frequency);
+    case 0x0C: return (uint32_t) seconds;
+    case 0x10:
+      value = timer_flag();
+      timer.flag_seconds = seconds;
+      timer_irq();
+      return value;
+  }
+
+  return 0;
+
+}
+
+static void timer_write(uint32_t offset, uint32_t value){
+
+  if(offset != 0x00) return;
+
+  timer.ticks = timer_ticks();
+  timer.since = vp_cycles;
+  if(value & 4){
+    timer.ticks = 0;
+    timer.flag_seconds = 0;
+  }
+  timer.control = value & 3;
+  timer_update();
+
+}
+
+//////////////////////////////////////////////////////////////////
+// Bus
+//////////////////////////////////////////////////////////////////
+
+static bool dma_warned;
+
+// word registers of the peripherals, a narrower access gets its byte lanes
+static bool peripheral_read(uint32_t address, uint32_t* value){
+
+  uint32_t offset = address & (SLAVE_SIZE - 4);
+
+  switch(address & ~(SLAVE_SIZE - 1)){
+    case BUTTON_BASE: *value = buttons_read(offset); return 1;
+    case LCD_BASE:    *value = lcd_read(offset); return 1;
+    case I2C_BASE:    *value = i2c_read_register(offset); return 1;
+    case COMP_BASE:   *value = comp_read(offset); return 1;
+    case TIMER_BASE:  *value = timer_read(offset); return 1;
+    case ALARM_BASE:  *value = alarm_read(offset); return 1;
+    case DMA_BASE:
+      if(!dma_warned) fprintf(stderr, "vp: ahb_dma is not modelled, its registers read as 0\n");
+      dma_warned = 1;
+      *value = 0;
+      return 1;
+  }
+
+  return 0;
+
+}
+
+static bool peripheral_write(uint32_t address, uint32_t value){
+
+  uint32_t offset = address & (SLAVE_SIZE - 4);
+
+  switch(address & ~(SLAVE_SIZE - 1)){
+    case BUTTON_BASE: return 1;
+    case LCD_BASE:    lcd_write(offset, value); return 1;
+    case I2C_BASE:    i2c_write_register(offset, value); return 1;
+    case COMP_BASE:   comp_write(offset, value); return 1;
+    case TIMER_BASE:  timer_write(offset, value); return 1;
+    case ALARM_BASE:  alarm_write(offset, value); return 1;
+    case DMA_BASE:
+      if(!dma_warned) fprintf(stderr, "vp: ahb_dma is not modelled, writes to it are ignored\n");
+      dma_warned = 1;
+      return 1;
+  }
+
+  return 0;
+
+}
+
+bool bus_read(uint32_t address, int size, uint32_t* value){
+
+  uint32_t word;
+  int i;
+
+  if(address < ROM_BASE + ROM_SIZE || (address >= RAM_BASE && address < RAM_BASE + RAM_SIZE)){
+    const uint8_t* memory = (address < ROM_BASE + ROM_SIZE) ? &rom[address - ROM_BASE] : &ram[address - RAM_BASE];
+    for(*value = 0, i = 0; i < size; i++)
+      *value |= (uint32_t) memory[i] << (8 * i);
+    return 1;
+  }
+
+  if(address >= SCS_BASE && address < SCS_BASE + SCS_SIZE)
+    return size == 4 && scs_read(address - SCS_BASE, value);
+
+  if(!peripheral_read(address, &word)) return 0;
+
+  *value = (word >> (8 * (address & 3))) & (size == 4 ? 0xFFFFFFFF : (1u << (8 * size)) - 1);
+  return 1;
+
+}
+
+bool bus_write(uint32_t address, int size, uint32_t value){
+
+  int i;
+
+  if(address < ROM_BASE + ROM_SIZE) return 1;   // a ROM ignores writes
+
+  if(address >= RAM_BASE && address < RAM_BASE + RAM_SIZE){
+    for(i = 0; i < size; i++)
+      ram[address - RAM_BASE + i] = value >> (8 * i);
+    return 1;
+  }
+
+  if(address >= SCS_BASE && address < SCS_BASE + SCS_SIZE)
+    return size == 4 && scs_write(address - SCS_BASE, value);
+
+  return peripheral_write(address, value << (8 * (address & 3)));
+
+}
+
+//////////////////////////////////////////////////////////////////
+// Reset and events
+//////////////////////////////////////////////////////////////////
+
+void peripherals_reset(bool power_on){
+
+  int next = buttons.next;
+
+  // the button presses are outside the SoC, only the reported state is reset
+  buttons.status = 0;
+  buttons.chord = 0;
+  buttons.data_valid = 0;
+  buttons.next = power_on ? 0 : next;
+
+  memset(lcd.chars, 0, sizeof(lcd.chars));
+  lcd.inst = 0;
+  lcd.read = 0;
+  lcd.busy_until = 0;
+
+  memset(&comp, 0, sizeof(comp));
+  memset(&alarm, 0, sizeof(alarm));
+  alarm.upper = 0xFFFFFF;
+
+  vp_irq_lines &= (1 << IRQ_TIMER) | (1 << IRQ_I2C);
+
+  if(power_on){
+    memset(&lcd, 0, sizeof(lcd));
+    memset(lcd.ddram, ' ', sizeof(lcd.ddram));
+    memset(lcd.text, ' ', 8);
+    memset(&bmp390, 0, sizeof(bmp390));
+    bmp390.osr = 0x02;
+    memset(&i2c, 0, sizeof(i2c));
+    memset(&timer, 0, sizeof(timer));
+    vp_irq_lines = 0;
+  }
+
+  vp_schedule(vp_cycles);
+
+}
+
+void peripherals_update(void){
+
+  buttons_update();
+  i2c_update();
+  timer_update();
+
+}
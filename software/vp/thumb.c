@@ -0,0 +1,1077 @@
+// Cortex-M0 instruction set simulator (thumb.c)
+//
+// Executes ARMv6-M (the 16 bit Thumb instructions, BL, MRS, MSR, DMB, DSB and
+// ISB) an instruction at a time and adds its cycle count from the Cortex-M0
+// Technical Reference Manual, with every slave at zero wait states: a load or
+// store 2, a taken branch 3, BL 4, LDM, STM, PUSH and POP 1 + n (+3 when POP
+// loads the pc), MULS 1 (the fast multiplier). Exceptions are taken between
+// instructions in priority order as by the NVIC, their entry and return take
+// 16 cycles each.
+//
+// An undefined instruction or an unaligned or unmapped access (a bus error
+// from the default slave) is a HardFault, a fault in the HardFault handler is
+// a lockup, which the SoC turns into a warm reset.
+//
+// SysTick (clocked by HCLK) and the NVIC and SCB registers the firmware uses
+// are in here as well.
+
+#include <stdio.h>
+#include <string.h>
+#include "vp.h"
+
+cpu_state cpu;
+
+#define EXC_RESET        1
+#define EXC_NMI          2
+#define EXC_HARDFAULT    3
+#define EXC_SVCALL       11
+#define EXC_PENDSV       14
+#define EXC_SYSTICK      15
+#define EXC_IRQ0         16
+
+#define EXC_ENTRY_CYCLES   16
+#define EXC_RETURN_CYCLES  16
+
+#define EXC_RETURN_HANDLER  0xFFFFFFF1
+#define EXC_RETURN_MSP      0xFFFFFFF9
+#define EXC_RETURN_PSP      0xFFFFFFFD
+
+#define EXC_BIT(n) ((uint64_t) 1 << (n))
+
+// set by an access which failed during the current instruction
+static bool fault;
+
+//////////////////////////////////////////////////////////////////
+// Memory access
+//////////////////////////////////////////////////////////////////
+
+static uint32_t load(uint32_t address, int size){
+
+  uint32_t value;
+
+  if((address & (size - 1)) || !bus_read(address, size, &value)){
+    fault = 1;
+    return 0;
+  }
+
+  return value;
+
+}
+
+static void store(uint32_t address, int size, uint32_t value){
+
+  if((address & (size - 1)) || !bus_write(address, size, value))
+    fault = 1;
+
+}
+
+static uint16_t fetch(uint32_t address){
+
+  uint32_t value;
+
+  if(address < ROM_SIZE - 1)
+    return rom[address] | (rom[address + 1] << 8);
+
+  if((address & 1) || !bus_read(address, 2, &value)){
+    fault = 1;
+    return 0;
+  }
+
+  return value;
+
+}
+
+//////////////////////////////////////////////////////////////////
+// Arithmetic
+//////////////////////////////////////////////////////////////////
+
+static void set_nz(uint32_t result){
+
+  cpu.n = result >> 31;
+  cpu.z = (result == 0);
+
+}
+
+static uint32_t add_with_carry(uint32_t a, uint32_t b, bool carry_in){
+
+  uint64_t unsigned_sum = (uint64_t) a + b + carry_in;
+  int64_t signed_sum = (int64_t) (int32_t) a + (int32_t) b + carry_in;
+  uint32_t result = (uint32_t) unsigned_sum;
+
+  set_nz(result);
+  cpu.c = unsigned_sum >> 32;
+  cpu.v = ((int64_t) (int32_t) result != signed_sum);
+
+  return result;
+
+}
+
+// shifts by a register (bottom byte), the carry is left alone by a shift of 0
+static uint32_t shift_lsl(uint32_t value, uint32_t n){
+
+  if(n == 0) return value;
+  cpu.c = (n <= 32) ? (uint32_t) ((uint64_t) value >> (32 - n)) & 1 : 0;
+  return (n < 32) ? value << n : 0;
+
+}
+
+static uint32_t shift_lsr(uint32_t value, uint32_t n){
+
+  if(n == 0) return value;
+  cpu.c = (n <= 32) ? (value >> (n - 1)) & 1 : 0;
+  return (n < 32) ? value >> n : 0;
+
+}
+
+static uint32_t shift_asr(uint32_t value, uint32_t n){
+
+  if(n == 0) return value;
+  if(n >= 32){
+    cpu.c = value >> 31;
+    return (value >> 31) ? 0xFFFFFFFF : 0;
+  }
+  cpu.c = (value >> (n - 1)) & 1;
+  return (uint32_t) ((int32_t) value >> n);
+
+}
+
+static uint32_t shift_ror(uint32_t value, uint32_t n){
+
+  if(n == 0) return value;
+  n &= 31;
+  if(n) value = (value >> n) | (value << (32 - n));
+  cpu.c = value >> 31;
+  return value;
+
+}
+
+//////////////////////////////////////////////////////////////////
+// Special registers
+//////////////////////////////////////////////////////////////////
+
+static uint32_t apsr(void){
+
+  return (cpu.n << 31) | (cpu.z << 30) | (cpu.c << 29) | (cpu.v << 28);
+
+}
+
+static void set_apsr(uint32_t value){
+
+  cpu.n = (value >> 31) & 1;
+  cpu.z = (value >> 30) & 1;
+  cpu.c = (value >> 29) & 1;
+  cpu.v = (value >> 28) & 1;
+
+}
+
+// the process stack is in use in thread mode with CONTROL.SPSEL set
+static bool using_psp(void){
+
+  return cpu.ipsr == 0 && (cpu.control & 2);
+
+}
+
+static uint32_t get_msp(void){
+
+  return using_psp() ? cpu.other_sp : cpu.r[13];
+
+}
+
+static uint32_t get_psp(void){
+
+  return using_psp() ? cpu.r[13] : cpu.other_sp;
+
+}
+
+static void set_msp(uint32_t value){
+
+  if(using_psp()) cpu.other_sp = value & ~3u;
+  else            cpu.r[13] = value & ~3u;
+
+}
+
+static void set_psp(uint32_t value){
+
+  if(using_psp()) cpu.r[13] = value & ~3u;
+  else            cpu.other_sp = value & ~3u;
+
+}
+
+// change the stack in use (r13 and other_sp are swapped)
+static void switch_stack(void){
+
+  uint32_t sp = cpu.r[13];
+
+  cpu.r[13] = cpu.other_sp;
+  cpu.other_sp = sp;
+
+}
+
+//////////////////////////////////////////////////////////////////
+// Exceptions
+//////////////////////////////////////////////////////////////////
+
+static int exception_priority(int n){
+
+  if(n == EXC_RESET) return -3;
+  if(n == EXC_NMI) return -2;
+  if(n == EXC_HARDFAULT) return -1;
+  return cpu.priority[n];
+
+}
+
+// priority the processor is running at (boosted to 0 by PRIMASK)
+static int execution_priority(void){
+
+  int n, priority = 4;
+
+  for(n = 1; n < 48; n++)
+    if((cpu.active & EXC_BIT(n)) && exception_priority(n) < priority)
+      priority = exception_priority(n);
+
+  if(cpu.primask && priority > 0) priority = 0;
+
+  return priority;
+
+}
+
+// pending exception which can preempt what is running (0 for none)
+static int ready_exception(void){
+
+  uint64_t candidates = cpu.pending & cpu.enabled;
+  int n, best = 0, limit;
+
+  if(!candidates) return 0;
+
+  limit = execution_priority();
+
+  for(n = 1; n < 48; n++)
+    if((candidates & EXC_BIT(n)) && exception_priority(n) < limit &&
+       (best == 0 || exception_priority(n) < exception_priority(best)))
+      best = n;
+
+  return best;
+
+}
+
+bool cpu_wakeup(void){
+
+  cpu.pending |= ((uint64_t) vp_irq_lines << EXC_IRQ0) & ~cpu.active;
+
+  return (cpu.pending & cpu.enabled) != 0;
+
+}
+
+static void lockup(const char* reason){
+
+  char message[96];
+
+  snprintf(message, sizeof(message), "lockup (%s in the HardFault handler)", reason);
+  vp_warm_reset(message);
+
+}
+
+// stack r0~r3, r12, lr, the return address and xPSR, then run the handler
+static void exception_entry(int n, uint32_t return_address){
+
+  uint32_t frame, xpsr, handler;
+  bool aligned;
+
+  frame = cpu.r[13];
+  aligned = !(frame & 4);
+  frame = (frame - 0x20) & ~7u;
+  xpsr = apsr() | cpu.ipsr | (1 << 24) | (!aligned << 9);
+
+  store(frame + 0x00, 4, cpu.r[0]);
+  store(frame + 0x04, 4, cpu.r[1]);
+  store(frame + 0x08, 4, cpu.r[2]);
+  store(frame + 0x0C, 4, cpu.r[3]);
+  store(frame + 0x10, 4, cpu.r[12]);
+  store(frame + 0x14, 4, cpu.r[14]);
+  store(frame + 0x18, 4, return_address);
+  store(frame + 0x1C, 4, xpsr);
+  cpu.r[13] = frame;
+
+  if(fault){
+    fault = 0;
+    if(n == EXC_HARDFAULT || cpu.ipsr == EXC_HARDFAULT){
+      lockup("stacking fault");
+      return;
+    }
+  }
+
+  if(cpu.ipsr) cpu.r[14] = EXC_RETURN_HANDLER;
+  else if(using_psp()){
+    cpu.r[14] = EXC_RETURN_PSP;
+    switch_stack();
+  }
+  else cpu.r[14] = EXC_RETURN_MSP;
+
+  cpu.ipsr = n;
+  cpu.pending &= ~EXC_BIT(n);
+  cpu.active |= EXC_BIT(n);
+  cpu.sleeping = 0;
+
+  handler = load(4 * n, 4);
+  cpu.r[15] = handler & ~1u;
+
+  vp_cycles += EXC_ENTRY_CYCLES;
+  profile_call(cpu.r[15], return_address, 1);
+  profile_cycles(cpu.r[15], EXC_ENTRY_CYCLES);
+
+}
+
+static void take_fault(uint32_t pc, const char* reason){
+
+  fault = 0;
+
+  if(cpu.ipsr == EXC_HARDFAULT || cpu.ipsr == EXC_NMI){
+    lockup(reason);
+    return;
+  }
+
+  fprintf(stderr, "vp: HardFault at 0x%08X (%s), cycle %llu\n", pc, reason, (unsigned long long) vp_cycles);
+  exception_entry(EXC_HARDFAULT, pc);
+
+}
+
+// unstack the frame and return to where the exception was taken
+static void exception_return(uint32_t exc_return, uint32_t pc){
+
+  uint32_t frame, xpsr;
+
+  if((exc_return != EXC_RETURN_HANDLER && exc_return != EXC_RETURN_MSP && exc_return != EXC_RETURN_PSP) ||
+     !(cpu.active & EXC_BIT(cpu.ipsr))){
+    take_fault(pc, "bad exception return");
+    return;
+  }
+
+  cpu.active &= ~EXC_BIT(cpu.ipsr);
+
+  if(exc_return == EXC_RETURN_HANDLER){
+    // back to the exception that was preempted (the highest priority one still active)
+    int n;
+    cpu.ipsr = 0;
+    for(n = 1; n < 48; n++)
+      if((cpu.active & EXC_BIT(n)) &&
+         (cpu.ipsr == 0 || exception_priority(n) < exception_priority(cpu.ipsr)))
+        cpu.ipsr = n;
+  }
+  else{
+    cpu.ipsr = 0;
+    if(exc_return == EXC_RETURN_PSP){
+      cpu.control |= 2;
+      switch_stack();
+    }
+    else
+      cpu.control &= ~2u;
+  }
+
+  frame = cpu.r[13];
+  cpu.r[0] = load(frame + 0x00, 4);
+  cpu.r[1] = load(frame + 0x04, 4);
+  cpu.r[2] = load(frame + 0x08, 4);
+  cpu.r[3] = load(frame + 0x0C, 4);
+  cpu.r[12] = load(frame + 0x10, 4);
+  cpu.r[14] = load(frame + 0x14, 4);
+  cpu.r[15] = load(frame + 0x18, 4) & ~1u;
+  xpsr = load(frame + 0x1C, 4);
+  cpu.r[13] = (frame + 0x20) | ((xpsr >> 7) & 4);
+  set_apsr(xpsr);
+
+  vp_cycles += EXC_RETURN_CYCLES;
+  profile_cycles(pc, EXC_RETURN_CYCLES);
+  profile_return(1);
+
+}
+
+// a branch which can change state (BX, BLX, POP), returns are profiled
+static void branch_exchange(uint32_t target, uint32_t pc, bool is_return){
+
+  if(cpu.ipsr && (target & 0xF0000000) == 0xF0000000){
+    exception_return(target, pc);
+    return;
+  }
+
+  if(!(target & 1)){
+    take_fault(pc, "branch to ARM state");
+    return;
+  }
+
+  cpu.r[15] = target & ~1u;
+  if(is_return) profile_return(0);
+
+}
+
+//////////////////////////////////////////////////////////////////
+// Reset
+//////////////////////////////////////////////////////////////////
+
+void cpu_reset(void){
+
+  memset(&cpu, 0, sizeof(cpu));
+  fault = 0;
+
+  // NMI and HardFault are always enabled, the others reset to priority 0
+  cpu.enabled = EXC_BIT(EXC_NMI) | EXC_BIT(EXC_HARDFAULT) | EXC_BIT(EXC_SVCALL) |
+                EXC_BIT(EXC_PENDSV) | EXC_BIT(EXC_SYSTICK);
+
+  cpu.r[13] = load(0, 4) & ~3u;
+  cpu.r[14] = 0xFFFFFFFF;
+  cpu.r[15] = load(4, 4) & ~1u;
+  fault = 0;
+
+  systick_reset();
+
+}
+
+//////////////////////////////////////////////////////////////////
+// Execution
+//////////////////////////////////////////////////////////////////
+
+static bool condition(uint32_t cond){
+
+  switch(cond){
+    case 0x0: return cpu.z;
+    case 0x1: return !cpu.z;
+    case 0x2: return cpu.c;
+    case 0x3: return !cpu.c;
+    case 0x4: return cpu.n;
+    case 0x5: return !cpu.n;
+    case 0x6: return cpu.v;
+    case 0x7: return !cpu.v;
+    case 0x8: return cpu.c && !cpu.z;
+    case 0x9: return !cpu.c || cpu.z;
+    case 0xA: return cpu.n == cpu.v;
+    case 0xB: return cpu.n != cpu.v;
+    case 0xC: return !cpu.z && cpu.n == cpu.v;
+    case 0xD: return cpu.z || cpu.n != cpu.v;
+    default:  return 1;
+  }
+
+}
+
+static int count_bits(uint32_t list){
+
+  int n = 0;
+
+  for(; list; list >>= 1) n += list & 1;
+
+  return n;
+
+}
+
+// 32 bit instructions, returns the cycles taken (0 for an undefined instruction)
+static uint32_t execute32(uint32_t pc, uint16_t op1, uint16_t op2){
+
+  uint32_t rd, rn, sysm, value;
+
+  // BL
+  if((op1 & 0xF800) == 0xF000 && (op2 & 0xD000) == 0xD000){
+    uint32_t s = (op1 >> 10) & 1;
+    uint32_t i1 = !(((op2 >> 13) & 1) ^ s);
+    uint32_t i2 = !(((op2 >> 11) & 1) ^ s);
+    int32_t offset = (int32_t) ((i1 << 23) | (i2 << 22) | ((op1 & 0x3FF) << 12) | ((op2 & 0x7FF) << 1)) -
+                     (int32_t) (s << 24);
+    cpu.r[14] = (pc + 4) | 1;
+    cpu.r[15] = pc + 4 + offset;
+    profile_call(cpu.r[15], pc + 4, 0);
+    return 4;
+  }
+
+  // MSR
+  if((op1 & 0xFFF0) == 0xF380 && (op2 & 0xFF00) == 0x8800){
+    rn = op1 & 0xF;
+    sysm = op2 & 0xFF;
+    value = cpu.r[rn];
+    if(sysm < 8){
+      if(!(sysm & 4)) set_apsr(value);
+    }
+    else if(sysm == 8) set_msp(value);
+    else if(sysm == 9) set_psp(value);
+    else if(sysm == 16) cpu.primask = value & 1;
+    else if(sysm == 20){
+      if(cpu.ipsr == 0 && ((cpu.control ^ value) & 2)) switch_stack();
+      if(cpu.ipsr == 0) cpu.control = value & 3;
+    }
+    return 4;
+  }
+
+  // MRS
+  if(op1 == 0xF3EF && (op2 & 0xF000) == 0x8000){
+    rd = (op2 >> 8) & 0xF;
+    sysm = op2 & 0xFF;
+    value = 0;
+    if(sysm < 8){
+      if(sysm & 1) value |= cpu.ipsr;
+      if(!(sysm & 4)) value |= apsr();
+    }
+    else if(sysm == 8) value = get_msp();
+    else if(sysm == 9) value = get_psp();
+    else if(sysm == 16) value = cpu.primask;
+    else if(sysm == 20) value = cpu.control;
+    cpu.r[rd] = value;
+    return 4;
+  }
+
+  // DSB, DMB and ISB
+  if(op1 == 0xF3BF && (op2 & 0xFFC0) == 0x8F40)
+    return 4;
+
+  return 0;
+
+}
+
+void cpu_step(void){
+
+  uint32_t pc, op, cycles = 1;
+  uint32_t rd, rn, rm, a, b, result, address, list, i;
+  int n;
+
+  // the interrupt lines are level sensitive, a line still high after the handler pends it again
+  cpu.pending |= ((uint64_t) vp_irq_lines << EXC_IRQ0) & ~cpu.active;
+  if(cpu.pending && (n = ready_exception())){
+    exception_entry(n, cpu.r[15]);
+    return;
+  }
+
+  // a pending interrupt ends a sleep even when it cannot be taken yet
+  if(cpu.sleeping){
+    if(!(cpu.pending & cpu.enabled)) return;
+    cpu.sleeping = 0;
+  }
+
+  pc = cpu.r[15];
+  op = fetch(pc);
+  if(fault){
+    take_fault(pc, "instruction fetch");
+    return;
+  }
+  cpu.r[15] = pc + 2;
+  cpu.instructions++;
+
+  rd = op & 7;
+  rn = (op >> 3) & 7;
+
+  switch(op >> 11){
+
+    case 0x00:  // LSLS Rd, Rm, #imm5
+      cpu.r[rd] = shift_lsl(cpu.r[rn], (op >> 6) & 0x1F);
+      set_nz(cpu.r[rd]);
+      break;
+
+    case 0x01:  // LSRS Rd, Rm, #imm5 (0 is 32)
+      a = (op >> 6) & 0x1F;
+      cpu.r[rd] = shift_lsr(cpu.r[rn], a ? a : 32);
+      set_nz(cpu.r[rd]);
+      break;
+
+    case 0x02:  // ASRS Rd, Rm, #imm5 (0 is 32)
+      a = (op >> 6) & 0x1F;
+      cpu.r[rd] = shift_asr(cpu.r[rn], a ? a : 32);
+      set_nz(cpu.r[rd]);
+      break;
+
+    case 0x03:  // ADDS/SUBS Rd, Rn, Rm or #imm3
+      b = (op & 0x0400) ? (op >> 6) & 7 : cpu.r[(op >> 6) & 7];
+      if(op & 0x0200) cpu.r[rd] = add_with_carry(cpu.r[rn], ~b, 1);
+      else            cpu.r[rd] = add_with_carry(cpu.r[rn], b, 0);
+      break;
+
+    case 0x04:  // MOVS Rd, #imm8
+      rd = (op >> 8) & 7;
+      cpu.r[rd] = op & 0xFF;
+      set_nz(cpu.r[rd]);
+      break;
+
+    case 0x05:  // CMP Rn, #imm8
+      add_with_carry(cpu.r[(op >> 8) & 7], ~(op & 0xFF), 1);
+      break;
+
+    case 0x06:  // ADDS Rdn, #imm8
+      rd = (op >> 8) & 7;
+      cpu.r[rd] = add_with_carry(cpu.r[rd], op & 0xFF, 0);
+      break;
+
+    case 0x07:  // SUBS Rdn, #imm8
+      rd = (op >> 8) & 7;
+      cpu.r[rd] = add_with_carry(cpu.r[rd], ~(op & 0xFF), 1);
+      break;
+
+    case 0x08:
+      if(!(op & 0x0400)){
+        // data processing Rdn, Rm
+        a = cpu.r[rd];
+        b = cpu.r[rn];
+        switch((op >> 6) & 0xF){
+          case 0x0: result = a & b; set_nz(result); cpu.r[rd] = result; break;                  // ANDS
+          case 0x1: result = a ^ b; set_nz(result); cpu.r[rd] = result; break;                  // EORS
+          case 0x2: result = shift_lsl(a, b & 0xFF); set_nz(result); cpu.r[rd] = result; break; // LSLS
+          case 0x3: result = shift_lsr(a, b & 0xFF); set_nz(result); cpu.r[rd] = result; break; // LSRS
+          case 0x4: result = shift_asr(a, b & 0xFF); set_nz(result); cpu.r[rd] = result; break; // ASRS
+          case 0x5: cpu.r[rd] = add_with_carry(a, b, cpu.c); break;                             // ADCS
+          case 0x6: cpu.r[rd] = add_with_carry(a, ~b, cpu.c); break;                            // SBCS
+          case 0x7: result = shift_ror(a, b & 0xFF); set_nz(result); cpu.r[rd] = result; break; // RORS
+          case 0x8: set_nz(a & b); break;                                                       // TST
+          case 0x9: cpu.r[rd] = add_with_carry(~b, 0, 1); break;                                // RSBS #0
+          case 0xA: add_with_carry(a, ~b, 1); break;                                            // CMP
+          case 0xB: add_with_carry(a, b, 0); break;                                             // CMN
+          case 0xC: result = a | b; set_nz(result); cpu.r[rd] = result; break;                  // ORRS
+          case 0xD: result = a * b; set_nz(result); cpu.r[rd] = result; break;                  // MULS
+          case 0xE: result = a & ~b; set_nz(result); cpu.r[rd] = result; break;                 // BICS
+          case 0xF: result = ~b; set_nz(result); cpu.r[rd] = result; break;                     // MVNS
+        }
+      }
+      else{
+        // high register operations and BX/BLX
+        rd = (op & 7) | ((op >> 4) & 8);
+        rm = (op >> 3) & 0xF;
+        b = (rm == 15) ? pc + 4 : cpu.r[rm];
+        switch((op >> 8) & 3){
+          case 0:  // ADD Rdn, Rm
+            a = (rd == 15) ? pc + 4 : cpu.r[rd];
+            result = a + b;
+            if(rd == 15){
+              cpu.r[15] = result & ~1u;
+              cycles = 3;
+            }
+            else if(rd == 13) cpu.r[13] = result & ~3u;
+            else cpu.r[rd] = result;
+            break;
+          case 1:  // CMP Rn, Rm
+            add_with_carry(cpu.r[rd], ~b, 1);
+            break;
+          case 2:  // MOV Rd, Rm
+            if(rd == 15){
+              cpu.r[15] = b & ~1u;
+              cycles = 3;
+            }
+            else if(rd == 13) cpu.r[13] = b & ~3u;
+            else cpu.r[rd] = b;
+            break;
+          case 3:  // BX Rm, BLX Rm
+            cycles = 3;
+            if(op & 0x80){
+              cpu.r[14] = (pc + 2) | 1;
+              if(!(b & 1)) take_fault(pc, "branch to ARM state");
+              else{
+                cpu.r[15] = b & ~1u;
+                profile_call(cpu.r[15], pc + 2, 0);
+              }
+            }
+            else
+              branch_exchange(b, pc, 1);
+            break;
+        }
+      }
+      break;
+
+    case 0x09:  // LDR Rt, [pc, #imm8]
+      cpu.r[(op >> 8) & 7] = load(((pc + 4) & ~3u) + ((op & 0xFF) << 2), 4);
+      cycles = 2;
+      break;
+
+    case 0x0A:
+    case 0x0B:  // load/store Rt, [Rn, Rm]
+      address = cpu.r[rn] + cpu.r[(op >> 6) & 7];
+      cycles = 2;
+      switch((op >> 9) & 7){
+        case 0: store(address, 4, cpu.r[rd]); break;                          // STR
+        case 1: store(address, 2, cpu.r[rd]); break;                          // STRH
+        case 2: store(address, 1, cpu.r[rd]); break;                          // STRB
+        case 3: cpu.r[rd] = (uint32_t) (int8_t) load(address, 1); break;      // LDRSB
+        case 4: cpu.r[rd] = load(address, 4); break;                          // LDR
+        case 5: cpu.r[rd] = load(address, 2); break;                          // LDRH
+        case 6: cpu.r[rd] = load(address, 1); break;                          // LDRB
+        case 7: cpu.r[rd] = (uint32_t) (int16_t) load(address, 2); break;     // LDRSH
+      }
+      break;
+
+    case 0x0C:  // STR Rt, [Rn, #imm5*4]
+      store(cpu.r[rn] + (((op >> 6) & 0x1F) << 2), 4, cpu.r[rd]);
+      cycles = 2;
+      break;
+
+    case 0x0D:  // LDR Rt, [Rn, #imm5*4]
+      cpu.r[rd] = load(cpu.r[rn] + (((op >> 6) & 0x1F) << 2), 4);
+      cycles = 2;
+      break;
+
+    case 0x0E:  // STRB Rt, [Rn, #imm5]
+      store(cpu.r[rn] + ((op >> 6) & 0x1F), 1, cpu.r[rd]);
+      cycles = 2;
+      break;
+
+    case 0x0F:  // LDRB Rt, [Rn, #imm5]
+      cpu.r[rd] = load(cpu.r[rn] + ((op >> 6) & 0x1F), 1);
+      cycles = 2;
+      break;
+
+    case 0x10:  // STRH Rt, [Rn, #imm5*2]
+      store(cpu.r[rn] + (((op >> 6) & 0x1F) << 1), 2, cpu.r[rd]);
+      cycles = 2;
+      break;
+
+    case 0x11:  // LDRH Rt, [Rn, #imm5*2]
+      cpu.r[rd] = load(cpu.r[rn] + (((op >> 6) & 0x1F) << 1), 2);
+      cycles = 2;
+      break;
+
+    case 0x12:  // STR Rt, [sp, #imm8*4]
+      store(cpu.r[13] + ((op & 0xFF) << 2), 4, cpu.r[(op >> 8) & 7]);
+      cycles = 2;
+      break;
+
+    case 0x13:  // LDR Rt, [sp, #imm8*4]
+      cpu.r[(op >> 8) & 7] = load(cpu.r[13] + ((op & 0xFF) << 2), 4);
+      cycles = 2;
+      break;
+
+    case 0x14:  // ADR Rd, #imm8*4
+      cpu.r[(op >> 8) & 7] = ((pc + 4) & ~3u) + ((op & 0xFF) << 2);
+      break;
+
+    case 0x15:  // ADD Rd, sp, #imm8*4
+      cpu.r[(op >> 8) & 7] = cpu.r[13] + ((op & 0xFF) << 2);
+      break;
+
+    case 0x16:
+    case 0x17:  // miscellaneous
+      if((op & 0xFF00) == 0xB000){
+        // ADD/SUB sp, sp, #imm7*4
+        if(op & 0x80) cpu.r[13] -= (op & 0x7F) << 2;
+        else          cpu.r[13] += (op & 0x7F) << 2;
+      }
+      else if((op & 0xFF00) == 0xB200){
+        a = cpu.r[rn];
+        switch((op >> 6) & 3){
+          case 0: cpu.r[rd] = (uint32_t) (int16_t) a; break;   // SXTH
+          case 1: cpu.r[rd] = (uint32_t) (int8_t) a; break;    // SXTB
+          case 2: cpu.r[rd] = a & 0xFFFF; break;               // UXTH
+          case 3: cpu.r[rd] = a & 0xFF; break;                 // UXTB
+        }
+      }
+      else if((op & 0xFE00) == 0xB400){
+        // PUSH {list, lr}
+        list = (op & 0xFF) | ((op & 0x100) << 6);
+        n = count_bits(list);
+        address = cpu.r[13] - 4 * n;
+        cpu.r[13] = address;
+        for(i = 0; i < 15; i++)
+          if(list & (1 << i)){
+            store(address, 4, cpu.r[i]);
+            address += 4;
+          }
+        cycles = 1 + n;
+      }
+      else if((op & 0xFFEF) == 0xB662){
+        // CPSIE i, CPSID i
+        cpu.primask = (op >> 4) & 1;
+      }
+      else if((op & 0xFF00) == 0xBA00 && ((op >> 6) & 3) != 2){
+        a = cpu.r[rn];
+        switch((op >> 6) & 3){
+          case 0:  // REV
+            cpu.r[rd] = (a >> 24) | ((a >> 8) & 0xFF00) | ((a << 8) & 0xFF0000) | (a << 24);
+            break;
+          case 1:  // REV16
+            cpu.r[rd] = ((a >> 8) & 0x00FF00FF) | ((a << 8) & 0xFF00FF00);
+            break;
+          case 3:  // REVSH
+            cpu.r[rd] = (uint32_t) (int16_t) (((a >> 8) & 0xFF) | ((a << 8) & 0xFF00));
+            break;
+        }
+      }
+      else if((op & 0xFE00) == 0xBC00){
+        // POP {list, pc}
+        list = op & 0xFF;
+        n = count_bits(list) + ((op >> 8) & 1);
+        address = cpu.r[13];
+        for(i = 0; i < 8; i++)
+          if(list & (1 << i)){
+            cpu.r[i] = load(address, 4);
+            address += 4;
+          }
+        cycles = 1 + n;
+        if(op & 0x100){
+          a = load(address, 4);
+          cpu.r[13] = address + 4;
+          cycles += 3;
+          if(!fault) branch_exchange(a, pc, 1);
+        }
+        else
+          cpu.r[13] = address;
+      }
+      else if((op & 0xFF00) == 0xBF00 && !(op & 0xF)){
+        // hints
+        switch((op >> 4) & 0xF){
+          case 0x2:  // WFE
+            cycles = 2;
+            if(cpu.event) cpu.event = 0;
+            else cpu.sleeping = 1;
+            break;
+          case 0x3:  // WFI
+            cycles = 2;
+            cpu.sleeping = 1;
+            break;
+          case 0x4:  // SEV
+            cpu.event = 1;
+            break;
+          default:   // NOP, YIELD
+            break;
+        }
+      }
+      else{
+        // BKPT (no debugger) and undefined instructions
+        cpu.r[15] = pc;
+        take_fault(pc, (op & 0xFF00) == 0xBE00 ? "breakpoint" : "undefined instruction");
+        return;
+      }
+      break;
+
+    case 0x18:  // STM Rn!, {list}
+      rn = (op >> 8) & 7;
+      list = op & 0xFF;
+      address = cpu.r[rn];
+      for(i = 0; i < 8; i++)
+        if(list & (1 << i)){
+          store(address, 4, cpu.r[i]);
+          address += 4;
+        }
+      cpu.r[rn] = address;
+      cycles = 1 + count_bits(list);
+      break;
+
+    case 0x19:  // LDM Rn{!}, {list} (no write back when Rn is loaded)
+      rn = (op >> 8) & 7;
+      list = op & 0xFF;
+      address = cpu.r[rn];
+      for(i = 0; i < 8; i++)
+        if(list & (1 << i)){
+          cpu.r[i] = load(address, 4);
+          address += 4;
+        }
+      if(!(list & (1 << rn))) cpu.r[rn] = address;
+      cycles = 1 + count_bits(list);
+      break;
+
+    case 0x1A:
+    case 0x1B:
+      if(((op >> 8) & 0xF) == 0xF){
+        // SVC
+        exception_entry(EXC_SVCALL, pc + 2);
+        return;
+      }
+      if(((op >> 8) & 0xF) == 0xE){
+        // UDF
+        cpu.r[15] = pc;
+        take_fault(pc, "undefined instruction");
+        return;
+      }
+      // B<cond> label
+      if(condition((op >> 8) & 0xF)){
+        cpu.r[15] = pc + 4 + (int32_t) (int8_t) (op & 0xFF) * 2;
+        cycles = 3;
+      }
+      break;
+
+    case 0x1C:  // B label
+      cpu.r[15] = pc + 4 + (((int32_t) (op << 21)) >> 20);
+      cycles = 3;
+      break;
+
+    default:    // 32 bit instructions
+      cpu.r[15] = pc + 4;
+      cycles = execute32(pc, op, fetch(pc + 2));
+      if(cycles == 0){
+        cpu.r[15] = pc;
+        take_fault(pc, "undefined instruction");
+        return;
+      }
+      break;
+
+  }
+
+  if(fault){
+    cpu.r[15] = pc;
+    take_fault(pc, "bus error or unaligned access");
+    return;
+  }
+
+  vp_cycles += cycles;
+  profile_cycles(pc, cycles);
+
+}
+
+//////////////////////////////////////////////////////////////////
+// SysTick
+//////////////////////////////////////////////////////////////////
+
+// the counter is not stored, it is worked out from the cycle at which it last
+// reached zero (it reloads on the next cycle, so it wraps every LOAD + 1 cycles)
+
+static struct {
+  uint32_t ctrl;         // bit 0 enable, bit 1 tickint, bit 2 clksource, bit 16 countflag
+  uint32_t load;
+  uint32_t val;          // while disabled
+  uint64_t zero_at;      // while enabled
+  uint64_t next_zero;
+} systick;
+
+static uint32_t systick_val(void){
+
+  uint64_t period = (uint64_t) systick.load + 1;
+
+  if(!(systick.ctrl & 1)) return systick.val;
+
+  return (uint32_t) ((period - (vp_cycles - systick.zero_at) % period) % period);
+
+}
+
+// start counting from val at the current cycle
+static void systick_start(uint32_t val){
+
+  uint64_t period = (uint64_t) systick.load + 1;
+
+  if(val == 0){
+    systick.zero_at = vp_cycles;
+    systick.next_zero = vp_cycles + period;
+  }
+  else{
+    systick.zero_at = vp_cycles - (period - val);
+    systick.next_zero = vp_cycles + val;
+  }
+  vp_schedule(systick.next_zero);
+
+}
+
+void systick_reset(void){
+
+  memset(&systick, 0, sizeof(systick));
+
+}
+
+void systick_update(void){
+
+  uint64_t period = (uint64_t) systick.load + 1;
+
+  if(!(systick.ctrl & 1)) return;
+
+  if(vp_cycles >= systick.next_zero){
+    systick.ctrl |= 1 << 16;
+    if(systick.ctrl & 2) cpu.pending |= EXC_BIT(EXC_SYSTICK);
+    systick.next_zero += period * ((vp_cycles - systick.next_zero) / period + 1);
+  }
+  vp_schedule(systick.next_zero);
+
+}
+
+//////////////////////////////////////////////////////////////////
+// System control space (SysTick, NVIC and SCB)
+//////////////////////////////////////////////////////////////////
+
+bool scs_read(uint32_t offset, uint32_t* value){
+
+  int i;
+
+  *value = 0;
+
+  switch(offset){
+    case 0x010:  // SYST_CSR (COUNTFLAG is cleared by the read)
+      systick_update();
+      *value = systick.ctrl;
+      systick.ctrl &= ~(1u << 16);
+      return 1;
+    case 0x014: *value = systick.load; return 1;
+    case 0x018: *value = systick_val(); return 1;
+    case 0x01C: *value = 0; return 1;
+    case 0x100:  // NVIC_ISER
+    case 0x180:  // NVIC_ICER
+      *value = (uint32_t) (cpu.enabled >> EXC_IRQ0);
+      return 1;
+    case 0x200:  // NVIC_ISPR
+    case 0x280:  // NVIC_ICPR
+      *value = (uint32_t) (cpu.pending >> EXC_IRQ0);
+      return 1;
+    case 0xD00: *value = 0x410CC200; return 1;   // CPUID, Cortex-M0 r0p0
+    case 0xD04:  // ICSR
+      *value = cpu.ipsr;
+      if(cpu.pending & EXC_BIT(EXC_SYSTICK)) *value |= 1 << 26;
+      if(cpu.pending & EXC_BIT(EXC_PENDSV)) *value |= 1 << 28;
+      return 1;
+    case 0xD0C: *value = 0xFA050000; return 1;   // AIRCR
+    case 0xD10:
+    case 0xD14: return 1;                        // SCR, CCR
+    case 0xD1C: *value = (uint32_t) (cpu.priority[EXC_SVCALL] << 30); return 1;
+    case 0xD20: *value = (uint32_t) (cpu.priority[EXC_PENDSV] << 22) | (uint32_t) (cpu.priority[EXC_SYSTICK] << 30); return 1;
+  }
+
+  if(offset >= 0x400 && offset < 0x420){
+    // NVIC_IPR, 2 bits of priority per interrupt
+    for(i = 0; i < 4; i++)
+      *value |= (uint32_t) cpu.priority[EXC_IRQ0 + (offset - 0x400) + i] << (8 * i + 6);
+    return 1;
+  }
+
+  return 0;
+
+}
+
+bool scs_write(uint32_t offset, uint32_t value){
+
+  int i;
+
+  switch(offset){
+    case 0x010:  // SYST_CSR
+      {
+        uint32_t val = systick_val();
+        systick.ctrl = (systick.ctrl & (1 << 16)) | (value & 7);
+        if(systick.ctrl & 1) systick_start(val);
+        else systick.val = val;
+      }
+      return 1;
+    case 0x014:  // SYST_RVR, used from the next reload
+      {
+        uint32_t val = systick_val();
+        systick.load = value & 0x00FFFFFF;
+        if(systick.ctrl & 1) systick_start(val);
+      }
+      return 1;
+    case 0x018:  // SYST_CVR, any write clears the counter and COUNTFLAG
+      systick.ctrl &= ~(1u << 16);
+      if(systick.ctrl & 1) systick_start(0);
+      else systick.val = 0;
+      return 1;
+    case 0x01C: return 1;
+    case 0x100: cpu.enabled |= (uint64_t) value << EXC_IRQ0; return 1;
+    case 0x180: cpu.enabled &= ~((uint64_t) value << EXC_IRQ0); return 1;
+    case 0x200: cpu.pending |= (uint64_t) value << EXC_IRQ0; return 1;
+    case 0x280: cpu.pending &= ~((uint64_t) value << EXC_IRQ0); return 1;
+    case 0xD04:  // ICSR
+      if(value & (1u << 31)) cpu.pending |= EXC_BIT(EXC_NMI);
+      if(value & (1 << 28)) cpu.pending |= EXC_BIT(EXC_PENDSV);
+      if(value & (1 << 27)) cpu.pending &= ~EXC_BIT(EXC_PENDSV);
+      if(value & (1 << 26)) cpu.pending |= EXC_BIT(EXC_SYSTICK);
+      if(value & (1 << 25)) cpu.pending &= ~EXC_BIT(EXC_SYSTICK);
+      return 1;
+    case 0xD0C:  // AIRCR, SYSRESETREQ with the key
+      if((value >> 16) == 0x05FA && (value & 4)) vp_warm_reset("system reset request");
+      return 1;
+    case 0xD10:
+    case 0xD14: return 1;
+    case 0xD1C: cpu.priority[EXC_SVCALL] = value >> 30; return 1;
+    case 0xD20:
+      cpu.priority[EXC_PENDSV] = (value >> 22) & 3;
+      cpu.priority[EXC_SYSTICK] = value >> 30;
+      return 1;
+  }
+
+  if(offset >= 0x400 && offset < 0x420){
+    for(i = 0; i < 4; i++)
+      cpu.priority[EXC_IRQ0 + (offset - 0x400) + i] = (value >> (8 * i + 6)) & 3;
+    return 1;
+  }
+
+  return 0;
+
+}
@@ -0,0 +1,603 @@
+// Virtual platform, loader, scenario and profiler (vp.c)
+//
+// Runs the firmware on the models in thumb.c and peripherals.c for a number
+// of simulated seconds, then reports where the cycles went, function by
+// function. Build on the host (the compensation relies on two's complement
+// wrap around, as in bmp_comp_ref.c) with
+//
+//   cc -O2 -fwrapv -o vp vp.c thumb.c peripherals.c -lm
+//
+// Usage: vp [options] <image>
+//
+//   <image>          code.elf, or code.vmem / ahb_rom.sv (assign memory[ n ] lines)
+//   -s <file>        symbols for a vmem image (arm-none-eabi-nm -S code.elf output)
+//   -t <seconds>     simulated time (default 10)
+//   -f <hertz>       HCLK frequency (default 32768)
+//   -a <file>        altitude profile, lines of "<seconds> <metres>" joined by straight
+//                    lines (default 0m), converted to pressure by the standard atmosphere
+//   -b <file>        button script, lines of "<seconds> mode|trip|both <milliseconds>"
+//   -S               a simple sensor returning Pascals through ahb_simple_i2c (firmware
+//                    built with SIMPLE_SENSOR) rather than the BMP390
+//   -l               print the LCD text every time it changes
+//   -p <rows>        functions listed in the profile (default 20)
+//
+// Cycle counts are for zero wait state memory and peripherals, the peripheral
+// timings are those of the RTL to within a few clock cycles.
+//
+// What has been checked: the only firmware image available to run is the one in
+// behavioural/ahb_rom.sv. It was built before the sequencer, the compensation
+// pipeline, the timer, the alarm and the warm restart. It shows the pressure,
+// the altitude at 1000 m and a trip reset as the soc testbenches do. There is
+// no ELF or nm output for that image, so the per-function profile has only been
+// exercised with hand written symbols. The models of the peripherals that image
+// does not use have not been run against firmware at all; they follow the RTL
+// register maps and the ahb_*_stim.sv testbenches. Treat their results as
+// unverified until main.c has been built with an ARM toolchain and run here
+// with -s.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <elf.h>
+#include "vp.h"
+#include "../code/bmp390_comp.h"
+
+uint64_t vp_cycles;
+uint64_t vp_next_event;
+uint32_t vp_frequency = 32768;
+uint32_t vp_irq_lines;
+bool     vp_simple_sensor;
+
+static const char* reset_reason;
+
+//////////////////////////////////////////////////////////////////
+// Scenario
+//////////////////////////////////////////////////////////////////
+
+#define SCENARIO_UNCOMP_TEMP   0x74B1C0   // ~25C, as bmp390_model.sv
+#define SCENARIO_MAX_POINTS    4096
+
+static struct {
+
+  double   seconds[SCENARIO_MAX_POINTS], metres[SCENARIO_MAX_POINTS];
+  int      npoints;
+
+  BMP390_calib_data     calib_data;
+  BMP390_pressure_terms terms;
+  int64_t  last_Pa;
+  uint32_t last_uncomp;
+
+} scenario;
+
+static double scenario_altitude(double seconds){
+
+  int i;
+
+  if(scenario.npoints == 0) return 0.0;
+  if(seconds <= scenario.seconds[0]) return scenario.metres[0];
+
+  for(i = 1; i < scenario.npoints; i++)
+    if(seconds < scenario.seconds[i])
+      return scenario.metres[i - 1] + (scenario.metres[i] - scenario.metres[i - 1]) *
+             (seconds - scenario.seconds[i - 1]) / (scenario.seconds[i] - scenario.seconds[i - 1]);
+
+  return scenario.metres[scenario.npoints - 1];
+
+}
+
+uint32_t scenario_pressure(uint64_t cycle){
+
+  double metres = scenario_altitude((double) cycle / vp_frequency);
+
+  return (uint32_t) (101325.0 * pow(1.0 - metres / 44330.0, 5.255) + 0.5);
+
+}
+
+uint32_t scenario_uncomp_press(uint64_t cycle){
+
+  int64_t pressure_Pa = scenario_pressure(cycle);
+
+  // raw pressure the firmware compensates back to the profile, starting from the last one
+  if(pressure_Pa != scenario.last_Pa){
+    scenario.last_uncomp = BMP390_uncompensate_pressure_terms(pressure_Pa, scenario.last_uncomp,
+                                                              &scenario.calib_data, &scenario.terms);
+    scenario.last_Pa = pressure_Pa;
+  }
+
+  return scenario.last_uncomp;
+
+}
+
+uint32_t scenario_uncomp_temp(uint64_t cycle){
+
+  (void) cycle;
+  return SCENARIO_UNCOMP_TEMP;
+
+}
+
+static void scenario_init(void){
+
+  uint8_t buffer[24];
+  int i;
+
+  for(i = 0; i < 24; i++)
+    buffer[i] = bmp390_calib[i / 4] >> (8 * (i % 4));
+
+  BMP390_unpack_calib(buffer, &scenario.calib_data);
+  BMP390_compensate_temperature(SCENARIO_UNCOMP_TEMP, &scenario.calib_data);
+  BMP390_pressure_terms_update(&scenario.calib_data, &scenario.terms);
+
+  scenario.last_Pa = -1;
+  scenario.last_uncomp = 0x800000;
+
+}
+
+static void load_altitude_profile(const char* filename){
+
+  FILE* file = fopen(filename, "r");
+  char line[256];
+
+  if(!file){
+    perror(filename);
+    exit(1);
+  }
+
+  while(fgets(line, sizeof(line), file)){
+    if(line[0] == '#') continue;
+    if(scenario.npoints == SCENARIO_MAX_POINTS){
+      fprintf(stderr, "vp: %s has more than %d points\n", filename, SCENARIO_MAX_POINTS);
+      break;
+    }
+    if(sscanf(line, "%lf %lf", &scenario.seconds[scenario.npoints], &scenario.metres[scenario.npoints]) == 2)
+      scenario.npoints++;
+  }
+
+  fclose(file);
+
+}
+
+static void load_button_script(const char* filename){
+
+  FILE* file = fopen(filename, "r");
+  char line[256], which[16];
+  double seconds, ms;
+  uint32_t mask;
+
+  if(!file){
+    perror(filename);
+    exit(1);
+  }
+
+  while(fgets(line, sizeof(line), file)){
+    if(line[0] == '#' || sscanf(line, "%lf %15s %lf", &seconds, which, &ms) != 3) continue;
+    if(!strcmp(which, "mode")) mask = 1;
+    else if(!strcmp(which, "trip")) mask = 2;
+    else if(!strcmp(which, "both")) mask = 3;
+    else{
+      fprintf(stderr, "vp: %s: unknown button '%s'\n", filename, which);
+      continue;
+    }
+    buttons_press(vp_ms_to_cycles(seconds * 1000.0), vp_ms_to_cycles(seconds * 1000.0 + ms), mask);
+  }
+
+  fclose(file);
+
+}
+
+//////////////////////////////////////////////////////////////////
+// Symbols and profiler
+//////////////////////////////////////////////////////////////////
+
+#define MAX_SYMBOLS     1024
+#define MAX_CALL_DEPTH  256
+
+typedef struct {
+
+  uint32_t address, size;
+  char     name[64];
+  uint64_t self, inclusive, calls;
+  uint32_t active;            // frames of this function on the call stack
+
+} symbol;
+
+typedef struct {
+
+  int      function;
+  uint32_t sp;
+  bool     exception;
+  uint64_t start;
+  uint64_t handler_start;     // handler_cycles at the call
+
+} call_frame;
+
+static symbol symbols[MAX_SYMBOLS + 2];
+static int nsymbols;
+static int function_of[ROM_SIZE / 2];    // symbol for each halfword of the ROM
+
+static call_frame call_stack[MAX_CALL_DEPTH];
+static int call_depth;
+static uint64_t handler_cycles;          // spent in exception handlers (excluding those they preempted)
+
+#define UNKNOWN_FUNCTION  (MAX_SYMBOLS)
+#define SLEEPING          (MAX_SYMBOLS + 1)
+
+static void add_symbol(uint32_t address, uint32_t size, const char* name){
+
+  if(nsymbols == MAX_SYMBOLS || address >= ROM_BASE + ROM_SIZE) return;
+
+  symbols[nsymbols].address = address & ~1u;
+  symbols[nsymbols].size = size;
+  snprintf(symbols[nsymbols].name, sizeof(symbols[nsymbols].name), "%s", name);
+  nsymbols++;
+
+}
+
+static int compare_address(const void* a, const void* b){
+
+  const symbol *x = a, *y = b;
+
+  return (x->address > y->address) - (x->address < y->address);
+
+}
+
+// a function without a size runs up to the next one
+static void index_symbols(void){
+
+  uint32_t end, address;
+  int i;
+
+  qsort(symbols, nsymbols, sizeof(symbol), compare_address);
+
+  for(i = 0; i < ROM_SIZE / 2; i++)
+    function_of[i] = UNKNOWN_FUNCTION;
+
+  for(i = 0; i < nsymbols; i++){
+    end = symbols[i].size ? symbols[i].address + symbols[i].size :
+          (i + 1 < nsymbols ? symbols[i + 1].address : symbols[i].address + 2);
+    for(address = symbols[i].address; address < end && address < ROM_BASE + ROM_SIZE; address += 2)
+      function_of[address / 2] = i;
+  }
+
+  strcpy(symbols[UNKNOWN_FUNCTION].name, "(unknown)");
+  strcpy(symbols[SLEEPING].name, "(sleeping)");
+
+}
+
+static int function_at(uint32_t pc){
+
+  return pc < ROM_BASE + ROM_SIZE ? function_of[pc / 2] : UNKNOWN_FUNCTION;
+
+}
+
+void profile_cycles(uint32_t pc, uint32_t cycles){
+
+  symbols[function_at(pc)].self += cycles;
+
+}
+
+void profile_call(uint32_t target, uint32_t return_address, bool exception){
+
+  call_frame* frame;
+  int function = function_at(target);
+
+  (void) return_address;
+
+  symbols[function].calls++;
+
+  if(call_depth == MAX_CALL_DEPTH) return;
+
+  frame = &call_stack[call_depth++];
+  frame->function = function;
+  frame->sp = cpu.r[13];
+  frame->exception = exception;
+  frame->start = vp_cycles;
+  frame->handler_start = handler_cycles;
+  symbols[function].active++;
+
+}
+
+static void pop_frame(void){
+
+  call_frame* frame = &call_stack[--call_depth];
+  uint64_t cycles = (vp_cycles - frame->start) - (handler_cycles - frame->handler_start);
+
+  // recursive and nested frames are already inside the outermost one
+  if(--symbols[frame->function].active == 0) symbols[frame->function].inclusive += cycles;
+  if(frame->exception) handler_cycles += cycles;
+
+}
+
+// a return pops the calls made at or below the stack pointer it returns to (tail calls
+// and helpers returning through a branch return only once), an exception return pops
+// everything down to the exception
+void profile_return(bool exception){
+
+  if(exception){
+    while(call_depth && !call_stack[call_depth - 1].exception) pop_frame();
+    if(call_depth) pop_frame();
+    return;
+  }
+
+  while(call_depth && !call_stack[call_depth - 1].exception && call_stack[call_depth - 1].sp <= cpu.r[13])
+    pop_frame();
+
+}
+
+static int compare_self(const void* a, const void* b){
+
+  const symbol *x = a, *y = b;
+
+  return (x->self < y->self) - (x->self > y->self);
+
+}
+
+static void report_profile(int rows){
+
+  uint64_t total = vp_cycles;
+  int i;
+
+  // still running at the end
+  while(call_depth) pop_frame();
+
+  qsort(symbols, MAX_SYMBOLS + 2, sizeof(symbol), compare_self);
+
+  printf("\n%-32s %12s %6s %10s %12s\n", "function", "self cycles", "%", "calls", "inclusive");
+  for(i = 0; i < rows && i < MAX_SYMBOLS + 2 && symbols[i].self; i++)
+    printf("%-32s %12llu %5.1f%% %10llu %12llu\n", symbols[i].name, (unsigned long long) symbols[i].self,
+           100.0 * symbols[i].self / total, (unsigned long long) symbols[i].calls,
+           (unsigned long long) symbols[i].inclusive);
+
+}
+
+//////////////////////////////////////////////////////////////////
+// Loader
+//////////////////////////////////////////////////////////////////
+
+static bool load_memory(uint32_t address, const uint8_t* data, uint32_t size){
+
+  // the ROM starts at address 0
+  if(address + size <= ROM_BASE + ROM_SIZE)
+    memcpy(&rom[address - ROM_BASE], data, size);
+  else if(address >= RAM_BASE && address + size <= RAM_BASE + RAM_SIZE)
+    memcpy(&ram[address - RAM_BASE], data, size);
+  else
+    return 0;
+
+  return 1;
+
+}
+
+// loadable segments at their load (ROM) addresses, the start up code copies .data, and the functions
+static void load_elf(const uint8_t* image, size_t size, const char* filename){
+
+  const Elf32_Ehdr* header = (const Elf32_Ehdr*) image;
+  const Elf32_Phdr* segment;
+  const Elf32_Shdr *sections, *strings;
+  const Elf32_Sym* sym;
+  int i, j;
+
+  if(size < sizeof(Elf32_Ehdr) || header->e_ident[EI_CLASS] != ELFCLASS32 || header->e_machine != EM_ARM){
+    fprintf(stderr, "vp: %s is not a 32 bit ARM ELF file\n", filename);
+    exit(1);
+  }
+
+  for(i = 0; i < header->e_phnum; i++){
+    segment = (const Elf32_Phdr*) (image + header->e_phoff + i * header->e_phentsize);
+    if(segment->p_type != PT_LOAD || segment->p_filesz == 0) continue;
+    if(!load_memory(segment->p_paddr, image + segment->p_offset, segment->p_filesz))
+      fprintf(stderr, "vp: segment at 0x%08X does not fit the ROM or RAM\n", segment->p_paddr);
+  }
+
+  sections = (const Elf32_Shdr*) (image + header->e_shoff);
+  for(i = 0; i < header->e_shnum; i++){
+    if(sections[i].sh_type != SHT_SYMTAB) continue;
+    strings = &sections[sections[i].sh_link];
+    for(j = 0; j < (int) (sections[i].sh_size / sizeof(Elf32_Sym)); j++){
+      sym = (const Elf32_Sym*) (image + sections[i].sh_offset) + j;
+      if(ELF32_ST_TYPE(sym->st_info) == STT_FUNC)
+        add_symbol(sym->st_value, sym->st_size, (const char*) image + strings->sh_offset + sym->st_name);
+    }
+  }
+
+}
+
+// code.vmem (and so ahb_rom.sv) has a line per word: assign memory[ n ] = 32'hxxxxxxxx;
+static void load_vmem(const char* filename){
+
+  FILE* file = fopen(filename, "r");
+  char line[256];
+  uint32_t index, word;
+  uint8_t bytes[4];
+  int words = 0;
+
+  while(fgets(line, sizeof(line), file))
+    if(sscanf(line, " assign memory[ %u ] = 32'h%x;", &index, &word) == 2){
+      bytes[0] = word;
+      bytes[1] = word >> 8;
+      bytes[2] = word >> 16;
+      bytes[3] = word >> 24;
+      if(load_memory(ROM_BASE + 4 * index, bytes, 4)) words++;
+    }
+
+  fclose(file);
+
+  if(words == 0){
+    fprintf(stderr, "vp: no ROM contents in %s\n", filename);
+    exit(1);
+  }
+
+}
+
+// nm output, "address [size] type name" with code symbols of type t or T
+static void load_nm_symbols(const char* filename){
+
+  FILE* file = fopen(filename, "r");
+  char line[256], type, name[64];
+  unsigned address, size;
+
+  if(!file){
+    perror(filename);
+    exit(1);
+  }
+
+  while(fgets(line, sizeof(line), file)){
+    if(sscanf(line, "%x %x %c %63s", &address, &size, &type, name) == 4 ||
+       (size = 0, sscanf(line, "%x %c %63s", &address, &type, name) == 3))
+      if(type == 't' || type == 'T') add_symbol(address, size, name);
+  }
+
+  fclose(file);
+
+}
+
+static void load_image(const char* filename){
+
+  FILE* file = fopen(filename, "rb");
+  uint8_t* image;
+  long size;
+
+  if(!file){
+    perror(filename);
+    exit(1);
+  }
+
+  fseek(file, 0, SEEK_END);
+  size = ftell(file);
+  rewind(file);
+  image = malloc(size);
+  if(fread(image, 1, size, file) != (size_t) size){
+    perror(filename);
+    exit(1);
+  }
+  fclose(file);
+
+  if(size >= 4 && !memcmp(image, ELFMAG, SELFMAG)) load_elf(image, size, filename);
+  else load_vmem(filename);
+
+  free(image);
+
+}
+
+//////////////////////////////////////////////////////////////////
+// Simulation
+//////////////////////////////////////////////////////////////////
+
+// reset once the current instruction has finished
+void vp_warm_reset(const char* reason){
+
+  reset_reason = reason;
+
+}
+
+static void usage(void){
+
+  fprintf(stderr, "usage: vp [-t seconds] [-f hertz] [-a altitude_file] [-b button_file] [-s nm_file] [-S] [-l] [-p rows] image\n");
+  exit(1);
+
+}
+
+int main(int argc, char** argv){
+
+  const char *image = NULL, *altitude_file = NULL, *button_file = NULL, *symbol_file = NULL;
+  double seconds = 10.0, host_seconds;
+  bool log_lcd = 0;
+  int rows = 20, i;
+  uint64_t end, until, sleeping = 0, instructions = 0;
+  uint32_t changes = 0;
+  clock_t host_start;
+
+  for(i = 1; i < argc; i++){
+    if(argv[i][0] != '-'){
+      image = argv[i];
+      continue;
+    }
+    if(argv[i][1] == 'l'){
+      log_lcd = 1;
+      continue;
+    }
+    if(argv[i][1] == 'S'){
+      vp_simple_sensor = 1;
+      continue;
+    }
+    if(i + 1 == argc) usage();
+    switch(argv[i][1]){
+      case 't': seconds = atof(argv[++i]); break;
+      case 'f': vp_frequency = strtoul(argv[++i], NULL, 0); break;
+      case 'a': altitude_file = argv[++i]; break;
+      case 'b': button_file = argv[++i]; break;
+      case 's': symbol_file = argv[++i]; break;
+      case 'p': rows = atoi(argv[++i]); break;
+      default:  usage();
+    }
+  }
+  if(!image || vp_frequency == 0) usage();
+
+  load_image(image);
+  if(symbol_file) load_nm_symbols(symbol_file);
+  index_symbols();
+
+  scenario_init();
+  if(altitude_file) load_altitude_profile(altitude_file);
+
+  vp_next_event = VP_NEVER;
+  peripherals_reset(1);
+  cpu_reset();
+  if(button_file) load_button_script(button_file);
+
+  end = vp_ms_to_cycles(seconds * 1000.0);
+  host_start = clock();
+
+  while(vp_cycles < end){
+
+    if(vp_cycles >= vp_next_event){
+      vp_next_event = VP_NEVER;
+      systick_update();
+      peripherals_update();
+    }
+
+    // nothing happens until the next event while asleep
+    if(cpu.sleeping && !cpu_wakeup()){
+      until = vp_next_event < end ? vp_next_event : end;
+      if(until > vp_cycles){
+        symbols[SLEEPING].self += until - vp_cycles;
+        sleeping += until - vp_cycles;
+        vp_cycles = until;
+      }
+      continue;
+    }
+
+    cpu_step();
+
+    if(reset_reason){
+      printf("%10.3fs  warm reset: %s\n", (double) vp_cycles / vp_frequency, reset_reason);
+      reset_reason = NULL;
+      call_depth = 0;
+      instructions += cpu.instructions;
+      peripherals_reset(0);
+      cpu_reset();
+    }
+
+    if(log_lcd && lcd_changes() != changes){
+      changes = lcd_changes();
+      printf("%10.3fs  LCD \"%.8s\"\n", (double) vp_cycles / vp_frequency, lcd_text());
+    }
+
+  }
+
+  host_seconds = (double) (clock() - host_start) / CLOCKS_PER_SEC;
+  instructions += cpu.instructions;
+
+  printf("\nsimulated %.3fs (%llu cycles at %uHz, %llu instructions) in %.3fs\n",
+         (double) vp_cycles / vp_frequency, (unsigned long long) vp_cycles, vp_frequency,
+         (unsigned long long) instructions, host_seconds);
+  printf("processor asleep for %llu cycles (%.1f%%)\n", (unsigned long long) sleeping,
+         100.0 * sleeping / vp_cycles);
+  printf("LCD \"%.8s\"\n", lcd_text());
+
+  report_profile(rows);
+
+  return 0;
+
+}
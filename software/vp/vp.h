@@ -0,0 +1,137 @@
+// Virtual platform (vp.h)
+//
+// Host model of the altimeter SoC for running the firmware without the RTL:
+// a Cortex-M0 instruction set simulator with SysTick and the NVIC (thumb.c),
+// models of the peripherals written from the register maps at the top of
+// their RTL (peripherals.c), and the loader, scenario and profiler (vp.c).
+//
+// Everything runs on the HCLK cycle count vp_cycles. A peripheral only does
+// something when it is accessed or at the next event it has asked for with
+// vp_schedule(), so long busy waits and sleeps cost little host time.
+
+#ifndef VP_H
+#define VP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// memory map (soc.sv)
+#define ROM_BASE     0x00000000
+#define ROM_SIZE     0x4000
+#define RAM_BASE     0x20000000
+#define RAM_SIZE     812         // fitted, the rest of the 1kB region is unmapped
+#define BUTTON_BASE  0x40000000
+#define LCD_BASE     0x50000000
+#define I2C_BASE     0x60000000
+#define DMA_BASE     0x70000000
+#define COMP_BASE    0x80000000
+#define TIMER_BASE   0x90000000
+#define ALARM_BASE   0xA0000000
+#define SLAVE_SIZE   0x1000
+#define SCS_BASE     0xE000E000
+#define SCS_SIZE     0x1000
+
+// interrupt lines (soc.sv)
+#define IRQ_TIMER    0
+#define IRQ_ALARM    1
+#define IRQ_DMA      2
+#define IRQ_BUTTON   3
+#define IRQ_I2C      15
+
+#define VP_NEVER     UINT64_MAX
+
+//////////////////////////////////////////////////////////////////
+// Simulation time (vp.c)
+//////////////////////////////////////////////////////////////////
+
+extern uint64_t vp_cycles;          // HCLK cycles since power on
+extern uint64_t vp_next_event;      // earliest event asked for by a model
+extern uint32_t vp_frequency;       // HCLK frequency (Hz)
+extern uint32_t vp_irq_lines;       // interrupt lines driven by the peripherals
+extern bool     vp_simple_sensor;   // ahb_simple_i2c and a sensor returning Pascals (use_simple_sensor)
+
+// ask for peripherals_update() to be called at (or soon after) cycle
+static inline void vp_schedule(uint64_t cycle){
+
+  if(cycle < vp_next_event) vp_next_event = cycle;
+
+}
+
+static inline uint64_t vp_ms_to_cycles(double ms){
+
+  return (uint64_t) (ms * vp_frequency / 1000.0 + 0.5);
+
+}
+
+// pressure (Pa), and the raw pressure and temperature the sensor converts, at a cycle (the scenario)
+uint32_t scenario_pressure(uint64_t cycle);
+uint32_t scenario_uncomp_press(uint64_t cycle);
+uint32_t scenario_uncomp_temp(uint64_t cycle);
+
+// the processor has locked up or requested a reset (warm reset of the SoC)
+void vp_warm_reset(const char* reason);
+
+//////////////////////////////////////////////////////////////////
+// Processor (thumb.c)
+//////////////////////////////////////////////////////////////////
+
+typedef struct {
+
+  uint32_t r[16];          // r13 is the stack pointer in use
+  uint32_t other_sp;       // the banked stack pointer not in use (MSP or PSP)
+  bool     n, z, c, v;
+  uint32_t ipsr;           // exception number, 0 in thread mode
+  bool     primask;
+  uint32_t control;        // bit 1 SPSEL (thread mode on the PSP)
+  bool     sleeping;       // WFI or WFE
+  bool     event;          // event register (SEV)
+  uint64_t instructions;
+
+  // NVIC and system handlers, exception numbers 0~47
+  uint64_t pending, active, enabled;
+  int8_t   priority[48];
+
+} cpu_state;
+
+extern cpu_state cpu;
+
+void cpu_reset(void);
+void cpu_step(void);
+bool cpu_wakeup(void);     // an exception would end a sleep
+
+void systick_reset(void);
+void systick_update(void);
+
+bool scs_read(uint32_t offset, uint32_t* value);
+bool scs_write(uint32_t offset, uint32_t value);
+
+// profiler hooks (vp.c), pc is the address of the instruction that took cycles
+void profile_cycles(uint32_t pc, uint32_t cycles);
+void profile_call(uint32_t target, uint32_t return_address, bool exception);
+void profile_return(bool exception);
+
+//////////////////////////////////////////////////////////////////
+// Memory and peripherals (peripherals.c)
+//////////////////////////////////////////////////////////////////
+
+extern uint8_t rom[ROM_SIZE];
+extern uint8_t ram[RAM_SIZE];
+
+// size is 1, 2 or 4 bytes, false for a bus error (unmapped address)
+bool bus_read(uint32_t address, int size, uint32_t* value);
+bool bus_write(uint32_t address, int size, uint32_t value);
+
+void peripherals_reset(bool power_on);
+void peripherals_update(void);
+
+// a press of the buttons in mask (bit 0 mode, bit 1 trip) from start to end
+void buttons_press(uint64_t start, uint64_t end, uint32_t mask);
+
+// calibration registers of the sensor (register 0x31 in bits 7~0 of bmp390_calib[0])
+extern const uint32_t bmp390_calib[6];
+
+// the 8 characters shown by the LCD and the number of times they have changed
+const char* lcd_text(void);
+uint32_t lcd_changes(void);
+
+#endif
@@ -0,0 +1,39 @@
+///////////////////////////////////////////////////////////////////////
+//
+// CORTEXM0DS black box
+//
+//    port list of the (encrypted) Cortex-M0 DesignStart processor so that
+//    soc can be synthesised without it, the processor is left out of the
+//    area, flop count and timing figures
+//
+///////////////////////////////////////////////////////////////////////
+
+(* blackbox *)
+module CORTEXM0DS(
+
+  // AHB Signals
+  input HCLK, HRESETn,
+  output [31:0] HADDR,
+  output [2:0] HBURST,
+  output HMASTLOCK,
+  output [3:0] HPROT,
+  output [2:0] HSIZE,
+  output [1:0] HTRANS,
+  output [31:0] HWDATA,
+  output HWRITE,
+  input [31:0] HRDATA,
+  input HREADY,
+  input HRESP,
+
+  // Non-AHB Signals
+  input NMI,
+  input [15:0] IRQ,
+  output TXEV,
+  input RXEV,
+  output LOCKUP,
+  output SYSRESETREQ,
+  output SLEEPING
+
+);
+
+endmodule
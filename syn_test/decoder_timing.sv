@@ -0,0 +1,115 @@
+///////////////////////////////////////////////////////////////////////
+//
+// decoder_timing module
+//
+//    register to register wrappers for comparing the timing of the
+//    address decoders of the SoC (synthesise each one on its own):
+//
+//      decoder_chain_timing  the original priority chain of 32-bit "<"
+//                            comparisons (minimal decoding, no unmapped
+//                            regions)
+//
+//      decoder_table_timing  the table driven decoder of ahb_interconnect
+//                            with the address map of soc.sv
+//
+//    both use the SoC's 9 slaves, the critical path is HADDR register ->
+//    decoder -> HSEL register (the HSEL inputs of the slaves)
+//
+///////////////////////////////////////////////////////////////////////
+
+module decoder_chain_timing(
+
+  input HCLK, HRESETn,
+  input [31:0] HADDR_in,
+  output logic [8:0] HSEL_out
+
+);
+
+timeunit 1ns;
+timeprecision 100ps;
+
+  logic [31:0] HADDR;
+  logic [8:0] HSEL_SIGNALS;
+
+  always_ff @(posedge HCLK, negedge HRESETn)
+    if ( ! HRESETn )
+      begin
+        HADDR <= '0;
+        HSEL_out <= '0;
+      end
+    else
+      begin
+        HADDR <= HADDR_in;
+        HSEL_out <= HSEL_SIGNALS;
+      end
+
+  always_comb
+    if ( HADDR < 32'h2000_0000 )
+      HSEL_SIGNALS = 1 << 0;
+    else if ( HADDR < 32'h4000_0000 )
+      HSEL_SIGNALS = 1 << 1;
+    else if ( HADDR < 32'h5000_0000 )
+      HSEL_SIGNALS = 1 << 2;
+    else if ( HADDR < 32'h6000_0000 )
+      HSEL_SIGNALS = 1 << 3;
+    else if ( HADDR < 32'h7000_0000 )
+      HSEL_SIGNALS = 1 << 4;
+    else if ( HADDR < 32'h8000_0000 )
+      HSEL_SIGNALS = 1 << 5;
+    else if ( HADDR < 32'h9000_0000 )
+      HSEL_SIGNALS = 1 << 6;
+    else if ( HADDR < 32'hA000_0000 )
+      HSEL_SIGNALS = 1 << 7;
+    else if ( HADDR < 32'hB000_0000 )
+      HSEL_SIGNALS = 1 << 8;
+    else
+      HSEL_SIGNALS = 0;
+
+endmodule
+
+
+module decoder_table_timing(
+
+  input HCLK, HRESETn,
+  input [31:0] HADDR_in,
+  output logic [8:0] HSEL_out
+
+);
+
+timeunit 1ns;
+timeprecision 100ps;
+
+  logic [31:0] HADDR;
+  wire [8:0] HSEL_SIGNALS;
+  wire HREADY, HRESP;
+  wire [31:0] HRDATA;
+
+  always_ff @(posedge HCLK, negedge HRESETn)
+    if ( ! HRESETn )
+      begin
+        HADDR <= '0;
+        HSEL_out <= '0;
+      end
+    else
+      begin
+        HADDR <= HADDR_in;
+        HSEL_out <= HSEL_SIGNALS;
+      end
+
+  // same address map as soc.sv
+  ahb_interconnect #(
+    .num_slaves(9),
+    .slave_base({32'hA000_0000, 32'h9000_0000, 32'h8000_0000, 32'h7000_0000, 32'h6000_0000, 32'h5000_0000, 32'h4000_0000, 32'h2000_0000, 32'h0000_0000}),
+    .slave_size({32'h0000_1000, 32'h0000_1000, 32'h0000_1000, 32'h0000_1000, 32'h0000_1000, 32'h0000_1000, 32'h0000_1000, 32'h0000_0400, 32'h0000_4000}),
+    .slave_fitted({32'h0000_1000, 32'h0000_1000, 32'h0000_1000, 32'h0000_1000, 32'h0000_1000, 32'h0000_1000, 32'h0000_1000, 32'h0000_032C, 32'h0000_4000})
+  ) interconnect_1 (
+
+    .HCLK, .HRESETn, .HADDR, .HTRANS(2'b10), .HRDATA, .HREADY, .HRESP,
+
+    .HSEL_SIGNALS,
+    .HRDATA_SIGNALS('0),
+    .HREADYOUT_SIGNALS('1)
+
+  );
+
+endmodule
@@ -0,0 +1,227 @@
+#! /usr/bin/env python3
+#
+# synth_report.py
+#
+#   Synthesis benchmark of the SoC hardware: synthesises each ahb_* module on
+#   its own, soc (with the Cortex-M0 left as a black box) and the address
+#   decoder timing wrappers with Yosys, then times each netlist with OpenSTA.
+#
+#   For every block it reports cell count, cell area, flop count, logic depth,
+#   critical path delay, the fastest HCLK it would run at and an estimate of
+#   its power (OpenSTA default switching activity at the options.sv clock
+#   period). The table is printed and written as CSV so results can be compared
+#   between changes.
+#
+#   Usage: synth_report.py [--liberty <lib_file>] [--period <ns>] [--out <csv_file>]
+#                          [--slang] [<block> ...]
+#          (run from this directory, default: all blocks, the clock period of
+#           ../behavioural/options.sv and reports/synth_report.csv)
+#
+#   Any liberty file can be used, e.g. the typical corner of an open PDK
+#   (sky130_fd_sc_hd__tt_025C_1v80.lib) or the Nangate 45nm open cell library.
+#   Without one the design is mapped to generic gates: area, timing and power
+#   are left empty and only the cell, flop and logic depth columns are filled
+#   in. --slang reads the sources with the yosys-slang plugin instead of the
+#   built in SystemVerilog front end.
+
+import csv
+import glob
+import json
+import os
+import re
+import shutil
+import subprocess
+import sys
+
+BEHAVIOURAL = '../behavioural'
+REPORTS = 'reports'
+
+COLUMNS = ['block', 'cells', 'area', 'flops', 'logic_depth', 'critical_path_ns', 'fmax_mhz', 'power_mw', 'status']
+
+
+def blocks():
+    """block name -> (top module, source files)"""
+    slaves = sorted(glob.glob(os.path.join(BEHAVIOURAL, 'ahb_*.sv')))
+    table = {}
+    for source in slaves:
+        name = os.path.splitext(os.path.basename(source))[0]
+        table[name] = (name, [source])
+    table['soc'] = ('soc', slaves + [os.path.join(BEHAVIOURAL, 'soc.sv'), 'cortexm0ds_blackbox.sv'])
+    for top in ('decoder_chain_timing', 'decoder_table_timing'):
+        table[top] = (top, ['decoder_timing.sv', os.path.join(BEHAVIOURAL, 'ahb_interconnect.sv')])
+    return table
+
+
+def clock_period(options_file):
+    """clock period (ns) from `define clock_period in options.sv"""
+    with open(options_file) as f:
+        m = re.search(r'^`define\s+clock_period\s+([\d.]+)ns', f.read(), re.M)
+    return float(m.group(1))
+
+
+def copy_sources(sources, work):
+    """copies of the sources without timeunit/timeprecision, which not every front end accepts"""
+    copies = []
+    for source in sources:
+        copy = os.path.join(work, os.path.basename(source))
+        with open(source) as f:
+            text = f.read()
+        text = re.sub(r'^[ \t]*(timeunit|timeprecision)\b[^;]*;', r'// \g<0>', text, flags=re.M)
+        with open(copy, 'w') as f:
+            f.write(text)
+        copies.append(copy)
+    return copies
+
+
+def yosys_script(top, sources, liberty, slang):
+    lines = []
+    if slang:
+        lines.append('plugin -i slang')
+        lines.append('read_slang --top %s %s' % (top, ' '.join(sources)))
+    else:
+        for source in sources:
+            lines.append('read_verilog -sv %s' % source)
+    lines.append('hierarchy -check -top %s' % top)
+    lines.append('synth -flatten -top %s' % top)
+    lines.append('tee -q -o generic_stat.json stat -json')
+    if liberty:
+        lines.append('dfflibmap -liberty %s' % liberty)
+        lines.append('abc -liberty %s' % liberty)
+        lines.append('opt_clean -purge')
+        lines.append('tee -q -o mapped_stat.json stat -json -liberty %s' % liberty)
+    else:
+        lines.append('abc -g AND,NAND,OR,NOR,XOR,XNOR,MUX')
+        lines.append('opt_clean -purge')
+        lines.append('tee -q -o mapped_stat.json stat -json')
+    lines.append('tee -q -o ltp.txt ltp -noff')
+    lines.append('write_verilog -noattr netlist.v')
+    return '\n'.join(lines) + '\n'
+
+
+def sta_script(top, liberty, period):
+    return '\n'.join([
+        'read_liberty %s' % liberty,
+        'read_verilog netlist.v',
+        'link_design %s' % top,
+        'create_clock -name HCLK -period %g [get_ports HCLK]' % period,
+        'set_input_delay 0 -clock HCLK [delete_from_list [all_inputs] [get_ports HCLK]]',
+        'set_output_delay 0 -clock HCLK [all_outputs]',
+        'report_checks -path_delay max -digits 3',
+        'report_worst_slack -max -digits 3',
+        'report_power -digits 6',
+        'exit',
+    ]) + '\n'
+
+
+def design_stat(stat_file):
+    with open(stat_file) as f:
+        return json.load(f)['design']
+
+
+def flop_count(cells_by_type):
+    """flops and latches of a generic (unmapped) netlist"""
+    return sum(n for cell, n in cells_by_type.items() if re.match(r'\$_(\w*DFF\w*|DLATCH\w*)_', cell))
+
+
+def synthesise(name, top, sources, liberty, period, slang):
+    row = dict.fromkeys(COLUMNS, '')
+    row['block'] = name
+    work = os.path.join(REPORTS, name)
+    os.makedirs(work, exist_ok=True)
+
+    copies = [os.path.abspath(c) for c in copy_sources(sources, work)]
+    with open(os.path.join(work, 'synth.ys'), 'w') as f:
+        f.write(yosys_script(top, copies, liberty and os.path.abspath(liberty), slang))
+    result = subprocess.run(['yosys', '-q', '-l', 'yosys.log', '-s', 'synth.ys'], cwd=work,
+                            stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+    if result.returncode != 0:
+        row['status'] = 'yosys failed (see %s/yosys.log)' % work
+        return row
+
+    row['flops'] = flop_count(design_stat(os.path.join(work, 'generic_stat.json'))['num_cells_by_type'])
+    mapped = design_stat(os.path.join(work, 'mapped_stat.json'))
+    row['cells'] = mapped['num_cells']
+    if 'area' in mapped:
+        row['area'] = '%.2f' % mapped['area']
+    with open(os.path.join(work, 'ltp.txt')) as f:
+        m = re.search(r'length=(\d+)', f.read())
+    if m:
+        row['logic_depth'] = int(m.group(1))
+
+    if not liberty:
+        row['status'] = 'generic gates'
+        return row
+    if shutil.which('sta') is None:
+        row['status'] = 'no sta'
+        return row
+
+    with open(os.path.join(work, 'sta.tcl'), 'w') as f:
+        f.write(sta_script(top, os.path.abspath(liberty), period))
+    result = subprocess.run(['sta', '-no_init', '-no_splash', '-exit', 'sta.tcl'], cwd=work,
+                            stdout=subprocess.PIPE, stderr=subprocess.STDOUT, universal_newlines=True)
+    with open(os.path.join(work, 'sta.log'), 'w') as f:
+        f.write(result.stdout)
+
+    m = re.search(r'worst slack\s+(-?[\d.]+)', result.stdout)
+    if not m:
+        row['status'] = 'sta failed (see %s/sta.log)' % work
+        return row
+    critical = period - float(m.group(1))
+    row['critical_path_ns'] = '%.3f' % critical
+    if critical > 0:
+        row['fmax_mhz'] = '%.2f' % (1000.0 / critical)
+    m = re.search(r'^Total\s+\S+\s+\S+\s+\S+\s+(\S+)', result.stdout, re.M)
+    if m:
+        row['power_mw'] = '%.6f' % (float(m.group(1)) * 1000.0)
+    row['status'] = 'ok'
+    return row
+
+
+def main():
+    args = sys.argv[1:]
+    options = {'--liberty': None, '--period': None, '--out': os.path.join(REPORTS, 'synth_report.csv')}
+    slang = '--slang' in args
+    if slang:
+        args.remove('--slang')
+    for option in list(options):
+        if option in args:
+            i = args.index(option)
+            if i + 1 >= len(args):
+                sys.exit("ERROR - %s needs a value" % option)
+            options[option] = args[i + 1]
+            del args[i:i + 2]
+
+    if shutil.which('yosys') is None:
+        sys.exit("ERROR - yosys not found")
+
+    table = blocks()
+    names = args if args else sorted(table)
+    for name in names:
+        if name not in table:
+            print("\nUsage: synth_report.py [--liberty <lib_file>] [--period <ns>] [--out <csv_file>] [--slang] [<block> ...]")
+            sys.exit("ERROR - unknown block %s (one of %s)" % (name, ', '.join(sorted(table))))
+
+    period = float(options['--period']) if options['--period'] else clock_period(os.path.join(BEHAVIOURAL, 'options.sv'))
+    os.makedirs(REPORTS, exist_ok=True)
+
+    rows = []
+    for name in names:
+        top, sources = table[name]
+        print("Synthesising %s" % name)
+        rows.append(synthesise(name, top, sources, options['--liberty'], period, slang))
+
+    with open(options['--out'], 'w', newline='') as f:
+        writer = csv.DictWriter(f, fieldnames=COLUMNS)
+        writer.writeheader()
+        writer.writerows(rows)
+
+    print("")
+    print("%-22s %7s %12s %6s %6s %10s %10s %12s  %s" % ('block', 'cells', 'area', 'flops', 'depth',
+                                                         'crit (ns)', 'fmax (MHz)', 'power (mW)', 'status'))
+    for row in rows:
+        print("%-22s %7s %12s %6s %6s %10s %10s %12s  %s" % tuple(row[c] for c in COLUMNS))
+    print("\nClock period %g ns (power), writing '%s'" % (period, options['--out']))
+
+
+if __name__ == '__main__':
+    main()
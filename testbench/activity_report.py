@@ -0,0 +1,224 @@
+#! /usr/bin/env python3
+#
+# activity_report.py
+#
+#   Relative dynamic energy of the SoC hardware per module and per scenario,
+#   from the VCD files written by soc_power_stim.sv (simulated once for each
+#   scenario with +scenario=<name>).
+#
+#   Every bit of every signal dumped is counted each time it changes between
+#   0 and 1 (changes to or from x/z are not counted). Dynamic energy is taken
+#   to be proportional to the number of toggles, i.e. every net is assumed to
+#   have the same capacitance, so the figures are for comparing scenarios and
+#   changes with each other rather than absolute energies. A net connected to
+#   the ports of several modules (HCLK, HADDR, ...) is counted in each of them
+#   as it drives a load in each.
+#
+#   Toggles are grouped by the instance below soc they belong to (rom_1,
+#   lcd_1, ...), signals of soc itself are reported as "bus". For each
+#   scenario the table gives toggles per second of the dump window, the share
+#   of the scenario total and the total relative to the first scenario given.
+#
+#   With --baseline the toggle rates are compared with an earlier CSV report
+#   and every module whose rate has changed by more than the --threshold
+#   factor (default 1.5) is flagged, the exit status is then 1 if any module
+#   has become busier by more than the threshold.
+#
+#   Usage: activity_report.py <vcd_file> [<vcd_file> ...] [--out <csv_file>]
+#                             [--baseline <csv_file>] [--threshold <factor>]
+#          (default activity_report.csv, the scenario name is taken from
+#           soc_power_<scenario>.vcd)
+
+import csv
+import os
+import re
+import sys
+
+COLUMNS = ['scenario', 'module', 'toggles', 'toggles_per_s', 'share_pct']
+
+TIME_UNITS = {'s': 1.0, 'ms': 1e-3, 'us': 1e-6, 'ns': 1e-9, 'ps': 1e-12, 'fs': 1e-15}
+
+
+def scenario_name(vcd_file):
+    name = os.path.splitext(os.path.basename(vcd_file))[0]
+    return name[len('soc_power_'):] if name.startswith('soc_power_') else name
+
+
+def module_name(scope):
+    """instance below soc (dut) which a scope belongs to (generate blocks are skipped)"""
+    top = scope.index('dut') + 1 if 'dut' in scope else 1
+    below = [s for s in scope[top:] if not s.startswith('genblk')]
+    return below[0] if below else 'bus'
+
+
+def toggles(old, new):
+    """bits which have changed between 0 and 1"""
+    width = max(len(old), len(new))
+    # VCD vectors omit leading zeros (or repeat a leading x/z)
+    old = old.rjust(width, old[0] if old[0] in 'xz' else '0')
+    new = new.rjust(width, new[0] if new[0] in 'xz' else '0')
+    return sum(1 for a, b in zip(old, new) if a != b and a in '01' and b in '01')
+
+
+def read_vcd(vcd_file):
+    """module -> toggles and the length of the dump window in seconds"""
+    signals = {}          # id code -> module (a signal can appear in several scopes)
+    values = {}
+    counts = {}
+    scope = []
+    timescale = 1e-9
+    time = 0
+    window = 0
+    dumping = False       # between $dumpvars/$dumpon and $dumpoff
+    dump_start = 0
+    counting = False      # not inside a $dumpvars, $dumpon or $dumpoff section
+
+    with open(vcd_file) as f:
+        tokens = (token for line in f for token in line.split())
+        for token in tokens:
+            if token == '$timescale':
+                text = ''
+                for t in tokens:
+                    if t == '$end':
+                        break
+                    text += t
+                m = re.match(r'(\d+)(\w+)', text)
+                timescale = int(m.group(1)) * TIME_UNITS[m.group(2)]
+            elif token == '$scope':
+                next(tokens)
+                scope.append(next(tokens))
+                next(tokens)
+            elif token == '$upscope':
+                scope.pop()
+                next(tokens)
+            elif token == '$var':
+                next(tokens)
+                next(tokens)
+                code = next(tokens)
+                for t in tokens:
+                    if t == '$end':
+                        break
+                module = module_name(scope)
+                signals.setdefault(code, set()).add(module)
+                counts.setdefault(module, 0)
+            elif token in ('$comment', '$date', '$version'):
+                for t in tokens:
+                    if t == '$end':
+                        break
+            elif token in ('$dumpvars', '$dumpon'):
+                counting = False
+                if not dumping:
+                    dumping = True
+                    dump_start = time
+            elif token in ('$dumpoff', '$dumpall'):
+                counting = False
+                if token == '$dumpoff' and dumping:
+                    window += time - dump_start
+                    dumping = False
+            elif token == '$end':
+                counting = dumping
+            elif token.startswith('#'):
+                time = int(token[1:])
+            elif token[0] in 'bB':
+                code = next(tokens)
+                count(code, token[1:].lower(), values, signals, counts, counting)
+            elif token[0] in 'rR':
+                next(tokens)
+            elif token[0] in '01xXzZ' and len(token) > 1:
+                count(token[1:], token[0].lower(), values, signals, counts, counting)
+
+    if dumping:
+        window += time - dump_start
+    return counts, window * timescale
+
+
+def count(code, value, values, signals, counts, counting):
+    if counting and code in values:
+        n = toggles(values[code], value)
+        for module in signals.get(code, ()):
+            counts[module] += n
+    values[code] = value
+
+
+def read_baseline(csv_file):
+    with open(csv_file) as f:
+        return {(row['scenario'], row['module']): float(row['toggles_per_s']) for row in csv.DictReader(f)}
+
+
+def main():
+    args = sys.argv[1:]
+    options = {'--out': 'activity_report.csv', '--baseline': None, '--threshold': '1.5'}
+    for option in list(options):
+        if option in args:
+            i = args.index(option)
+            if i + 1 >= len(args):
+                sys.exit("ERROR - %s needs a value" % option)
+            options[option] = args[i + 1]
+            del args[i:i + 2]
+
+    if not args:
+        print("\nUsage: activity_report.py <vcd_file> [<vcd_file> ...] [--out <csv_file>] [--baseline <csv_file>] [--threshold <factor>]")
+        sys.exit("ERROR - no VCD files")
+
+    rows = []
+    rates = {}
+    scenarios = []
+    modules = set()
+    for vcd_file in args:
+        scenario = scenario_name(vcd_file)
+        counts, window = read_vcd(vcd_file)
+        if window <= 0:
+            sys.exit("ERROR - nothing was dumped in '%s'" % vcd_file)
+        scenarios.append(scenario)
+        total = sum(counts.values())
+        for module in sorted(counts):
+            rate = counts[module] / window
+            rates[(scenario, module)] = rate
+            modules.add(module)
+            rows.append({'scenario': scenario, 'module': module, 'toggles': counts[module],
+                         'toggles_per_s': '%.1f' % rate,
+                         'share_pct': '%.1f' % (100.0 * counts[module] / total if total else 0.0)})
+
+    with open(options['--out'], 'w', newline='') as f:
+        writer = csv.DictWriter(f, fieldnames=COLUMNS)
+        writer.writeheader()
+        writer.writerows(rows)
+
+    # toggles per second, one column per scenario
+    modules = sorted(modules, key=lambda m: (m == 'bus', m))
+    print("")
+    print("%-16s" % 'toggles/s' + ''.join("%15s" % s for s in scenarios))
+    for module in modules:
+        print("%-16s" % module + ''.join("%15.1f" % rates.get((s, module), 0.0) for s in scenarios))
+    totals = [sum(rates.get((s, m), 0.0) for m in modules) for s in scenarios]
+    print("%-16s" % 'total' + ''.join("%15.1f" % t for t in totals))
+    print("%-16s" % 'relative' + ''.join("%15s" % ('x%.2f' % (t / totals[0]) if totals[0] else '-') for t in totals))
+
+    status = 0
+    if options['--baseline']:
+        threshold = float(options['--threshold'])
+        baseline = read_baseline(options['--baseline'])
+        print("\nChanges from '%s' by more than x%g:" % (options['--baseline'], threshold))
+        changed = False
+        for key in sorted(rates):
+            if key not in baseline:
+                continue
+            old, new = baseline[key], rates[key]
+            if old == 0:
+                ratio = float('inf') if new > 0 else 1.0
+            else:
+                ratio = new / old
+            if ratio > threshold or ratio < 1.0 / threshold:
+                changed = True
+                print("  %-14s %-16s %12.1f -> %12.1f toggles/s  (x%.2f)" % (key[0], key[1], old, new, ratio))
+                if ratio > threshold:
+                    status = 1
+        if not changed:
+            print("  none")
+
+    print("\nWriting '%s'" % options['--out'])
+    sys.exit(status)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,148 @@
+module ahb_alarm_stim();
+
+timeunit 1ns;
+timeprecision 100ps;
+
+  // input of module
+  logic HRESETn, HCLK;
+  logic [31:0] HADDR, HWDATA;
+  logic [2:0] HSIZE;
+  logic [1:0] HTRANS;
+  logic HWRITE, HREADY, HSEL;
+  logic [23:0] Pressure;
+  logic NewSample;
+
+  // output of module to AHB
+  wire [31:0] HRDATA;
+  wire HREADYOUT;
+  wire IRQ;
+
+  logic [31:0] read_data;
+  logic irq_seen;
+
+  ahb_alarm dut(.HCLK, .HRESETn,
+              .HADDR, .HWDATA, .HSIZE, .HTRANS, .HWRITE, .HREADY, .HSEL,
+	      .HRDATA, .HREADYOUT,
+	      .Pressure, .NewSample, .IRQ);
+
+  always  /* simulating 32.768 kHz, ~30us */
+    begin
+           HCLK = 0;
+      #7.5us HCLK = 1;
+      #15us HCLK = 0;
+      #7.5us HCLK = 0;
+    end
+
+  // single AHB write to the comparator registers
+  task ahb_write(input [31:0] address, input [31:0] data);
+      HREADY = 1;
+      HADDR = address;
+      HSEL = 1;
+      HWRITE = 1;
+      HTRANS = 2;
+      #30us
+      HTRANS = 0;
+      HWDATA = data;
+      #30us
+      HWDATA = 0;
+  endtask
+
+  // single AHB read from the comparator registers
+  task ahb_read(input [31:0] address, output [31:0] data);
+      HREADY = 1;
+      HADDR = address;
+      HSEL = 1;
+      HWRITE = 0;
+      HTRANS = 2;
+      #30us
+      HTRANS = 0;
+      data = HRDATA;
+      #30us ;
+  endtask
+
+  // one sequencer sample, as presented by ahb_bmp_i2c
+  task sample(input [23:0] value);
+      Pressure = value;
+      NewSample = 1;
+      #30us
+      NewSample = 0;
+      #90us ;
+  endtask
+
+  initial
+    begin
+      HRESETn = 0;
+      HADDR = 0;
+      HWDATA = 0;
+      HSIZE = 3'b010;
+      HTRANS = 0;
+      HSEL = 0;
+      HREADY = 0;
+      HWRITE = 0;
+      Pressure = 24'h80_0000;
+      NewSample = 0;
+
+      #30us
+
+      HRESETn = 1;
+
+      // window 0x60_0000 ~ 0x70_0000, interrupt enabled, single sample alarm
+      ahb_write(32'h0000_0000, 32'h0060_0000);
+      ahb_write(32'h0000_0004, 32'h0070_0000);
+      ahb_write(32'h0000_0008, 32'h0000_0003);
+
+      sample(24'h80_0000);    // data register reset value, ignored
+      sample(24'h68_0000);
+      if ( !IRQ )
+        $display("PASS: inside window");
+      else
+        $display("FAIL: inside window");
+
+      sample(24'h5F_FFFF);
+      ahb_read(32'h0000_000C, read_data);
+      #30us
+      if ( ( read_data == 32'h0000_0001 ) && !IRQ )
+        $display("PASS: below lower threshold");
+      else
+        $display("FAIL: below lower threshold %h", read_data);
+
+      // three consecutive samples needed above the upper threshold (N = 2)
+      ahb_write(32'h0000_0008, 32'h0000_0023);
+      sample(24'h70_0001);
+      sample(24'h70_0002);
+      sample(24'h68_0000);
+      sample(24'h70_0003);
+      sample(24'h70_0004);
+      if ( !IRQ )
+        $display("PASS: filtered");
+      else
+        $display("FAIL: filtered");
+      sample(24'h70_0005);
+      irq_seen = IRQ;
+      ahb_read(32'h0000_000C, read_data);
+      if ( irq_seen && ( read_data == 32'h0000_0002 ) )
+        $display("PASS: above upper threshold");
+      else
+        $display("FAIL: above upper threshold %h", read_data);
+
+      ahb_read(32'h0000_0010, read_data);
+      if ( read_data == 32'h0070_0005 )
+        $display("PASS: last pressure");
+      else
+        $display("FAIL: last pressure %h", read_data);
+
+      // disabled, samples are not compared
+      ahb_write(32'h0000_0008, 32'h0000_0002);
+      sample(24'h10_0000);
+      #30us
+      if ( !IRQ )
+        $display("PASS: disabled");
+      else
+        $display("FAIL: disabled");
+
+      #300us
+      $stop;
+      $finish;
+    end
+
+endmodule
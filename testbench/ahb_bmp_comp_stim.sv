@@ -0,0 +1,184 @@
+module ahb_bmp_comp_stim();
+
+timeunit 1ns;
+timeprecision 100ps;
+
+  // reference model (bmp_comp_ref.c, the firmware compensation code)
+  import "DPI-C" function void bmp390_comp_ref(
+    input int unsigned calib0, input int unsigned calib1, input int unsigned calib2,
+    input int unsigned calib3, input int unsigned calib4, input int unsigned calib5,
+    input int unsigned uncomp_temp, input int unsigned uncomp_press,
+    output longint t_lin, output longint pressure);
+
+  // input of module
+  logic HRESETn, HCLK;
+  logic [31:0] HADDR, HWDATA;
+  logic [2:0] HSIZE;
+  logic [1:0] HTRANS;
+  logic HWRITE, HREADY, HSEL;
+
+  // output of module to AHB
+  wire [31:0] HRDATA;
+  wire HREADYOUT;
+
+  ahb_bmp_comp dut(.HCLK, .HRESETn,
+                   .HADDR, .HWDATA, .HSIZE, .HTRANS, .HWRITE, .HREADY, .HSEL,
+	           .HRDATA, .HREADYOUT);
+
+  always  /* simulating 32.768 kHz, ~30us */
+    begin
+           HCLK = 0;
+      #7.5us HCLK = 1;
+      #15us HCLK = 0;
+      #7.5us HCLK = 0;
+    end
+
+  // single AHB write
+  task ahb_write(input [31:0] address, input [31:0] data);
+      HADDR = address;
+      HSEL = 1;
+      HWRITE = 1;
+      HTRANS = 2;
+      #30us
+      HTRANS = 0;
+      HWDATA = data;
+      #30us
+      HWDATA = 0;
+  endtask
+
+  // single AHB read
+  task ahb_read(input [31:0] address, output [31:0] data);
+      HADDR = address;
+      HSEL = 1;
+      HWRITE = 0;
+      HTRANS = 2;
+      #30us
+      HTRANS = 0;
+      #5us
+      data = HRDATA;
+      #25us ;
+  endtask
+
+  logic [31:0] calib [0:5];
+  logic [31:0] uncomp_temp, uncomp_press;
+  logic [31:0] status, t_lin, temperature, pressure;
+  longint ref_t_lin, ref_pressure;
+  int cycles, max_cycles, failures;
+
+  // compensate one reading and compare the result with the reference model
+  task check(input string name);
+      for (int i = 0; i < 6; i++)
+        ahb_write(4 * i, calib[i]);
+      ahb_write(32'h18, uncomp_temp);
+      ahb_write(32'h1C, uncomp_press);
+      ahb_write(32'h20, 32'h3);
+
+      cycles = 0;
+      do
+        begin
+          ahb_read(32'h24, status);
+          cycles = cycles + 2;
+        end
+      while (status[0]);
+      if (cycles > max_cycles)
+        max_cycles = cycles;
+
+      ahb_read(32'h28, t_lin);
+      ahb_read(32'h2C, temperature);
+      ahb_read(32'h30, pressure);
+
+      bmp390_comp_ref(calib[0], calib[1], calib[2], calib[3], calib[4], calib[5],
+                      uncomp_temp, uncomp_press, ref_t_lin, ref_pressure);
+
+      if ( ( $signed(t_lin) == ref_t_lin ) && ( $signed(temperature) == ( ref_t_lin >>> 16 ) ) &&
+           ( pressure == ref_pressure ) )
+        $display("PASS: %s t_lin %0d pressure %0d (%0d cycles)", name, $signed(t_lin), pressure, cycles);
+      else
+        begin
+          $display("FAIL: %s calib %h %h %h %h %h %h raw %h %h", name,
+                   calib[0], calib[1], calib[2], calib[3], calib[4], calib[5], uncomp_temp, uncomp_press);
+          $display("      t_lin %0d (expected %0d) pressure %0d (expected %0d)",
+                   $signed(t_lin), ref_t_lin, pressure, ref_pressure);
+          failures = failures + 1;
+        end
+  endtask
+
+  initial
+    begin
+      HRESETn = 0;
+      HADDR = 0;
+      HWDATA = 0;
+      HSIZE = 3'b010;
+      HTRANS = 0;
+      HSEL = 0;
+      HREADY = 1;
+      HWRITE = 0;
+      max_cycles = 0;
+      failures = 0;
+
+      #30us
+
+      HRESETn = 1;
+
+      // typical calibration (t1 27530, t2 19090, t3 -7, p1 -2, p2 -9, p3 18,
+      // p4 2, p5 24500, p6 23900, p7 3, p8 -6, p9 16000, p10 6, p11 -55)
+      calib[0] = 32'h4A92_6B8A;
+      calib[1] = 32'hF7FF_FEF9;
+      calib[2] = 32'hB402_12FF;
+      calib[3] = 32'h035D_5C5F;
+      calib[4] = 32'h063E_80FA;
+      calib[5] = 32'h0000_00C9;
+      uncomp_temp = 32'h0074_B1C0;
+      uncomp_press = 32'h0063_2EA0;
+      check("typical");
+
+      // a new pressure with the temperature (t_lin) of the previous reading
+      uncomp_press = 32'h0062_0000;
+      ahb_write(32'h1C, uncomp_press);
+      ahb_write(32'h20, 32'h2);
+      do ahb_read(32'h24, status); while (status[0]);
+      ahb_read(32'h30, pressure);
+      bmp390_comp_ref(calib[0], calib[1], calib[2], calib[3], calib[4], calib[5],
+                      uncomp_temp, uncomp_press, ref_t_lin, ref_pressure);
+      if ( pressure == ref_pressure )
+        $display("PASS: pressure only %0d", pressure);
+      else
+        begin
+          $display("FAIL: pressure only %0d (expected %0d)", pressure, ref_pressure);
+          failures = failures + 1;
+        end
+
+      // compensate another temperature, restore t_lin, then update the t_lin
+      // terms and the pressure
+      ahb_write(32'h18, 32'h0070_0000);
+      ahb_write(32'h20, 32'h1);
+      do ahb_read(32'h24, status); while (status[0]);
+      ahb_write(32'h28, ref_t_lin[31:0]);
+      ahb_write(32'h20, 32'h6);
+      do ahb_read(32'h24, status); while (status[0]);
+      ahb_read(32'h30, pressure);
+      if ( pressure == ref_pressure )
+        $display("PASS: restored t_lin %0d", pressure);
+      else
+        begin
+          $display("FAIL: restored t_lin %0d (expected %0d)", pressure, ref_pressure);
+          failures = failures + 1;
+        end
+
+      // random calibration and raw readings, every bit pattern must match
+      repeat(100)
+        begin
+          for (int i = 0; i < 6; i++)
+            calib[i] = $urandom;
+          uncomp_temp = $urandom & 32'h00FF_FFFF;
+          uncomp_press = $urandom & 32'h00FF_FFFF;
+          check("random");
+        end
+
+      $display("%0d failures, longest calculation %0d cycles", failures, max_cycles);
+
+      $stop;
+      $finish;
+    end
+
+endmodule
@@ -13,6 +13,7 @@ timeprecision 100ps;
   // output of module to AHB
   wire [31:0] HRDATA;
   wire HREADYOUT;
+  wire IRQ;
   
   // output of module to peripherals
   logic nMode, nTrip;
@@ -20,7 +21,7 @@ timeprecision 100ps;
   ahb_buttons dut(.HCLK, .HRESETn, 
               .HADDR, .HWDATA, .HSIZE, .HTRANS, .HWRITE, .HREADY, .HSEL,
 	      .HRDATA, .HREADYOUT,
-	      .nMode, .nTrip);
+	      .nButtons({nTrip, nMode}), .IRQ);
 
   always  /* simulating 32.768 kHz, ~30us */
     begin
@@ -50,9 +51,9 @@ timeprecision 100ps;
       
       #25ms
       nMode = 0;
-      #30ms
+      #60ms
       nMode = 1;
-      #30ms
+      #60ms
       
       // testing to see if data will be replaced (data should not change while data_valid)
       nMode = 0;
@@ -96,10 +97,10 @@ timeprecision 100ps;
       nMode = 0;
       #300us
       nTrip = 0;
-      #30ms 
+      #60ms 
       nMode = 1;
       nTrip = 1;
-      #30ms
+      #60ms
       
       //read datavalid
       #30us
@@ -133,9 +134,75 @@ timeprecision 100ps;
       #500us
       nMode = 0;
       nTrip = 0;
-      #30ms 
+      #60ms 
       nMode = 1;
       nTrip = 1;
+      #60ms
+      
+      //read status and chord
+      #30us
+      HADDR = 0;
+      HREADY = 1;
+      HWDATA = 0;
+      HSIZE = 0;
+      HSEL = 1;
+      HWRITE = 0;
+      HTRANS = 2;
+      
+      #30us
+      HADDR = 8;
+      HREADY = 1;
+      HWDATA = 0;
+      HSIZE = 0;
+      HSEL = 1;
+      HWRITE = 0;
+      HTRANS = 2;
+      
+      #30us
+      HADDR = 0;
+      HREADY = 1;
+      HWDATA = 0;
+      HSIZE = 0;
+      HSEL = 1;
+      HWRITE = 0;
+      HTRANS = 0;
+      
+      // long press, reported while the button is still held (status 0x9)
+      #500us
+      nTrip = 0;
+      #1200ms
+      
+      //read pressed buttons (0x2) and status
+      #30us
+      HADDR = 12;
+      HREADY = 1;
+      HWDATA = 0;
+      HSIZE = 0;
+      HSEL = 1;
+      HWRITE = 0;
+      HTRANS = 2;
+      
+      #30us
+      HADDR = 0;
+      HREADY = 1;
+      HWDATA = 0;
+      HSIZE = 0;
+      HSEL = 1;
+      HWRITE = 0;
+      HTRANS = 2;
+      
+      #30us
+      HADDR = 0;
+      HREADY = 1;
+      HWDATA = 0;
+      HSIZE = 0;
+      HSEL = 1;
+      HWRITE = 0;
+      HTRANS = 0;
+      
+      // the release after a long press is not reported again
+      nTrip = 1;
+      #60ms
       
       #500us
       $stop;
@@ -0,0 +1,184 @@
+module ahb_dma_stim();
+
+timeunit 1ns;
+timeprecision 100ps;
+
+  // input of module
+  logic HRESETn, HCLK;
+  logic [31:0] HADDR, HWDATA;
+  logic [2:0] HSIZE;
+  logic [1:0] HTRANS;
+  logic HWRITE, HREADY, HSEL;
+  logic [1:0] DREQ;
+
+  // output of module to AHB
+  wire [31:0] HRDATA;
+  wire HREADYOUT;
+  wire IRQ;
+
+  // master port of module, connected straight to a RAM (always granted)
+  // addresses from 0x1000 up are unmapped and get the two cycle ERROR response
+  wire [31:0] HADDR_M, HWDATA_M, HRDATA_M;
+  wire [1:0] HTRANS_M;
+  wire [2:0] HSIZE_M;
+  wire HWRITE_M, HBUSREQ_M, HREADY_M, HREADY_RAM, HRESP_M;
+  logic error_dphase, error_first;
+
+  ahb_dma dut(.HCLK, .HRESETn,
+              .HADDR, .HWDATA, .HSIZE, .HTRANS, .HWRITE, .HREADY, .HSEL,
+	      .HRDATA, .HREADYOUT,
+	      .HADDR_M, .HWDATA_M, .HTRANS_M, .HSIZE_M, .HWRITE_M, .HBUSREQ_M,
+	      .HGRANT_M(1'b1), .HREADY_M, .HRESP_M, .HRDATA_M,
+	      .DREQ, .IRQ);
+
+  ahb_ram ram(.HCLK, .HRESETn,
+              .HSEL(!HADDR_M[12]), .HREADY(HREADY_M), .HADDR(HADDR_M), .HTRANS(HTRANS_M),
+	      .HWRITE(HWRITE_M), .HSIZE(HSIZE_M), .HWDATA(HWDATA_M),
+	      .HREADYOUT(HREADY_RAM), .HRDATA(HRDATA_M));
+
+  always_ff @(posedge HCLK, negedge HRESETn)
+    if (!HRESETn)
+      begin
+        error_dphase <= 0;
+        error_first <= 0;
+      end
+    else if (HREADY_M)
+      begin
+        error_dphase <= (HTRANS_M != 0) && HADDR_M[12];
+        error_first <= (HTRANS_M != 0) && HADDR_M[12];
+      end
+    else
+      error_first <= 0;
+
+  assign HREADY_M = HREADY_RAM && !error_first;
+  assign HRESP_M = error_dphase;
+
+  always  /* simulating 32.768 kHz, ~30us */
+    begin
+           HCLK = 0;
+      #7.5us HCLK = 1;
+      #15us HCLK = 0;
+      #7.5us HCLK = 0;
+    end
+
+  // single AHB write to the DMA configuration registers
+  task ahb_write(input [31:0] address, input [31:0] data);
+      HREADY = 1;
+      HADDR = address;
+      HSEL = 1;
+      HWRITE = 1;
+      HTRANS = 2;
+      #30us
+      HTRANS = 0;
+      HWDATA = data;
+      #30us
+      HWDATA = 0;
+  endtask
+
+  initial
+    begin
+      HRESETn = 0;
+      HADDR = 0;
+      HWDATA = 0;
+      HSIZE = 3'b010;
+      HTRANS = 0;
+      HSEL = 0;
+      HREADY = 0;
+      HWRITE = 0;
+      // DREQ[1] high out of reset must not count as a trigger for channel 1
+      DREQ = 2'b10;
+
+      // descriptor 0 at 0x00: copy 4 words from 0x40 to 0x80, link to descriptor 1
+      ram.memory[0] = 32'h0000_0040;
+      ram.memory[1] = 32'h0000_0080;
+      ram.memory[2] = 32'h0000_1E04;
+      ram.memory[3] = 32'h0000_0010;
+      // descriptor 1 at 0x10: copy 3 bytes from 0x41 to 0xA0, end of chain
+      ram.memory[4] = 32'h0000_0041;
+      ram.memory[5] = 32'h0000_00A0;
+      ram.memory[6] = 32'h0000_0C03;
+      ram.memory[7] = 32'h0000_0000;
+      // descriptor 2 at 0x20: copy 1 word from 0x40 to 0xB0, back to itself (ring)
+      ram.memory[8] = 32'h0000_0040;
+      ram.memory[9] = 32'h0000_00B0;
+      ram.memory[10] = 32'h0000_0201;
+      ram.memory[11] = 32'h0000_0020;
+      // descriptor 3 at 0x30: copy 2 words from 0x1000 (unmapped) to 0xC0, end of chain
+      ram.memory[12] = 32'h0000_1000;
+      ram.memory[13] = 32'h0000_00C0;
+      ram.memory[14] = 32'h0000_0E02;
+      ram.memory[15] = 32'h0000_0000;
+      ram.memory[48] = 32'h0000_0000;
+      // source data
+      ram.memory[16] = 32'h1122_3344;
+      ram.memory[17] = 32'h5566_7788;
+      ram.memory[18] = 32'h99AA_BBCC;
+      ram.memory[19] = 32'hDDEE_FF00;
+      ram.memory[40] = 32'h0000_0000;
+
+      #30us
+
+      HRESETn = 1;
+
+      #60us
+      DREQ = 0;
+
+      // channel 0: descriptor pointer 0, enable with interrupt
+      ahb_write(32'h0000_0000, 32'h0000_0000);
+      ahb_write(32'h0000_0004, 32'h0000_0005);
+
+      #3000us
+
+      if ( {ram.memory[32], ram.memory[33], ram.memory[34], ram.memory[35]} ==
+           {ram.memory[16], ram.memory[17], ram.memory[18], ram.memory[19]} )
+        $display("PASS: word copy");
+      else
+        $display("FAIL: word copy");
+      if ( ram.memory[40][23:0] == 24'h11_2233 )
+        $display("PASS: byte copy");
+      else
+        $display("FAIL: byte copy %h", ram.memory[40]);
+      if ( IRQ && ( dut.ch_enable[0] == 0 ) )
+        $display("PASS: end of chain");
+      else
+        $display("FAIL: end of chain");
+
+      // channel 1: ring descriptor waiting for DREQ[1]
+      ahb_write(32'h0000_0010, 32'h0000_0020);
+      ahb_write(32'h0000_0014, 32'h0000_0003);
+
+      #300us
+
+      repeat(3)
+        begin
+          ram.memory[16] = ram.memory[16] + 1;
+          DREQ[1] = 1;
+          #60us
+          DREQ[1] = 0;
+          #600us ;
+        end
+
+      if ( ( ram.memory[44] == ram.memory[16] ) && ( dut.done_count[1] == 3 ) )
+        $display("PASS: triggered ring");
+      else
+        $display("FAIL: triggered ring");
+
+      // channel 1: stop the ring, channel 0: a read from an unmapped address
+      ahb_write(32'h0000_0014, 32'h0000_0000);
+      ahb_write(32'h0000_0000, 32'h0000_0030);
+      ahb_write(32'h0000_0004, 32'h0000_0005);
+
+      #1000us
+
+      if ( dut.error_flag[0] && IRQ && ( dut.ch_enable[0] == 0 ) && ( dut.desc_ptr[0] == 32'h30 ) &&
+           ( dut.done_count[0] == 2 ) && ( ram.memory[48] == 0 ) && ( dut.dma_state == dut.IDLE ) )
+        $display("PASS: error response");
+      else
+        $display("FAIL: error response");
+
+      #300us
+      $stop;
+      $finish;
+    end
+
+endmodule
@@ -182,6 +182,177 @@ timeprecision 100ps;
       #30us
       
       #3000us 
+      
+      // sequencer: period 1000 cycles (~30ms), interrupt enabled
+      HREADY = 1;
+      HADDR = 32'h0000_0020;
+      HSEL = 1;
+      HWRITE = 1;
+      HWDATA = 0;
+      HTRANS = 2;
+      #30us
+      
+      HREADY = 1;
+      HADDR = 32'h0000_001C;
+      HSEL = 1;
+      HWRITE = 1;
+      HWDATA = 32'h0000_03E8;
+      HTRANS = 2;
+      #30us
+      
+      HREADY = 1;
+      HADDR = 32'h0000_0000;
+      HSEL = 1;
+      HWRITE = 0;
+      HWDATA = 32'h0000_0003;
+      HTRANS = 0;
+      #30us
+      HWDATA = 32'h0000_0000;
+      
+      // sensor returns alternating bits while the sequencer reads 0x04~0x09
+      repeat(400)
+        begin
+          SDA_in = ~SDA_in;
+          #150us ;
+        end
+      SDA_in = 0;
+      
+      // read latched pressure (clears SampleReady and IRQ) and temperature
+      HREADY = 1;
+      HADDR = 32'h0000_0024;
+      HSEL = 1;
+      HWRITE = 0;
+      HWDATA = 0;
+      HTRANS = 2;
+      #30us
+      
+      HREADY = 1;
+      HADDR = 32'h0000_0028;
+      HSEL = 1;
+      HWRITE = 0;
+      HWDATA = 0;
+      HTRANS = 2;
+      #30us
+      
+      // accumulate pairs of pressure samples (N = 1), interrupt on each sum,
+      // temperature read with every other sample (T = 1)
+      HREADY = 1;
+      HADDR = 32'h0000_001C;
+      HSEL = 1;
+      HWRITE = 1;
+      HWDATA = 0;
+      HTRANS = 2;
+      #30us
+      
+      HREADY = 1;
+      HADDR = 32'h0000_0000;
+      HSEL = 1;
+      HWRITE = 0;
+      HWDATA = 32'h0000_0107;
+      HTRANS = 0;
+      #30us
+      HWDATA = 32'h0000_0000;
+      
+      repeat(800)
+        begin
+          SDA_in = ~SDA_in;
+          #150us ;
+        end
+      SDA_in = 0;
+      
+      // read the sum of two samples (clears AccReady and IRQ)
+      HREADY = 1;
+      HADDR = 32'h0000_002C;
+      HSEL = 1;
+      HWRITE = 0;
+      HWDATA = 0;
+      HTRANS = 2;
+      #30us
+      
+      // command queue: disable the sequencer, then write 0x33 to register 0x1B and
+      // read 2 bytes from register 0x04 into buffer slot 4 as one sequence
+      HREADY = 1;
+      HADDR = 32'h0000_001C;
+      HSEL = 1;
+      HWRITE = 1;
+      HWDATA = 0;
+      HTRANS = 2;
+      #30us
+      
+      HREADY = 1;
+      HADDR = 32'h0000_0040;
+      HSEL = 1;
+      HWRITE = 1;
+      HWDATA = 32'h0000_0000;
+      HTRANS = 2;
+      #30us
+      
+      HREADY = 1;
+      HADDR = 32'h0000_0044;
+      HSEL = 1;
+      HWRITE = 1;
+      HWDATA = 32'h0000_1B77;
+      HTRANS = 2;
+      #30us
+      
+      HREADY = 1;
+      HADDR = 32'h0000_0060;
+      HSEL = 1;
+      HWRITE = 1;
+      HWDATA = 32'h0021_04F7;
+      HTRANS = 2;
+      #30us
+      
+      HREADY = 1;
+      HADDR = 32'h0000_0030;
+      HSEL = 1;
+      HWRITE = 1;
+      HWDATA = 32'h0000_0033;
+      HTRANS = 2;
+      #30us
+      
+      // start entries 0 ~ 1, interrupt enabled
+      HREADY = 1;
+      HADDR = 32'h0000_0000;
+      HSEL = 1;
+      HWRITE = 0;
+      HWDATA = 32'h0000_0013;
+      HTRANS = 0;
+      #30us
+      HWDATA = 32'h0000_0000;
+      
+      repeat(100)
+        begin
+          SDA_in = ~SDA_in;
+          #150us ;
+        end
+      SDA_in = 0;
+      
+      // read the queue status (clears Done and IRQ) and the read data in slot 4
+      HREADY = 1;
+      HADDR = 32'h0000_0030;
+      HSEL = 1;
+      HWRITE = 0;
+      HWDATA = 0;
+      HTRANS = 2;
+      #30us
+      
+      HREADY = 1;
+      HADDR = 32'h0000_0064;
+      HSEL = 1;
+      HWRITE = 0;
+      HWDATA = 0;
+      HTRANS = 2;
+      #30us
+      
+      HREADY = 1;
+      HADDR = 32'h0000_0000;
+      HSEL = 1;
+      HWRITE = 0;
+      HWDATA = 0;
+      HTRANS = 0;
+      
+      #60ms 
       $stop;
       $finish;
     end
@@ -0,0 +1,118 @@
+module ahb_interconnect_stim();
+
+timeunit 1ns;
+timeprecision 100ps;
+
+  // input of module
+  logic HRESETn, HCLK;
+  logic [31:0] HADDR;
+  logic [1:0] HTRANS;
+
+  // slaves: 0 at 0x0000_0000 (16kB), 1 at 0x2000_0000 (1kB, 812 bytes fitted, one wait state),
+  //         2 at 0x4000_0000 (4kB)
+  wire [2:0] HSEL_SIGNALS;
+  logic [2:0] HREADYOUT_SIGNALS;
+  logic [2:0][31:0] HRDATA_SIGNALS;
+
+  // output of module to master
+  wire HREADY, HRESP;
+  wire [31:0] HRDATA;
+
+  ahb_interconnect #(
+    .num_slaves(3),
+    .slave_base({32'h4000_0000, 32'h2000_0000, 32'h0000_0000}),
+    .slave_size({32'h0000_1000, 32'h0000_0400, 32'h0000_4000}),
+    .slave_fitted({32'h0000_1000, 32'h0000_032C, 32'h0000_4000})
+  ) dut(.HCLK, .HRESETn, .HADDR, .HTRANS,
+        .HSEL_SIGNALS, .HREADYOUT_SIGNALS, .HRDATA_SIGNALS,
+        .HREADY, .HRESP, .HRDATA);
+
+  always  /* simulating 32.768 kHz, ~30us */
+    begin
+           HCLK = 0;
+      #7.5us HCLK = 1;
+      #15us HCLK = 0;
+      #7.5us HCLK = 0;
+    end
+
+  // address decoding
+  task check_select(input [31:0] address, input [2:0] expected);
+      HADDR = address;
+      #1us
+      if ( HSEL_SIGNALS == expected )
+        $display("PASS: %h selects %b", address, expected);
+      else
+        $display("FAIL: %h selects %b, expected %b", address, HSEL_SIGNALS, expected);
+  endtask
+
+  initial
+    begin
+      HRESETn = 0;
+      HADDR = 0;
+      HTRANS = 0;
+      HREADYOUT_SIGNALS = '1;
+      HRDATA_SIGNALS = {32'h4444_4444, 32'h2222_2222, 32'h0000_0000};
+
+      #30us
+
+      HRESETn = 1;
+
+      check_select(32'h0000_0000, 3'b001);
+      check_select(32'h0000_3FFC, 3'b001);
+      check_select(32'h0000_4000, 3'b000);
+      check_select(32'h2000_0328, 3'b010);
+      check_select(32'h2000_032C, 3'b000);
+      check_select(32'h2000_03FC, 3'b000);
+      check_select(32'h2000_0400, 3'b000);
+      check_select(32'h4000_0FFC, 3'b100);
+      check_select(32'h4000_1000, 3'b000);
+      check_select(32'h5000_0000, 3'b000);
+
+      // read from a slave, OKAY response
+      HADDR = 32'h4000_0004;
+      HTRANS = 2;
+      #30us
+      HTRANS = 0;
+      #1us
+      if ( HREADY && !HRESP && ( HRDATA == 32'h4444_4444 ) )
+        $display("PASS: mapped transfer");
+      else
+        $display("FAIL: mapped transfer");
+      #29us
+
+      // IDLE transfer to an unmapped address, OKAY response
+      HADDR = 32'h5000_0000;
+      #30us
+      #1us
+      if ( HREADY && !HRESP )
+        $display("PASS: unmapped idle");
+      else
+        $display("FAIL: unmapped idle");
+      #29us
+
+      // transfer to an unmapped address, two cycle ERROR response
+      HTRANS = 2;
+      #30us
+      HTRANS = 0;
+      #1us
+      if ( !HREADY && HRESP )
+        $display("PASS: error first cycle");
+      else
+        $display("FAIL: error first cycle");
+      #30us
+      if ( HREADY && HRESP )
+        $display("PASS: error second cycle");
+      else
+        $display("FAIL: error second cycle");
+      #30us
+      if ( HREADY && !HRESP )
+        $display("PASS: error ended");
+      else
+        $display("FAIL: error ended");
+
+      #300us
+      $stop;
+      $finish;
+    end
+
+endmodule
@@ -17,11 +17,46 @@ timeprecision 100ps;
   // output of module to peripherals
   wire RS, RnW, E;
   wire [7:0] DB;
+  wire [7:0] DB_out;
+  wire DB_oe;
 
   ahb_lcd dut(.HCLK, .HRESETn, 
               .HADDR, .HWDATA, .HSIZE, .HTRANS, .HWRITE, .HREADY, .HSEL,
 	      .HRDATA, .HREADYOUT,
-	      .RS, .RnW, .E, .DB);
+	      .RS, .RnW, .E, .DB_in(DB), .DB_out, .DB_oe);
+
+  hd44780_model lcd(.RS, .RnW, .E, .DB);
+
+  // DB pad
+  assign DB = DB_oe ? DB_out : 'z;
+
+  // the same interface at 8MHz, timed from its parameters and the LCD busy flag
+  localparam fast_frequency = 8_000_000;
+
+  logic HCLK_fast;
+  logic [31:0] HADDR_fast, HWDATA_fast;
+  logic [1:0] HTRANS_fast;
+  logic HWRITE_fast;
+  wire [31:0] HRDATA_fast;
+  wire HREADYOUT_fast;
+  wire RS_fast, RnW_fast, E_fast;
+  wire [7:0] DB_fast, DB_out_fast;
+  wire DB_oe_fast;
+  wire Busy_fast;
+
+  ahb_lcd #(.clock_frequency(fast_frequency))
+          dut_fast(.HCLK(HCLK_fast), .HRESETn,
+                   .HADDR(HADDR_fast), .HWDATA(HWDATA_fast), .HSIZE(3'b010), .HTRANS(HTRANS_fast),
+                   .HWRITE(HWRITE_fast), .HREADY(1'b1), .HSEL(1'b1),
+                   .HRDATA(HRDATA_fast), .HREADYOUT(HREADYOUT_fast),
+                   .RS(RS_fast), .RnW(RnW_fast), .E(E_fast),
+                   .DB_in(DB_fast), .DB_out(DB_out_fast), .DB_oe(DB_oe_fast),
+                   .Busy(Busy_fast));
+
+  hd44780_model lcd_fast(.RS(RS_fast), .RnW(RnW_fast), .E(E_fast), .DB(DB_fast));
+
+  // DB pad
+  assign DB_fast = DB_oe_fast ? DB_out_fast : 'z;
 
   always  /* simulating 32.768 kHz, ~30us */
     begin
@@ -30,6 +65,143 @@ timeprecision 100ps;
       #15us HCLK = 0;
       #7.5us HCLK = 0;
     end
+
+  always  /* simulating 8 MHz, 125ns */
+    begin
+             HCLK_fast = 0;
+      #62.5ns HCLK_fast = 1;
+      #62.5ns HCLK_fast = 0;
+    end
+
+  // HD44780 bus timing (3V supply), checked on the fast interface
+  realtime rs_changed = -1ms, e_rose = -1ms, e_fell = -1ms;
+  int timing_errors = 0;
+
+  always @(RS_fast, RnW_fast)
+    begin
+      rs_changed = $realtime;
+      if ( E_fast )
+        begin
+          $display( "FAIL: RS or R/W changed while E is high at %t", $realtime );
+          timing_errors++;
+        end
+      if ( $realtime - e_fell < 20ns )
+        begin
+          $display( "FAIL: RS or R/W hold %t after E fell", $realtime - e_fell );
+          timing_errors++;
+        end
+    end
+
+  always @(posedge E_fast)
+    begin
+      if ( $realtime - rs_changed < 140ns )
+        begin
+          $display( "FAIL: RS or R/W setup %t before E rose", $realtime - rs_changed );
+          timing_errors++;
+        end
+      if ( $realtime - e_rose < 1000ns )
+        begin
+          $display( "FAIL: E cycle time %t", $realtime - e_rose );
+          timing_errors++;
+        end
+      e_rose = $realtime;
+    end
+
+  always @(negedge E_fast)
+    begin
+      if ( $realtime - e_rose < 450ns )
+        begin
+          $display( "FAIL: E pulse width %t", $realtime - e_rose );
+          timing_errors++;
+        end
+      e_fell = $realtime;
+    end
+
+  task write_fast(input [31:0] address, input [31:0] data);
+      @(posedge HCLK_fast) #10ns
+      HADDR_fast = address;
+      HWRITE_fast = 1;
+      HTRANS_fast = 2;
+      @(posedge HCLK_fast) #10ns
+      HTRANS_fast = 0;
+      HWDATA_fast = data;
+  endtask
+
+  task read_fast(input [31:0] address, output [31:0] data);
+      @(posedge HCLK_fast) #10ns
+      HADDR_fast = address;
+      HWRITE_fast = 0;
+      HTRANS_fast = 2;
+      @(posedge HCLK_fast) #10ns
+      HTRANS_fast = 0;
+      #50ns data = HRDATA_fast;
+  endtask
+
+  task wait_fast(output realtime busy_time);
+      logic [31:0] status;
+      realtime started;
+      started = $realtime;
+      do
+        read_fast(32'h10, status);
+      while ( status[0] );
+      busy_time = $realtime - started;
+  endtask
+
+  initial
+    begin
+      realtime busy_time;
+      logic [31:0] data;
+      int errors;
+      errors = 0;
+      HADDR_fast = 0;
+      HWDATA_fast = 0;
+      HTRANS_fast = 0;
+      HWRITE_fast = 0;
+      @(posedge HRESETn);
+
+      // clear display, busy for the LCD's 1.52ms
+      write_fast(32'h08, 32'h001);
+      write_fast(32'h0C, 32'h2);
+      wait_fast(busy_time);
+      if ( busy_time < 1.52ms || busy_time > 1.6ms || lcd_fast.clears != 1 )
+        begin
+          $display( "FAIL: clear display busy for %t (%0d clears)", busy_time, lcd_fast.clears );
+          errors++;
+        end
+
+      // characters as fast as the LCD takes them (9 transfers of 37us)
+      write_fast(32'h00, 32'h4443_4241);   // ABCD
+      write_fast(32'h04, 32'h4847_4645);   // EFGH
+      write_fast(32'h0C, 32'h3);
+      wait_fast(busy_time);
+      if ( lcd_fast.display() != "ABCDEFGH" )
+        begin
+          $display( "FAIL: LCD shows \"%s\"", lcd_fast.display() );
+          errors++;
+        end
+      if ( busy_time < 9 * 37us || busy_time > 9 * 42us )
+        begin
+          $display( "FAIL: display refresh busy for %t", busy_time );
+          errors++;
+        end
+
+      // read the busy flag and address with an instruction
+      write_fast(32'h08, 32'h100);
+      write_fast(32'h0C, 32'h2);
+      wait_fast(busy_time);
+      read_fast(32'h14, data);
+      if ( data[7:0] != 8'h08 )
+        begin
+          $display( "FAIL: read 0x%h from the LCD (expected address 0x08)", data[7:0] );
+          errors++;
+        end
+
+      errors += timing_errors;
+      if ( errors == 0 )
+        $display( "PASS: ahb_lcd at %0dHz, busy flag polling and bus timing", fast_frequency );
+      else
+        $display( "FAIL: ahb_lcd at %0dHz, %0d errors", fast_frequency, errors );
+    end
     
   initial
     begin
@@ -0,0 +1,510 @@
+///////////////////////////////////////////////////////////////////////
+//
+// ahb_throughput_stim module
+//
+//    throughput characterisation of the peripheral slaves, each on its
+//    own select line of a test bus driven by a pipelined AHB master (a
+//    transfer every clock cycle when back to back):
+//
+//      ahb_bmp_i2c     with a bmp390_model, I2C reads and writes of each
+//                      size (read data checked against the calibration)
+//      ahb_simple_i2c  with a bmp390_model, as ahb_bmp_i2c
+//      ahb_lcd         with an hd44780_model, back to back 8 character
+//                      refreshes (the characters shown are checked)
+//      ahb_buttons     presses at increasing rates, read as the firmware
+//                      does, the highest rate with no lost presses is found
+//
+//    and before that each slave gets random_transfers back to back random
+//    reads and writes of its plain registers, checked against a copy
+//
+//    the status registers are polled every poll_interval clock cycles so
+//    that the bus busy figure is the bus time the peripheral needs
+//    rather than that of a busy wait
+//
+//    each measurement is printed as a line of a table (transfers per
+//    second, bytes per transfer and per second, bus busy percentage and
+//    errors) and appended to throughput_report.csv, labelled with
+//    +build=<name>, to track the figures across RTL changes (+seed=<n>
+//    for the random traffic)
+//
+///////////////////////////////////////////////////////////////////////
+
+module ahb_throughput_stim();
+
+timeunit 1ns;
+timeprecision 100ps;
+
+  parameter transfers_per_setting = 4;
+  parameter random_transfers = 200;
+  parameter poll_interval = 8;
+  parameter press_count = 8;
+  parameter timeout_cycles = 20000;
+
+  localparam clock_period = 30us;
+
+  // button press periods (ms), fastest last
+  localparam int press_periods [7] = '{400, 200, 150, 120, 100, 80, 60};
+
+  // slaves on the test bus
+  localparam BMP_I2C = 0, SIMPLE_I2C = 1, LCD = 2, BUTTONS = 3;
+
+  // typical calibration (as bmp390_model)
+  localparam logic [5:0][31:0] calib = {32'h0000_00C9, 32'h063E_80FA, 32'h035D_5C5F, 32'hB402_12FF, 32'hF7FF_FEF9, 32'h4A92_6B8A};
+
+  logic HRESETn, HCLK;
+  logic [31:0] HADDR, HWDATA;
+  logic [2:0] HSIZE;
+  logic [1:0] HTRANS;
+  logic HWRITE, HREADY;
+  logic [3:0] HSEL;
+
+  logic [31:0] HRDATA;
+  wire [31:0] HRDATA_BMP_I2C, HRDATA_SIMPLE_I2C, HRDATA_LCD, HRDATA_BUTTONS;
+  wire HREADYOUT_BMP_I2C, HREADYOUT_SIMPLE_I2C, HREADYOUT_LCD, HREADYOUT_BUTTONS;
+
+  wire SCL_BMP, SDA_out_BMP, SDA_in_BMP;
+  wire SCL_SIMPLE, SDA_out_SIMPLE, SDA_in_SIMPLE;
+  wire RS, RnW, E;
+  wire [7:0] DB;
+  wire [7:0] DB_out;
+  wire DB_oe;
+  logic nMode, nTrip;
+
+  ahb_bmp_i2c bmp_i2c_1(.HCLK, .HRESETn,
+                        .HADDR, .HWDATA, .HSIZE, .HTRANS, .HWRITE, .HREADY, .HSEL(HSEL[BMP_I2C]),
+                        .HRDATA(HRDATA_BMP_I2C), .HREADYOUT(HREADYOUT_BMP_I2C),
+                        .SCL(SCL_BMP), .SDA_out(SDA_out_BMP), .SDA_in(SDA_in_BMP),
+                        .DataValid(), .IRQ(), .Pressure(), .NewSample());
+
+  bmp390_model #(.calib(calib)) bmp_sensor(.SCL(SCL_BMP), .SDA_out(SDA_out_BMP), .SDA_in(SDA_in_BMP),
+                                           .uncomp_press(24'h63_2EA0), .uncomp_temp(24'h74_B1C0));
+
+  ahb_simple_i2c simple_i2c_1(.HCLK, .HRESETn,
+                              .HADDR, .HWDATA, .HSIZE, .HTRANS, .HWRITE, .HREADY, .HSEL(HSEL[SIMPLE_I2C]),
+                              .HRDATA(HRDATA_SIMPLE_I2C), .HREADYOUT(HREADYOUT_SIMPLE_I2C),
+                              .SCL(SCL_SIMPLE), .SDA_out(SDA_out_SIMPLE), .SDA_in(SDA_in_SIMPLE),
+                              .DataValid());
+
+  bmp390_model #(.calib(calib)) simple_sensor(.SCL(SCL_SIMPLE), .SDA_out(SDA_out_SIMPLE), .SDA_in(SDA_in_SIMPLE),
+                                              .uncomp_press(24'h63_2EA0), .uncomp_temp(24'h74_B1C0));
+
+  ahb_lcd lcd_1(.HCLK, .HRESETn,
+                .HADDR, .HWDATA, .HSIZE, .HTRANS, .HWRITE, .HREADY, .HSEL(HSEL[LCD]),
+                .HRDATA(HRDATA_LCD), .HREADYOUT(HREADYOUT_LCD),
+                .RS, .RnW, .E, .DB_in(DB), .DB_out, .DB_oe,
+                .Busy());
+
+  hd44780_model lcd(.RS, .RnW, .E, .DB);
+
+  // DB pad
+  assign DB = DB_oe ? DB_out : 'z;
+
+  ahb_buttons buttons_1(.HCLK, .HRESETn,
+                        .HADDR, .HWDATA, .HSIZE, .HTRANS, .HWRITE, .HREADY, .HSEL(HSEL[BUTTONS]),
+                        .HRDATA(HRDATA_BUTTONS), .HREADYOUT(HREADYOUT_BUTTONS),
+                        .nButtons({nTrip, nMode}));
+
+  always  /* simulating 32.768 kHz, ~30us */
+    begin
+           HCLK = 0;
+      #7.5us HCLK = 1;
+      #15us HCLK = 0;
+      #7.5us HCLK = 0;
+    end
+
+
+  //-------------------------
+  // AHB master
+
+  int data_slave;
+
+  // read data and ready of the slave in the data phase
+  always_comb
+    case ( data_slave )
+      BMP_I2C :    begin HRDATA = HRDATA_BMP_I2C;    HREADY = HREADYOUT_BMP_I2C;    end
+      SIMPLE_I2C : begin HRDATA = HRDATA_SIMPLE_I2C; HREADY = HREADYOUT_SIMPLE_I2C; end
+      LCD :        begin HRDATA = HRDATA_LCD;        HREADY = HREADYOUT_LCD;        end
+      default :    begin HRDATA = HRDATA_BUTTONS;    HREADY = HREADYOUT_BUTTONS;    end
+    endcase
+
+  // one transfer, called just after a rising edge of HCLK it returns early in the
+  // next cycle (its data phase) so that consecutive calls are pipelined
+  task ahb_transfer(input int slave, input write, input [31:0] address, input [31:0] wdata, output [31:0] rdata);
+      HSEL = '0;
+      HSEL[slave] = 1;
+      HADDR = address;
+      HWRITE = write;
+      HTRANS = 2;
+      @(posedge HCLK) #1us
+      HSEL = '0;
+      HTRANS = 0;
+      data_slave = slave;
+      HWDATA = wdata;
+      #1us
+      rdata = HRDATA;
+  endtask
+
+  task ahb_write(input int slave, input [31:0] address, input [31:0] data);
+      logic [31:0] unused;
+      ahb_transfer(slave, 1, address, data, unused);
+  endtask
+
+  task ahb_read(input int slave, input [31:0] address, output [31:0] data);
+      ahb_transfer(slave, 0, address, 0, data);
+  endtask
+
+  task idle(input int cycles);
+      repeat ( cycles ) @(posedge HCLK);
+      #1us ;
+  endtask
+
+
+  //-------------------------
+  // measurement
+
+  logic measuring = 0;
+  int cycles, busy_cycles;
+  string build;
+  string results[$];
+
+  always @(posedge HCLK)
+    if ( measuring )
+      begin
+        cycles++;
+        if ( HTRANS[1] && HREADY )
+          busy_cycles++;
+      end
+
+  task start_measure();
+      cycles = 0;
+      busy_cycles = 0;
+      measuring = 1;
+  endtask
+
+  // one line of the results table
+  task end_measure(input string slave, input string test, input string setting,
+                   input int transfers, input int bytes_per_transfer, input int errors);
+      real seconds;
+      string line;
+      measuring = 0;
+      seconds = cycles * ( clock_period / 1s );
+      line = $sformatf("%s,%s,%s,%0d,%.1f,%0d,%.1f,%.1f,%0d", slave, test, setting, transfers,
+                       transfers / seconds, bytes_per_transfer, transfers * bytes_per_transfer / seconds,
+                       100.0 * busy_cycles / cycles, errors);
+      results.push_back(line);
+      $display( "%-16s %-10s %-8s %6d %12.1f %6d %12.1f %8.1f %6d", slave, test, setting, transfers,
+                transfers / seconds, bytes_per_transfer, transfers * bytes_per_transfer / seconds,
+                100.0 * busy_cycles / cycles, errors );
+  endtask
+
+  // poll a status register until (status & mask) == value
+  task poll(input int slave, input [31:0] address, input [31:0] mask, input [31:0] value, inout int errors);
+      logic [31:0] status;
+      int waited;
+      waited = 0;
+      ahb_read(slave, address, status);
+      while ( ( status & mask ) != value )
+        begin
+          if ( waited > timeout_cycles )
+            begin
+              $display( "FAIL: slave %0d register %h timed out", slave, address );
+              errors++;
+              return;
+            end
+          idle(poll_interval - 1);
+          waited += poll_interval;
+          ahb_read(slave, address, status);
+        end
+  endtask
+
+
+  //-------------------------
+  // random register traffic
+
+  // registers which read back what was written (mask of the bits kept)
+  function automatic logic [31:0] readback_mask(input int slave, input [7:0] address);
+      case ( slave )
+        BMP_I2C :    if ( address == 8'h00 )                     return 32'h0000_007F;   // device address
+                     else if ( address == 8'h04 )                return 32'hFFFF_FFFF;   // register addresses
+                     else if ( address >= 8'h40 && address < 8'h60 ) return 32'h00FF_FFFF; // queue entries
+                     else if ( address >= 8'h60 && address < 8'h80 ) return 32'hFFFF_FFFF; // queue buffer
+                     else                                        return 0;
+        SIMPLE_I2C : if ( address == 8'h00 )                     return 32'h0000_007F;
+                     else if ( address == 8'h04 )                return 32'hFFFF_FFFF;
+                     else                                        return 0;
+        LCD :        if ( address == 8'h00 || address == 8'h04 ) return 32'hFFFF_FFFF;   // characters
+                     else if ( address == 8'h08 )                return 32'h0000_03FF;   // instruction
+                     else                                        return 0;
+        default :    return 0;
+      endcase
+  endfunction
+
+  // registers which may be read or written at random (nothing is started)
+  function automatic logic [7:0] random_register(input int slave, input bit write);
+      int r;
+      case ( slave )
+        BMP_I2C :    begin
+                       r = $urandom_range(0, 17);
+                       if ( r < 16 ) return 8'h40 + 4 * r;       // queue entries and buffer
+                       else if ( r == 16 ) return 8'h00;
+                       else return 8'h04;
+                     end
+        SIMPLE_I2C : return ( $urandom_range(0, 1) ) ? 8'h04 : 8'h00;
+        LCD :        return 4 * $urandom_range(0, 2);
+        default :    return write ? 8'h08 : 4 * $urandom_range(1, 3);   // not the buttons status (cleared on read)
+      endcase
+  endfunction
+
+  task random_traffic(input int slave, input string name);
+      logic [31:0] shadow [logic [7:0]];
+      logic [31:0] data, mask;
+      logic [7:0] address;
+      bit write;
+      int errors;
+      errors = 0;
+      start_measure();
+      for ( int i = 0; i < random_transfers; i++ )
+        begin
+          write = $urandom_range(0, 1);
+          address = random_register(slave, write);
+          mask = readback_mask(slave, address);
+          if ( write )
+            begin
+              data = $urandom;
+              ahb_write(slave, address, data);
+              shadow[address] = data & mask;
+            end
+          else
+            begin
+              ahb_read(slave, address, data);
+              if ( shadow.exists(address) && ( data & mask ) != shadow[address] )
+                begin
+                  $display( "FAIL: %s register %h read %h, expected %h", name, address, data & mask, shadow[address] );
+                  errors++;
+                end
+            end
+        end
+      idle(1);
+      end_measure(name, "random", "-", random_transfers, 4, errors);
+  endtask
+
+
+  //-------------------------
+  // I2C transfers
+
+  task i2c_transfers(input int slave, input string name, input bit read, input int nbytes);
+      logic [31:0] data_low, data_high;
+      logic [7:0] expected;
+      int errors;
+      errors = 0;
+      start_measure();
+      for ( int n = 0; n < transfers_per_setting; n++ )
+        begin
+          // the simple interface keeps its register addresses and write data in the opposite byte order
+          ahb_write(slave, 32'h00, 32'h77);                         // device address
+          if ( read )
+            ahb_write(slave, 32'h04, ( slave == BMP_I2C ) ? 32'h31 : 32'h3100_0000);  // calibration
+          else
+            begin
+              ahb_write(slave, 32'h04, ( slave == BMP_I2C ) ? 32'h1E1D_1C1B : 32'h1B1C_1D1E);
+              ahb_write(slave, 32'h10, ( slave == BMP_I2C ) ? 32'h0002_0233 : 32'h3302_0200);
+            end
+          ahb_write(slave, 32'h14, { nbytes[2:0], 1'b1, read });    // start
+          idle(2);
+          poll(slave, 32'h18, 32'h2, 32'h0, errors);                // until not busy
+          if ( read )
+            begin
+              ahb_read(slave, 32'h08, data_low);
+              ahb_read(slave, 32'h0C, data_high);
+              // the simple interface reads on from the last register address
+              if ( slave == BMP_I2C )
+                for ( int i = 0; i < nbytes; i++ )
+                  begin
+                    expected = calib[i / 4] >> ( 8 * ( i % 4 ) );
+                    if ( ( ( i < 4 ) ? data_low >> ( 8 * i ) : data_high >> ( 8 * ( i - 4 ) ) ) & 8'hFF ) != expected )
+                      begin
+                        $display( "FAIL: %s read byte %0d of %0d wrong", name, i, nbytes );
+                        errors++;
+                      end
+                  end
+            end
+        end
+      idle(1);
+      end_measure(name, read ? "read" : "write", $sformatf("%0d bytes", nbytes), transfers_per_setting, nbytes, errors);
+  endtask
+
+
+  //-------------------------
+  // LCD refreshes
+
+  task lcd_refreshes();
+      logic [7:0] characters [0:7];
+      int errors;
+      errors = 0;
+      start_measure();
+      for ( int n = 0; n < transfers_per_setting; n++ )
+        begin
+          for ( int i = 0; i < 8; i++ )
+            characters[i] = 8'h41 + ( ( n + i ) % 26 );   // A~Z
+          poll(LCD, 32'h10, 32'h1, 32'h0, errors);        // until not busy
+          ahb_write(LCD, 32'h00, { characters[3], characters[2], characters[1], characters[0] });
+          ahb_write(LCD, 32'h04, { characters[7], characters[6], characters[5], characters[4] });
+          ahb_write(LCD, 32'h0C, 32'h3);                  // display, enable
+          idle(2);
+          poll(LCD, 32'h10, 32'h1, 32'h0, errors);
+          for ( int i = 0; i < 8; i++ )
+            if ( lcd.text[i] != characters[i] )
+              begin
+                $display( "FAIL: LCD shows \"%s\" after refresh %0d", lcd.display(), n );
+                errors++;
+                break;
+              end
+        end
+      idle(1);
+      end_measure("ahb_lcd", "refresh", "8 chars", transfers_per_setting * 8, 1, errors);
+  endtask
+
+
+  //-------------------------
+  // button presses
+
+  int presses_made, presses_seen;
+
+  // press_count presses (alternately mode and trip), press_period apart
+  task press_buttons(input realtime press_period);
+      presses_made = 0;
+      for ( int n = 0; n < press_count; n++ )
+        begin
+          if ( n % 2 ) nTrip = 0; else nMode = 0;
+          #( press_period / 2 )
+          nMode = 1;
+          nTrip = 1;
+          #( press_period / 2 )
+          presses_made++;
+        end
+  endtask
+
+  task button_events(input int period_ms, output bit lossless);
+      logic [31:0] status;
+      int errors, wrong;
+      errors = 0;
+      wrong = 0;
+      presses_seen = 0;
+      start_measure();
+      fork
+        press_buttons(period_ms * 1ms);
+        begin
+          while ( presses_made < press_count )
+            begin
+              ahb_read(BUTTONS, 32'h04, status);            // DataValid
+              if ( status[0] )
+                begin
+                  ahb_read(BUTTONS, 32'h00, status);
+                  if ( status[1:0] == ( presses_seen % 2 ? 2'b10 : 2'b01 ) )
+                    presses_seen++;
+                  else
+                    wrong++;
+                end
+              else
+                idle(poll_interval - 1);
+            end
+          idle(100ms / clock_period);                      // last debounce
+          ahb_read(BUTTONS, 32'h04, status);
+          if ( status[0] )
+            begin
+              ahb_read(BUTTONS, 32'h00, status);
+              presses_seen++;
+            end
+        end
+      join
+      errors = press_count - presses_seen + wrong;
+      lossless = ( errors == 0 );
+      end_measure("ahb_buttons", "press", $sformatf("%0dms", period_ms), presses_seen, 0, errors);
+  endtask
+
+
+  //-------------------------
+  // suite
+
+  int fd;
+  bit lossless;
+  int fastest_lossless;
+
+  initial
+    begin
+      $timeformat( -3, 3, " ms", 10 );
+
+      if ( ! $value$plusargs("build=%s", build) )
+        build = "default";
+      if ( $value$plusargs("seed=%d", fd) )
+        process::self().srandom(fd);
+
+      HRESETn = 0;
+      HADDR = 0;
+      HWDATA = 0;
+      HSIZE = 3'b010;
+      HTRANS = 0;
+      HSEL = 0;
+      HWRITE = 0;
+      data_slave = BMP_I2C;
+      nMode = 1;
+      nTrip = 1;
+
+      #30us
+
+      HRESETn = 1;
+      @(posedge HCLK) #1us ;
+
+      $display( "" );
+      $display( "%-16s %-10s %-8s %6s %12s %6s %12s %8s %6s", "slave", "test", "setting", "xfers",
+                "xfers/s", "bytes", "bytes/s", "busy %", "errors" );
+
+      random_traffic(BMP_I2C, "ahb_bmp_i2c");
+      random_traffic(SIMPLE_I2C, "ahb_simple_i2c");
+      random_traffic(LCD, "ahb_lcd");
+      random_traffic(BUTTONS, "ahb_buttons");
+
+      for ( int nbytes = 1; nbytes <= 6; nbytes++ )
+        i2c_transfers(BMP_I2C, "ahb_bmp_i2c", 1, nbytes);
+      for ( int nbytes = 1; nbytes <= 4; nbytes++ )
+        i2c_transfers(BMP_I2C, "ahb_bmp_i2c", 0, nbytes);
+      for ( int nbytes = 1; nbytes <= 6; nbytes++ )
+        i2c_transfers(SIMPLE_I2C, "ahb_simple_i2c", 1, nbytes);
+      for ( int nbytes = 1; nbytes <= 4; nbytes++ )
+        i2c_transfers(SIMPLE_I2C, "ahb_simple_i2c", 0, nbytes);
+
+      lcd_refreshes();
+
+      // the rate goes up until presses are lost
+      fastest_lossless = 0;
+      foreach ( press_periods[i] )
+        begin
+          button_events(press_periods[i], lossless);
+          if ( ! lossless )
+            break;
+          fastest_lossless = press_periods[i];
+        end
+      if ( fastest_lossless )
+        $display( "Buttons: no presses lost up to %.1f presses/s", 1000.0 / fastest_lossless );
+      else
+        $display( "FAIL: buttons lose presses at one every %0dms", press_periods[0] );
+
+      fd = $fopen("throughput_report.csv", "r");
+      if ( fd != 0 )
+        $fclose(fd);
+      else
+        begin
+          fd = $fopen("throughput_report.csv", "w");
+          $fdisplay( fd, "build,slave,test,setting,transfers,transfers_per_s,bytes_per_transfer,bytes_per_s,bus_busy_pct,errors" );
+          $fclose(fd);
+        end
+      fd = $fopen("throughput_report.csv", "a");
+      foreach ( results[i] )
+        $fdisplay( fd, "%s,%s", build, results[i] );
+      $fclose(fd);
+
+      $stop;
+      $finish;
+    end
+
+endmodule
@@ -0,0 +1,143 @@
+///////////////////////////////////////////////////////////////////////
+//
+// alt_core_stim module
+//
+//    self checking test of the LCD data bus at alt_core level, with
+//    bmp390_model as the sensor and hd44780_model as the LCD connected
+//    through a model of the DB pads (DB_Out driven onto DB unless
+//    DB_nEnable is set, DB_In always reads DB):
+//
+//      contention   DB_nEnable must be set whenever E is high for a read
+//                   (RnW set) and clear for a write
+//
+//      busy flag    the busy flag must be read back through DB_In, seen
+//                   set at least once (after clear display), and no
+//                   instruction or character may be written while the
+//                   LCD is still busy (hd44780_model busy_writes)
+//
+//      display      the firmware must show a reading within 1s of reset
+//                   and keep refreshing it
+//
+///////////////////////////////////////////////////////////////////////
+
+module alt_core_stim();
+
+timeunit 1ns;
+timeprecision 100ps;
+
+  logic nReset, Clock;
+  logic nMode, nTrip;
+
+  wire RS, RnW, E;
+  wire [7:0] DB, DB_In, DB_Out;
+  wire DB_nEnable;
+
+  wire SCL, SDA_Out, SDA_In;
+
+  logic [23:0] uncomp_press, uncomp_temp;
+
+  alt_core dut(.RS, .RnW, .E,
+               .DB_In, .DB_Out, .DB_nEnable,
+               .nMode, .nTrip,
+               .SCL, .SDA_In, .SDA_Out,
+               .Clock, .nReset);
+
+  // DB pads
+  assign DB = DB_nEnable ? 'z : DB_Out;
+  assign DB_In = DB;
+
+  bmp390_model sensor(.SCL, .SDA_out(SDA_Out), .SDA_in(SDA_In), .uncomp_press, .uncomp_temp);
+
+  hd44780_model lcd(.RS, .RnW, .E, .DB);
+
+  always
+    begin
+                Clock = 0;
+      #7.629us  Clock = 1;
+      #15.528us Clock = 0;
+      #7.629us  Clock = 0;
+    end
+
+  int errors = 0;
+  int contention = 0;
+  int busy_reads = 0, busy_seen = 0;
+  int refreshes;
+
+  // the pads must not drive DB while the LCD does, and must drive it for a write
+  always @(posedge E, negedge E)
+    if ( RnW != DB_nEnable )
+      begin
+        if ( contention < 5 )
+          $display( "FAIL: DB_nEnable %b with RnW %b at %t", DB_nEnable, RnW, $realtime );
+        contention++;
+      end
+
+  // busy flag reads, sampled while E is still high
+  always @(negedge E)
+    if ( RnW && ! RS )
+      begin
+        busy_reads++;
+        if ( DB_In[7] === 1'b1 )
+          busy_seen++;
+      end
+
+  initial
+    begin
+      $timeformat( -3, 3, " ms", 10 );
+
+      nMode = 1;
+      nTrip = 1;
+      uncomp_temp = 24'h74_B1C0;
+      uncomp_press = 24'h63_2EA0;
+
+      nReset = 0;
+      #10ns nReset = 1;
+
+      fork
+        wait ( lcd.refreshes > 0 );
+        #1s ;
+      join_any
+      disable fork;
+
+      if ( lcd.refreshes == 0 )
+        begin
+          $display( "FAIL: nothing displayed" );
+          errors++;
+        end
+      else
+        $display( "display \"%s\" after %t", lcd.display(), $realtime );
+
+      // keep it running for a few more refreshes
+      refreshes = lcd.refreshes;
+      #1s ;
+      if ( lcd.refreshes <= refreshes )
+        begin
+          $display( "FAIL: the display is not refreshed" );
+          errors++;
+        end
+
+      $display( "%0d busy flag reads (%0d busy), %0d writes while busy, %0d contention",
+                busy_reads, busy_seen, lcd.busy_writes, contention );
+
+      if ( busy_reads == 0 || busy_seen == 0 )
+        begin
+          $display( "FAIL: the busy flag was not read back through DB_In" );
+          errors++;
+        end
+      if ( lcd.busy_writes != 0 )
+        begin
+          $display( "FAIL: the LCD was written while busy" );
+          errors++;
+        end
+      errors += contention;
+
+      if ( errors == 0 )
+        $display( "PASS: LCD data bus at alt_core level" );
+      else
+        $display( "FAIL: LCD data bus at alt_core level (%0d errors)", errors );
+
+      $stop;
+      $finish;
+    end
+
+endmodule
@@ -0,0 +1,202 @@
+///////////////////////////////////////////////////////////////////////
+//
+// bmp390_model module
+//
+//    behavioural model of the BMP390 pressure sensor I2C interface for
+//    soc level testbenches (not synthesisable)
+//
+//    device address 0x77, registers:
+//      0x00        CHIP_ID (0x60)
+//      0x04~0x06   PRESS_XLSB, PRESS_LSB, PRESS_MSB  (uncomp_press)
+//      0x07~0x09   TEMP_XLSB, TEMP_LSB, TEMP_MSB     (uncomp_temp)
+//      0x1B~0x1D   PWR_CTRL, OSR, ODR                (read/write)
+//      0x31~0x45   calibration (calib parameter, register 0x31 in bits
+//                  7~0 of calib[0] as in ahb_bmp_comp)
+//
+//    the data registers read 0x800000 until PWR_CTRL selects normal mode,
+//    after that they follow the uncomp_press and uncomp_temp inputs (no
+//    conversion time is modelled), they are sampled at the start of each
+//    read so a burst read is always coherent
+//
+//    reads auto-increment the register address, writes are register/data
+//    pairs as on the real device, unknown registers read 0
+//
+//    SDA_in is the wired AND of SDA_out and the open drain output of the
+//    sensor (the bus pull-up is implied)
+//
+///////////////////////////////////////////////////////////////////////
+
+module bmp390_model #(
+  parameter logic [6:0] device_addr = 7'h77,
+  // typical calibration (as in ahb_bmp_comp_stim.sv)
+  parameter logic [5:0][31:0] calib = {32'h0000_00C9, 32'h063E_80FA, 32'h035D_5C5F, 32'hB402_12FF, 32'hF7FF_FEF9, 32'h4A92_6B8A}
+)(
+
+  input SCL,
+  input SDA_out,
+  output SDA_in,
+
+  input [23:0] uncomp_press,
+  input [23:0] uncomp_temp
+
+);
+
+timeunit 1ns;
+timeprecision 100ps;
+
+  localparam DATA_RESET = 24'h80_0000;
+
+  enum {IDLE, ADDRESS, REGISTER, WRITE, READ} state;
+
+  logic sda_drive;
+  logic read_op, master_ack;
+  logic [7:0] shift_reg, tx_data, reg_addr;
+  logic [7:0] pwr_ctrl, osr, odr;
+  logic [23:0] press_sample, temp_sample;
+  int bit_count;
+
+  // number of transfers seen (for testbenches)
+  int reads, writes;
+
+  assign SDA_in = SDA_out && sda_drive;
+
+  initial
+    begin
+      state = IDLE;
+      sda_drive = 1;
+      bit_count = 0;
+      pwr_ctrl = 0;
+      osr = 8'h02;
+      odr = 0;
+      reads = 0;
+      writes = 0;
+    end
+
+  function logic [7:0] read_register(input [7:0] address);
+      if ( address == 8'h00 )
+        return 8'h60;
+      else if ( address >= 8'h04 && address <= 8'h06 )
+        return press_sample >> ( 8 * ( address - 8'h04 ) );
+      else if ( address >= 8'h07 && address <= 8'h09 )
+        return temp_sample >> ( 8 * ( address - 8'h07 ) );
+      else if ( address == 8'h1B )
+        return pwr_ctrl;
+      else if ( address == 8'h1C )
+        return osr;
+      else if ( address == 8'h1D )
+        return odr;
+      else if ( address >= 8'h31 && address <= 8'h45 )
+        return calib[( address - 8'h31 ) / 4] >> ( 8 * ( ( address - 8'h31 ) % 4 ) );
+      else
+        return 8'h00;
+  endfunction
+
+  task write_register(input [7:0] address, input [7:0] data);
+      case ( address )
+        8'h1B : pwr_ctrl = data;
+        8'h1C : osr = data;
+        8'h1D : odr = data;
+        default : ;
+      endcase
+  endtask
+
+  // START (also repeated START): SDA falls while SCL is high
+  always @(negedge SDA_out)
+    if ( SCL )
+      begin
+        state = ADDRESS;
+        bit_count = 0;
+        sda_drive = 1;
+      end
+
+  // STOP: SDA rises while SCL is high
+  always @(posedge SDA_out)
+    if ( SCL )
+      begin
+        state = IDLE;
+        sda_drive = 1;
+      end
+
+  // data and acknowledge bits are sampled on the rising edge of SCL
+  always @(posedge SCL)
+    if ( state != IDLE )
+      begin
+        if ( bit_count < 8 )
+          shift_reg = { shift_reg[6:0], SDA_in };
+        else
+          master_ack = ! SDA_in;
+        bit_count++;
+      end
+
+  // and SDA is changed after the falling edge
+  always @(negedge SCL)
+    if ( state != IDLE )
+      if ( bit_count == 8 )
+        // acknowledge a byte from the master or release SDA for the master to acknowledge
+        case ( state )
+          ADDRESS :  if ( shift_reg[7:1] == device_addr )
+                       begin
+                         read_op = shift_reg[0];
+                         sda_drive = 0;
+                       end
+                     else
+                       state = IDLE;
+          REGISTER : begin
+                       reg_addr = shift_reg;
+                       sda_drive = 0;
+                     end
+          WRITE :    begin
+                       write_register(reg_addr, shift_reg);
+                       writes++;
+                       sda_drive = 0;
+                     end
+          READ :     sda_drive = 1;
+          default :  ;
+        endcase
+      else if ( bit_count == 9 )
+        begin
+          // end of the acknowledge bit
+          bit_count = 0;
+          sda_drive = 1;
+          case ( state )
+            ADDRESS :  if ( read_op )
+                         begin
+                           // sample the measurement for the whole burst
+                           if ( pwr_ctrl[5:4] == 2'b11 )
+                             begin
+                               press_sample = uncomp_press;
+                               temp_sample = uncomp_temp;
+                             end
+                           else
+                             begin
+                               press_sample = DATA_RESET;
+                               temp_sample = DATA_RESET;
+                             end
+                           state = READ;
+                           tx_data = read_register(reg_addr);
+                           sda_drive = tx_data[7];
+                         end
+                       else
+                         state = REGISTER;
+            REGISTER : state = WRITE;
+            WRITE :    state = REGISTER;
+            READ :     if ( master_ack )
+                         begin
+                           reg_addr++;
+                           reads++;
+                           tx_data = read_register(reg_addr);
+                           sda_drive = tx_data[7];
+                         end
+                       else
+                         begin
+                           reg_addr++;
+                           reads++;
+                           state = IDLE;
+                         end
+            default :  ;
+          endcase
+        end
+      else if ( state == READ )
+        sda_drive = tx_data[7 - bit_count];
+
+endmodule
@@ -0,0 +1,61 @@
+// Reference model for ahb_bmp_comp_stim.sv and soc_latency_stim.sv (bmp_comp_ref.c)
+//
+// Imported through DPI-C, this runs the firmware compensation code on the
+// simulation host so the pipeline is checked against exactly what the
+// processor would have computed.
+//
+// The compensation relies on two's complement wrap around of int64_t so this
+// file must be compiled with -fwrapv (e.g. xrun ... bmp_comp_ref.c -Wcc,-fwrapv)
+
+#include <stdint.h>
+#include "../software/code/bmp390_comp.h"
+
+// calib0~calib5 hold the calibration registers in the same order as the
+// ahb_bmp_comp CALIB registers (register 0x31 in bits 7~0 of calib0)
+void bmp390_comp_ref(unsigned int calib0, unsigned int calib1, unsigned int calib2,
+                     unsigned int calib3, unsigned int calib4, unsigned int calib5,
+                     unsigned int uncomp_temp, unsigned int uncomp_press,
+                     long long* t_lin, long long* pressure){
+
+  uint32_t calib[6] = { calib0, calib1, calib2, calib3, calib4, calib5 };
+  uint8_t buffer[24];
+  BMP390_calib_data calib_data;
+  int i;
+
+  for(i = 0; i < 24; i++)
+    buffer[i] = (uint8_t) (calib[i / 4] >> (8 * (i % 4)));
+
+  BMP390_unpack_calib(buffer, &calib_data);
+
+  BMP390_compensate_temperature(uncomp_temp, &calib_data);
+  *t_lin = calib_data.t_lin;
+  *pressure = BMP390_compensate_pressure(uncomp_press, &calib_data);
+
+}
+
+// raw pressure which the firmware compensates to (within ~1Pa of) pressure_Pa at
+// uncomp_temp, for sensor models replaying a pressure profile
+unsigned int bmp390_uncomp_ref(unsigned int calib0, unsigned int calib1, unsigned int calib2,
+                               unsigned int calib3, unsigned int calib4, unsigned int calib5,
+                               unsigned int uncomp_temp, long long pressure_Pa){
+
+  uint32_t calib[6] = { calib0, calib1, calib2, calib3, calib4, calib5 };
+  uint8_t buffer[24];
+  BMP390_calib_data calib_data;
+  BMP390_pressure_terms terms;
+  uint32_t uncomp_press;
+  int i;
+
+  for(i = 0; i < 24; i++)
+    buffer[i] = (uint8_t) (calib[i / 4] >> (8 * (i % 4)));
+
+  BMP390_unpack_calib(buffer, &calib_data);
+
+  BMP390_compensate_temperature(uncomp_temp, &calib_data);
+  BMP390_pressure_terms_update(&calib_data, &terms);
+
+  // start from the middle of the range, then again from the first estimate
+  uncomp_press = BMP390_uncompensate_pressure_terms(pressure_Pa, 0x800000, &calib_data, &terms);
+  return BMP390_uncompensate_pressure_terms(pressure_Pa, uncomp_press, &calib_data, &terms);
+
+}
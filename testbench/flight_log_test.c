@@ -0,0 +1,106 @@
+// Host round trip test for the flight log (flight_log_test.c)
+//
+// Appends a random altitude walk to a flight_log and, after every append,
+// replays the log and checks it against the newest samples of the walk.
+// The walk mixes one nibble deltas, byte deltas and jumps that force a
+// keyframe, so the ring wraps around, blocks are dropped and the keyframe
+// escape is decoded many times over.
+//
+//   cc -O2 -Wall -o flight_log_test flight_log_test.c && ./flight_log_test
+//
+// Prints PASS or FAIL lines like the testbenches and returns non-zero on failure.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "../software/code/flight_log.h"
+
+#define APPENDS 20000
+
+static int16_t history[APPENDS];
+
+static int32_t next_altitude(int32_t altitude){
+
+  int32_t r = rand() % 100;
+  int32_t delta;
+
+  if(r < 80)
+    delta = (rand() % 15) - 7;               // one nibble
+  else if(r < 97)
+    delta = (rand() % 255) - 127;            // escape and byte
+  else
+    delta = (rand() % 4001) - 2000;          // keyframe
+
+  altitude += delta;
+  if(altitude > 9000) altitude = 9000;
+  if(altitude < -500) altitude = -500;
+
+  return altitude;
+
+}
+
+int main(void){
+
+  flight_log log;
+  flight_log_cursor cursor;
+  int32_t altitude = 0, value = 0;
+  uint32_t i, n, wraps = 0, drops = 0, keys = 0, min_samples = APPENDS;
+  uint16_t head;
+  int errors = 0;
+
+  srand(1);
+  flight_log_clear(&log);
+
+  for(i = 0; i < APPENDS; i++){
+    uint32_t samples = log.samples;
+
+    altitude = next_altitude(altitude);
+    history[i] = (int16_t) altitude;
+
+    head = log.head;
+    flight_log_append(&log, altitude);
+
+    if(log.head < head) wraps++;
+    if(log.samples <= samples) drops++;
+    // a keyframe starts with the escape nibble followed by FLIGHT_LOG_KEY_MARK
+    if(flight_log_get(&log, &head) == FLIGHT_LOG_ESCAPE){
+      uint32_t mark = flight_log_get(&log, &head);
+      mark |= flight_log_get(&log, &head) << 4;
+      if(mark == FLIGHT_LOG_KEY_MARK) keys++;
+    }
+
+    if(log.samples == 0 || log.samples > i + 1){
+      if(errors++ < 10) printf("FAIL: %u samples held after append %u\n", log.samples, i);
+      continue;
+    }
+    if(i >= FLIGHT_LOG_NIBBLES && log.samples < min_samples)
+      min_samples = log.samples;
+
+    // the log must replay exactly the newest log.samples altitudes
+    flight_log_begin(&log, &cursor);
+    for(n = i + 1 - log.samples; n <= i; n++)
+      if(!flight_log_next(&log, &cursor, &value) || value != history[n]){
+        if(errors++ < 10) printf("FAIL: append %u, sample %u replayed as %d, expected %d\n", i, n, value, history[n]);
+        break;
+      }
+    if(n > i && flight_log_next(&log, &cursor, &value))
+      if(errors++ < 10) printf("FAIL: append %u, replay did not end after %u samples\n", i, log.samples);
+  }
+
+  printf("%u appends, %u wraps, %u drops, %u keyframes, at least %u samples held\n",
+         APPENDS, wraps, drops, keys, min_samples);
+
+  if(errors == 0)
+    printf("PASS: replay\n");
+  else
+    printf("FAIL: replay (%d errors)\n", errors);
+
+  if(wraps > 0 && drops > 0 && keys > APPENDS / FLIGHT_LOG_KEYFRAME)
+    printf("PASS: coverage\n");
+  else {
+    printf("FAIL: coverage\n");
+    errors++;
+  }
+
+  return (errors != 0);
+
+}
@@ -0,0 +1,122 @@
+///////////////////////////////////////////////////////////////////////
+//
+// hd44780_model module
+//
+//    behavioural model of the HD44780 based 1x8 character LCD for soc
+//    level testbenches (not synthesisable)
+//
+//    instructions and data are taken on the falling edge of E:
+//      RS=0 RnW=0  instruction: clear display (0x01), return home (0x02)
+//                  and set DDRAM address (0x80 | address), the others
+//                  are accepted and ignored
+//      RS=1 RnW=0  character written at the DDRAM address, which is then
+//                  incremented
+//      RS=0 RnW=1  busy flag and address are driven on DB while E is high
+//      RS=1 RnW=1  character at the DDRAM address is driven on DB
+//
+//    the controller is busy for 37us after an instruction or a character
+//    (1.52ms after clear display or return home)
+//
+//    text holds the 8 characters shown, refreshes counts the times the
+//    last character (address 7) has been written, refreshed is triggered
+//    each time, clears counts the clear display instructions and
+//    busy_writes the instructions and characters written while the
+//    controller was still busy
+//
+///////////////////////////////////////////////////////////////////////
+
+module hd44780_model(
+
+  input RS,
+  input RnW,
+  input E,
+  inout [7:0] DB
+
+);
+
+timeunit 1ns;
+timeprecision 100ps;
+
+  logic [7:0] ddram [0:79];
+  logic [6:0] address;
+  logic busy;
+  realtime busy_until;
+
+  logic [7:0] text [0:7];
+  int refreshes;
+  event refreshed;
+  int clears;
+  int busy_writes;
+
+  assign DB = ( E && RnW ) ? ( RS ? ddram[address] : { busy, address } ) : 'z;
+
+  always @(E, busy_until)
+    busy = ( $realtime < busy_until );
+
+  initial
+    begin
+      for ( int i = 0; i < 80; i++ )
+        ddram[i] = 8'h20;
+      for ( int i = 0; i < 8; i++ )
+        text[i] = 8'h20;
+      address = 0;
+      refreshes = 0;
+      clears = 0;
+      busy_writes = 0;
+      busy_until = 0;
+    end
+
+  // the characters shown as a string (for messages)
+  function string display();
+      display = "";
+      for ( int i = 0; i < 8; i++ )
+        display = { display, string'(text[i]) };
+  endfunction
+
+  always @(negedge E)
+    if ( ! RnW )
+      begin
+        // a write the controller is not ready for is lost by a real HD44780
+        if ( $realtime < busy_until )
+          busy_writes++;
+        if ( ! RS )
+          begin
+            if ( DB[7] )
+              begin
+                address = DB[6:0];
+                busy_until = $realtime + 37us;
+              end
+            else if ( DB == 8'h01 )
+              begin
+                for ( int i = 0; i < 80; i++ )
+                  ddram[i] = 8'h20;
+                for ( int i = 0; i < 8; i++ )
+                  text[i] = 8'h20;
+                address = 0;
+                clears++;
+                busy_until = $realtime + 1.52ms;
+              end
+            else if ( DB[7:1] == 7'b0000_001 )
+              begin
+                address = 0;
+                busy_until = $realtime + 1.52ms;
+              end
+            else
+              busy_until = $realtime + 37us;
+          end
+        else
+          begin
+            ddram[address] = DB;
+            if ( address < 8 )
+              text[address] = DB;
+            if ( address == 7 )
+              begin
+                refreshes++;
+                -> refreshed;
+              end
+            address = ( address == 79 ) ? 0 : address + 1;
+            busy_until = $realtime + 37us;
+          end
+      end
+
+endmodule
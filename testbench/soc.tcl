@@ -28,6 +28,11 @@ simvision {
     waveform  add  -signals  soc_stim.dut.HSEL_BUTTON
     waveform  add  -signals  soc_stim.dut.HSEL_LCD
     waveform  add  -signals  soc_stim.dut.HSEL_I2C
+    waveform  add  -signals  soc_stim.dut.HSEL_DMA
+    waveform  add  -signals  soc_stim.dut.HGRANT_DMA
+    waveform  add  -signals  soc_stim.dut.HSEL_COMP
+    waveform  add  -signals  soc_stim.dut.HSEL_TIMER
+    waveform  add  -signals  soc_stim.dut.HSEL_ALARM
 
 }
 
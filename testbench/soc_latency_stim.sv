@@ -0,0 +1,392 @@
+///////////////////////////////////////////////////////////////////////
+//
+// soc_latency_stim module
+//
+//    end to end benchmark of the SoC from the pressure sensor to the LCD,
+//    self checking, three parts:
+//
+//      sensor      bmp390_model replaying a pressure profile (the raw
+//                  pressure is found with the firmware compensation code,
+//                  bmp_comp_ref.c, so the firmware will see the profile)
+//
+//      lcd         hd44780_model decoding the characters written by the
+//                  SoC
+//
+//      scoreboard  checks each display refresh against the profile and
+//                  reports:
+//                    min/avg/max latency from a pressure step to the
+//                    correct pressure on the display (display mode 0)
+//                    display refresh rate (in display mode 0)
+//                    VSI settling time after the start of a constant
+//                    rate climb or descent (display mode 3)
+//
+//    the profile is a list of points, "<time_ms> <pressure_Pa> <mode>",
+//    with times from the first display, the pressure is linear between
+//    points and two points at the same time make a step, the mode
+//    button is pressed at each point to reach its display mode
+//    (+profile=<file> reads the points from a file, by default a series
+//    of steps is followed by a 30s climb at ~5.8m/s)
+//
+//    the results are appended to latency_benchmark.csv, labelled with
+//    +build=<name>, to compare firmware and hardware builds
+//
+//    bmp_comp_ref.c must be compiled with -fwrapv
+//    (e.g. xrun ... bmp_comp_ref.c -Wcc,-fwrapv)
+//
+///////////////////////////////////////////////////////////////////////
+
+module soc_latency_stim();
+
+timeunit 1ns;
+timeprecision 100ps;
+
+  // firmware compensation code (bmp_comp_ref.c)
+  import "DPI-C" function int unsigned bmp390_uncomp_ref(
+    input int unsigned calib0, input int unsigned calib1, input int unsigned calib2,
+    input int unsigned calib3, input int unsigned calib4, input int unsigned calib5,
+    input int unsigned uncomp_temp, input longint pressure_Pa);
+
+  // typical calibration (as bmp390_model)
+  localparam logic [5:0][31:0] calib = {32'h0000_00C9, 32'h063E_80FA, 32'h035D_5C5F, 32'hB402_12FF, 32'hF7FF_FEF9, 32'h4A92_6B8A};
+
+  localparam num_display_modes = 11;
+
+  // the displayed pressure must be correct within this time of a step
+  localparam step_timeout = 2s;
+
+  // the VSI has settled once it stays within this of the profile's rate (m/s)
+  localparam real vsi_tolerance = 0.5;
+
+  // sea level pressure used by the firmware (p0) and the standard atmosphere
+  localparam real p0 = 101325.0;
+
+  logic HRESETn, HCLK;
+  logic nMode, nTrip;
+
+  wire RS, RnW, E;
+  wire [7:0] DB;
+  wire [7:0] DB_out;
+  wire DB_oe;
+
+  wire SCL, SDA_out, SDA_in;
+
+  logic [23:0] uncomp_press, uncomp_temp;
+
+  soc dut(.HCLK, .HRESETn,
+          .nMode, .nTrip,
+          .RS, .RnW, .E, .DB_in(DB), .DB_out, .DB_oe,
+          .SCL, .SDA_out, .SDA_in);
+
+  bmp390_model #(.calib(calib)) sensor(.SCL, .SDA_out, .SDA_in, .uncomp_press, .uncomp_temp);
+
+  hd44780_model lcd(.RS, .RnW, .E, .DB);
+
+  // DB pad
+  assign DB = DB_oe ? DB_out : 'z;
+
+  always
+    begin
+                HCLK = 0;
+      #7.629us  HCLK = 1;
+      #15.528us HCLK = 0;
+      #7.629us  HCLK = 0;
+    end
+
+
+  //-------------------------
+  // pressure profile
+
+  typedef struct {
+    int time_ms;
+    int pressure_Pa;
+    int mode;
+  } profile_point;
+
+  profile_point profile[$];
+
+  realtime start_time;
+  logic replaying = 0;
+
+  task default_profile();
+      profile = '{
+        '{    0, 101250, 0 },
+        '{ 1000, 101250, 0 },
+        '{ 1000, 100050, 0 },     // 1012mb -> 1000mb
+        '{ 3000, 100050, 0 },
+        '{ 3000,  99550, 0 },     // 1000mb -> 995mb
+        '{ 5000,  99550, 0 },
+        '{ 5000, 101250, 0 },     // 995mb -> 1012mb
+        '{ 7000, 101250, 0 },
+        '{ 7000, 100650, 0 },     // 1012mb -> 1006mb
+        '{ 9000, 100650, 3 },
+        '{ 9000, 101250, 3 },     // VSI at rest
+        '{14000, 101250, 3 },
+        '{44000,  99150, 3 },     // 30s climb at -70Pa/s
+        '{48000,  99150, 3 }
+      };
+  endtask
+
+  task read_profile(input string file_name);
+      int fd, time_ms, pressure_Pa, mode;
+      fd = $fopen(file_name, "r");
+      if ( fd == 0 )
+        begin
+          $display( "ERROR: cannot open profile %s", file_name );
+          $stop;
+          $finish;
+        end
+      while ( $fscanf(fd, "%d %d %d", time_ms, pressure_Pa, mode) == 3 )
+        profile.push_back('{ time_ms, pressure_Pa, mode });
+      $fclose(fd);
+  endtask
+
+  // pressure at a time in the profile (the later point of a step)
+  function real pressure_at(input real time_ms);
+      int i;
+      if ( time_ms <= profile[0].time_ms )
+        return profile[0].pressure_Pa;
+      for ( i = 1; i < profile.size(); i++ )
+        if ( time_ms < profile[i].time_ms )
+          return profile[i-1].pressure_Pa + ( profile[i].pressure_Pa - profile[i-1].pressure_Pa ) *
+                 ( time_ms - profile[i-1].time_ms ) / ( profile[i].time_ms - profile[i-1].time_ms );
+      return profile[profile.size()-1].pressure_Pa;
+  endfunction
+
+  // raw pressure updated every millisecond
+  always #1ms
+    if ( replaying )
+      uncomp_press = bmp390_uncomp_ref(calib[0], calib[1], calib[2], calib[3], calib[4], calib[5],
+                                       uncomp_temp, longint'(pressure_at(( $realtime - start_time ) / 1ms)));
+
+
+  //-------------------------
+  // buttons
+
+  int display_mode = 0;
+
+  task press_mode();
+      nMode = 0;
+      #100ms
+      nMode = 1;
+      #200ms
+      display_mode = ( display_mode + 1 ) % num_display_modes;
+  endtask
+
+
+  //-------------------------
+  // scoreboard
+
+  // pressure steps
+  logic step_pending = 0;
+  int expected_mb;
+  realtime step_time;
+  int steps = 0, missed_steps = 0;
+  realtime latency, latency_min, latency_max, latency_sum;
+
+  // display refresh rate
+  int mode0_refreshes = 0;
+  realtime mode0_time = 0, refresh_time;
+
+  // VSI
+  logic ramp_active = 0;
+  real vsi_expected, vsi_shown;
+  realtime ramp_time, vsi_outside_time;
+  logic vsi_settled = 0, vsi_checked = 0;
+  realtime vsi_settling;
+
+  int errors = 0;
+
+  function automatic int digit(input logic [7:0] character);
+      if ( character >= "0" && character <= "9" )
+        return character - "0";
+      else
+        return 0;   // blank leading zero
+  endfunction
+
+  // pressure display "[ ][1][0][1][3][ ][m][b]"
+  function automatic int shown_mb();
+      return digit(lcd.text[1]) * 1000 + digit(lcd.text[2]) * 100 + digit(lcd.text[3]) * 10 + digit(lcd.text[4]);
+  endfunction
+
+  // VSI display "[+-][9][.][9][9][m][/][s]"
+  function automatic real shown_vsi();
+      real v;
+      v = digit(lcd.text[1]) + digit(lcd.text[3]) / 10.0 + digit(lcd.text[4]) / 100.0;
+      return ( lcd.text[0] == "-" ) ? -v : v;
+  endfunction
+
+  // vertical speed of a pressure ramp in the standard atmosphere (m/s, positive when climbing)
+  function automatic real ramp_vsi(input real pressure_Pa, input real rate_Pa_per_s);
+      return - rate_Pa_per_s * ( 288.15 / 0.0065 ) * 0.190263 * ( ( pressure_Pa / p0 ) ** ( 0.190263 - 1.0 ) ) / p0;
+  endfunction
+
+  always @(lcd.refreshed)
+    if ( replaying )
+      begin
+        if ( display_mode == 0 )
+          begin
+            if ( lcd.refreshes > 1 && lcd.text[6] == "m" )
+              begin
+                mode0_refreshes++;
+                mode0_time += $realtime - refresh_time;
+              end
+            if ( step_pending && lcd.text[6] == "m" && shown_mb() == expected_mb )
+              begin
+                latency = $realtime - step_time;
+                if ( steps == 0 || latency < latency_min ) latency_min = latency;
+                if ( steps == 0 || latency > latency_max ) latency_max = latency;
+                latency_sum += latency;
+                steps++;
+                step_pending = 0;
+                $display( "%t step to %0dmb shown after %t", step_time, expected_mb, latency );
+              end
+          end
+        if ( display_mode == 3 && ramp_active && lcd.text[5] == "m" )
+          begin
+            vsi_shown = shown_vsi();
+            if ( vsi_shown > vsi_expected + vsi_tolerance || vsi_shown < vsi_expected - vsi_tolerance )
+              vsi_outside_time = $realtime;
+          end
+        refresh_time = $realtime;
+      end
+
+  always @(lcd.refreshed)
+    if ( ! replaying )
+      refresh_time = $realtime;
+
+  // a step the display has not followed within step_timeout
+  always @(posedge step_pending)
+    begin
+      #step_timeout
+      if ( step_pending )
+        begin
+          $display( "FAIL: step at %t to %0dmb not shown (display \"%s\")", step_time, expected_mb, lcd.display() );
+          missed_steps++;
+          errors++;
+          step_pending = 0;
+        end
+    end
+
+  // the end of a ramp segment
+  task end_ramp();
+      if ( ramp_active )
+        begin
+          ramp_active = 0;
+          vsi_checked = 1;
+          vsi_settled = ( vsi_shown <= vsi_expected + vsi_tolerance && vsi_shown >= vsi_expected - vsi_tolerance );
+          vsi_settling = ( vsi_outside_time > ramp_time ) ? vsi_outside_time - ramp_time : 0;
+          if ( vsi_settled )
+            $display( "%t VSI %.2fm/s (%.2fm/s) settled after %t", ramp_time, vsi_shown, vsi_expected, vsi_settling );
+          else
+            begin
+              $display( "FAIL: VSI %.2fm/s did not settle to %.2fm/s +/- %.1f", vsi_shown, vsi_expected, vsi_tolerance );
+              errors++;
+            end
+        end
+  endtask
+
+
+  //-------------------------
+  // benchmark
+
+  string build, profile_file;
+  int fd;
+
+  initial
+    begin
+      $timeformat( -3, 3, " ms", 10 );
+
+      if ( ! $value$plusargs("build=%s", build) )
+        build = "default";
+      if ( $value$plusargs("profile=%s", profile_file) )
+        read_profile(profile_file);
+      else
+        default_profile();
+
+      nMode = 1;
+      nTrip = 1;
+      uncomp_temp = 24'h74_B1C0;
+      uncomp_press = bmp390_uncomp_ref(calib[0], calib[1], calib[2], calib[3], calib[4], calib[5],
+                                       uncomp_temp, profile[0].pressure_Pa);
+
+      HRESETn = 0;
+      #10ns HRESETn = 1;
+
+      wait ( lcd.refreshes > 0 );
+      $display( "First display: %t \"%s\"", $time, lcd.display() );
+
+      start_time = $realtime;
+      replaying = 1;
+
+      for ( int i = 0; i < profile.size(); i++ )
+        begin
+          if ( start_time + profile[i].time_ms * 1ms > $realtime )
+            #( start_time + profile[i].time_ms * 1ms - $realtime );
+
+          end_ramp();
+
+          while ( display_mode != profile[i].mode )
+            press_mode();
+
+          if ( i > 0 && profile[i].time_ms == profile[i-1].time_ms && profile[i].pressure_Pa != profile[i-1].pressure_Pa
+               && display_mode == 0 )
+            begin
+              if ( step_pending )
+                #step_timeout ;
+              step_time = $realtime;
+              expected_mb = profile[i].pressure_Pa / 100;
+              step_pending = 1;
+            end
+
+          if ( i + 1 < profile.size() && profile[i+1].time_ms > profile[i].time_ms
+               && profile[i+1].pressure_Pa != profile[i].pressure_Pa && display_mode == 3 )
+            begin
+              ramp_time = $realtime;
+              vsi_outside_time = $realtime;
+              vsi_expected = ramp_vsi(( profile[i].pressure_Pa + profile[i+1].pressure_Pa ) / 2.0,
+                                      ( profile[i+1].pressure_Pa - profile[i].pressure_Pa ) * 1000.0 /
+                                      ( profile[i+1].time_ms - profile[i].time_ms ));
+              ramp_active = 1;
+            end
+        end
+      end_ramp();
+
+      if ( step_pending )
+        #step_timeout ;
+
+      $display( "" );
+      $display( "Build %s", build );
+      if ( steps > 0 )
+        $display( "  step latency min %t avg %t max %t (%0d steps, %0d missed)",
+                  latency_min, latency_sum / steps, latency_max, steps, missed_steps );
+      if ( mode0_time > 0 )
+        $display( "  display refresh rate %.2fHz", mode0_refreshes / ( mode0_time / 1s ) );
+      if ( vsi_checked )
+        $display( "  VSI settling time %t", vsi_settling );
+
+      fd = $fopen("latency_benchmark.csv", "r");
+      if ( fd != 0 )
+        $fclose(fd);
+      else
+        begin
+          fd = $fopen("latency_benchmark.csv", "w");
+          $fdisplay( fd, "build,steps,missed_steps,latency_min_ms,latency_avg_ms,latency_max_ms,refresh_hz,vsi_settling_s,vsi_final,errors" );
+          $fclose(fd);
+        end
+      fd = $fopen("latency_benchmark.csv", "a");
+      $fdisplay( fd, "%s,%0d,%0d,%.3f,%.3f,%.3f,%.2f,%.3f,%.2f,%0d", build, steps, missed_steps,
+                 steps ? latency_min / 1ms : 0, steps ? latency_sum / steps / 1ms : 0, steps ? latency_max / 1ms : 0,
+                 mode0_time > 0 ? mode0_refreshes / ( mode0_time / 1s ) : 0,
+                 vsi_checked ? vsi_settling / 1s : 0, vsi_shown, errors );
+      $fclose(fd);
+
+      if ( errors == 0 )
+        $display( "PASS: latency benchmark" );
+      else
+        $display( "FAIL: latency benchmark (%0d errors)", errors );
+
+      $stop;
+      $finish;
+    end
+
+endmodule
@@ -0,0 +1,147 @@
+///////////////////////////////////////////////////////////////////////
+//
+// soc_power_stim module
+//
+//    switching activity of the SoC in scripted scenarios, for relative
+//    dynamic energy estimates (see activity_report.py)
+//
+//    the scenario is chosen with +scenario=<name>:
+//
+//      mode0 ~ mode3   idle in display mode 0 (pressure), 1 (altitude),
+//                      2 (trip timer) or 3 (vertical speed)
+//      init_pressure   idle in the sea level pressure initialisation
+//      init_altitude   idle in the altitude initialisation
+//      climb           altitude display while climbing at ~5m/s
+//
+//    after the first display the buttons are pressed to reach the
+//    scenario, then every signal of soc below the processor (the slaves,
+//    the interconnect, the arbiter and the bus) is dumped to
+//    soc_power_<name>.vcd for a window of one second
+//
+///////////////////////////////////////////////////////////////////////
+
+module soc_power_stim();
+
+timeunit 1ns;
+timeprecision 100ps;
+
+  localparam window = 1s;
+
+  // raw pressure change every 20ms (one sensor sample) while climbing,
+  // ~65 raw LSBs per Pa with the typical calibration, ~12Pa per metre
+  localparam climb_step = 78;
+
+  logic HRESETn, HCLK;
+  logic nMode, nTrip;
+
+  wire RS, RnW, E;
+  wire [7:0] DB;
+  wire [7:0] DB_out;
+  wire DB_oe;
+
+  wire SCL, SDA_out, SDA_in;
+
+  logic [23:0] uncomp_press, uncomp_temp;
+  logic climbing;
+
+  string scenario;
+
+  soc dut(.HCLK, .HRESETn,
+          .nMode, .nTrip,
+          .RS, .RnW, .E, .DB_in(DB), .DB_out, .DB_oe,
+          .SCL, .SDA_out, .SDA_in);
+
+  // DB pad (there is no LCD, reads see DB floating)
+  assign DB = DB_oe ? DB_out : 'z;
+
+  bmp390_model sensor(.SCL, .SDA_out, .SDA_in, .uncomp_press, .uncomp_temp);
+
+  always
+    begin
+                HCLK = 0;
+      #7.629us  HCLK = 1;
+      #15.528us HCLK = 0;
+      #7.629us  HCLK = 0;
+    end
+
+  // pressure falls (raw pressure rises) while climbing
+  always #20ms
+    if ( climbing )
+      uncomp_press = uncomp_press + climb_step;
+
+  // the first display refresh is complete once 8 characters have been written
+  int chars_written = 0;
+
+  always @(negedge E)
+    if ( RS && !RnW )
+      chars_written++;
+
+  // press (and release) the mode button, the trip button or both
+  task press(input mode, input trip);
+      nMode = !mode;
+      nTrip = !trip;
+      #100ms
+      nMode = 1;
+      nTrip = 1;
+      #200ms ;
+  endtask
+
+  initial
+    begin
+      $timeformat( -3, 3, " ms", 10 );
+
+      if ( ! $value$plusargs("scenario=%s", scenario) )
+        scenario = "mode0";
+
+      $dumpfile({"soc_power_", scenario, ".vcd"});
+      $dumpvars(0, dut);
+      $dumpoff;
+
+      nMode = 1;
+      nTrip = 1;
+      climbing = 0;
+      uncomp_press = 24'h63_2EA0;
+      uncomp_temp = 24'h74_B1C0;
+
+      HRESETn = 0;
+      #10ns HRESETn = 1;
+
+      wait ( chars_written >= 8 );
+      $display( "First display: %0t", $time );
+
+      case ( scenario )
+        "mode0" :         ;
+        "mode1" :         press(1, 0);
+        "mode2" :         repeat (2) press(1, 0);
+        "mode3" :         repeat (3) press(1, 0);
+        "init_pressure" : press(1, 1);
+        "init_altitude" : begin
+                            press(1, 0);
+                            press(1, 1);
+                          end
+        "climb" :         begin
+                            press(1, 0);
+                            climbing = 1;
+                          end
+        default :         begin
+                            $display( "ERROR: unknown scenario %s", scenario );
+                            $stop;
+                            $finish;
+                          end
+      endcase
+
+      // let the display catch up before measuring
+      #100ms
+
+      $display( "Scenario %s: dumping from %0t", scenario, $time );
+      $dumpon;
+      #window
+      $dumpoff;
+      $display( "Scenario %s: %0d characters written, %0d sensor bytes read",
+                scenario, chars_written, sensor.reads );
+
+      $stop;
+      $finish;
+    end
+
+endmodule
@@ -7,6 +7,8 @@ timeprecision 100ps;
   
   wire RS, RnW, E;
   wire [7:0] DB;
+  wire [7:0] DB_out;
+  wire DB_oe;
   
   wire SCL, SDA_out;
   logic SDA_in;
@@ -14,10 +16,13 @@ timeprecision 100ps;
   wire LOCKUP;
 
   soc dut(.HCLK, .HRESETn, 
-          .RS, .RnW, .E, .DB, 
+          .RS, .RnW, .E, .DB_in(DB), .DB_out, .DB_oe, 
           .SCL, .SDA_out, .SDA_in,
 	   .LOCKUP);
 
+  // DB pad (there is no LCD, reads see DB floating)
+  assign DB = DB_oe ? DB_out : 'z;
+
   always
     begin
                 HCLK = 0;
@@ -27,8 +32,21 @@ timeprecision 100ps;
     end
     
 
+  // report boot-to-first-display time
+  // (the first display refresh is complete once 8 characters have been written)
+  int chars_written = 0;
+  
+  always @(negedge E)
+    if ( RS && !RnW && ( chars_written < 8 ) )
+      begin
+        chars_written++;
+        if ( chars_written == 8 )
+          $display( "Boot to first display: %0t", $time );
+      end
+
   initial
     begin
+            $timeformat( -3, 3, " ms", 10 );
             SDA_in = 0;
             HRESETn = 0;
       #10ns HRESETn = 1;
@@ -0,0 +1,156 @@
+///////////////////////////////////////////////////////////////////////
+//
+// soc_warm_reset_stim module
+//
+//    self checking test of the warm restart, with bmp390_model as the
+//    sensor and hd44780_model as the LCD:
+//
+//      cold start   power on reset (HRESETn), the firmware configures
+//                   the sensor, reads its calibration and initialises
+//                   the LCD
+//
+//      warm reset   SYSRESETREQ (as when the firmware sets
+//                   AIRCR.SYSRESETREQ), the firmware must resume from
+//                   the retained state: the same pressure shown within
+//                   warm_timeout, no sensor writes and no LCD clear
+//
+//      lockup       the same for a processor lockup
+//
+//      reset        HRESETn again with the retained state still in RAM,
+//                   the peripherals have been reset so this must be a
+//                   cold start again
+//
+///////////////////////////////////////////////////////////////////////
+
+module soc_warm_reset_stim();
+
+timeunit 1ns;
+timeprecision 100ps;
+
+  // the display must be back within this time of a warm reset
+  localparam warm_timeout = 25ms;
+
+  logic HRESETn, HCLK;
+  logic nMode, nTrip;
+
+  wire RS, RnW, E;
+  wire [7:0] DB;
+  wire [7:0] DB_out;
+  wire DB_oe;
+
+  wire SCL, SDA_out, SDA_in;
+
+  logic [23:0] uncomp_press, uncomp_temp;
+
+  soc dut(.HCLK, .HRESETn,
+          .nMode, .nTrip,
+          .RS, .RnW, .E, .DB_in(DB), .DB_out, .DB_oe,
+          .SCL, .SDA_out, .SDA_in);
+
+  bmp390_model sensor(.SCL, .SDA_out, .SDA_in, .uncomp_press, .uncomp_temp);
+
+  hd44780_model lcd(.RS, .RnW, .E, .DB);
+
+  // DB pad
+  assign DB = DB_oe ? DB_out : 'z;
+
+  always
+    begin
+                HCLK = 0;
+      #7.629us  HCLK = 1;
+      #15.528us HCLK = 0;
+      #7.629us  HCLK = 0;
+    end
+
+  int errors = 0;
+  string shown;
+  realtime reset_time;
+
+  // wait for the first display after a reset and check how it started
+  task check_restart(input string name, input logic warm);
+      int writes, clears, refreshes;
+      writes = sensor.writes;
+      clears = lcd.clears;
+      refreshes = lcd.refreshes;
+      reset_time = $realtime;
+
+      fork
+        wait ( lcd.refreshes > refreshes );
+        #( warm ? warm_timeout : 1s );
+      join_any
+      disable fork;
+
+      if ( lcd.refreshes == refreshes )
+        begin
+          $display( "FAIL: %s, nothing displayed", name );
+          errors++;
+        end
+      else
+        begin
+          $display( "%s: display \"%s\" after %t (%0d sensor writes, %0d LCD clears)", name, lcd.display(),
+                    $realtime - reset_time, sensor.writes - writes, lcd.clears - clears );
+          if ( warm && ( sensor.writes != writes || lcd.clears != clears ) )
+            begin
+              $display( "FAIL: %s was not a warm restart", name );
+              errors++;
+            end
+          if ( ! warm && ( sensor.writes == writes || lcd.clears == clears ) )
+            begin
+              $display( "FAIL: %s was not a cold start", name );
+              errors++;
+            end
+          // the pressure is only shown as it was with the calibration restored
+          if ( shown != "" && lcd.display() != shown )
+            begin
+              $display( "FAIL: %s shows \"%s\" instead of \"%s\"", name, lcd.display(), shown );
+              errors++;
+            end
+        end
+  endtask
+
+  initial
+    begin
+      $timeformat( -3, 3, " ms", 10 );
+
+      nMode = 1;
+      nTrip = 1;
+      uncomp_temp = 24'h74_B1C0;
+      uncomp_press = 24'h63_2EA0;
+
+      HRESETn = 0;
+      #10ns HRESETn = 1;
+
+      shown = "";
+      check_restart("Cold start", 0);
+
+      // let the pressure settle and the retained state be saved
+      #1s shown = lcd.display();
+
+      force dut.SYSRESETREQ = 1;
+      @(posedge HCLK);
+      @(posedge HCLK);
+      release dut.SYSRESETREQ;
+      check_restart("Warm reset (SYSRESETREQ)", 1);
+
+      #1s ;
+      force dut.LOCKUP = 1;
+      @(posedge HCLK);
+      @(posedge HCLK);
+      release dut.LOCKUP;
+      check_restart("Warm reset (lockup)", 1);
+
+      #1s ;
+      HRESETn = 0;
+      #10ns HRESETn = 1;
+      check_restart("Power on reset", 0);
+
+      if ( errors == 0 )
+        $display( "PASS: warm restart" );
+      else
+        $display( "FAIL: warm restart (%0d errors)", errors );
+
+      $stop;
+      $finish;
+    end
+
+endmodule